@@ -13,6 +13,7 @@ from typing import Dict, Optional, Any
 from functools import wraps
 from itsdangerous import URLSafeTimedSerializer, BadSignature, SignatureExpired
 from object_storage import ObjectStorageService, ObjectNotFoundError, ObjectStorageError
+import firmware_encoding
 from models import db, Device, FirmwareVersion, User, Role, PlatformPermission, DownloadLog, DevEnvironment
 
 # Map device board types (as reported by firmware) to platform identifiers
@@ -731,7 +732,7 @@ with app.app_context():
     # Sync firmware from production on startup (dev environment only)
     sync_firmware_from_production()
 
-from mqtt_subscriber import start_mqtt_subscriber, stop_mqtt_subscriber, set_app_context
+from mqtt_subscriber import start_mqtt_subscriber, stop_mqtt_subscriber, set_app_context, get_live_heartbeats
 import atexit
 
 # Pass app context to MQTT subscriber for database operations
@@ -1231,6 +1232,80 @@ def user_download_partitions(token):
         response.headers['Access-Control-Allow-Headers'] = 'Content-Type'
         return response
 
+def firmware_bytes_response(firmware_data: bytes, filename: str, extra_headers: Optional[Dict[str, str]] = None) -> Response:
+    """Serve an in-memory firmware image, honouring a single byte Range.
+    
+    Devices resume interrupted OTA downloads with "Range: bytes=<offset>-";
+    send_file() already handles this for local files.
+    """
+    total = len(firmware_data)
+    headers = {
+        'Content-Disposition': f'attachment; filename="{filename}"',
+        'Accept-Ranges': 'bytes'
+    }
+    if extra_headers:
+        headers.update(extra_headers)
+    
+    byte_range = request.range
+    if byte_range is not None and byte_range.units == 'bytes' and len(byte_range.ranges) == 1:
+        span = byte_range.range_for_length(total)
+        if span is None:
+            return Response(status=416, headers={'Content-Range': f'bytes */{total}'})
+        
+        start, stop = span
+        headers['Content-Range'] = f'bytes {start}-{stop - 1}/{total}'
+        headers['Content-Length'] = str(stop - start)
+        print(f"[OTA] Resuming download at byte {start}/{total}")
+        return Response(firmware_data[start:stop], status=206, mimetype='application/octet-stream', headers=headers)
+    
+    headers['Content-Length'] = str(total)
+    return Response(firmware_data, mimetype='application/octet-stream', headers=headers)
+
+def load_firmware_data(version_info: dict) -> Optional[bytes]:
+    """Read a stored firmware image from Object Storage or the local directory"""
+    if version_info.get('storage', 'local') == 'object_storage':
+        try:
+            storage = ObjectStorageService()
+            object_path = version_info.get('object_path')
+            if not object_path:
+                object_path = f"/{storage.get_bucket_name()}/{version_info.get('object_name', get_firmwares_prefix() + version_info['filename'])}"
+            return storage.download_as_bytes(object_path)
+        except (ObjectStorageError, ObjectNotFoundError) as e:
+            print(f"Error downloading from Object Storage: {e}")
+    
+    firmware_path = Path(version_info.get('local_path', version_info['filename']))
+    if not firmware_path.is_absolute():
+        firmware_path = FIRMWARES_DIR / firmware_path
+    if firmware_path.exists():
+        return firmware_path.read_bytes()
+    return None
+
+def encoded_firmware_response(firmware_data: bytes, version_info: dict, product: str, platform: str) -> Response:
+    """Serve the smallest representation the device accepts (gzip or delta).
+    
+    X-Firmware-Encoding/-Size/-MD5 tell the device how to decode and verify.
+    A resuming device sends its X-Firmware-Encoding back so Range offsets
+    refer to the same byte stream.
+    """
+    accept = [e.strip() for e in request.args.get('accept', '').split(',') if e.strip()]
+    from_version = request.args.get('from')
+    pinned = request.headers.get('X-Firmware-Encoding') if request.range else None
+    
+    def load_base():
+        if not from_version or from_version == version_info.get('version'):
+            return None
+        base = FirmwareVersion.query.filter_by(product=product, platform=platform, version=from_version).first()
+        return load_firmware_data(base.to_dict()) if base else None
+    
+    encoding, payload = firmware_encoding.select_encoding(firmware_data, accept, load_base, pinned)
+    print(f"[OTA] Encoding: {encoding}, {len(payload)} of {len(firmware_data)} bytes (from={from_version or 'unknown'})")
+    
+    return firmware_bytes_response(payload, version_info['filename'], {
+        'X-Firmware-Encoding': encoding,
+        'X-Firmware-Size': str(len(firmware_data)),
+        'X-Firmware-MD5': hashlib.md5(firmware_data).hexdigest()
+    })
+
 @app.route('/api/firmware/<platform>')
 def download_firmware(platform):
     api_key = request.headers.get('X-API-Key')
@@ -1242,6 +1317,7 @@ def download_firmware(platform):
     product = request.args.get('product')
     env = request.args.get('env', 'prod')
     version = request.args.get('version')  # Specific version for pinned devices/rollback
+    wants_encoding = 'accept' in request.args  # Firmware that understands gzip/delta responses
     
     if not product:
         return jsonify({'error': 'Missing required parameter: product'}), 400
@@ -1254,6 +1330,9 @@ def download_firmware(platform):
             redirect_url = f"{dev_env.base_url}/api/firmware/{platform}?product={product}&env={env}"
             if version:
                 redirect_url += f"&version={version}"
+            for param in ('from', 'accept'):
+                if request.args.get(param):
+                    redirect_url += f"&{param}={request.args[param]}"
             print(f"[OTA] Redirecting dev device to: {redirect_url}")
             return redirect(redirect_url, code=302)
         else:
@@ -1306,14 +1385,9 @@ def download_firmware(platform):
             
             print(f"[OTA] Serving firmware: version={version_info.get('version')}, env={env}, path={object_path}, size={len(firmware_data)} bytes")
             
-            return Response(
-                firmware_data,
-                mimetype='application/octet-stream',
-                headers={
-                    'Content-Disposition': f'attachment; filename="{version_info["filename"]}"',
-                    'Content-Length': str(len(firmware_data))
-                }
-            )
+            if wants_encoding:
+                return encoded_firmware_response(firmware_data, version_info, product, platform)
+            return firmware_bytes_response(firmware_data, version_info['filename'])
         except (ObjectStorageError, ObjectNotFoundError) as e:
             error_msg = f"Error downloading from Object Storage"
             if object_path:
@@ -1342,6 +1416,9 @@ def download_firmware(platform):
         
         print(f"[OTA] Serving firmware from local: version={version_info.get('version')}, env={env}, path={firmware_path}")
         
+        if wants_encoding:
+            return encoded_firmware_response(firmware_path.read_bytes(), version_info, product, platform)
+        
         return send_file(
             firmware_path,
             mimetype='application/octet-stream',
@@ -1934,6 +2011,22 @@ def devices():
     all_devices = Device.query.filter(Device.deleted_at.is_(None)).all()
     device_list = [device.to_dict(online_threshold_minutes=15) for device in all_devices]
     
+    # Heartbeats are written in batches - show telemetry from the latest one received
+    live_heartbeats = get_live_heartbeats()
+    for d in device_list:
+        heartbeat = live_heartbeats.get(d['device_id'])
+        if heartbeat and heartbeat['received_at'] > datetime.fromisoformat(d['last_seen']):
+            payload = heartbeat['payload']
+            d.update(
+                last_seen=heartbeat['received_at'].isoformat(),
+                uptime=payload.get('uptime', 0),
+                rssi=payload.get('rssi', 0),
+                free_heap=payload.get('free_heap', 0),
+                ssid=payload.get('ssid'),
+                ip_address=payload.get('ip'),
+                minutes_since_last_seen=0.0
+            )
+    
     # Sort: online devices alphabetically by device_id, offline devices by last_seen (most recent first)
     online_devices = sorted([d for d in device_list if d['online']], key=lambda d: d['device_id'].lower())
     offline_devices = sorted([d for d in device_list if not d['online']], key=lambda d: d['last_seen'], reverse=True)
@@ -2070,6 +2163,61 @@ def request_snapshot(device_id):
             'error': 'Failed to send snapshot command (MQTT not connected)'
         }), 503
 
+@app.route('/api/devices/<device_id>/frame', methods=['POST'])
+@login_required
+def push_display_frame(device_id):
+    """Push a bitmap for a device to display via MQTT
+    
+    JSON body:
+    - bitmap: base64 frame buffer bytes (1 bit per pixel, a snapshot's row
+      'mono' bytes concatenated); omit or send an empty string to clear
+    - ttl: Seconds to hold the image (0 to 3600, 0 = device default)
+    """
+    import base64
+    import binascii
+    from mqtt_subscriber import publish_display_frame
+    
+    device = Device.query.filter_by(device_id=device_id).filter(Device.deleted_at.is_(None)).first()
+    if not device:
+        return jsonify({
+            'success': False,
+            'error': 'Device not found'
+        }), 404
+    
+    data = request.get_json(silent=True) or {}
+    
+    ttl = data.get('ttl', 0)
+    if isinstance(ttl, bool) or not isinstance(ttl, int) or ttl < 0 or ttl > 3600:
+        return jsonify({
+            'success': False,
+            'error': 'ttl must be a whole number between 0 and 3600'
+        }), 400
+    
+    try:
+        bitmap = base64.b64decode(data.get('bitmap') or '', validate=True)
+    except (binascii.Error, TypeError):
+        return jsonify({
+            'success': False,
+            'error': 'bitmap must be base64'
+        }), 400
+    
+    success = publish_display_frame(
+        device_id=device_id,
+        bitmap=bitmap,
+        ttl=ttl
+    )
+    
+    if success:
+        return jsonify({
+            'success': True,
+            'message': f'Display frame sent to {device_id}' if bitmap else f'Display frame cleared on {device_id}'
+        }), 200
+    else:
+        return jsonify({
+            'success': False,
+            'error': 'Failed to send display frame (MQTT not connected)'
+        }), 503
+
 @app.route('/api/devices/<device_id>/config', methods=['POST'])
 @login_required
 def set_device_config(device_id):
@@ -2077,6 +2225,8 @@ def set_device_config(device_id):
     
     JSON body can include:
     - temp_offset: Temperature calibration offset in degrees C (-20.0 to 20.0)
+    - brightness_day, brightness_night: Brightness caps (0 to 255)
+    - night_start, night_end: Local hours the night cap applies between (0 to 23)
     """
     from mqtt_subscriber import publish_config
     
@@ -2112,6 +2262,23 @@ def set_device_config(device_id):
                 'error': 'temp_offset must be a number'
             }), 400
     
+    for key, max_value in (('brightness_day', 255), ('brightness_night', 255),
+                           ('night_start', 23), ('night_end', 23)):
+        if key not in data:
+            continue
+        value = data[key]
+        if isinstance(value, bool) or not isinstance(value, int):
+            return jsonify({
+                'success': False,
+                'error': f'{key} must be a whole number'
+            }), 400
+        if value < 0 or value > max_value:
+            return jsonify({
+                'success': False,
+                'error': f'{key} must be between 0 and {max_value}'
+            }), 400
+        config_values[key] = value
+    
     if not config_values:
         return jsonify({
             'success': False,
@@ -2432,7 +2599,7 @@ def get_events():
     if event_type:
         if event_type == '__other__':
             known_event_types = [
-                'boot', 'device_info', 'heartbeat', 'low_heap_warning',
+                'boot', 'boot_stage', 'device_info', 'heartbeat', 'low_heap_warning',
                 'wifi_connect', 'wifi_disconnect', 'wifi_rssi_low', 'mqtt_connect', 'mqtt_disconnect',
                 'config_updated', 'config_error', 'config_noop',
                 'temperature_read', 'temperature_error', 'temp_sensor_not_found', 'temp_read_invalid', 'temp_read_crc_error',
@@ -2763,7 +2930,7 @@ def send_command():
     if not command_type:
         return jsonify({'error': 'command_type is required'}), 400
     
-    valid_commands = ['temp_offset', 'rollback', 'restart', 'snapshot', 'info']
+    valid_commands = ['temp_offset', 'rollback', 'restart', 'snapshot', 'info', 'marquee']
     if command_type not in valid_commands:
         return jsonify({'error': f'Invalid command_type. Must be one of: {valid_commands}'}), 400
     
@@ -2784,6 +2951,15 @@ def send_command():
         except (ValueError, TypeError):
             return jsonify({'error': 'temp_offset must be a number'}), 400
     
+    # Validate parameters for marquee (empty text stops the scrolling)
+    if command_type == 'marquee':
+        text = parameters.get('text', '')
+        if not isinstance(text, str) or len(text) > 31:
+            return jsonify({'error': 'text must be a string of at most 31 characters'}), 400
+        row = parameters.get('row', 1)
+        if not isinstance(row, int) or row < 0 or row > 1:
+            return jsonify({'error': 'row must be 0 or 1'}), 400
+    
     # Send command via MQTT using this dashboard's environment-scoped topic
     try:
         from mqtt_subscriber import get_mqtt_client
@@ -2800,18 +2976,19 @@ def send_command():
             topic = f"norrtek-iot/{env_scope}/config/{device_id}"
             payload = json.dumps({'temp_offset': parameters.get('temp_offset')})
             mqtt_client.publish(topic, payload, qos=0)
-        elif command_type == 'rollback':
+        elif command_type in ('rollback', 'restart', 'snapshot', 'info'):
+            # The firmware reads commands as {"command": "<name>", ...arguments}
             topic = f"norrtek-iot/{env_scope}/command/{device_id}"
-            mqtt_client.publish(topic, 'rollback', qos=0)
-        elif command_type == 'restart':
-            topic = f"norrtek-iot/{env_scope}/command/{device_id}"
-            mqtt_client.publish(topic, 'restart', qos=0)
-        elif command_type == 'snapshot':
-            topic = f"norrtek-iot/{env_scope}/command/{device_id}"
-            mqtt_client.publish(topic, 'snapshot', qos=0)
-        elif command_type == 'info':
+            payload = json.dumps({'command': command_type, **parameters})
+            mqtt_client.publish(topic, payload, qos=0)
+        elif command_type == 'marquee':
             topic = f"norrtek-iot/{env_scope}/command/{device_id}"
-            mqtt_client.publish(topic, 'info', qos=0)
+            payload = json.dumps({
+                'command': 'marquee',
+                'text': parameters.get('text', ''),
+                'row': parameters.get('row', 1)
+            })
+            mqtt_client.publish(topic, payload, qos=0)
         
         status = 'sent'
         error_message = None
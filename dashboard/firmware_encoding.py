@@ -0,0 +1,274 @@
+"""
+Compressed and delta representations of firmware images for OTA.
+
+Devices list the encodings they can apply (accept=gzip,delta) and the version
+they are running (from=...). The server derives the representations from the
+full images it already stores, so no extra CI artifacts are needed:
+
+- gzip:  gzip.compress() with a fixed header (mtime=0, no optional fields)
+- delta: SKD1 patch against the device's running image, built from bsdiff
+
+SKD1 format (little-endian, decoded by firmware ota_decoder.cpp):
+    b"SKD1" u32 new_size u32 old_size
+    then operations - a 1-byte opcode followed by a LEB128 varint:
+        0 END
+        1 COPY n      - n bytes of the old image at the cursor (cursor += n)
+        2 ADD n ...   - n patch bytes, each added (mod 256) to old[cursor++]
+        3 INSERT n ...- n literal bytes
+        4 SEEK z      - cursor += zigzag-decoded z
+
+Deltas take seconds to compute, longer than a device waits for a response,
+so they are built on a background thread and offered once ready. A resuming
+device names the encoding it started with and always gets that one back.
+"""
+
+import gzip
+import hashlib
+import struct
+import threading
+from collections import OrderedDict
+from typing import Callable, List, Optional, Tuple
+
+try:
+    import bsdiff4
+except ImportError:  # Delta updates are optional
+    bsdiff4 = None
+
+
+DELTA_MAGIC = b'SKD1'
+OP_END, OP_COPY, OP_ADD, OP_INSERT, OP_SEEK = range(5)
+
+# Image header bytes (flash mode/size) may be rewritten on the device, so the
+# first bytes are always sent literally rather than patched from the old image
+DELTA_LITERAL_PREFIX = 16
+
+# Zero runs in the bsdiff add block shorter than this stay inside ADD
+MIN_COPY_RUN = 8
+
+CACHE_SIZE = 8  # Encoded variants kept per (image, base) pair
+
+_cache: "OrderedDict[tuple, bytes]" = OrderedDict()
+_pending = set()
+_lock = threading.Lock()
+
+
+def delta_supported() -> bool:
+    return bsdiff4 is not None
+
+
+def _varint(value: int) -> bytes:
+    out = bytearray()
+    while True:
+        byte = value & 0x7F
+        value >>= 7
+        if value:
+            out.append(byte | 0x80)
+        else:
+            out.append(byte)
+            return bytes(out)
+
+
+def _zigzag(value: int) -> int:
+    return (value << 1) if value >= 0 else ((-value << 1) - 1)
+
+
+def _emit_add(out: bytearray, diff: bytes):
+    """ADD a slice of the bsdiff diff block, turning long zero runs into COPY"""
+    start = 0
+    length = len(diff)
+    i = 0
+    while i < length:
+        if diff[i] != 0:
+            i += 1
+            continue
+        run_end = i
+        while run_end < length and diff[run_end] == 0:
+            run_end += 1
+        if run_end - i >= MIN_COPY_RUN:
+            if i > start:
+                out += bytes([OP_ADD]) + _varint(i - start) + diff[start:i]
+            out += bytes([OP_COPY]) + _varint(run_end - i)
+            start = run_end
+        i = run_end
+    if length > start:
+        out += bytes([OP_ADD]) + _varint(length - start) + diff[start:]
+
+
+def build_delta(old: bytes, new: bytes) -> Optional[bytes]:
+    """SKD1 patch turning old into new, or None if bsdiff4 is unavailable"""
+    if bsdiff4 is None or len(new) <= DELTA_LITERAL_PREFIX or len(old) <= DELTA_LITERAL_PREFIX:
+        return None
+
+    prefix = DELTA_LITERAL_PREFIX
+    control, diff_block, extra_block = bsdiff4.core.diff(old[prefix:], new[prefix:])
+
+    out = bytearray(DELTA_MAGIC + struct.pack('<II', len(new), len(old)))
+    out += bytes([OP_INSERT]) + _varint(prefix) + new[:prefix]
+    out += bytes([OP_SEEK]) + _varint(_zigzag(prefix))
+
+    diff_pos = extra_pos = 0
+    for add_len, insert_len, seek in control:
+        if add_len:
+            _emit_add(out, diff_block[diff_pos:diff_pos + add_len])
+            diff_pos += add_len
+        if insert_len:
+            out += bytes([OP_INSERT]) + _varint(insert_len) + extra_block[extra_pos:extra_pos + insert_len]
+            extra_pos += insert_len
+        if seek:
+            out += bytes([OP_SEEK]) + _varint(_zigzag(seek))
+    out.append(OP_END)
+
+    delta = bytes(out)
+    if apply_delta(old, delta) != new:
+        raise ValueError('SKD1 round trip failed')
+    return delta
+
+
+def apply_delta(old: bytes, delta: bytes) -> bytes:
+    """Reference decoder - mirrors ota_decoder.cpp"""
+    if delta[:4] != DELTA_MAGIC:
+        raise ValueError('not an SKD1 delta')
+    new_size, old_size = struct.unpack_from('<II', delta, 4)
+    if old_size > len(old):
+        raise ValueError('delta base larger than old image')
+
+    pos = 12
+    cursor = 0
+    out = bytearray()
+
+    def read_varint():
+        nonlocal pos
+        value = shift = 0
+        while True:
+            byte = delta[pos]
+            pos += 1
+            value |= (byte & 0x7F) << shift
+            shift += 7
+            if not byte & 0x80:
+                return value
+
+    while True:
+        op = delta[pos]
+        pos += 1
+        if op == OP_END:
+            break
+        n = read_varint()
+        if op == OP_COPY:
+            out += old[cursor:cursor + n]
+            cursor += n
+        elif op == OP_ADD:
+            out += bytes((old[cursor + i] + delta[pos + i]) & 0xFF for i in range(n))
+            cursor += n
+            pos += n
+        elif op == OP_INSERT:
+            out += delta[pos:pos + n]
+            pos += n
+        elif op == OP_SEEK:
+            cursor += (n >> 1) ^ -(n & 1)
+        else:
+            raise ValueError(f'unknown SKD1 op {op}')
+
+    if len(out) != new_size:
+        raise ValueError('delta size mismatch')
+    return bytes(out)
+
+
+def build_gzip(image: bytes) -> bytes:
+    return gzip.compress(image, compresslevel=9, mtime=0)
+
+
+def _cache_get(key: tuple) -> Optional[bytes]:
+    with _lock:
+        if key in _cache:
+            _cache.move_to_end(key)
+            return _cache[key]
+    return None
+
+
+def _cache_put(key: tuple, value: bytes):
+    with _lock:
+        _cache[key] = value
+        _cache.move_to_end(key)
+        while len(_cache) > CACHE_SIZE:
+            _cache.popitem(last=False)
+
+
+def _delta_worker(key: tuple, old: bytes, new: bytes):
+    try:
+        delta = build_delta(old, new)
+        # b'' marks "tried, not useful" so we don't rebuild on every check
+        _cache_put(key, delta if delta is not None else b'')
+        if delta is not None:
+            print(f"[OTA] Delta ready: {len(delta)} bytes (image {len(new)} bytes)")
+    except Exception as e:
+        print(f"[OTA] Delta build failed: {e}")
+        _cache_put(key, b'')
+    finally:
+        with _lock:
+            _pending.discard(key)
+
+
+def _get_delta(new: bytes, new_md5: str, load_base: Callable[[], Optional[bytes]], wait: bool) -> Optional[bytes]:
+    if bsdiff4 is None:
+        return None
+
+    base = load_base()
+    if not base:
+        return None
+    key = ('delta', new_md5, hashlib.md5(base).hexdigest())
+
+    cached = _cache_get(key)
+    if cached is not None:
+        return cached or None
+
+    if wait:
+        _delta_worker(key, base, new)
+        return _cache_get(key) or None
+
+    with _lock:
+        if key in _pending:
+            return None
+        _pending.add(key)
+    threading.Thread(target=_delta_worker, args=(key, base, new), daemon=True).start()
+    return None
+
+
+def select_encoding(image: bytes, accept: List[str], load_base: Callable[[], Optional[bytes]],
+                    pinned: Optional[str] = None) -> Tuple[str, bytes]:
+    """Pick the representation to send.
+
+    accept: encodings the device can apply (besides identity)
+    load_base: returns the device's running image, or None if unknown
+    pinned: encoding a resuming device started with - must be served again
+
+    Returns (encoding, payload). Without a pin the smallest available
+    representation wins, so repeated requests get identical bytes.
+    """
+    image_md5 = hashlib.md5(image).hexdigest()
+
+    def gzip_variant():
+        key = ('gzip', image_md5)
+        data = _cache_get(key)
+        if data is None:
+            data = build_gzip(image)
+            _cache_put(key, data)
+        return data
+
+    if pinned:
+        if pinned == 'gzip':
+            return 'gzip', gzip_variant()
+        if pinned == 'delta':
+            delta = _get_delta(image, image_md5, load_base, wait=True)
+            if delta:
+                return 'delta', delta
+        return 'identity', image
+
+    candidates = [('identity', image)]
+    if 'gzip' in accept:
+        candidates.append(('gzip', gzip_variant()))
+    if 'delta' in accept:
+        delta = _get_delta(image, image_md5, load_base, wait=False)
+        if delta:
+            candidates.append(('delta', delta))
+
+    return min(candidates, key=lambda c: len(c[1]))
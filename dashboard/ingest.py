@@ -0,0 +1,391 @@
+"""
+Buffered database writes for the MQTT subscriber.
+
+Message handlers queue rows here instead of opening a transaction per
+message. A flusher thread writes whatever has accumulated in one transaction
+with bulk inserts, as soon as INGEST_BATCH_SIZE rows are waiting or every
+INGEST_FLUSH_SECONDS, whichever comes first.
+
+- Events and snapshots: every row is kept and bulk-inserted
+- Heartbeats: every one still lands in heartbeat_history (degraded-status
+  detection needs the gaps), but only the latest per device updates the
+  device row, gets a heartbeat row in the event feed and runs the follow-up
+  checks (OTA resolution, version offer).
+  The latest heartbeat per device also stays in memory for the live view.
+- Display: only the latest snapshot per device is written to the device row
+
+Rows for devices that aren't registered yet are dropped at flush, the same
+rule the per-message handlers used to apply.
+
+If the batch transaction fails it is written again with every insert and
+device update in its own savepoint, so only rows the database rejects are
+dropped. If that fails too (database unreachable) the batch goes back in the
+buffer, up to INGEST_MAX_QUEUED_ROWS, and the flusher backs off.
+"""
+
+import os
+import threading
+import time
+from datetime import datetime, timezone, timedelta
+from typing import Callable, Dict, List, Optional
+
+from sqlalchemy import insert
+
+INGEST_BATCH_SIZE = int(os.getenv('INGEST_BATCH_SIZE', '500'))
+INGEST_FLUSH_SECONDS = float(os.getenv('INGEST_FLUSH_SECONDS', '2.0'))
+INGEST_MAX_QUEUED_ROWS = int(os.getenv('INGEST_MAX_QUEUED_ROWS', '20000'))
+INGEST_MAX_BACKOFF_SECONDS = 60.0
+HEARTBEAT_RETENTION = timedelta(hours=24)
+HEARTBEAT_CLEANUP_SECONDS = 600
+
+
+class IngestBuffer:
+    """Collects rows from MQTT handlers and writes them in batches"""
+
+    def __init__(self, app, on_heartbeat: Optional[Callable] = None,
+                 batch_size: int = INGEST_BATCH_SIZE, flush_seconds: float = INGEST_FLUSH_SECONDS,
+                 max_queued_rows: int = INGEST_MAX_QUEUED_ROWS):
+        """on_heartbeat(device, heartbeat) runs after each flush for every
+        device that sent a heartbeat, inside the flush's app context"""
+        self._app = app
+        self._on_heartbeat = on_heartbeat
+        self._batch_size = batch_size
+        self._flush_seconds = flush_seconds
+        self._max_queued_rows = max_queued_rows
+        self._failures = 0  # Flushes in a row that had to put their batch back
+
+        self._lock = threading.Lock()
+        self._flush_lock = threading.Lock()  # One flush at a time (thread or stop())
+        self._wake = threading.Event()
+        self._stop = threading.Event()
+        self._thread: Optional[threading.Thread] = None
+        self._last_cleanup = 0.0
+
+        self._events: List[dict] = []
+        self._heartbeat_rows: List[dict] = []
+        self._snapshot_rows: List[dict] = []
+        self._pending_heartbeats: Dict[str, dict] = {}  # Latest since the last flush
+        self._pending_displays: Dict[str, dict] = {}    # Latest device.display_snapshot
+        self._registrations: Dict[str, dict] = {}       # product/board for unknown devices
+        self._live_heartbeats: Dict[str, dict] = {}     # Latest ever, for the live view
+
+    # ------------------------------------------------------------------
+    # Producer side (MQTT thread)
+    # ------------------------------------------------------------------
+
+    def _queued(self) -> int:
+        return len(self._events) + len(self._heartbeat_rows) + len(self._snapshot_rows)
+
+    def _added(self):
+        # While backing off, a full batch waits for the retry like the rest
+        if self._failures == 0 and self._queued() >= self._batch_size:
+            self._wake.set()
+
+    def add_events(self, device_id: str, events, topic: str, raw_payload: Optional[str] = None,
+                   product: Optional[str] = None, board_type: Optional[str] = None):
+        """Queue (event_type, event_data, event_time, time_source) tuples"""
+        with self._lock:
+            for event_type, event_data, event_time, _ in events:
+                self._events.append({
+                    'device_id': device_id,
+                    'event_type': event_type,
+                    'event_data': event_data,
+                    'timestamp': event_time,
+                    'mqtt_topic': topic,
+                    'mqtt_payload': raw_payload,
+                })
+            if product:
+                self._registrations.setdefault(device_id, {'product': product, 'board_type': board_type})
+            self._added()
+
+    def add_heartbeat(self, device_id: str, environment: str, payload: dict):
+        """Queue a heartbeat (history row now, device update at flush)"""
+        now = datetime.now(timezone.utc)
+        heartbeat = {'environment': environment, 'payload': payload, 'received_at': now}
+        with self._lock:
+            self._heartbeat_rows.append({
+                'device_id': device_id,
+                'timestamp': now,
+                'rssi': payload.get('rssi'),
+                'uptime': payload.get('uptime'),
+                'free_heap': payload.get('free_heap'),
+            })
+            self._pending_heartbeats[device_id] = heartbeat
+            self._live_heartbeats[device_id] = heartbeat
+            self._added()
+
+    def add_snapshot(self, device_id: str, snapshot_data: dict, row_text, bitmap_data: dict,
+                     timestamp: datetime, history: bool = True):
+        """Set the device's current display; history=True also keeps a display_snapshots row"""
+        with self._lock:
+            self._pending_displays[device_id] = snapshot_data
+            if history:
+                self._snapshot_rows.append({
+                    'device_id': device_id,
+                    'row_text': row_text,
+                    'bitmap_data': bitmap_data,
+                    'timestamp': timestamp,
+                })
+            self._added()
+
+    def live_heartbeat(self, device_id: str) -> Optional[dict]:
+        """Latest heartbeat received from a device (may not be flushed yet)"""
+        with self._lock:
+            return self._live_heartbeats.get(device_id)
+
+    def live_heartbeats(self) -> Dict[str, dict]:
+        with self._lock:
+            return dict(self._live_heartbeats)
+
+    # ------------------------------------------------------------------
+    # Flusher
+    # ------------------------------------------------------------------
+
+    def start(self):
+        if self._thread is not None:
+            return
+        self._stop.clear()
+        self._thread = threading.Thread(target=self._run, daemon=True, name="IngestFlusher")
+        self._thread.start()
+
+    def stop(self):
+        """Stop the flusher and write whatever is still queued"""
+        self._stop.set()
+        self._wake.set()
+        if self._thread is not None:
+            self._thread.join(timeout=10)
+            self._thread = None
+        self.flush()
+
+    def _retry_delay(self) -> float:
+        with self._lock:
+            failures = self._failures
+        if failures == 0:
+            return self._flush_seconds
+        return min(self._flush_seconds * 2 ** failures, INGEST_MAX_BACKOFF_SECONDS)
+
+    def _run(self):
+        while not self._stop.is_set():
+            self._wake.wait(self._retry_delay())
+            self._wake.clear()
+            if not self._stop.is_set():
+                self.flush()
+
+    def _take(self):
+        with self._lock:
+            taken = (self._events, self._heartbeat_rows, self._snapshot_rows,
+                     self._pending_heartbeats, self._pending_displays, self._registrations)
+            self._events, self._heartbeat_rows, self._snapshot_rows = [], [], []
+            self._pending_heartbeats, self._pending_displays, self._registrations = {}, {}, {}
+        return taken
+
+    def _requeue(self, batch) -> int:
+        """Put a batch that couldn't be written back ahead of newer rows; the
+        oldest history rows beyond max_queued_rows go. Returns rows dropped"""
+        events, heartbeat_rows, snapshot_rows, heartbeats, displays, registrations = batch
+        with self._lock:
+            self._events = events + self._events
+            self._heartbeat_rows = heartbeat_rows + self._heartbeat_rows
+            self._snapshot_rows = snapshot_rows + self._snapshot_rows
+            # Anything that arrived since the take is newer and wins
+            self._pending_heartbeats = {**heartbeats, **self._pending_heartbeats}
+            self._pending_displays = {**displays, **self._pending_displays}
+            self._registrations = {**registrations, **self._registrations}
+
+            # Display history goes first, then heartbeat history; events are kept longest
+            dropped = 0
+            for rows in (self._snapshot_rows, self._heartbeat_rows, self._events):
+                overflow = self._queued() - self._max_queued_rows
+                if overflow <= 0:
+                    break
+                count = min(overflow, len(rows))
+                del rows[:count]
+                dropped += count
+            self._failures += 1
+        return dropped
+
+    def flush(self):
+        """Write everything queued so far in one transaction, row by row if
+        that fails, or put it back for a later retry if that fails too"""
+        with self._flush_lock:
+            batch = self._take()
+            events, heartbeat_rows, snapshot_rows, heartbeats, displays, registrations = batch
+            if not (events or heartbeat_rows or snapshot_rows or displays):
+                return
+
+            from models import db
+
+            started = time.monotonic()
+            with self._app.app_context():
+                try:
+                    devices, written, dropped = self._write(batch, per_row=False)
+                except Exception as e:
+                    db.session.rollback()
+                    print(f"✗ Ingest flush failed, writing row by row: {e}")
+                    try:
+                        devices, written, dropped = self._write(batch, per_row=True)
+                    except Exception as e:
+                        db.session.rollback()
+                        queued = len(events) + len(heartbeat_rows) + len(snapshot_rows)
+                        lost = self._requeue(batch)
+                        print(f"✗ Ingest flush failed again, {queued} rows kept for retry in "
+                              f"{self._retry_delay():.0f} s ({lost} oldest dropped): {e}")
+                        return
+
+                with self._lock:
+                    self._failures = 0
+
+                elapsed_ms = (time.monotonic() - started) * 1000
+                dropped_note = f", {dropped} rejected" if dropped else ""
+                print(f"💾 Ingest flush: {written[0]} events, {written[1]} heartbeats, "
+                      f"{written[2]} snapshots, {len(devices)} devices{dropped_note} ({elapsed_ms:.0f} ms)")
+
+                if self._on_heartbeat:
+                    for device_id, heartbeat in heartbeats.items():
+                        device = devices.get(device_id)
+                        if not device:
+                            continue
+                        try:
+                            self._on_heartbeat(device, heartbeat)
+                        except Exception as e:
+                            db.session.rollback()
+                            print(f"✗ Heartbeat follow-up failed for {device_id}: {e}")
+
+    def _write(self, batch, per_row: bool):
+        """Apply a batch and commit it. With per_row every insert and device
+        update gets its own savepoint, and the ones the database rejects are
+        skipped. Returns (devices, rows written per table, changes skipped)"""
+        events, heartbeat_rows, snapshot_rows, heartbeats, displays, registrations = batch
+        from models import Device, EventLog, HeartbeatHistory, DisplaySnapshot, db
+
+        device_ids = ({r['device_id'] for r in events} | {r['device_id'] for r in heartbeat_rows}
+                      | {r['device_id'] for r in snapshot_rows} | set(displays))
+        devices = {d.device_id: d for d in
+                   Device.query.filter(Device.device_id.in_(device_ids)).all()}
+
+        self._register_devices(devices, device_ids, registrations, heartbeats, Device, db, per_row)
+
+        now = datetime.now(timezone.utc)
+        events = list(events)  # The batch stays as taken, in case it is written again
+        dropped = 0
+        for device_id, heartbeat in heartbeats.items():
+            device = devices.get(device_id)
+            if device and not self._isolated(db, per_row, f"heartbeat update for {device_id}",
+                                             lambda: events.append(self._apply_heartbeat(device, heartbeat))):
+                dropped += 1
+        for device_id, snapshot_data in displays.items():
+            device = devices.get(device_id)
+            if device and not self._isolated(db, per_row, f"display update for {device_id}",
+                                             lambda: self._apply_display(device, snapshot_data, now)):
+                dropped += 1
+
+        written = []
+        for model, rows in ((EventLog, events), (HeartbeatHistory, heartbeat_rows),
+                            (DisplaySnapshot, snapshot_rows)):
+            rows = [r for r in rows if r['device_id'] in devices]
+            if rows and not per_row:
+                db.session.execute(insert(model), rows)
+            elif rows:
+                kept = [r for r in rows if self._isolated(
+                    db, True, f"{model.__tablename__} row from {r['device_id']}",
+                    lambda: db.session.execute(insert(model), [r]))]
+                dropped += len(rows) - len(kept)
+                rows = kept
+            written.append(len(rows))
+
+        if time.monotonic() - self._last_cleanup > HEARTBEAT_CLEANUP_SECONDS:
+            self._last_cleanup = time.monotonic()
+            HeartbeatHistory.query.filter(
+                HeartbeatHistory.timestamp < now - HEARTBEAT_RETENTION
+            ).delete(synchronize_session=False)
+
+        db.session.commit()
+        return devices, written, dropped
+
+    @staticmethod
+    def _isolated(db, per_row: bool, what: str, apply: Callable) -> bool:
+        """Run apply(); with per_row inside a savepoint, so a change the
+        database rejects is rolled back and skipped (False) on its own"""
+        if not per_row:
+            apply()
+            return True
+        try:
+            with db.session.begin_nested():
+                apply()
+            return True
+        except Exception as e:
+            print(f"✗ Ingest skipped {what}: {e}")
+            return False
+
+    def _register_devices(self, devices, device_ids, registrations, heartbeats, Device, db, per_row: bool):
+        """Create devices first seen in this batch, when their messages carried enough info"""
+        created = False
+        for device_id in device_ids - set(devices):
+            payload = heartbeats.get(device_id, {}).get('payload', {})
+            if payload.get('product') and payload.get('board'):
+                # Legacy heartbeat with full device info
+                device = Device(device_id=device_id, product=payload['product'], board_type=payload['board'],
+                                firmware_version=payload.get('version') or 'Unknown')
+                print(f"✨ New device registered: {device_id} ({payload['product']}/{payload['board']}, "
+                      f"env={heartbeats[device_id]['environment']})")
+            elif device_id in registrations:
+                info = registrations[device_id]
+                device = Device(device_id=device_id, product=info['product'],
+                                board_type=info['board_type'] or 'Unknown', firmware_version='Unknown')
+                print(f"✨ New device registered via event: {device_id} ({info['product']})")
+            else:
+                if device_id in heartbeats:
+                    print(f"⚠ Heartbeat from unknown device {device_id} - waiting for device info")
+                else:
+                    print(f"⚠ Dropping data from unknown device {device_id} - no product to register it with")
+                continue
+            if not self._isolated(db, per_row, f"registration of {device_id}", lambda: db.session.add(device)):
+                continue
+            devices[device_id] = device
+            created = True
+        if created:
+            db.session.flush()  # Rows below reference the new device_ids
+
+    @staticmethod
+    def _apply_display(device, snapshot_data: dict, now: datetime):
+        device.display_snapshot = snapshot_data
+        device.last_seen = now
+
+    @staticmethod
+    def _apply_heartbeat(device, heartbeat) -> dict:
+        """Update the device row from its latest heartbeat; returns the heartbeat event row"""
+        payload = heartbeat['payload']
+        if device.deleted_at:
+            # Device was deleted but is still running - user probably wants it back
+            print(f"🔄 Restoring soft-deleted device: {device.device_id}")
+            device.deleted_at = None
+
+        device.last_seen = heartbeat['received_at']
+        device.last_uptime = payload.get('uptime', 0)
+        device.last_rssi = payload.get('rssi', 0)
+        device.last_free_heap = payload.get('free_heap', 0)
+        device.ssid = payload.get('ssid')
+        device.ip_address = payload.get('ip')
+
+        # Legacy format: static fields in the heartbeat
+        if payload.get('board'):
+            device.board_type = payload['board']
+        if payload.get('version'):
+            device.firmware_version = payload['version']
+        if payload.get('product'):
+            device.product = payload['product']
+
+        return {
+            'device_id': device.device_id,
+            'event_type': 'heartbeat',
+            'event_data': {
+                'version': device.firmware_version,
+                'rssi': payload.get('rssi'),
+                'uptime': payload.get('uptime'),
+                'free_heap': payload.get('free_heap'),
+                'ssid': payload.get('ssid'),
+            },
+            'timestamp': heartbeat['received_at'],
+            'mqtt_topic': None,
+            'mqtt_payload': None,
+        }
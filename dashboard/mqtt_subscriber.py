@@ -6,9 +6,13 @@ import threading
 import uuid
 import ipaddress
 import base64
-from datetime import datetime, timezone
+import struct
+from datetime import datetime, timezone, timedelta
 from typing import Dict, Any, Optional, TYPE_CHECKING
 
+from ingest import IngestBuffer
+from wire_format import decode_event_batch, decode_display_delta, DisplayMirror
+
 if TYPE_CHECKING:
     from flask import Flask
 
@@ -69,6 +73,7 @@ MQTT_TOPIC_OTA_COMPLETE = lambda: build_topic("ota/complete")
 MQTT_TOPIC_COMMAND = lambda: build_topic("command")
 MQTT_TOPIC_CONFIG = lambda: build_topic("config")
 MQTT_TOPIC_DISPLAY_SNAPSHOT = lambda: build_topic("display/snapshot")
+MQTT_TOPIC_DISPLAY_DELTA = lambda: build_topic("display/delta")
 MQTT_TOPIC_EVENTS = lambda: build_topic("event")
 
 # Store Flask app instance for database access
@@ -79,6 +84,12 @@ _mqtt_client = None
 _shutdown_event = None
 # Unique subscriber ID for tracking which thread is sending messages
 _subscriber_id = None
+# Batched database writes (see ingest.py)
+_ingest: Optional[IngestBuffer] = None
+# Display mirror state per device, and the last snapshot rows (text/cols/color)
+# that mirrored frames are merged into - only touched from the MQTT thread
+_display_mirrors: Dict[str, DisplayMirror] = {}
+_display_rows: Dict[str, list] = {}
 
 # Map device board types (as reported by firmware) to platform identifiers
 # This ensures all board names resolve correctly to their firmware cache keys
@@ -135,6 +146,7 @@ def on_connect(client, userdata, flags, rc, properties=None):
         client.unsubscribe(f"{MQTT_TOPIC_PREFIX}/{other_env}/ota/progress/+")
         client.unsubscribe(f"{MQTT_TOPIC_PREFIX}/{other_env}/ota/complete/+")
         client.unsubscribe(f"{MQTT_TOPIC_PREFIX}/{other_env}/display/snapshot/#")
+        client.unsubscribe(f"{MQTT_TOPIC_PREFIX}/{other_env}/display/delta/+")
         client.unsubscribe(f"{MQTT_TOPIC_PREFIX}/{other_env}/event/#")
         # NOTE: Do NOT unsubscribe from broad wildcards like norrtek-iot/#
         # Those patterns match the current environment too, wiping out valid subscriptions
@@ -143,7 +155,7 @@ def on_connect(client, userdata, flags, rc, properties=None):
         # Subscribe ONLY to this dashboard's environment topics
         # Dev dashboard sees only dev devices, prod dashboard sees only prod devices
         # QoS levels:
-        #   - Heartbeats: QoS 0 (fire-and-forget, only latest matters)
+        #   - Heartbeats and display mirror deltas: QoS 0 (only latest matters)
         #   - Everything else: QoS 1 (guaranteed delivery, queued when offline)
         client.subscribe(f"{MQTT_TOPIC_PREFIX}/{env}/heartbeat/+", qos=0)
         print(f"✓ Subscribed to topic: {MQTT_TOPIC_PREFIX}/{env}/heartbeat/+ (QoS 0)")
@@ -157,6 +169,8 @@ def on_connect(client, userdata, flags, rc, properties=None):
         print(f"✓ Subscribed to topic: {MQTT_TOPIC_PREFIX}/{env}/ota/complete/+ (QoS 1)")
         client.subscribe(f"{MQTT_TOPIC_PREFIX}/{env}/display/snapshot/#", qos=1)
         print(f"✓ Subscribed to topic: {MQTT_TOPIC_PREFIX}/{env}/display/snapshot/# (QoS 1)")
+        client.subscribe(f"{MQTT_TOPIC_PREFIX}/{env}/display/delta/+", qos=0)
+        print(f"✓ Subscribed to topic: {MQTT_TOPIC_PREFIX}/{env}/display/delta/+ (QoS 0)")
         client.subscribe(f"{MQTT_TOPIC_PREFIX}/{env}/event/#", qos=1)
         print(f"✓ Subscribed to topic: {MQTT_TOPIC_PREFIX}/{env}/event/# (QoS 1)")
     else:
@@ -172,6 +186,10 @@ def handle_heartbeat(client, payload, topic):
     
     Legacy format (backwards compatible) may also include:
     - product, board, version (now handled by device_info topic)
+    
+    The heartbeat is queued for the ingest flush, which writes the history
+    row, updates the device from its latest heartbeat and then runs
+    process_heartbeat() for it.
     """
     # Extract device_id and environment from topic (format: norrtek-iot/{env}/heartbeat/{device_id})
     topic_parts = topic.split('/')
@@ -187,221 +205,143 @@ def handle_heartbeat(client, payload, topic):
         print(f"⚠ Rejecting heartbeat with invalid environment in topic: {environment}")
         return
     
-    # Legacy format: product, board, version in heartbeat payload
-    # New format: these fields come from info topic instead
-    board_type = payload.get('board')
-    current_version = payload.get('version')
-    product = payload.get('product')
+    if device_id and _ingest:
+        payload['ip'] = validate_ip_address(payload.get('ip'))
+        _ingest.add_heartbeat(device_id, environment, payload)
     
-    if device_id and _app_context:
-        from models import Device, HeartbeatHistory, EventLog, db
+    print(f"📡 Heartbeat from {topic}: uptime={payload.get('uptime')}s, RSSI={payload.get('rssi')}dBm")
+
+def process_heartbeat(device, heartbeat):
+    """Follow-up checks for a device's latest heartbeat (run by the ingest flush)
+    
+    Resolves stuck OTA updates from the reported version and offers firmware
+    updates. Runs in the flush's app context, after the heartbeat itself has
+    been committed, so the device row already holds the latest telemetry.
+    """
+    from models import db
+    
+    client = _mqtt_client
+    device_id = device.device_id
+    environment = heartbeat['environment']
+    effective_product = device.product
+    effective_board = device.board_type
+    effective_version = device.firmware_version
+    
+    # Check for stuck OTA updates and resolve ALL of them based on version
+    from models import OTAUpdateLog
+    stuck_otas = OTAUpdateLog.query.filter(
+        OTAUpdateLog.device_id == device_id,
+        OTAUpdateLog.status.in_(['started', 'downloading'])
+    ).order_by(OTAUpdateLog.started_at.desc()).all()
+    
+    if stuck_otas and effective_version:
+        # Normalize current version once
+        normalized_current = effective_version.lstrip('vV')
+        now = datetime.now(timezone.utc)
+        # Timeout threshold: 5 minutes of inactivity
+        timeout_threshold = now - timedelta(minutes=5)
+        resolved_count = 0
         
-        with _app_context.app_context():
-            device = Device.query.filter_by(device_id=device_id).first()
+        for stuck_ota in stuck_otas:
+            # Normalize target version for comparison
+            normalized_target = stuck_ota.new_version.lstrip('vV')
             
-            if device:
-                # Auto-restore soft-deleted devices that send heartbeats
-                # (device was deleted but is still running - user probably wants it back)
-                if device.deleted_at:
-                    print(f"🔄 Restoring soft-deleted device: {device_id}")
-                    device.deleted_at = None
-                
-                # Update existing device telemetry
-                device.last_seen = datetime.now(timezone.utc)
-                device.last_uptime = payload.get('uptime', 0)
-                device.last_rssi = payload.get('rssi', 0)
-                device.last_free_heap = payload.get('free_heap', 0)
-                device.ssid = payload.get('ssid')
-                device.ip_address = validate_ip_address(payload.get('ip'))
-                
-                # Legacy format: update static fields if present in payload
-                if board_type:
-                    device.board_type = board_type
-                if current_version:
-                    device.firmware_version = current_version
-                if product:
-                    device.product = product
+            if normalized_current == normalized_target:
+                # Success: device is now running the target version
+                stuck_ota.status = 'success'
+                stuck_ota.completed_at = now
+                stuck_ota.download_progress = 100
+                print(f"✅ OTA resolved via heartbeat (success): {device_id} ({stuck_ota.old_version} → {stuck_ota.new_version})")
+                resolved_count += 1
             else:
-                # Device not found - check if we have enough info to create it
-                if product and board_type:
-                    # Legacy format: create device with full info from heartbeat
-                    device = Device(
-                        device_id=device_id,
-                        product=product,
-                        board_type=board_type,
-                        firmware_version=current_version or 'Unknown',
-                        last_uptime=payload.get('uptime', 0),
-                        last_rssi=payload.get('rssi', 0),
-                        last_free_heap=payload.get('free_heap', 0),
-                        ssid=payload.get('ssid'),
-                        ip_address=validate_ip_address(payload.get('ip'))
-                    )
-                    db.session.add(device)
-                    db.session.flush()
-                    print(f"✨ New device registered: {device_id} ({product}/{board_type}, env={environment})")
-                else:
-                    # New format: device must first send info message before heartbeat is processed
-                    print(f"⚠ Heartbeat from unknown device {device_id} (env={environment}) - waiting for device info")
-                    return
-            
-            # Use device's stored values for static fields if not in payload (new format)
-            effective_product = product or device.product
-            effective_board = board_type or device.board_type
-            effective_version = current_version or device.firmware_version
-            
-            # Log heartbeat to history (for degraded status detection)
-            heartbeat_log = HeartbeatHistory(
-                device_id=device_id,
-                timestamp=datetime.now(timezone.utc),
-                rssi=payload.get('rssi'),
-                uptime=payload.get('uptime'),
-                free_heap=payload.get('free_heap')
-            )
-            db.session.add(heartbeat_log)
-            
-            # Log heartbeat as event for dashboard events feed
-            heartbeat_event = EventLog(
-                device_id=device_id,
-                event_type='heartbeat',
-                event_data={
-                    'version': effective_version,
-                    'rssi': payload.get('rssi'),
-                    'uptime': payload.get('uptime'),
-                    'free_heap': payload.get('free_heap'),
-                    'ssid': payload.get('ssid')
-                },
-                timestamp=datetime.now(timezone.utc)
-            )
-            db.session.add(heartbeat_event)
-            
-            # Cleanup old heartbeat history (keep only last 24 hours)
-            from datetime import timedelta
-            cleanup_threshold = datetime.now(timezone.utc) - timedelta(hours=24)
-            HeartbeatHistory.query.filter(
-                HeartbeatHistory.device_id == device_id,
-                HeartbeatHistory.timestamp < cleanup_threshold
-            ).delete()
-            
-            db.session.commit()
-            
-            # Check for stuck OTA updates and resolve ALL of them based on version
-            from models import OTAUpdateLog
-            from datetime import timedelta
-            stuck_otas = OTAUpdateLog.query.filter(
-                OTAUpdateLog.device_id == device_id,
-                OTAUpdateLog.status.in_(['started', 'downloading'])
-            ).order_by(OTAUpdateLog.started_at.desc()).all()
-            
-            if stuck_otas and effective_version:
-                # Normalize current version once
-                normalized_current = effective_version.lstrip('vV')
-                now = datetime.now(timezone.utc)
-                # Timeout threshold: 5 minutes of inactivity
-                timeout_threshold = now - timedelta(minutes=5)
-                resolved_count = 0
+                # Check if OTA has timed out (>5 min with no progress or old progress)
+                ota_started_long_ago = stuck_ota.started_at < timeout_threshold
                 
-                for stuck_ota in stuck_otas:
-                    # Normalize target version for comparison
-                    normalized_target = stuck_ota.new_version.lstrip('vV')
-                    
-                    if normalized_current == normalized_target:
-                        # Success: device is now running the target version
-                        stuck_ota.status = 'success'
-                        stuck_ota.completed_at = now
-                        stuck_ota.download_progress = 100
-                        print(f"✅ OTA resolved via heartbeat (success): {device_id} ({stuck_ota.old_version} → {stuck_ota.new_version})")
-                        resolved_count += 1
-                    else:
-                        # Check if OTA has timed out (>5 min with no progress or old progress)
-                        ota_started_long_ago = stuck_ota.started_at < timeout_threshold
-                        
-                        # If last_progress_at is NULL, check started_at age
-                        # If last_progress_at exists, check its age
-                        has_timed_out = ota_started_long_ago and (
-                            stuck_ota.last_progress_at is None or 
-                            stuck_ota.last_progress_at < timeout_threshold
-                        )
-                        
-                        if has_timed_out:
-                            # Failed: device has different version AND OTA has timed out
-                            stuck_ota.status = 'failed'
-                            stuck_ota.completed_at = now
-                            stuck_ota.error_message = f"Heartbeat shows version {effective_version} instead of expected {stuck_ota.new_version} after 5+ minutes of inactivity (resolved via heartbeat)"
-                            print(f"❌ OTA resolved via heartbeat (failed): {device_id} - version mismatch after timeout (expected {stuck_ota.new_version}, got {effective_version})")
-                            resolved_count += 1
-                        # else: Active download still in progress, don't resolve yet
+                # If last_progress_at is NULL, check started_at age
+                # If last_progress_at exists, check its age
+                has_timed_out = ota_started_long_ago and (
+                    stuck_ota.last_progress_at is None or 
+                    stuck_ota.last_progress_at < timeout_threshold
+                )
                 
-                if resolved_count > 0:
-                    db.session.commit()
-                    print(f"📋 Resolved {resolved_count} stuck OTA update(s) for {device_id}")
-            
-            # Check for firmware updates based on board type and product
-            # Map board type to platform using authoritative mapping
-            from app import get_firmware_version
-            from models import FirmwareVersion
-            platform = BOARD_TYPE_TO_PLATFORM.get(effective_board)
+                if has_timed_out:
+                    # Failed: device has different version AND OTA has timed out
+                    stuck_ota.status = 'failed'
+                    stuck_ota.completed_at = now
+                    stuck_ota.error_message = f"Heartbeat shows version {effective_version} instead of expected {stuck_ota.new_version} after 5+ minutes of inactivity (resolved via heartbeat)"
+                    print(f"❌ OTA resolved via heartbeat (failed): {device_id} - version mismatch after timeout (expected {stuck_ota.new_version}, got {effective_version})")
+                    resolved_count += 1
+                # else: Active download still in progress, don't resolve yet
+        
+        if resolved_count > 0:
+            db.session.commit()
+            print(f"📋 Resolved {resolved_count} stuck OTA update(s) for {device_id}")
+    
+    # Check for firmware updates based on board type and product
+    # Map board type to platform using authoritative mapping
+    from app import get_firmware_version
+    from models import FirmwareVersion
+    platform = BOARD_TYPE_TO_PLATFORM.get(effective_board)
+    
+    if not platform:
+        # Log when no matching platform mapping is found
+        if effective_board and effective_board != 'Unknown':
+            print(f"⚠ No platform mapping for board type '{effective_board}'")
+    else:
+        # Check if device has a pinned firmware version
+        pinned_version = device.pinned_firmware_version
+        target_version = None
+        
+        if pinned_version:
+            # Device is pinned - verify the pinned version exists for this product
+            pinned_fw = FirmwareVersion.query.filter_by(
+                product=effective_product,
+                platform=platform, 
+                version=pinned_version
+            ).first()
             
-            if not platform:
-                # Log when no matching platform mapping is found
-                if effective_board and effective_board != 'Unknown':
-                    print(f"⚠ No platform mapping for board type '{effective_board}'")
+            if pinned_fw:
+                target_version = pinned_version
+                print(f"📌 Device {device_id} is pinned to version {pinned_version}")
             else:
-                # Check if device has a pinned firmware version
-                pinned_version = device.pinned_firmware_version
-                target_version = None
-                
-                if pinned_version:
-                    # Device is pinned - verify the pinned version exists for this product
-                    pinned_fw = FirmwareVersion.query.filter_by(
-                        product=effective_product,
-                        platform=platform, 
-                        version=pinned_version
-                    ).first()
-                    
-                    if pinned_fw:
-                        target_version = pinned_version
-                        print(f"📌 Device {device_id} is pinned to version {pinned_version}")
-                    else:
-                        # Pinned version doesn't exist - fall back to latest
-                        print(f"⚠ Pinned version {pinned_version} not found for {effective_product}/{platform}, falling back to latest")
-                        version_info = get_firmware_version(platform, effective_product)
-                        if version_info:
-                            target_version = version_info.get('version')
-                else:
-                    # Not pinned - use latest version for this product
-                    version_info = get_firmware_version(platform, effective_product)
-                    if version_info:
-                        target_version = version_info.get('version')
-                
-                if target_version and effective_version:
-                    # Normalize versions by removing 'v' prefix for comparison
-                    normalized_current = effective_version.lstrip('vV')
-                    normalized_target = target_version.lstrip('vV')
-                    update_available = normalized_target != normalized_current
-                    
-                    if update_available:
-                        # Send version response to notify device of update
-                        # Use the device's environment from the topic
-                        session_id = str(uuid.uuid4())
-                        response_topic = f"{MQTT_TOPIC_PREFIX}/{environment}/version/response/{device_id}"
-                        response_payload = {
-                            'latest_version': target_version,
-                            'current_version': effective_version,
-                            'update_available': True,
-                            'product': effective_product,
-                            'platform': platform,
-                            'session_id': session_id,
-                            'subscriber_id': _subscriber_id,  # Track which thread sent this
-                            'pinned': pinned_version is not None  # Let device know if this is a pinned version
-                        }
-                        client.publish(response_topic, json.dumps(response_payload), qos=1)
-                        pin_status = "pinned" if pinned_version else "latest"
-                        print(f"📤 Version response sent to {device_id} (env={environment}): {target_version} (update: True, {pin_status}) [subscriber: {_subscriber_id}]")
-                else:
-                    # Log when platform exists in mapping but no firmware in cache
-                    print(f"⚠ No firmware found for {effective_product}/{platform} (board type: '{effective_board}')")
+                # Pinned version doesn't exist - fall back to latest
+                print(f"⚠ Pinned version {pinned_version} not found for {effective_product}/{platform}, falling back to latest")
+                version_info = get_firmware_version(platform, effective_product)
+                if version_info:
+                    target_version = version_info.get('version')
+        else:
+            # Not pinned - use latest version for this product
+            version_info = get_firmware_version(platform, effective_product)
+            if version_info:
+                target_version = version_info.get('version')
         
-        print(f"📡 Heartbeat from {topic}: v{effective_version}, uptime={payload.get('uptime')}s, RSSI={payload.get('rssi')}dBm")
+        if target_version and effective_version:
+            # Normalize versions by removing 'v' prefix for comparison
+            normalized_current = effective_version.lstrip('vV')
+            normalized_target = target_version.lstrip('vV')
+            update_available = normalized_target != normalized_current
+            
+            if update_available and client:
+                # Send version response to notify device of update
+                # Use the device's environment from the topic
+                session_id = str(uuid.uuid4())
+                response_topic = f"{MQTT_TOPIC_PREFIX}/{environment}/version/response/{device_id}"
+                response_payload = {
+                    'latest_version': target_version,
+                    'current_version': effective_version,
+                    'update_available': True,
+                    'product': effective_product,
+                    'platform': platform,
+                    'session_id': session_id,
+                    'subscriber_id': _subscriber_id,  # Track which thread sent this
+                    'pinned': pinned_version is not None  # Let device know if this is a pinned version
+                }
+                client.publish(response_topic, json.dumps(response_payload), qos=1)
+                pin_status = "pinned" if pinned_version else "latest"
+                print(f"📤 Version response sent to {device_id} (env={environment}): {target_version} (update: True, {pin_status}) [subscriber: {_subscriber_id}]")
+        else:
+            # Log when platform exists in mapping but no firmware in cache
+            print(f"⚠ No firmware found for {effective_product}/{platform} (board type: '{effective_board}')")
 
 def handle_device_info(client, payload, topic):
     """Handle device info messages - updates static device data and capabilities
@@ -758,129 +698,156 @@ def handle_display_snapshot(client, payload, topic):
         print(f"⚠ Invalid display snapshot topic format: {topic}")
         return
     
-    if _app_context:
-        with _app_context.app_context():
-            from models import Device, DisplaySnapshot, db
-            
-            device = Device.query.filter_by(device_id=device_id).first()
-            if device:
-                try:
-                    # Check for new per-row format: {"rows": [{...}, {...}]}
-                    rows_data = payload.get('rows')
-                    
-                    # Determine snapshot time: use device timestamp if available, otherwise receive time
-                    unix_timestamp = payload.get('timestamp')
-                    receive_time = datetime.now(timezone.utc)
-                    if unix_timestamp and unix_timestamp > 0:
-                        snapshot_time = datetime.fromtimestamp(unix_timestamp, tz=timezone.utc)
-                        time_source = "device"
-                    else:
-                        snapshot_time = receive_time
-                        time_source = "receive"
-                    
-                    if rows_data and isinstance(rows_data, list) and len(rows_data) > 0 and isinstance(rows_data[0], dict):
-                        # NEW PER-ROW FORMAT: Each row is a dict with own dimensions
-                        total_bytes = 0
-                        row_texts = []
-                        for i, row in enumerate(rows_data):
-                            if not isinstance(row, dict):
-                                print(f"✗ Invalid row {i} in snapshot for {device_id}")
-                                return
-                            
-                            mono_base64 = row.get('mono')
-                            if not mono_base64:
-                                print(f"✗ Row {i} missing 'mono' data for {device_id}")
-                                return
-                            
-                            row_bytes = base64.b64decode(mono_base64)
-                            total_bytes += len(row_bytes)
-                            row_texts.append(row.get('text', ''))
-                        
-                        snapshot_data = {
-                            'rows': rows_data,
-                            'timestamp': snapshot_time.isoformat()
-                        }
-                        
-                        device.display_snapshot = snapshot_data
-                        device.last_seen = receive_time  # Always use receive time for last_seen
-                        
-                        bitmap_data = {
-                            'rows': rows_data
-                        }
-                        
-                        snapshot = DisplaySnapshot(
-                            device_id=device_id,
-                            row_text=row_texts,
-                            bitmap_data=bitmap_data,
-                            timestamp=snapshot_time  # Use device timestamp when available
-                        )
-                        db.session.add(snapshot)
-                        db.session.commit()
-                        
-                        row_info = ", ".join([f"{r.get('cols', '?')}x{r.get('height', '?')}" for r in rows_data])
-                        time_info = f" (time: {time_source})" if time_source != "receive" else ""
-                        print(f"📸 Display snapshot stored for {device_id} ({total_bytes} bytes, rows: [{row_info}]){time_info}")
-                    
-                    else:
-                        # LEGACY FORMAT: Single mono/color with shared dimensions
-                        mono_base64 = payload.get('mono') or payload.get('pixels', '')
-                        mono_color = payload.get('monoColor')
-                        color_base64 = payload.get('color')
-                        row_text = payload.get('row_text', [])
-                        
-                        if not mono_base64 and not color_base64:
-                            print(f"✗ No pixel data in snapshot for {device_id}")
-                            return
-                        
-                        if mono_base64:
-                            pixels_bytes = base64.b64decode(mono_base64)
-                        elif color_base64:
-                            pixels_bytes = base64.b64decode(color_base64)
-                        
-                        snapshot_data = {
-                            'rows': payload.get('rows', 1),
-                            'cols': payload.get('cols', 1),
-                            'width': payload.get('width', 16),
-                            'height': payload.get('height', 16),
-                            'mono': mono_base64,
-                            'timestamp': datetime.now(timezone.utc).isoformat()
-                        }
-                        
-                        if mono_color:
-                            snapshot_data['monoColor'] = mono_color
-                        if color_base64:
-                            snapshot_data['color'] = color_base64
-                        
-                        device.display_snapshot = snapshot_data
-                        device.last_seen = datetime.now(timezone.utc)
-                        
-                        bitmap_data = {
-                            'mono': mono_base64,
-                            'width': payload.get('width', 16),
-                            'height': payload.get('height', 16),
-                            'rows': payload.get('rows', 1),
-                            'cols': payload.get('cols', 1)
-                        }
-                        
-                        if mono_color:
-                            bitmap_data['monoColor'] = mono_color
-                        if color_base64:
-                            bitmap_data['color'] = color_base64
-                        
-                        snapshot = DisplaySnapshot(
-                            device_id=device_id,
-                            row_text=row_text,
-                            bitmap_data=bitmap_data,
-                            timestamp=datetime.now(timezone.utc)
-                        )
-                        db.session.add(snapshot)
-                        db.session.commit()
-                        
-                        color_info = f", color={mono_color}" if mono_color else ""
-                        print(f"📸 Display snapshot stored for {device_id} ({len(pixels_bytes)} bytes, {len(row_text)} rows{color_info}) [legacy format]")
+    if not _ingest:
+        return
+    
+    try:
+        # Check for new per-row format: {"rows": [{...}, {...}]}
+        rows_data = payload.get('rows')
+        
+        # Determine snapshot time: use device timestamp if available, otherwise receive time
+        unix_timestamp = payload.get('timestamp')
+        receive_time = datetime.now(timezone.utc)
+        if unix_timestamp and unix_timestamp > 0:
+            snapshot_time = datetime.fromtimestamp(unix_timestamp, tz=timezone.utc)
+            time_source = "device"
+        else:
+            snapshot_time = receive_time
+            time_source = "receive"
+        
+        if rows_data and isinstance(rows_data, list) and len(rows_data) > 0 and isinstance(rows_data[0], dict):
+            # NEW PER-ROW FORMAT: Each row is a dict with own dimensions
+            total_bytes = 0
+            row_texts = []
+            for i, row in enumerate(rows_data):
+                if not isinstance(row, dict):
+                    print(f"✗ Invalid row {i} in snapshot for {device_id}")
+                    return
+                
+                mono_base64 = row.get('mono')
+                if not mono_base64:
+                    print(f"✗ Row {i} missing 'mono' data for {device_id}")
+                    return
                 
-                except Exception as e:
-                    print(f"✗ Failed to store display snapshot: {e}")
+                row_bytes = base64.b64decode(mono_base64)
+                total_bytes += len(row_bytes)
+                row_texts.append(row.get('text', ''))
+            
+            snapshot_data = {
+                'rows': rows_data,
+                'timestamp': snapshot_time.isoformat()
+            }
+            
+            bitmap_data = {
+                'rows': rows_data
+            }
+            
+            # Mirrored frames reuse this row metadata (text, cols, color)
+            _display_rows[device_id] = rows_data
+            _ingest.add_snapshot(device_id, snapshot_data, row_texts, bitmap_data, snapshot_time)
+            
+            row_info = ", ".join([f"{r.get('cols', '?')}x{r.get('height', '?')}" for r in rows_data])
+            time_info = f" (time: {time_source})" if time_source != "receive" else ""
+            print(f"📸 Display snapshot queued for {device_id} ({total_bytes} bytes, rows: [{row_info}]){time_info}")
+        
+        else:
+            # LEGACY FORMAT: Single mono/color with shared dimensions
+            mono_base64 = payload.get('mono') or payload.get('pixels', '')
+            mono_color = payload.get('monoColor')
+            color_base64 = payload.get('color')
+            row_text = payload.get('row_text', [])
+            
+            if not mono_base64 and not color_base64:
+                print(f"✗ No pixel data in snapshot for {device_id}")
+                return
+            
+            if mono_base64:
+                pixels_bytes = base64.b64decode(mono_base64)
+            elif color_base64:
+                pixels_bytes = base64.b64decode(color_base64)
+            
+            snapshot_data = {
+                'rows': payload.get('rows', 1),
+                'cols': payload.get('cols', 1),
+                'width': payload.get('width', 16),
+                'height': payload.get('height', 16),
+                'mono': mono_base64,
+                'timestamp': receive_time.isoformat()
+            }
+            
+            if mono_color:
+                snapshot_data['monoColor'] = mono_color
+            if color_base64:
+                snapshot_data['color'] = color_base64
+            
+            bitmap_data = {
+                'mono': mono_base64,
+                'width': payload.get('width', 16),
+                'height': payload.get('height', 16),
+                'rows': payload.get('rows', 1),
+                'cols': payload.get('cols', 1)
+            }
+            
+            if mono_color:
+                bitmap_data['monoColor'] = mono_color
+            if color_base64:
+                bitmap_data['color'] = color_base64
+            
+            _ingest.add_snapshot(device_id, snapshot_data, row_text, bitmap_data, receive_time)
+            
+            color_info = f", color={mono_color}" if mono_color else ""
+            print(f"📸 Display snapshot queued for {device_id} ({len(pixels_bytes)} bytes, {len(row_text)} rows{color_info}) [legacy format]")
+    
+    except Exception as e:
+        print(f"✗ Failed to queue display snapshot: {e}")
+
+def handle_display_delta(client, raw_payload: bytes, topic):
+    """Handle display mirror messages (topic: norrtek-iot/{env}/display/delta/{device_id})
+    
+    Binary keyframes and XOR deltas (layout in the firmware's
+    mqtt_wire_format.h) are applied to the device's DisplayMirror. Every
+    rebuilt frame becomes the device's current display snapshot, in the
+    per-row format the UI already renders; keyframes are also kept in the
+    snapshot history. A delta that doesn't chain onto the last frame means a
+    message was lost, and is ignored until the next keyframe.
+    """
+    topic_parts = topic.split('/')
+    if len(topic_parts) < 5 or topic_parts[1] not in ('dev', 'prod'):
+        print(f"⚠ Invalid display delta topic: {topic}")
+        return
+    
+    device_id = topic_parts[4]
+    
+    try:
+        message = decode_display_delta(raw_payload)
+    except (ValueError, IndexError, struct.error) as e:
+        print(f"✗ Failed to decode display delta from {device_id}: {e}")
+        return
+    
+    mirror = _display_mirrors.setdefault(device_id, DisplayMirror())
+    if not mirror.apply(message):
+        print(f"⚠ Display delta from {device_id} doesn't follow frame {mirror.sequence} - waiting for keyframe")
+        return
+    
+    if not _ingest:
+        return
+    
+    # Merge the frame into the last known row metadata (text, panel count, color)
+    known_rows = _display_rows.get(device_id, [])
+    rows_data = []
+    for i, (width, height, row_bytes) in enumerate(mirror.row_bitmaps()):
+        row = dict(known_rows[i]) if i < len(known_rows) else {'cols': width // height if height else 1}
+        row.update(width=width, height=height, mono=base64.b64encode(row_bytes).decode())
+        rows_data.append(row)
+    
+    receive_time = datetime.now(timezone.utc)
+    snapshot_data = {
+        'rows': rows_data,
+        'timestamp': receive_time.isoformat(),
+        'mirror_sequence': mirror.sequence
+    }
+    _ingest.add_snapshot(device_id, snapshot_data, [row.get('text', '') for row in rows_data],
+                         {'rows': rows_data}, receive_time, history=message['keyframe'])
 
 def handle_event(client, payload, topic, raw_payload=None):
     """Handle device event messages for analytics
@@ -890,7 +857,8 @@ def handle_event(client, payload, topic, raw_payload=None):
     Timestamp handling (priority order):
     1. 'timestamp' - Unix timestamp from device RTC/NTP (preferred, most accurate)
     2. 'offset_ms' - Fallback when device has no RTC sync (calculate from receive time)
-    3. Neither - Use receive time (legacy fallback)
+    3. Neither - Use receive time (legacy fallback, and events replayed from
+       the device's flash spool after a reboot without time sync)
     
     New payload format (with RTC/NTP sync):
     {
@@ -937,61 +905,111 @@ def handle_event(client, payload, topic, raw_payload=None):
         print(f"⚠ Missing event type in payload from {device_id}")
         return
     
-    if _app_context:
-        from models import Device, EventLog, db
-        from datetime import timedelta
-        
-        with _app_context.app_context():
-            receive_time = datetime.now(timezone.utc)
-            
-            # Determine event time using priority: timestamp > offset_ms > receive_time
-            if unix_timestamp and unix_timestamp > 0:
-                # Use Unix timestamp from device (most accurate when RTC/NTP is synced)
-                event_time = datetime.fromtimestamp(unix_timestamp, tz=timezone.utc)
-                time_source = "timestamp"
-            elif offset_ms > 0:
-                # Use offset from receive time (fallback when no RTC sync)
-                event_time = receive_time - timedelta(milliseconds=offset_ms)
-                time_source = "offset"
-            else:
-                # Use receive time (legacy fallback)
-                event_time = receive_time
-                time_source = "receive"
-            
-            # Ensure device exists (create if new)
-            device = Device.query.filter_by(device_id=device_id).first()
-            if not device:
-                if not product:
-                    print(f"⚠ Cannot register new device via event: missing 'product' in payload from {device_id}")
-                    return
-                device = Device(
-                    device_id=device_id,
-                    product=product,
-                    board_type=board_type or 'Unknown',
-                    firmware_version='Unknown'
-                )
-                db.session.add(device)
-                print(f"✨ New device registered via event: {device_id} ({product})")
-            
-            # Store the event with raw MQTT data for debugging
-            event_log = EventLog(
-                device_id=device_id,
-                event_type=event_type,
-                event_data=event_data,
-                timestamp=event_time,
-                mqtt_topic=topic,
-                mqtt_payload=raw_payload
-            )
-            db.session.add(event_log)
-            db.session.commit()
-            
-            # Format data for logging
-            data_str = f", data={event_data}" if event_data else ""
-            time_info = f" (time: {time_source})" if time_source != "receive" else ""
-            print(f"📊 Event logged: {device_id} [{event_type}]{data_str}{time_info}")
+    receive_time = datetime.now(timezone.utc)
+    
+    # Determine event time using priority: timestamp > offset_ms > receive_time
+    if unix_timestamp and unix_timestamp > 0:
+        # Use Unix timestamp from device (most accurate when RTC/NTP is synced)
+        event_time = datetime.fromtimestamp(unix_timestamp, tz=timezone.utc)
+        time_source = "timestamp"
+    elif offset_ms > 0:
+        # Use offset from receive time (fallback when no RTC sync)
+        event_time = receive_time - timedelta(milliseconds=offset_ms)
+        time_source = "offset"
+    else:
+        # Use receive time (legacy fallback)
+        event_time = receive_time
+        time_source = "receive"
+    
+    store_events(device_id, [(event_type, event_data, event_time, time_source)],
+                 topic, raw_payload, product, board_type)
+
+def store_events(device_id, events, topic, raw_payload=None, product=None, board_type=None):
+    """Queue decoded events for one device (written by the next ingest flush)
+    
+    Args:
+        device_id: Device ID from the topic
+        events: List of (event_type, event_data, event_time, time_source) tuples
+        topic: MQTT topic string
+        raw_payload: Optional raw payload string for debugging storage
+        product: Product name (needed to register a device first seen via events)
+        board_type: Board type (optional, used when registering)
+    """
+    if not _ingest or not events:
+        return
+    
+    _ingest.add_events(device_id, events, topic, raw_payload, product, board_type)
+    
+    # Format data for logging
+    for event_type, event_data, event_time, time_source in events:
+        data_str = f", data={event_data}" if event_data else ""
+        time_info = f" (time: {time_source})" if time_source != "receive" else ""
+        print(f"📊 Event queued: {device_id} [{event_type}]{data_str}{time_info}")
+
+def handle_event_batch(client, raw_payload: bytes, topic):
+    """Handle batched device events (topic: norrtek-iot/{env}/event/batch/{device_id})
+    
+    Each event's time is base + dt: base is a Unix timestamp when the device
+    had time sync, otherwise the first event's age in ms at send time. Events
+    from an earlier boot carry no usable base, so the batch is placed to end
+    at receive time.
+    """
+    topic_parts = topic.split('/')
+    if len(topic_parts) < 5:
+        print(f"⚠ Invalid event batch topic format: {topic}")
+        return
+    
+    environment = topic_parts[1]
+    device_id = topic_parts[4]
+    
+    if environment not in ('dev', 'prod'):
+        print(f"⚠ Rejecting event batch with invalid environment in topic: {environment}")
+        return
+    
+    try:
+        base, base_kind, batch_events = decode_event_batch(raw_payload)
+    except (ValueError, IndexError, struct.error, UnicodeDecodeError) as e:
+        print(f"✗ Failed to decode event batch from {device_id}: {e}")
+        return
+    
+    receive_time = datetime.now(timezone.utc)
+    if base_kind == 'unix':
+        base_time = datetime.fromtimestamp(base, tz=timezone.utc)
+        time_source = "timestamp"
+    elif base_kind == 'previous_boot':
+        last_dt = max((dt for _, _, dt in batch_events), default=0)
+        base_time = receive_time - timedelta(milliseconds=last_dt)
+        time_source = "previous_boot"
+    else:
+        base_time = receive_time - timedelta(milliseconds=base)
+        time_source = "offset"
+    
+    events = []
+    for event_type, event_data, dt in batch_events:
+        if not event_type:
+            continue
+        events.append((event_type, event_data, base_time + timedelta(milliseconds=dt), time_source))
+    
+    # Keep the raw payload readable for debugging (binary batches stored as base64)
+    if raw_payload[:1] == b'{':
+        raw_text = raw_payload.decode(errors='replace')
+    else:
+        raw_text = base64.b64encode(raw_payload).decode()
+    
+    store_events(device_id, events, topic, raw_text)
+    print(f"📦 Event batch from {device_id}: {len(events)} events ({len(raw_payload)} bytes)")
 
 def on_message(client, userdata, msg):
     try:
+        # Event batches and display deltas may be binary, so route them before JSON decoding
+        topic_parts = msg.topic.split('/')
+        if len(topic_parts) >= 5 and topic_parts[0] == 'norrtek-iot' and topic_parts[2] == 'event' and topic_parts[3] == 'batch':
+            handle_event_batch(client, msg.payload, msg.topic)
+            return
+        if len(topic_parts) >= 5 and topic_parts[0] == 'norrtek-iot' and topic_parts[2] == 'display' and topic_parts[3] == 'delta':
+            handle_display_delta(client, msg.payload, msg.topic)
+            return
+        
         raw_payload = msg.payload.decode()  # Store raw for debugging
         payload = json.loads(raw_payload)
         
@@ -1121,6 +1139,45 @@ def publish_config(device_id: str, topic_environment: str = None, **config_value
         print(f"✗ Error publishing config: {e}")
         return False
 
+def publish_display_frame(device_id: str, bitmap: bytes, ttl: int = 0) -> bool:
+    """
+    Push a 1bpp bitmap for a device to show in place of its own content.
+    
+    Binary payload on display/frame/<device_id>: a little-endian uint16 hold
+    time in seconds (0 = device default), then the bitmap in the device's
+    frame buffer layout (a snapshot's row 'mono' bytes, concatenated). An empty
+    bitmap ends the hold.
+    
+    Args:
+        device_id: Target device ID
+        bitmap: Frame buffer bytes (must match the device's buffer size), or b'' to clear
+        ttl: Seconds to hold the image (0 = device default)
+    
+    Returns:
+        True if published successfully, False otherwise
+    """
+    global _mqtt_client, _subscriber_id
+    
+    if not _mqtt_client or not _mqtt_client.is_connected():
+        print(f"✗ Cannot publish display frame: MQTT client not connected")
+        return False
+    
+    environment = get_environment_scope()
+    topic = f"{MQTT_TOPIC_PREFIX}/{environment}/display/frame/{device_id}"
+    payload = struct.pack('<H', ttl) + bitmap if bitmap else b''
+    
+    try:
+        result = _mqtt_client.publish(topic, payload, qos=0)
+        if result.rc == mqtt.MQTT_ERR_SUCCESS:
+            print(f"✓ Published display frame to {device_id} ({len(bitmap)} bytes, ttl={ttl}) [subscriber: {_subscriber_id}]")
+            return True
+        else:
+            print(f"✗ Failed to publish display frame to {device_id}: error code {result.rc}")
+            return False
+    except Exception as e:
+        print(f"✗ Error publishing display frame: {e}")
+        return False
+
 def ota_timeout_checker():
     """
     Background thread that checks for timed-out OTA updates.
@@ -1201,7 +1258,7 @@ def ota_timeout_checker():
 
 def stop_mqtt_subscriber():
     """Gracefully stop MQTT subscriber thread"""
-    global _mqtt_client, _shutdown_event, _subscriber_id
+    global _mqtt_client, _shutdown_event, _subscriber_id, _ingest
     
     if _shutdown_event:
         print(f"🛑 Signaling MQTT subscriber shutdown (ID: {_subscriber_id})...")
@@ -1215,12 +1272,21 @@ def stop_mqtt_subscriber():
         except Exception as e:
             print(f"⚠ Error stopping MQTT subscriber: {e}")
     
+    # Write whatever is still buffered once no more messages can arrive
+    if _ingest:
+        _ingest.stop()
+    
+    _ingest = None
     _mqtt_client = None
     _shutdown_event = None
     _subscriber_id = None
 
+def get_live_heartbeats() -> Dict[str, dict]:
+    """Latest heartbeat per device, including ones not yet written to the database"""
+    return _ingest.live_heartbeats() if _ingest else {}
+
 def start_mqtt_subscriber():
-    global _mqtt_client, _shutdown_event, _subscriber_id
+    global _mqtt_client, _shutdown_event, _subscriber_id, _ingest
     
     # Prevent duplicate subscribers (can happen with Flask reloader or workflow restarts)
     if _mqtt_client is not None:
@@ -1265,6 +1331,11 @@ def start_mqtt_subscriber():
     client.on_message = on_message
     client.on_disconnect = on_disconnect
     
+    # Database writes are batched; start the flusher before messages arrive
+    if _app_context:
+        _ingest = IngestBuffer(_app_context, on_heartbeat=process_heartbeat)
+        _ingest.start()
+    
     try:
         client.connect(MQTT_HOST, MQTT_PORT, keepalive=60)
         client.loop_start()
@@ -1278,6 +1349,9 @@ def start_mqtt_subscriber():
         return client
     except Exception as e:
         print(f"✗ Failed to start MQTT subscriber: {e}")
+        if _ingest:
+            _ingest.stop()
+        _ingest = None
         _shutdown_event = None
         _subscriber_id = None
         return None
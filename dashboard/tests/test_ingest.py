@@ -0,0 +1,203 @@
+"""
+IngestBuffer flush tests against a fake database session.
+
+models.py needs Flask-SQLAlchemy and PostgreSQL, so the models and session
+are replaced by fakes that record committed rows and can be told to reject
+rows or fail commits.
+
+    python -m unittest discover dashboard/tests
+"""
+
+import contextlib
+import io
+import os
+import sys
+import time
+import types
+import unittest
+from unittest import mock
+
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+import ingest  # noqa: E402
+
+
+class FakeColumn:
+    def in_(self, values):
+        return set(values)
+
+
+class FakeSession:
+    """Rows land in pending on execute and move to committed on commit"""
+
+    def __init__(self):
+        self.devices = {}
+        self.committed = {}
+        self.pending = []
+        self.executes = 0
+        self.fail_commits = 0
+        self.reject = lambda row: False
+
+    def execute(self, model, rows):
+        self.executes += 1
+        for row in rows:
+            if self.reject(row):
+                raise ValueError(f"rejected {row}")
+        self.pending.extend((model.__tablename__, row) for row in rows)
+
+    @contextlib.contextmanager
+    def begin_nested(self):
+        mark = len(self.pending)
+        try:
+            yield
+        except Exception:
+            del self.pending[mark:]
+            raise
+
+    def add(self, device):
+        self.devices[device.device_id] = device
+
+    def flush(self):
+        pass
+
+    def commit(self):
+        if self.fail_commits > 0:
+            self.fail_commits -= 1
+            self.pending = []
+            raise ConnectionError("database unreachable")
+        for table, row in self.pending:
+            self.committed.setdefault(table, []).append(row)
+        self.pending = []
+
+    def rollback(self):
+        self.pending = []
+
+    def rows(self, table):
+        return self.committed.get(table, [])
+
+
+def fake_models(session):
+    class DeviceQuery:
+        def filter(self, device_ids):
+            self._device_ids = device_ids
+            return self
+
+        def all(self):
+            return [d for d in session.devices.values() if d.device_id in self._device_ids]
+
+    class Device:
+        device_id = FakeColumn()
+        query = DeviceQuery()
+
+        def __init__(self, device_id, **fields):
+            self.device_id = device_id
+            self.deleted_at = None
+            self.firmware_version = 'Unknown'
+            self.__dict__.update(fields)
+
+    def model(name):
+        return type(name, (), {'__tablename__': name})
+
+    module = types.ModuleType('models')
+    module.Device = Device
+    module.EventLog = model('event_log')
+    module.HeartbeatHistory = model('heartbeat_history')
+    module.DisplaySnapshot = model('display_snapshots')
+    module.db = types.SimpleNamespace(session=session)
+    return module
+
+
+class FakeApp:
+    def app_context(self):
+        return contextlib.nullcontext()
+
+
+class IngestFlushTest(unittest.TestCase):
+
+    def setUp(self):
+        self.session = FakeSession()
+        self.models = fake_models(self.session)
+        self.session.devices['clock-1'] = self.models.Device('clock-1')
+
+        patches = [mock.patch.dict(sys.modules, {'models': self.models}),
+                   mock.patch.object(ingest, 'insert', lambda model: model)]
+        for patch in patches:
+            patch.start()
+            self.addCleanup(patch.stop)
+
+        self.buffer = self._buffer()
+
+    def _buffer(self, **kwargs):
+        buffer = ingest.IngestBuffer(FakeApp(), flush_seconds=2.0, **kwargs)
+        buffer._last_cleanup = time.monotonic()  # No heartbeat_history cleanup query
+        return buffer
+
+    def _add_events(self, *event_types, buffer=None):
+        events = [(event_type, {}, None, 'device') for event_type in event_types]
+        (buffer or self.buffer).add_events('clock-1', events, 'events/clock-1')
+
+    def _flush(self, buffer=None):
+        with contextlib.redirect_stdout(io.StringIO()):
+            (buffer or self.buffer).flush()
+
+    def test_flush_writes_batch_in_bulk(self):
+        self._add_events('boot', 'wifi_connect')
+        self.buffer.add_heartbeat('clock-1', 'prod', {'rssi': -60, 'uptime': 12})
+        self.buffer.add_snapshot('clock-1', {'rows': []}, ['12:34'], {}, None)
+
+        self._flush()
+
+        self.assertEqual([r['event_type'] for r in self.session.rows('event_log')],
+                         ['boot', 'wifi_connect', 'heartbeat'])
+        self.assertEqual(len(self.session.rows('heartbeat_history')), 1)
+        self.assertEqual(len(self.session.rows('display_snapshots')), 1)
+        self.assertEqual(self.session.executes, 3)  # One bulk insert per table
+        self.assertEqual(self.session.devices['clock-1'].last_rssi, -60)
+        self.assertEqual(self.buffer._queued(), 0)
+
+    def test_rejected_row_is_dropped_alone(self):
+        self.session.reject = lambda row: row.get('event_type') == 'bad'
+        self._add_events('boot', 'bad', 'wifi_connect')
+
+        self._flush()
+
+        self.assertEqual([r['event_type'] for r in self.session.rows('event_log')],
+                         ['boot', 'wifi_connect'])
+        self.assertEqual(self.buffer._queued(), 0)
+        self.assertEqual(self.buffer._failures, 0)
+
+    def test_unreachable_database_keeps_batch_for_retry(self):
+        self.session.fail_commits = 2  # Bulk and row-by-row attempts
+        self._add_events('boot', 'wifi_connect')
+
+        self._flush()
+
+        self.assertEqual(self.session.committed, {})
+        self.assertEqual(self.buffer._queued(), 2)
+        self.assertGreater(self.buffer._retry_delay(), 2.0)
+
+        self._add_events('mqtt_connect')
+        self._flush()
+
+        self.assertEqual([r['event_type'] for r in self.session.rows('event_log')],
+                         ['boot', 'wifi_connect', 'mqtt_connect'])
+        self.assertEqual(self.buffer._queued(), 0)
+        self.assertEqual(self.buffer._retry_delay(), 2.0)
+
+    def test_retry_queue_is_bounded(self):
+        buffer = self._buffer(max_queued_rows=3)
+        self.session.fail_commits = 2
+        buffer.add_snapshot('clock-1', {'rows': []}, ['12:34'], {}, None)
+        buffer.add_snapshot('clock-1', {'rows': []}, ['12:35'], {}, None)
+        self._add_events('boot', 'wifi_connect', buffer=buffer)
+
+        self._flush(buffer)
+
+        # Display history is dropped before events
+        self.assertEqual(buffer._queued(), 3)
+        self.assertEqual(len(buffer._events), 2)
+        self.assertEqual([r['row_text'] for r in buffer._snapshot_rows], [['12:35']])
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,226 @@
+"""
+Decoders for the compact binary payloads published by the firmware.
+
+The layout constants are not repeated here: they are read at import from the
+firmware's src/connectivity/mqtt_wire_format.h, the one schema definition the
+encoders in event_log.cpp and mqtt_client.cpp compile against. Changing a
+value there changes both sides; changing a header layout without updating
+the struct formats below fails at import instead of mis-decoding.
+
+- Event batches (event/batch): JSON or version/flags/base/count + TLV records
+- Display mirror (display/delta): keyframes (row geometry + RLE frame) and
+  XOR deltas against the previous frame, chained by frame sequence
+
+Everything here is pure - no database or MQTT access.
+"""
+
+import json
+import os
+import re
+import struct
+from typing import Dict, List, Optional, Tuple
+
+WIRE_FORMAT_HEADER = os.getenv('WIRE_FORMAT_HEADER', os.path.join(
+    os.path.dirname(os.path.abspath(__file__)), '..',
+    'firmware', 'ski-clock-neo', 'src', 'connectivity', 'mqtt_wire_format.h'))
+
+_DEFINE = re.compile(r'^\s*#define\s+([A-Z][A-Z0-9_]*)\s+(0[xX][0-9A-Fa-f]+|\d+)\b', re.MULTILINE)
+
+
+def load_schema(path: str) -> Dict[str, int]:
+    """Read every integer #define from the firmware schema header"""
+    with open(path, encoding='utf-8') as f:
+        return {name: int(value, 0) for name, value in _DEFINE.findall(f.read())}
+
+
+SCHEMA = load_schema(WIRE_FORMAT_HEADER)
+
+EVENT_BATCH_BINARY_VERSION = SCHEMA['EVENT_BATCH_BINARY_VERSION']
+EVENT_BATCH_FLAG_UNIX_BASE = SCHEMA['EVENT_BATCH_FLAG_UNIX_BASE']
+EVENT_BATCH_FLAG_PREVIOUS_BOOT = SCHEMA['EVENT_BATCH_FLAG_PREVIOUS_BOOT']
+EVENT_TLV_EVENT = SCHEMA['EVENT_TLV_EVENT']
+
+DISPLAY_DELTA_VERSION = SCHEMA['DISPLAY_DELTA_VERSION']
+DISPLAY_DELTA_KEYFRAME = SCHEMA['DISPLAY_DELTA_KEYFRAME']
+DISPLAY_DELTA_XOR = SCHEMA['DISPLAY_DELTA_XOR']
+DISPLAY_RLE_LITERAL = SCHEMA['DISPLAY_RLE_LITERAL']
+
+EVENT_BATCH_HEADER = struct.Struct('<BBIB')      # version, flags, base, count
+DISPLAY_DELTA_HEADER = struct.Struct('<BBIIIH')  # version, type, seq, base seq, update seq, size
+DISPLAY_DELTA_ROW = struct.Struct('<HB')         # keyframe row width, height
+
+for _layout, _size_name in ((EVENT_BATCH_HEADER, 'EVENT_BATCH_HEADER_SIZE'),
+                            (DISPLAY_DELTA_HEADER, 'DISPLAY_DELTA_HEADER_SIZE'),
+                            (DISPLAY_DELTA_ROW, 'DISPLAY_DELTA_ROW_SIZE')):
+    if _layout.size != SCHEMA[_size_name]:
+        raise RuntimeError(f"{_size_name} is {SCHEMA[_size_name]} in {WIRE_FORMAT_HEADER} "
+                           f"but the decoder layout is {_layout.size} bytes")
+
+
+# ============================================================================
+# Event batches
+# ============================================================================
+
+def _read_varint(data: bytes, pos: int):
+    """Decode a LEB128 unsigned varint, returning (value, next_pos)"""
+    value = 0
+    shift = 0
+    while True:
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            return value, pos
+
+
+def decode_event_batch(raw: bytes):
+    """Decode a firmware event batch (JSON or binary TLV)
+
+    Returns (base, base_kind, [(event_type, event_data, dt_ms), ...]) where
+    base_kind is 'unix' (Unix seconds), 'offset' (first event's age in ms at
+    send time) or 'previous_boot' (millis() in an earlier boot, replayed from
+    the device's flash spool - only the spacing between events is known)
+
+    JSON format:
+    {"base": 1733580123, "events": [{"type": "boot", "data": {...}, "dt": 0}, ...]}
+    ("base_offset_ms" or "base_boot_ms" replaces "base" for the other kinds)
+
+    Binary format: header (version, flags, base u32, count) followed by
+    [tag][length][value] records; EVENT records hold a varint dt, the type
+    string and the JSON data text.
+    """
+    if raw[:1] == b'{':
+        batch = json.loads(raw.decode())
+        if 'base' in batch:
+            base, base_kind = batch['base'], 'unix'
+        elif 'base_boot_ms' in batch:
+            base, base_kind = batch['base_boot_ms'], 'previous_boot'
+        else:
+            base, base_kind = batch.get('base_offset_ms', 0), 'offset'
+        events = [(e.get('type'), e.get('data'), e.get('dt', 0)) for e in batch.get('events', [])]
+        return base, base_kind, events
+
+    version, flags, base, count = EVENT_BATCH_HEADER.unpack_from(raw, 0)
+    if version != EVENT_BATCH_BINARY_VERSION:
+        raise ValueError(f"unsupported event batch version {version}")
+
+    events = []
+    pos = EVENT_BATCH_HEADER.size
+    while pos + 2 <= len(raw):
+        tag, length = raw[pos], raw[pos + 1]
+        value = raw[pos + 2:pos + 2 + length]
+        pos += 2 + length
+        if tag != EVENT_TLV_EVENT:
+            continue  # Unknown record type from newer firmware
+
+        dt, vpos = _read_varint(value, 0)
+        type_len = value[vpos]
+        vpos += 1
+        event_type = value[vpos:vpos + type_len].decode()
+        data_text = value[vpos + type_len:].decode()
+        events.append((event_type, json.loads(data_text) if data_text else None, dt))
+
+    if len(events) != count:
+        print(f"⚠ Event batch declared {count} events but contained {len(events)}")
+    if flags & EVENT_BATCH_FLAG_UNIX_BASE:
+        base_kind = 'unix'
+    elif flags & EVENT_BATCH_FLAG_PREVIOUS_BOOT:
+        base_kind = 'previous_boot'
+    else:
+        base_kind = 'offset'
+    return base, base_kind, events
+
+
+# ============================================================================
+# Display mirror
+# ============================================================================
+
+def rle_decode(data: bytes, pos: int, size: int) -> bytes:
+    """Expand the mirror RLE body starting at pos into exactly size bytes"""
+    out = bytearray()
+    while len(out) < size:
+        token = data[pos]
+        pos += 1
+        count = (token & (DISPLAY_RLE_LITERAL - 1)) + 1
+        if token & DISPLAY_RLE_LITERAL:
+            literal = data[pos:pos + count]
+            if len(literal) != count:
+                raise ValueError("truncated RLE literal")
+            out += literal
+            pos += count
+        else:
+            out += bytes(count)
+    if len(out) != size:
+        raise ValueError(f"RLE body is {len(out)} bytes, frame is {size}")
+    return bytes(out)
+
+
+def decode_display_delta(raw: bytes) -> dict:
+    """Decode one display/delta message
+
+    Returns a dict with keyframe (bool), sequence, base_sequence,
+    update_sequence, size, rows ([(width, height), ...] for keyframes, else
+    None) and body - the frame itself for keyframes, frame XOR base for deltas.
+    """
+    version, frame_type, sequence, base_sequence, update_sequence, size = DISPLAY_DELTA_HEADER.unpack_from(raw, 0)
+    if version != DISPLAY_DELTA_VERSION:
+        raise ValueError(f"unsupported display delta version {version}")
+    if frame_type not in (DISPLAY_DELTA_KEYFRAME, DISPLAY_DELTA_XOR):
+        raise ValueError(f"unknown display frame type {frame_type}")
+
+    pos = DISPLAY_DELTA_HEADER.size
+    rows = None
+    keyframe = frame_type == DISPLAY_DELTA_KEYFRAME
+    if keyframe:
+        row_count = raw[pos]
+        pos += 1
+        rows = []
+        for _ in range(row_count):
+            rows.append(DISPLAY_DELTA_ROW.unpack_from(raw, pos))
+            pos += DISPLAY_DELTA_ROW.size
+
+    return {
+        'keyframe': keyframe,
+        'sequence': sequence,
+        'base_sequence': base_sequence,
+        'update_sequence': update_sequence,
+        'size': size,
+        'rows': rows,
+        'body': rle_decode(raw, pos, size),
+    }
+
+
+class DisplayMirror:
+    """Rebuilds one device's frame from its keyframe/delta stream"""
+
+    def __init__(self):
+        self.frame: Optional[bytes] = None
+        self.sequence = 0
+        self.rows: List[Tuple[int, int]] = []
+
+    def apply(self, message: dict) -> bool:
+        """Apply a decoded message; False if it couldn't be (lost delta, no keyframe yet)"""
+        if message['keyframe']:
+            self.frame = message['body']
+            self.rows = message['rows']
+        elif (self.frame is None or message['base_sequence'] != self.sequence
+              or message['size'] != len(self.frame)):
+            self.frame = None  # Out of sync - wait for the next keyframe
+            return False
+        else:
+            self.frame = bytes(a ^ b for a, b in zip(self.frame, message['body']))
+        self.sequence = message['sequence']
+        return True
+
+    def row_bitmaps(self) -> List[Tuple[int, int, bytes]]:
+        """Split the frame into (width, height, row bytes) - same bytes as a snapshot row's "mono" """
+        bitmaps = []
+        if self.frame is None:
+            return bitmaps
+        offset = 0
+        for width, height in self.rows:
+            row_bytes = (width * height + 7) // 8
+            bitmaps.append((width, height, self.frame[offset:offset + row_bytes]))
+            offset += row_bytes
+        return bitmaps
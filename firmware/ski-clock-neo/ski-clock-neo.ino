@@ -3,14 +3,89 @@
 #include "src/core/debug.h"
 #include "src/core/timer_helpers.h"
 #include "src/core/event_log.h"
+#include "src/core/event_spool.h"
 #include "src/core/led_indicator.h"
 #include "src/core/device_config.h"
 #include "src/display/display_core.h"
+#include "src/display/display_controller.h"
 
 // Connectivity modules
 #include "src/connectivity/mqtt_client.h"
 #include "src/connectivity/wifi_config.h"
 
+// Staged boot: setup() only does what the first frame needs (event ring,
+// config, LED, display and RTC time). The slower stages follow, each logged
+// as a boot_stage event with its duration:
+// - ESP32: the event spool is mounted first (the MQTT worker started by the
+//   network stage owns it from then on), then WiFi/MQTT bring-up runs on its
+//   own task while setup() goes on with sensor discovery
+// - ESP8266: loop() runs one stage per pass, after updateTimers() has
+//   rendered, so the time is on screen before anything blocks
+#define BOOT_NETWORK_STACK_SIZE 8192
+#define BOOT_NETWORK_PRIORITY   1
+#define BOOT_NETWORK_CORE       0  // WiFi core, opposite the display
+
+// Network stage finished (WiFi and MQTT both up) - loop() may service the
+// portal. Set only afterwards: on ESP32 the stage runs on core 0 while loop()
+// runs on core 1, and the portal must not be handled mid-initMQTT()
+static volatile bool networkReady = false;
+
+static void runBootStage(const char* stage, void (*init)()) {
+  unsigned long start = millis();
+  init();
+  uint32_t elapsed = millis() - start;
+  logEvent(EVT_BOOT_STAGE, stage, elapsed);
+  DEBUG_PRINT("Boot stage ");
+  DEBUG_PRINT(stage);
+  DEBUG_PRINT(": ");
+  DEBUG_PRINT(elapsed);
+  DEBUG_PRINTLN(" ms");
+}
+
+static void initNetwork() {
+  initWiFi();
+  initMQTT();
+}
+
+static void initSpool() {
+  initEventSpool();
+}
+
+#if defined(ESP32)
+static void bootNetworkTask(void* parameter) {
+  runBootStage("network", initNetwork);
+  networkReady = true;
+  vTaskDelete(NULL);
+}
+
+static void startNetworkStage() {
+  #if defined(CONFIG_IDF_TARGET_ESP32C3)
+    // ESP32-C3: Single-core RISC-V, use xTaskCreate
+    xTaskCreate(bootNetworkTask, "BootNet", BOOT_NETWORK_STACK_SIZE, NULL, BOOT_NETWORK_PRIORITY, NULL);
+  #else
+    xTaskCreatePinnedToCore(bootNetworkTask, "BootNet", BOOT_NETWORK_STACK_SIZE, NULL,
+                            BOOT_NETWORK_PRIORITY, NULL, BOOT_NETWORK_CORE);
+  #endif
+}
+#elif defined(ESP8266)
+// Stages still to run from loop(), in order
+enum BootStage { BOOT_STAGE_INPUTS, BOOT_STAGE_SPOOL, BOOT_STAGE_NETWORK, BOOT_STAGE_DONE };
+static BootStage bootStage = BOOT_STAGE_INPUTS;
+
+static void runNextBootStage() {
+  switch (bootStage) {
+    case BOOT_STAGE_INPUTS:  runBootStage("inputs", initDisplayInputs); break;
+    case BOOT_STAGE_SPOOL:   runBootStage("spool", initSpool); break;
+    case BOOT_STAGE_NETWORK: runBootStage("network", initNetwork); networkReady = true; break;
+    default: return;
+  }
+  bootStage = (BootStage)(bootStage + 1);
+  if (bootStage == BOOT_STAGE_DONE) {
+    DEBUG_PRINTLN("Boot complete");
+  }
+}
+#endif
+
 void setup() {
   // Initialise serial (only if debug logging enabled)
   DEBUG_BEGIN(115200);
@@ -20,7 +95,7 @@ void setup() {
   DEBUG_PRINT("Firmware version: ");
   DEBUG_PRINTLN(FIRMWARE_VERSION);
 
-  // Initialize event logging and log boot event
+  // Initialize event logging (RAM ring; the flash spool is mounted later)
   initEventLog();
   logBootEvent();
 
@@ -30,30 +105,38 @@ void setup() {
   // Initialize onboard LED indicator
   initLedIndicator();
 
-  // Initialize display (includes time, temperature, and button initialization)
-  initDisplay();
+  // Initialize display and time - RTC time is rendered when this returns
+  runBootStage("display", initDisplay);
+
+  #if defined(ESP32)
+    // Network bring-up in the background; sensor discovery meanwhile
+    runBootStage("spool", initSpool);
+    startNetworkStage();
+    runBootStage("inputs", initDisplayInputs);
+  #endif
 
-  // Initialise WiFi
-  initWiFi();
-  
-  // Initialize MQTT system
-  initMQTT();
-    
   DEBUG_PRINTLN("===========================================");
   DEBUG_PRINTLN("Setup complete - entering main loop");
   DEBUG_PRINTLN("===========================================\n");
 }
 
 void loop() {
-  // Handle WiFi tasks (config portal or reconnection)
-  updateWiFi();
+  // Handle WiFi tasks (config portal or reconnection) once AutoConnect is up
+  if (networkReady) {
+    updateWiFi();
+  }
+
+  // Handle MQTT updates (ESP8266 only - ESP32 runs MQTT on its own worker task)
+  #if defined(ESP8266)
+    if (bootStage == BOOT_STAGE_DONE) {
+      updateMQTT();
+    }
+  #endif
 
-  // Handle MQTT updates (subscriptions and version requests)
-  updateMQTT();
-  
   // Update timers (ESP8266 only - loop-driven, non-ISR, WiFi-safe)
-  // ESP32 uses FreeRTOS tasks, so no updates needed in loop
+  // ESP32 runs timers from its scheduler task, so no updates needed in loop
   #if defined(ESP8266)
     updateTimers();  // All timer_task managed timers (display, toggle, time check, temperature, button)
+    runNextBootStage();
   #endif
 }
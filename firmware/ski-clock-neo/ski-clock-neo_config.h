@@ -51,11 +51,13 @@
 
 // Hardware pin configuration
 #define DISPLAY_PIN_ROW0 4       // Display row 0 on GPIO4
-#define DISPLAY_PIN_ROW1 3       // Display row 1 on GPIO3
+#define DISPLAY_PIN_ROW1 3       // Display row 1 on GPIO3 (add ROW2/ROW3 for 3-4 row boards)
 #define RTC_SDA_PIN      5       // RTC I2C data pin on GPIO5
 #define RTC_SCL_PIN      6       // RTC I2C clock pin on GPIO 6
 #define TEMPERATURE_PIN  2       // DS18B20 temperature sensor on GPIO2
 #define TEMPERATURE_OFFSET 0.0  // Temperature calibration offset (degrees C)
+#define TEMPERATURE_RESOLUTION 12     // DS18B20 resolution, 9-12 bits (94-750 ms conversion)
+#define TEMPERATURE_DISPLAY_SENSOR 0  // Sensor shown on the display (bus search order)
 #define BUTTON_PIN       0       // Button on GPIO0 (CAUTION: boot button)
 
 // Display dimension configuration
@@ -63,42 +65,101 @@
 #define PANEL_HEIGHT    16      // Height of each panel in pixels
 #define DISPLAY_ROWS    2       // Number of physical display rows
 
+// Panel wiring layout (order the LEDs are chained within each panel)
+#define PANEL_LAYOUT_COLUMN_SERPENTINE  0  // Columns, alternate columns reversed (panel rotated 90°)
+#define PANEL_LAYOUT_COLUMN_PROGRESSIVE 1  // Columns, all top-to-bottom
+#define PANEL_LAYOUT_ROW_SERPENTINE     2  // Rows, alternate rows reversed
+#define PANEL_LAYOUT_ROW_PROGRESSIVE    3  // Rows, all left-to-right
+#define PANEL_LAYOUT    PANEL_LAYOUT_COLUMN_SERPENTINE
+
 // Display color configuration (RGB)
 #define DISPLAY_COLOR_R 255     // Red component (0-255)
 #define DISPLAY_COLOR_G 0       // Green component (0-255)
 #define DISPLAY_COLOR_B 0       // Blue component (0-255)
-#define BRIGHTNESS      255     // 0-255 (keeping dim for development)
+
+// Brightness (see display_brightness.h) - levels are perceptual 0-255 and go
+// through a gamma LUT before reaching the LEDs. Caps and the night window are
+// defaults for the MQTT config keys of the same purpose
+#define BRIGHTNESS        255   // Daytime cap
+#define BRIGHTNESS_NIGHT  64    // Cap between NIGHT_START_HOUR and NIGHT_END_HOUR
+#define BRIGHTNESS_MIN    12    // Light sensor in full darkness
+#define NIGHT_START_HOUR  20    // Local hour the night cap begins (equal hours = no night)
+#define NIGHT_END_HOUR    7     // Local hour the day cap resumes
+
+// Ambient light sensor - LDR divider on an ADC pin, brighter = higher reading
+// (-1 = not fitted: brightness follows the caps alone; ESP8266 can only use A0)
+#ifndef LIGHT_SENSOR_PIN
+  #define LIGHT_SENSOR_PIN -1
+#endif
+
+// LED current budget at 5 V, using FastLED's per-LED power model. Frames that
+// would draw more are scaled down as a whole (0 = no limit)
+#ifndef POWER_BUDGET_MA
+  #define POWER_BUDGET_MA 5000
+#endif
+
+// Marquee (scrolling text) - one pixel per frame. A 4-panel row is 1024 LEDs,
+// about 31 ms on the wire, so ~30 fps is the ceiling; ESP8266 bit-bangs with
+// the CPU and runs slower to leave loop() time for WiFi
+#ifndef MARQUEE_FRAME_MS
+  #if defined(ESP32)
+    #define MARQUEE_FRAME_MS 33   // ~30 fps
+  #else
+    #define MARQUEE_FRAME_MS 50   // 20 fps
+  #endif
+#endif
 
 // Activity pixel - blinks bottom-right pixel of each row every second
 #define ACTIVITY_PIXEL_ENABLED true
 
-// Per-row panel counts (allows different widths per row)
+// Display benchmark - adds the "bench" MQTT command (render timings and
+// golden-frame checks, see display_bench.h). Development builds only:
+// enable with -DDISPLAY_BENCHMARK=1 in build flags.
+#ifndef DISPLAY_BENCHMARK
+  #define DISPLAY_BENCHMARK 0
+#endif
+
+// WiFi fast reconnect - at boot the last good access point is joined directly
+// (cached BSSID and channel, see wifi_fast_connect.h) before AutoConnect scans.
+// WIFI_FAST_CONNECT_REUSE_IP=1 also reuses the last DHCP lease as a static
+// address and skips DHCP - only safe where the router reserves that address
+// for the device.
+#ifndef WIFI_FAST_CONNECT_REUSE_IP
+  #define WIFI_FAST_CONNECT_REUSE_IP 0
+#endif
+
+// Per-row panel counts (allows different widths per row), one entry per row
 // Example: Row 0 = 3 panels (48px wide), Row 1 = 4 panels (64px wide)
-static const uint8_t PANELS_PER_ROW[DISPLAY_ROWS] = {4, 4};
+// constexpr so display buffers and LED storage are sized from it at compile time
+static constexpr uint8_t PANELS_PER_ROW[] = {4, 4};
 
-// Display pin configuration (one GPIO per row)
-static const uint8_t DISPLAY_PINS[DISPLAY_ROWS] = {DISPLAY_PIN_ROW0, DISPLAY_PIN_ROW1};
+// Display pin configuration (one GPIO per row, one FastLED controller each)
+static constexpr uint8_t DISPLAY_PINS[] = {DISPLAY_PIN_ROW0, DISPLAY_PIN_ROW1};
+
+static_assert(sizeof(PANELS_PER_ROW) == DISPLAY_ROWS, "PANELS_PER_ROW needs one entry per display row");
+static_assert(sizeof(DISPLAY_PINS) == DISPLAY_ROWS, "DISPLAY_PINS needs one entry per display row");
 
 // Helper macros for calculating row dimensions
 #define ROW_WIDTH(row) (PANELS_PER_ROW[row] * PANEL_WIDTH)
 #define ROW_PIXELS(row) (ROW_WIDTH(row) * PANEL_HEIGHT)
 
-// Calculate maximum row width (for buffer sizing)
-inline uint8_t getMaxPanelsPerRow() {
-  uint8_t maxPanels = 0;
-  for (uint8_t i = 0; i < DISPLAY_ROWS; i++) {
-    if (PANELS_PER_ROW[i] > maxPanels) maxPanels = PANELS_PER_ROW[i];
-  }
-  return maxPanels;
+// Widest configured row in panels, from fromRow onwards (for buffer sizing)
+constexpr uint8_t getMaxPanelsPerRow(uint8_t fromRow = 0) {
+  return (fromRow >= DISPLAY_ROWS) ? 0 :
+         (PANELS_PER_ROW[fromRow] > getMaxPanelsPerRow(fromRow + 1)) ? PANELS_PER_ROW[fromRow] :
+         getMaxPanelsPerRow(fromRow + 1);
+}
+
+// Pixels in all rows before this one - where the row starts in LED storage
+// and the display buffer. 32-bit so oversized configs fail static_asserts
+// instead of wrapping
+constexpr uint32_t getRowPixelOffset(uint8_t row) {
+  return (row == 0) ? 0 : getRowPixelOffset(row - 1) + ROW_PIXELS(row - 1);
 }
 
-// Calculate total pixels across all rows
-inline uint16_t getTotalPixels() {
-  uint16_t total = 0;
-  for (uint8_t i = 0; i < DISPLAY_ROWS; i++) {
-    total += ROW_PIXELS(i);
-  }
-  return total;
+// Total pixels across all rows
+constexpr uint32_t getTotalPixels() {
+  return getRowPixelOffset(DISPLAY_ROWS);
 }
 
 #endif
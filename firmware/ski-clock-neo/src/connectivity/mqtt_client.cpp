@@ -2,11 +2,18 @@
 // mqtt_client.cpp - MQTT communication with HiveMQ Cloud
 // ============================================================================
 // This library manages MQTT connectivity and messaging:
-// - TLS-encrypted connection to HiveMQ Cloud
+// - TLS-encrypted connection to HiveMQ Cloud (ESP8266 resumes the TLS
+//   session on reconnect; the ESP32 core has no session API)
+// - Prioritized outbound queue drained by one worker (a task pinned to
+//   core 0 on ESP32, loop() on ESP8266) so network stalls never reach timers
 // - Heartbeat publishing every 60 seconds
 // - Version checking and OTA update triggering
 // - Display snapshot publishing (hourly + on-demand)
-// - Remote command handling (restart, rollback, snapshot)
+// - Live display mirroring (binary keyframe + XOR/RLE deltas, remote TTL)
+// - Remote command handling (restart, rollback, snapshot, mirror, stats)
+// - Inbound topics matched and payloads parsed in place (no String copies)
+// - Timer/render latency summary in the heartbeat, full dump on "stats"
+// - Render benchmark reports on "bench" (DISPLAY_BENCHMARK builds)
 // - Event queue flushing on connect
 // ============================================================================
 
@@ -20,8 +27,15 @@
 #include "../core/device_config.h"
 #include "../data/data_time.h"
 #include "ota_update.h"
+#include "mqtt_queue.h"
 #include "../display/display_core.h"
+#include "../display/display_bench.h"
+#include "../display/display_controller.h"
+#include "../display/display_brightness.h"
 #include "../core/event_log.h"
+#include "../core/timer_helpers.h"
+#include "../core/json_scan.h"
+#include "mqtt_wire_format.h"
 
 // ============================================================================
 // CONSTANTS
@@ -38,22 +52,56 @@ const char MQTT_TOPIC_OTA_START[] = "ota/start";
 const char MQTT_TOPIC_OTA_PROGRESS[] = "ota/progress";
 const char MQTT_TOPIC_OTA_COMPLETE[] = "ota/complete";
 const char MQTT_TOPIC_DISPLAY_SNAPSHOT[] = "display/snapshot";
+const char MQTT_TOPIC_DISPLAY_DELTA[] = "display/delta";
 const char MQTT_TOPIC_EVENTS[] = "event";
+const char MQTT_TOPIC_EVENTS_BATCH[] = "event/batch";
+const char MQTT_TOPIC_STATS[] = "stats";
+const char MQTT_TOPIC_BENCH[] = "bench";
+const char MQTT_TOPIC_DISPLAY_FRAME[] = "display/frame";
 
 const unsigned long HEARTBEAT_INTERVAL = 60000;
 const unsigned long DISPLAY_SNAPSHOT_INTERVAL = 3600000;
 
+const unsigned long DISPLAY_MIRROR_DEFAULT_TTL = 300;      // Seconds if the command gives no ttl
+const unsigned long DISPLAY_MIRROR_MAX_TTL = 3600;         // Upper bound on a single mirror session
+const unsigned long DISPLAY_MIRROR_MIN_INTERVAL = 500;     // Minimum ms between delta messages
+const uint8_t DISPLAY_MIRROR_KEYFRAME_EVERY = 60;          // Deltas between periodic keyframes
+
+const uint8_t MQTT_DRAIN_BUDGET = 4;                       // Queued items sent per updateMQTT() pass
+
+#if defined(ESP32)
+  #define MQTT_WORKER_STACK_SIZE 8192   // TLS, plus OTA downloads started by commands
+  #define MQTT_WORKER_PRIORITY 1        // Same as loop(), below the display tasks
+  #define MQTT_WORKER_CORE 0            // WiFi/lwIP core, opposite the display on core 1
+  #define MQTT_WORKER_IDLE_MS 10        // Longest wait between inbound polls
+#endif
+
 // ============================================================================
 // STATE VARIABLES
 // ============================================================================
 
 WiFiClientSecure wifiSecureClient;
+#if defined(ESP8266)
+  static BearSSL::Session tlsSession;             // Resumed on reconnect (abbreviated handshake)
+#endif
 PubSubClient mqttClient(wifiSecureClient);
 Ticker heartbeatTicker;
 Ticker displaySnapshotTicker;
 bool mqttIsConnected = false;
 bool mqttInitialized = false;
 
+static char connectedSsid[33] = "";              // Captured on connect for the heartbeat (WiFi.SSID() allocates)
+
+// Display mirror state (delta stream is only published while a session is active)
+static bool mirrorActive = false;
+static unsigned long mirrorStartedAt = 0;           // millis() when the session was (re)started
+static unsigned long mirrorTtlMs = 0;               // Session length
+static unsigned long lastMirrorPublish = 0;         // millis() of the last delta/keyframe
+static bool mirrorKeyframePending = false;          // Next message must be a keyframe
+static uint8_t mirrorDeltasSinceKeyframe = 0;
+static uint32_t mirrorBaseSequence = 0;             // Frame sequence of mirrorPrevious
+static uint8_t mirrorPrevious[MAX_DISPLAY_BUFFER_SIZE]; // Last frame sent (XOR reference)
+
 static const char BASE64_CHARS[] PROGMEM = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 
 // ============================================================================
@@ -61,88 +109,225 @@ static const char BASE64_CHARS[] PROGMEM = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghij
 // ============================================================================
 
 void mqttCallback(char* topic, byte* payload, unsigned int length);
-String base64Encode(const uint8_t* data, uint16_t length);
+static void requestHeartbeat();
+static void requestDisplaySnapshot();
+#if defined(ESP32)
+static void startMqttWorker();
+#endif
+static void updateDisplayMirror();
+#if DISPLAY_BENCHMARK
+static void publishBenchmarkReport();
+#endif
+
+// ============================================================================
+// TOPIC TABLE
+// ============================================================================
+// Every device topic ("norrtek-iot/<env>/<base>/<deviceId>") is formatted
+// once into a fixed slot by rebuildMqttTopics() - on connect and when the
+// environment changes - so publishing never allocates. Incoming topics are
+// matched against the subscribed slots by length and FNV-1a hash, then
+// confirmed with memcmp; retained version responses arrive in a burst after
+// reconnecting and are dispatched without building Strings.
+// Order must match MqttTopicId.
+
+#define MQTT_TOPIC_SIZE 96
+
+struct TopicEntry {
+  const char* basePath;
+  char topic[MQTT_TOPIC_SIZE];
+  uint16_t length;
+  uint32_t hash;
+};
+
+static TopicEntry topicTable[] = {
+  {MQTT_TOPIC_HEARTBEAT, "", 0, 0},
+  {MQTT_TOPIC_INFO, "", 0, 0},
+  {MQTT_TOPIC_VERSION_RESPONSE, "", 0, 0},
+  {MQTT_TOPIC_COMMAND, "", 0, 0},
+  {MQTT_TOPIC_CONFIG, "", 0, 0},
+  {MQTT_TOPIC_OTA_START, "", 0, 0},
+  {MQTT_TOPIC_OTA_PROGRESS, "", 0, 0},
+  {MQTT_TOPIC_OTA_COMPLETE, "", 0, 0},
+  {MQTT_TOPIC_DISPLAY_SNAPSHOT, "", 0, 0},
+  {MQTT_TOPIC_DISPLAY_DELTA, "", 0, 0},
+  {MQTT_TOPIC_EVENTS, "", 0, 0},
+  {MQTT_TOPIC_EVENTS_BATCH, "", 0, 0},
+  {MQTT_TOPIC_STATS, "", 0, 0},
+  {MQTT_TOPIC_BENCH, "", 0, 0},
+  {MQTT_TOPIC_DISPLAY_FRAME, "", 0, 0},
+};
+
+static_assert(sizeof(topicTable) / sizeof(topicTable[0]) == TOPIC_COUNT, "topicTable must list every MqttTopicId");
+
+// Topics the device subscribes to (and dispatches in mqttCallback)
+static const MqttTopicId SUBSCRIBED_TOPICS[] = {TOPIC_VERSION_RESPONSE, TOPIC_COMMAND, TOPIC_CONFIG, TOPIC_DISPLAY_FRAME};
+static const uint8_t SUBSCRIBED_TOPIC_COUNT = sizeof(SUBSCRIBED_TOPICS) / sizeof(SUBSCRIBED_TOPICS[0]);
+
+static uint32_t hashTopic(const char* topic, size_t length) {
+  uint32_t hash = 2166136261UL;   // FNV-1a offset basis
+  for (size_t i = 0; i < length; i++) {
+    hash ^= (uint8_t)topic[i];
+    hash *= 16777619UL;           // FNV-1a prime
+  }
+  return hash;
+}
+
+static MqttTopicId matchInboundTopic(const char* topic) {
+  size_t length = strlen(topic);
+  uint32_t hash = hashTopic(topic, length);
+  
+  for (uint8_t i = 0; i < SUBSCRIBED_TOPIC_COUNT; i++) {
+    const TopicEntry& entry = topicTable[SUBSCRIBED_TOPICS[i]];
+    if (entry.length == length && entry.hash == hash && memcmp(entry.topic, topic, length) == 0) {
+      return SUBSCRIBED_TOPICS[i];
+    }
+  }
+  return TOPIC_COUNT;
+}
 
 // ============================================================================
 // MQTT MESSAGE CALLBACK
 // ============================================================================
 
-void mqttCallback(char* topic, byte* payload, unsigned int length) {
-  String topicStr = String(topic);
-  String message = "";
-  for (unsigned int i = 0; i < length; i++) {
-    message += (char)payload[i];
+// {"latest_version": "x.y.z", "update_available": true, "pinned": false, ...}
+static void handleVersionResponse(const char* json, size_t length) {
+  DEBUG_PRINTLN("Version response received!");
+  
+  bool updateAvailable = false;
+  if (!jsonGetBool(json, length, "update_available", &updateAvailable) || !updateAvailable) {
+    DEBUG_PRINTLN("Firmware is up to date");
+    return;
   }
   
-  DEBUG_PRINT("MQTT message received on topic: ");
-  DEBUG_PRINTLN(topicStr);
-  DEBUG_PRINT("Message: ");
-  DEBUG_PRINTLN(message);
+  char latestVersion[32];
+  if (!jsonGetString(json, length, "latest_version", latestVersion, sizeof(latestVersion))) {
+    return;
+  }
+  DEBUG_PRINT("New version available: ");
+  DEBUG_PRINTLN(latestVersion);
   
-  String versionResponseTopic = buildDeviceTopic(MQTT_TOPIC_VERSION_RESPONSE);
-  if (topicStr == versionResponseTopic) {
-    DEBUG_PRINTLN("Version response received!");
-    
-    if (message.indexOf("\"update_available\": true") > 0 || message.indexOf("\"update_available\":true") > 0) {
-      int versionIndex = message.indexOf("\"latest_version\"");
-      if (versionIndex > 0) {
-        int colonIndex = message.indexOf(":", versionIndex);
-        int quoteStart = message.indexOf("\"", colonIndex + 1);
-        int quoteEnd = message.indexOf("\"", quoteStart + 1);
-        
-        if (quoteStart > 0 && quoteEnd > quoteStart) {
-          String latestVersion = message.substring(quoteStart + 1, quoteEnd);
-          DEBUG_PRINT("New version available: ");
-          DEBUG_PRINTLN(latestVersion);
-          
-          bool isPinned = false;
-          int pinnedIndex = message.indexOf("\"pinned\"");
-          if (pinnedIndex > 0) {
-            int pinnedColonIndex = message.indexOf(":", pinnedIndex);
-            if (pinnedColonIndex > pinnedIndex) {
-              String valueSection = message.substring(pinnedColonIndex + 1, pinnedColonIndex + 10);
-              valueSection.toLowerCase();
-              valueSection.trim();
-              isPinned = valueSection.startsWith("true");
-            }
-          }
-          if (isPinned) {
-            DEBUG_PRINTLN("Device is pinned to this version");
-          }
-          
-          triggerOTAUpdate(latestVersion, isPinned);
-        }
-      }
-    } else {
-      DEBUG_PRINTLN("Firmware is up to date");
-    }
+  bool isPinned = false;
+  jsonGetBool(json, length, "pinned", &isPinned);
+  if (isPinned) {
+    DEBUG_PRINTLN("Device is pinned to this version");
   }
   
-  String commandTopic = buildDeviceTopic(MQTT_TOPIC_COMMAND);
-  if (topicStr == commandTopic) {
-    DEBUG_PRINTLN("Command received!");
-    
-    if (message.indexOf("rollback") >= 0) {
-      DEBUG_PRINTLN("Executing rollback command");
-      handleRollbackCommand(message);
-    } else if (message.indexOf("restart") >= 0) {
-      DEBUG_PRINTLN("Executing restart command");
-      handleRestartCommand();
-    } else if (message.indexOf("snapshot") >= 0) {
-      DEBUG_PRINTLN("Executing snapshot command");
-      publishDisplaySnapshot();
-    } else if (message.indexOf("info") >= 0) {
-      DEBUG_PRINTLN("Executing info command");
-      publishDeviceInfo();
-    } else {
-      DEBUG_PRINTLN("Unknown command type");
-    }
+  triggerOTAUpdate(latestVersion, isPinned);
+}
+
+// Older dashboards publish the bare command name ("restart") - take the
+// whole payload, trimmed, as the name
+static bool bareCommandName(const char* payload, size_t length, char* command, size_t commandSize) {
+  while (length > 0 && isspace((unsigned char)payload[0])) {
+    payload++;
+    length--;
+  }
+  while (length > 0 && isspace((unsigned char)payload[length - 1])) {
+    length--;
+  }
+  if (length == 0 || length >= commandSize || payload[0] == '{') {
+    return false;
   }
+  memcpy(command, payload, length);
+  command[length] = '\0';
+  return true;
+}
+
+// {"command": "<name>", ...arguments}, or just "<name>"
+static void handleCommandMessage(const char* json, size_t length) {
+  DEBUG_PRINTLN("Command received!");
   
-  String configTopic = buildDeviceTopic(MQTT_TOPIC_CONFIG);
-  if (topicStr == configTopic) {
-    DEBUG_PRINTLN("Config message received!");
-    handleConfigMessage(message);
+  char command[16];
+  if (!jsonGetString(json, length, "command", command, sizeof(command)) &&
+      !bareCommandName(json, length, command, sizeof(command))) {
+    DEBUG_PRINTLN("Unknown command type");
+    return;
+  }
+  
+  if (strcmp(command, "rollback") == 0) {
+    DEBUG_PRINTLN("Executing rollback command");
+    handleRollbackCommand(json, length);
+  } else if (strcmp(command, "restart") == 0) {
+    DEBUG_PRINTLN("Executing restart command");
+    handleRestartCommand();
+  } else if (strcmp(command, "snapshot") == 0) {
+    DEBUG_PRINTLN("Executing snapshot command");
+    requestMqttJob(publishDisplaySnapshot, MQTT_PRIORITY_SNAPSHOT);
+  } else if (strcmp(command, "mirror") == 0) {
+    DEBUG_PRINTLN("Executing mirror command");
+    handleMirrorCommand(json, length);
+  } else if (strcmp(command, "stats") == 0) {
+    DEBUG_PRINTLN("Executing stats command");
+    handleStatsCommand(json, length);
+  } else if (strcmp(command, "bench") == 0) {
+    DEBUG_PRINTLN("Executing bench command");
+    handleBenchCommand();
+  } else if (strcmp(command, "marquee") == 0) {
+    DEBUG_PRINTLN("Executing marquee command");
+    handleMarqueeCommand(json, length);
+  } else if (strcmp(command, "info") == 0) {
+    DEBUG_PRINTLN("Executing info command");
+    requestMqttJob(publishDeviceInfo, MQTT_PRIORITY_HEARTBEAT);
+  } else {
+    DEBUG_PRINTLN("Unknown command type");
+  }
+}
+
+// Binary payload on MQTT_TOPIC_DISPLAY_FRAME, integers little-endian:
+//   [0..1] hold time in seconds (0 = default, see showRemoteFrame())
+//   [2..]  bitmap, getDisplayBufferSize() bytes in frame buffer layout
+// (a display/snapshot's row "mono" bytes, concatenated). An empty payload
+// ends the hold.
+#define DISPLAY_FRAME_HEADER_SIZE 2
+
+static void handleDisplayFrame(const uint8_t* payload, size_t length) {
+  if (length == 0) {
+    DEBUG_PRINTLN("Remote frame cleared");
+    endRemoteFrame();
+    return;
+  }
+  
+  uint16_t expected = getDisplayBufferSize();
+  if (length != (size_t)expected + DISPLAY_FRAME_HEADER_SIZE) {
+    logEvent(EVT_DISPLAY_FRAME_REJECTED, (unsigned long)length, (unsigned long)(expected + DISPLAY_FRAME_HEADER_SIZE));
+    return;
+  }
+  
+  uint16_t ttlSeconds = payload[0] | ((uint16_t)payload[1] << 8);
+  if (showRemoteFrame(payload + DISPLAY_FRAME_HEADER_SIZE, expected, ttlSeconds)) {
+    DEBUG_PRINT("Remote frame shown for ");
+    DEBUG_PRINT(ttlSeconds);
+    DEBUG_PRINTLN(" s (0 = default)");
+  }
+}
+
+void mqttCallback(char* topic, byte* payload, unsigned int length) {
+  const char* json = (const char*)payload;
+  MqttTopicId topicId = matchInboundTopic(topic);
+  
+  DEBUG_PRINT("MQTT message received on topic: ");
+  DEBUG_PRINTLN(topic);
+  
+  // Binary bitmap - dispatched before the payload is logged as text
+  if (topicId == TOPIC_DISPLAY_FRAME) {
+    handleDisplayFrame(payload, length);
+    return;
+  }
+  DEBUG_PRINTF("Message: %.*s\n", (int)length, json);
+  
+  switch (topicId) {
+    case TOPIC_VERSION_RESPONSE:
+      handleVersionResponse(json, length);
+      break;
+    case TOPIC_COMMAND:
+      handleCommandMessage(json, length);
+      break;
+    case TOPIC_CONFIG:
+      DEBUG_PRINTLN("Config message received!");
+      handleConfigMessage(json, length);
+      break;
+    default:
+      break;
   }
 }
 
@@ -154,6 +339,9 @@ void initMQTT() {
   DEBUG_PRINTLN("Initializing MQTT client...");
   
   wifiSecureClient.setInsecure();
+  #if defined(ESP8266)
+    wifiSecureClient.setSession(&tlsSession);
+  #endif
   
   mqttClient.setServer(MQTT_HOST, MQTT_PORT);
   mqttClient.setCallback(mqttCallback);
@@ -168,8 +356,12 @@ void initMQTT() {
   mqttInitialized = true;
 
   if (WiFi.status() == WL_CONNECTED) {
-    connectMQTT();
+    requestMQTTConnect();
   }
+  
+  #if defined(ESP32)
+    startMqttWorker();
+  #endif
 }
 
 // ============================================================================
@@ -201,38 +393,33 @@ bool connectMQTT() {
     DEBUG_PRINTLN("MQTT connected successfully");
     setConnectivityState(true, true);
     mqttIsConnected = true;
+    rebuildMqttTopics();
+    strlcpy(connectedSsid, WiFi.SSID().c_str(), sizeof(connectedSsid));
 
-    logEvent("mqtt_connect");
+    logEvent(EVT_MQTT_CONNECT);
     setEventLogReady(true);
-    flushEventQueue();
+    requestMqttJob(flushEventQueue, MQTT_PRIORITY_EVENT);
 
-    String versionResponseTopic = buildDeviceTopic(MQTT_TOPIC_VERSION_RESPONSE);
-    if (mqttClient.subscribe(versionResponseTopic.c_str())) {
-      DEBUG_PRINT("Subscribed: ");
-      DEBUG_PRINTLN(versionResponseTopic);
-    }
-    
-    String commandTopic = buildDeviceTopic(MQTT_TOPIC_COMMAND);
-    if (mqttClient.subscribe(commandTopic.c_str())) {
-      DEBUG_PRINT("Subscribed: ");
-      DEBUG_PRINTLN(commandTopic);
-    }
-    
-    String configTopic = buildDeviceTopic(MQTT_TOPIC_CONFIG);
-    if (mqttClient.subscribe(configTopic.c_str())) {
-      DEBUG_PRINT("Subscribed: ");
-      DEBUG_PRINTLN(configTopic);
+    for (uint8_t i = 0; i < SUBSCRIBED_TOPIC_COUNT; i++) {
+      const char* topic = mqttTopic(SUBSCRIBED_TOPICS[i]);
+      if (mqttClient.subscribe(topic)) {
+        DEBUG_PRINT("Subscribed: ");
+        DEBUG_PRINTLN(topic);
+      }
     }
     
-    publishDeviceInfo();
+    requestMqttJob(publishDeviceInfo, MQTT_PRIORITY_HEARTBEAT);
     
     heartbeatTicker.detach();
-    heartbeatTicker.attach_ms(HEARTBEAT_INTERVAL, publishHeartbeat);
-    publishHeartbeat();
+    heartbeatTicker.attach_ms(HEARTBEAT_INTERVAL, requestHeartbeat);
+    requestHeartbeat();
 
     displaySnapshotTicker.detach();
-    displaySnapshotTicker.attach_ms(DISPLAY_SNAPSHOT_INTERVAL, publishDisplaySnapshot);
-    publishDisplaySnapshot();
+    displaySnapshotTicker.attach_ms(DISPLAY_SNAPSHOT_INTERVAL, requestDisplaySnapshot);
+    requestDisplaySnapshot();
+    
+    // A mirror session survives reconnects, but the dashboard needs a fresh keyframe
+    mirrorKeyframePending = true;
         
     return true;
   } else {
@@ -252,7 +439,7 @@ void disconnectMQTT() {
   displaySnapshotTicker.detach();
   
   if (mqttIsConnected) {
-    logEvent("mqtt_disconnect");
+    logEvent(EVT_MQTT_DISCONNECT);
   }
   setEventLogReady(false);
   
@@ -278,6 +465,9 @@ void resetMQTTReconnectTimer() {
 }
 
 void updateMQTT() {
+  processDeferredMQTT();
+  updateEventLog();
+  
   if (mqttIsConnected && !mqttClient.connected()) {
     DEBUG_PRINTLN("MQTT connection lost unexpectedly, cleaning up...");
     disconnectMQTT();
@@ -313,29 +503,101 @@ void updateMQTT() {
   
   if (mqttClient.connected()) {
     mqttClient.loop();
+    
+    drainMqttQueue(MQTT_DRAIN_BUDGET);
+    
+    // Mirror deltas are the least urgent traffic - only when the queue is clear
+    if (!isMqttQueuePending(MQTT_PRIORITY_SNAPSHOT)) {
+      updateDisplayMirror();
+    }
+    
+    #if DISPLAY_BENCHMARK
+    publishBenchmarkReport();
+    #endif
   }
 }
 
+// ============================================================================
+// WORKER TASK (ESP32)
+// ============================================================================
+// The connection, inbound dispatch and every publish run on this one task.
+// Tickers, the event log and OTA only queue work and notify it, so a TLS
+// write blocked on a slow socket can't hold up the timer scheduler or the
+// display, which run on the other core. ESP8266 calls updateMQTT() from
+// loop() instead and relies on MQTT_DRAIN_BUDGET to keep passes short.
+
+#if defined(ESP32)
+static TaskHandle_t mqttWorkerHandle = NULL;
+
+static void mqttWorkerTask(void* parameter) {
+  for (;;) {
+    updateMQTT();
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(MQTT_WORKER_IDLE_MS));
+  }
+}
+
+static void startMqttWorker() {
+  if (mqttWorkerHandle != NULL) {
+    return;
+  }
+  
+  #if defined(CONFIG_IDF_TARGET_ESP32C3)
+    // ESP32-C3: Single-core RISC-V, use xTaskCreate
+    xTaskCreate(
+      mqttWorkerTask,
+      "MQTT",
+      MQTT_WORKER_STACK_SIZE,
+      NULL,
+      MQTT_WORKER_PRIORITY,
+      &mqttWorkerHandle
+    );
+  #else
+    // ESP32/ESP32-S3: Dual-core Xtensa, pin opposite the display
+    xTaskCreatePinnedToCore(
+      mqttWorkerTask,
+      "MQTT",
+      MQTT_WORKER_STACK_SIZE,
+      NULL,
+      MQTT_WORKER_PRIORITY,
+      &mqttWorkerHandle,
+      MQTT_WORKER_CORE
+    );
+  #endif
+  
+  if (mqttWorkerHandle == NULL) {
+    DEBUG_PRINTLN("ERROR: Failed to create MQTT worker task");
+    return;
+  }
+  setMqttQueueWorker(mqttWorkerHandle);
+  DEBUG_PRINTLN("MQTT worker task started");
+}
+#endif
+
 // ============================================================================
 // MQTT PUBLISHING HELPERS
 // ============================================================================
 
-String buildDeviceTopic(const char* basePath) {
-  String topic = "norrtek-iot/";
-  topic += getEnvironmentScope();
-  topic += '/';
-  topic += basePath;
-  topic += '/';
-  topic += getDeviceID();
-  return topic;
+void rebuildMqttTopics() {
+  String deviceId = getDeviceID();
+  const char* scope = getEnvironmentScope();
+  
+  for (uint8_t i = 0; i < TOPIC_COUNT; i++) {
+    TopicEntry& entry = topicTable[i];
+    int written = snprintf(entry.topic, sizeof(entry.topic), "norrtek-iot/%s/%s/%s",
+                           scope, entry.basePath, deviceId.c_str());
+    if (written < 0 || written >= (int)sizeof(entry.topic)) {
+      DEBUG_PRINT("MQTT topic too long: ");
+      DEBUG_PRINTLN(entry.basePath);
+      entry.topic[0] = '\0';
+      written = 0;
+    }
+    entry.length = written;
+    entry.hash = hashTopic(entry.topic, entry.length);
+  }
 }
 
-String buildBaseTopic(const char* basePath) {
-  String topic = "norrtek-iot/";
-  topic += getEnvironmentScope();
-  topic += '/';
-  topic += basePath;
-  return topic;
+const char* mqttTopic(MqttTopicId id) {
+  return (id < TOPIC_COUNT) ? topicTable[id].topic : "";
 }
 
 bool publishMqttPayload(const char* topic, const char* payload) {
@@ -357,12 +619,32 @@ bool publishMqttPayload(const char* topic, const char* payload) {
   }
 }
 
-bool publishMqttPayload(const String& topic, const char* payload) {
-  return publishMqttPayload(topic.c_str(), payload);
+bool publishMqttPayload(MqttTopicId topic, const char* payload) {
+  return publishMqttPayload(mqttTopic(topic), payload);
+}
+
+bool publishMqttPayload(MqttTopicId topic, const uint8_t* payload, unsigned int length) {
+  return publishMqttPayload(mqttTopic(topic), payload, length);
 }
 
-bool publishMqttPayload(const String& topic, const String& payload) {
-  return publishMqttPayload(topic.c_str(), payload.c_str());
+bool publishMqttPayload(const char* topic, const uint8_t* payload, unsigned int length) {
+  if (!mqttClient.connected()) {
+    DEBUG_PRINTLN("MQTT not connected, cannot publish");
+    return false;
+  }
+  
+  if (mqttClient.publish(topic, payload, length)) {
+    DEBUG_PRINT("Published to ");
+    DEBUG_PRINT(topic);
+    DEBUG_PRINT(": ");
+    DEBUG_PRINT(length);
+    DEBUG_PRINTLN(" bytes");
+    return true;
+  } else {
+    DEBUG_PRINT("Failed to publish to ");
+    DEBUG_PRINTLN(topic);
+    return false;
+  }
 }
 
 // ============================================================================
@@ -375,114 +657,270 @@ const uint32_t HEAP_WARNING_THRESHOLD = 20000;
 static bool lastRssiWasLow = false;
 static bool lastHeapWasLow = false;
 
-void publishHeartbeat() {
-  if (!mqttClient.connected()) return;
+// Compact timing summary: worst timer dispatch lateness (and which timer),
+// slowest callback, frame build/show times and the tightest task stack
+static void formatTimingSummary(char* buf, size_t size) {
+  uint32_t lateMaxUs = 0;
+  const char* lateTimer = "";
+  uint32_t runMaxUs = 0;
+  uint32_t stackFree = 0;
+  
+  TimerStats stats;
+  for (uint8_t i = 0; i < getTimerCount(); i++) {
+    if (!getTimerStats(i, stats)) continue;
+    if (stats.lateness.maxUs > lateMaxUs) {
+      lateMaxUs = stats.lateness.maxUs;
+      lateTimer = stats.name;
+    }
+    if (stats.runtime.maxUs > runMaxUs) {
+      runMaxUs = stats.runtime.maxUs;
+    }
+    if (stats.stackFree > 0 && (stackFree == 0 || stats.stackFree < stackFree)) {
+      stackFree = stats.stackFree;
+    }
+  }
+  
+  TimingStat build, show;
+  getRenderTimingStats(build, show);
+  
+  snprintf(buf, size,
+    "{\"late_max_ms\":%lu,\"late_timer\":\"%s\",\"run_max_us\":%lu,\"build_avg_us\":%lu,\"show_avg_us\":%lu,\"show_max_us\":%lu,\"stack_free\":%lu}",
+    (unsigned long)(lateMaxUs / 1000),
+    lateTimer,
+    (unsigned long)runMaxUs,
+    (unsigned long)timingAverage(build),
+    (unsigned long)timingAverage(show),
+    (unsigned long)show.maxUs,
+    (unsigned long)stackFree
+  );
+}
+
+bool publishHeartbeat() {
+  if (!mqttClient.connected()) return true;
   
   int32_t rssi = WiFi.RSSI();
   uint32_t freeHeap = ESP.getFreeHeap();
   
   bool rssiIsLow = (rssi < RSSI_WARNING_THRESHOLD);
   if (rssiIsLow && !lastRssiWasLow) {
-    static char eventData[48];
-    snprintf(eventData, sizeof(eventData), "{\"rssi\":%ld,\"threshold\":%ld}", rssi, RSSI_WARNING_THRESHOLD);
-    logEvent("wifi_rssi_low", eventData);
+    logEvent(EVT_WIFI_RSSI_LOW, rssi, RSSI_WARNING_THRESHOLD);
   }
   lastRssiWasLow = rssiIsLow;
   
   bool heapIsLow = (freeHeap < HEAP_WARNING_THRESHOLD);
   if (heapIsLow && !lastHeapWasLow) {
-    static char eventData[48];
-    snprintf(eventData, sizeof(eventData), "{\"free_heap\":%lu,\"threshold\":%lu}", freeHeap, HEAP_WARNING_THRESHOLD);
-    logEvent("low_heap_warning", eventData);
+    logEvent(EVT_LOW_HEAP_WARNING, freeHeap, HEAP_WARNING_THRESHOLD);
   }
   lastHeapWasLow = heapIsLow;
   
-  static char payload[192];
+  static char timing[192];
+  formatTimingSummary(timing, sizeof(timing));
+  
+  IPAddress ip = WiFi.localIP();
+  
+  static char payload[384];
   snprintf(payload, sizeof(payload),
-    "{\"uptime\":%lu,\"rssi\":%ld,\"free_heap\":%lu,\"ssid\":\"%s\",\"ip\":\"%s\"}",
+    "{\"uptime\":%lu,\"rssi\":%ld,\"free_heap\":%lu,\"ssid\":\"%s\",\"ip\":\"%u.%u.%u.%u\",\"timing\":%s}",
     millis() / 1000,
     rssi,
     freeHeap,
-    WiFi.SSID().c_str(),
-    WiFi.localIP().toString().c_str()
+    connectedSsid,
+    ip[0], ip[1], ip[2], ip[3],
+    timing
   );
   
-  publishMqttPayload(buildDeviceTopic(MQTT_TOPIC_HEARTBEAT), payload);
+  if (!publishMqttPayload(TOPIC_HEARTBEAT, payload)) {
+    return false;
+  }
+  logBootOnline();  // No-op after the first
+  return true;
+}
+
+// Ticker callback - the heartbeat is built by the worker when it is sent, so
+// a backed-up queue never holds more than one
+static void requestHeartbeat() {
+  requestMqttJob(publishHeartbeat, MQTT_PRIORITY_HEARTBEAT);
 }
 
 // ============================================================================
 // DEVICE INFO PUBLISHING
 // ============================================================================
 
-void publishDeviceInfo() {
-  if (!mqttClient.connected()) return;
+bool publishDeviceInfo() {
+  if (!mqttClient.connected()) return true;
   
   DEBUG_PRINTLN("Publishing device info...");
   
   static char payload[512];
   
+  BrightnessSchedule schedule = getBrightnessSchedule();
   time_t currentTime = getCurrentTime();
   if (currentTime > 0) {
     snprintf(payload, sizeof(payload),
-      "{\"product\":\"%s\",\"board\":\"%s\",\"version\":\"%s\",\"environment\":\"%s\",\"config\":{\"temp_offset\":%.1f},\"supported_commands\":[\"temp_offset\",\"rollback\",\"restart\",\"snapshot\",\"info\",\"environment\"],\"timestamp\":%lu}",
+      "{\"product\":\"%s\",\"board\":\"%s\",\"version\":\"%s\",\"environment\":\"%s\",\"config\":{\"temp_offset\":%.1f,\"brightness_day\":%u,\"brightness_night\":%u,\"night_start\":%u,\"night_end\":%u,\"revision\":%lu},\"supported_commands\":[\"temp_offset\",\"rollback\",\"restart\",\"snapshot\",\"mirror\",\"stats\",\"info\",\"environment\",\"marquee\",\"frame\"],\"timestamp\":%lu}",
       PRODUCT_NAME,
-      getBoardType().c_str(),
+      getBoardType(),
       FIRMWARE_VERSION,
       getEnvironmentScope(),
       getTemperatureOffset(),
+      schedule.dayLevel,
+      schedule.nightLevel,
+      schedule.nightStartHour,
+      schedule.nightEndHour,
+      (unsigned long)getDeviceConfigRevision(),
       (unsigned long)currentTime
     );
   } else {
     snprintf(payload, sizeof(payload),
-      "{\"product\":\"%s\",\"board\":\"%s\",\"version\":\"%s\",\"environment\":\"%s\",\"config\":{\"temp_offset\":%.1f},\"supported_commands\":[\"temp_offset\",\"rollback\",\"restart\",\"snapshot\",\"info\",\"environment\"]}",
+      "{\"product\":\"%s\",\"board\":\"%s\",\"version\":\"%s\",\"environment\":\"%s\",\"config\":{\"temp_offset\":%.1f,\"brightness_day\":%u,\"brightness_night\":%u,\"night_start\":%u,\"night_end\":%u,\"revision\":%lu},\"supported_commands\":[\"temp_offset\",\"rollback\",\"restart\",\"snapshot\",\"mirror\",\"stats\",\"info\",\"environment\",\"marquee\",\"frame\"]}",
       PRODUCT_NAME,
-      getBoardType().c_str(),
+      getBoardType(),
       FIRMWARE_VERSION,
       getEnvironmentScope(),
-      getTemperatureOffset()
+      getTemperatureOffset(),
+      schedule.dayLevel,
+      schedule.nightLevel,
+      schedule.nightStartHour,
+      schedule.nightEndHour,
+      (unsigned long)getDeviceConfigRevision()
     );
   }
   
-  if (publishMqttPayload(buildDeviceTopic(MQTT_TOPIC_INFO), payload)) {
-    DEBUG_PRINTLN("Device info published successfully");
+  if (!publishMqttPayload(TOPIC_INFO, payload)) {
+    return false;
   }
+  DEBUG_PRINTLN("Device info published successfully");
+  return true;
 }
 
 // ============================================================================
 // DISPLAY SNAPSHOT PUBLISHING
 // ============================================================================
 
-String base64Encode(const uint8_t* data, uint16_t length) {
-  if (!data || length == 0) {
-    return "";
+// Streams a payload into PubSubClient through one fixed scratch buffer.
+// beginPublish() needs the exact length up front, so the payload is emitted
+// twice by the same code: once with a counting stream, once for real.
+// Memory use is constant regardless of payload size (no String, no heap).
+#define MQTT_STREAM_SCRATCH_SIZE 64
+
+class MqttPayloadStream {
+public:
+  explicit MqttPayloadStream(bool countOnly)
+    : countOnly(countOnly), length(0), used(0), failed(false) {}
+  
+  void put(char c) {
+    length++;
+    if (countOnly) return;
+    scratch[used++] = (uint8_t)c;
+    if (used == sizeof(scratch)) flush();
   }
   
-  uint16_t encodedLen = ((length + 2) / 3) * 4;
-  String encoded;
-  encoded.reserve(encodedLen + 1);
+  void print(const char* str) {
+    while (*str) put(*str++);
+  }
   
-  uint16_t i = 0;
-  while (i < length) {
-    uint16_t remaining = length - i;
-    
-    uint32_t octet_a = data[i++];
-    uint32_t octet_b = remaining > 1 ? data[i++] : 0;
-    uint32_t octet_c = remaining > 2 ? data[i++] : 0;
+  void printUnsigned(unsigned long value) {
+    char digits[11];
+    snprintf(digits, sizeof(digits), "%lu", value);
+    print(digits);
+  }
+  
+  // Quoted JSON string, escaping quotes and backslashes
+  void printJsonString(const char* str, uint8_t maxLen) {
+    put('"');
+    for (uint8_t i = 0; i < maxLen && str[i] != '\0'; i++) {
+      if (str[i] == '"' || str[i] == '\\') put('\\');
+      put(str[i]);
+    }
+    put('"');
+  }
+  
+  void printBase64(const uint8_t* data, uint16_t len) {
+    for (uint16_t i = 0; i < len; i += 3) {
+      uint16_t remaining = len - i;
+      uint32_t triple = (uint32_t)data[i] << 16;
+      if (remaining > 1) triple |= (uint32_t)data[i + 1] << 8;
+      if (remaining > 2) triple |= data[i + 2];
+      
+      put(base64Char(triple >> 18));
+      put(base64Char(triple >> 12));
+      put(remaining > 1 ? base64Char(triple >> 6) : '=');
+      put(remaining > 2 ? base64Char(triple) : '=');
+    }
+  }
+  
+  // Send any buffered bytes; returns false if the client rejected a write
+  bool flush() {
+    if (!countOnly && used > 0) {
+      if (mqttClient.write(scratch, used) != used) failed = true;
+      used = 0;
+    }
+    return !failed;
+  }
+  
+  uint32_t size() const { return length; }
+
+private:
+  static char base64Char(uint32_t sextet) {
+    return (char)pgm_read_byte(&BASE64_CHARS[sextet & 0x3F]);
+  }
+  
+  bool countOnly;
+  uint32_t length;
+  uint8_t used;
+  bool failed;
+  uint8_t scratch[MQTT_STREAM_SCRATCH_SIZE];
+};
+
+// Emit the snapshot JSON (per-row format read by the dashboard)
+static void writeSnapshotPayload(MqttPayloadStream& out,
+                                 const DisplayConfig& cfg,
+                                 const uint8_t* buffer,
+                                 const char text[][MAX_TEXT_LENGTH],
+                                 uint8_t brightness,
+                                 time_t timestamp) {
+  char monoColorStr[24];
+  snprintf(monoColorStr, sizeof(monoColorStr), "[%u,%u,%u,%u]",
+           DISPLAY_COLOR_R, DISPLAY_COLOR_G, DISPLAY_COLOR_B, brightness);
+  
+  out.print("{\"rows\":[");
+  
+  for (uint8_t i = 0; i < cfg.rows; i++) {
+    if (i > 0) out.put(',');
     
-    uint32_t triple = (octet_a << 16) + (octet_b << 8) + octet_c;
+    const RowConfig& rowCfg = cfg.rowConfig[i];
+    uint16_t rowPixels = rowCfg.width * rowCfg.height;
+    uint16_t startByte = rowCfg.pixelOffset / 8;
+    uint16_t rowBytes = (rowPixels + 7) / 8;
     
-    encoded += (char)pgm_read_byte(&BASE64_CHARS[(triple >> 18) & 0x3F]);
-    encoded += (char)pgm_read_byte(&BASE64_CHARS[(triple >> 12) & 0x3F]);
-    encoded += (remaining > 1) ? (char)pgm_read_byte(&BASE64_CHARS[(triple >> 6) & 0x3F]) : '=';
-    encoded += (remaining > 2) ? (char)pgm_read_byte(&BASE64_CHARS[triple & 0x3F]) : '=';
+    out.print("{\"cols\":");
+    out.printUnsigned(rowCfg.panels);
+    out.print(",\"width\":");
+    out.printUnsigned(rowCfg.width);
+    out.print(",\"height\":");
+    out.printUnsigned(rowCfg.height);
+    out.print(",\"monoColor\":");
+    out.print(monoColorStr);
+    out.print(",\"text\":");
+    out.printJsonString(text[i], MAX_TEXT_LENGTH);
+    out.print(",\"mono\":\"");
+    out.printBase64(buffer + startByte, rowBytes);
+    out.print("\"}");
+  }
+  
+  out.put(']');
+  
+  if (timestamp > 0) {
+    out.print(",\"timestamp\":");
+    out.printUnsigned((unsigned long)timestamp);
   }
   
-  return encoded;
+  out.put('}');
 }
 
-void publishDisplaySnapshot() {
+bool publishDisplaySnapshot() {
   if (!mqttClient.connected()) {
-    return;
+    return true;
   }
   
   DEBUG_PRINTLN("Publishing display snapshot...");
@@ -491,103 +929,505 @@ void publishDisplaySnapshot() {
   
   if (cfg.rows == 0 || cfg.totalPixels == 0) {
     DEBUG_PRINTLN("Invalid display configuration, skipping snapshot");
-    return;
+    return true;
   }
   
-  createSnapshotBuffer();
-  
-  const uint8_t* buffer = getDisplayBuffer();
   uint16_t bufferSize = getDisplayBufferSize();
   
-  if (bufferSize == 0 || bufferSize > 1024) {
+  if (bufferSize == 0 || bufferSize > MAX_DISPLAY_BUFFER_SIZE) {
     DEBUG_PRINTLN("Invalid buffer size, skipping snapshot");
-    return;
+    return true;
   }
   
-  static char monoColorStr[32];
-  snprintf(monoColorStr, sizeof(monoColorStr), "[%u,%u,%u,%u]", 
-           DISPLAY_COLOR_R, DISPLAY_COLOR_G, DISPLAY_COLOR_B, BRIGHTNESS);
+  // Capture text, brightness and time once so both passes emit identical bytes
+  // (brightness is the LED scale the panel is showing, after dimming and the
+  // power limit)
+  char textSnapshot[DISPLAY_ROWS][MAX_TEXT_LENGTH];
+  snapshotAllText(textSnapshot);
+  uint8_t shownScale;
+  uint32_t powerLimitedFrames;
+  getShownBrightness(shownScale, powerLimitedFrames);
+  time_t currentTime = getCurrentTime();
   
-  String payload = "{\"rows\":[";
+  // Pin the latest frame so the renderer can't reuse it while we stream
+  const uint8_t* buffer = acquireDisplayBuffer();
   
-  for (uint8_t i = 0; i < cfg.rows; i++) {
-    if (i > 0) payload += ",";
-    
-    RowConfig& rowCfg = cfg.rowConfig[i];
-    const char* text = getText(i);
-    
-    uint16_t rowPixels = rowCfg.width * rowCfg.height;
-    uint16_t startBit = rowCfg.pixelOffset;
-    uint16_t startByte = startBit / 8;
-    uint16_t rowBytes = (rowPixels + 7) / 8;
-    
-    String rowBase64 = base64Encode(buffer + startByte, rowBytes);
+  MqttPayloadStream counter(true);
+  writeSnapshotPayload(counter, cfg, buffer, textSnapshot, shownScale, currentTime);
+  
+  const char* topic = mqttTopic(TOPIC_DISPLAY_SNAPSHOT);
+  bool published = false;
+  
+  if (mqttClient.beginPublish(topic, counter.size(), false)) {
+    MqttPayloadStream out(false);
+    writeSnapshotPayload(out, cfg, buffer, textSnapshot, shownScale, currentTime);
+    bool streamed = out.flush();
+    published = (mqttClient.endPublish() == 1) && streamed;
+  }
+  
+  releaseDisplayBuffer();
+  
+  if (published) {
+    DEBUG_PRINT("Display snapshot published successfully (");
+    DEBUG_PRINT(counter.size());
+    DEBUG_PRINTLN(" bytes)");
+  } else {
+    DEBUG_PRINT("Failed to publish to ");
+    DEBUG_PRINTLN(topic);
+  }
+  return published;
+}
+
+// Ticker callback - the snapshot is built by the worker, which is the only
+// display buffer reader (see acquireDisplayBuffer())
+static void requestDisplaySnapshot() {
+  requestMqttJob(publishDisplaySnapshot, MQTT_PRIORITY_SNAPSHOT);
+}
+
+// ============================================================================
+// DISPLAY MIRROR (DELTA STREAM)
+// ============================================================================
+// Binary payload on MQTT_TOPIC_DISPLAY_DELTA: a keyframe (row geometry and
+// RLE of the frame) or an XOR delta against the last frame sent. Layout and
+// constants in mqtt_wire_format.h, shared with the dashboard decoder.
+// ============================================================================
+
+static void putU16(MqttPayloadStream& out, uint16_t value) {
+  out.put((char)(value & 0xFF));
+  out.put((char)(value >> 8));
+}
+
+static void putU32(MqttPayloadStream& out, uint32_t value) {
+  putU16(out, value & 0xFFFF);
+  putU16(out, value >> 16);
+}
+
+// RLE of frame (previous == nullptr) or of frame XOR previous
+static void writeRle(MqttPayloadStream& out, const uint8_t* frame, const uint8_t* previous, uint16_t size) {
+  uint16_t i = 0;
+  while (i < size) {
+    uint8_t value = previous ? (frame[i] ^ previous[i]) : frame[i];
+    uint16_t start = i;
     
-    String escapedText = "";
-    for (int j = 0; text[j] != '\0' && j < MAX_TEXT_LENGTH; j++) {
-      if (text[j] == '"' || text[j] == '\\') {
-        escapedText += "\\";
+    if (value == 0) {
+      while (i < size && i - start < DISPLAY_RLE_MAX_RUN && (previous ? (frame[i] ^ previous[i]) : frame[i]) == 0) i++;
+      out.put((char)(i - start - 1));
+    } else {
+      while (i < size && i - start < DISPLAY_RLE_MAX_RUN && (previous ? (frame[i] ^ previous[i]) : frame[i]) != 0) i++;
+      out.put((char)(DISPLAY_RLE_LITERAL | (i - start - 1)));
+      for (uint16_t j = start; j < i; j++) {
+        out.put((char)(previous ? (frame[j] ^ previous[j]) : frame[j]));
       }
-      escapedText += text[j];
     }
-    
-    payload += "{\"width\":";
-    payload += rowCfg.width;
-    payload += ",\"height\":";
-    payload += rowCfg.height;
-    payload += ",\"scale\":";
-    payload += rowCfg.scale;
-    payload += ",\"monoColor\":";
-    payload += monoColorStr;
-    payload += ",\"text\":\"";
-    payload += escapedText;
-    payload += "\",\"pixels\":\"";
-    payload += rowBase64;
-    payload += "\"}";
-  }
-  
-  payload += "]";
+  }
+}
+
+static void writeDeltaPayload(MqttPayloadStream& out,
+                              const DisplayConfig& cfg,
+                              const uint8_t* frame,
+                              uint16_t size,
+                              bool keyframe,
+                              uint32_t frameSequence,
+                              uint32_t updateSequence) {
+  out.put((char)DISPLAY_DELTA_VERSION);
+  out.put((char)(keyframe ? DISPLAY_DELTA_KEYFRAME : DISPLAY_DELTA_XOR));
+  putU32(out, frameSequence);
+  putU32(out, keyframe ? 0 : mirrorBaseSequence);
+  putU32(out, updateSequence);
+  putU16(out, size);
   
-  time_t currentTime = getCurrentTime();
-  if (currentTime > 0) {
-    payload += ",\"timestamp\":";
-    payload += (unsigned long)currentTime;
+  if (keyframe) {
+    out.put((char)cfg.rows);
+    for (uint8_t i = 0; i < cfg.rows; i++) {
+      putU16(out, cfg.rowConfig[i].width);
+      out.put((char)cfg.rowConfig[i].height);
+    }
+  }
+  
+  writeRle(out, frame, keyframe ? nullptr : mirrorPrevious, size);
+}
+
+static void publishDisplayDelta(bool keyframe) {
+  DisplayConfig cfg = getDisplayConfig();
+  uint16_t size = getDisplayBufferSize();
+  uint32_t frameSequence = 0;
+  const uint8_t* frame = acquireDisplayBuffer(&frameSequence);
+  uint32_t updateSequence = getUpdateSequence();
+  
+  MqttPayloadStream counter(true);
+  writeDeltaPayload(counter, cfg, frame, size, keyframe, frameSequence, updateSequence);
+  
+  const char* topic = mqttTopic(TOPIC_DISPLAY_DELTA);
+  bool published = false;
+  
+  if (mqttClient.beginPublish(topic, counter.size(), false)) {
+    MqttPayloadStream out(false);
+    writeDeltaPayload(out, cfg, frame, size, keyframe, frameSequence, updateSequence);
+    bool streamed = out.flush();
+    published = (mqttClient.endPublish() == 1) && streamed;
+  }
+  
+  if (published) {
+    memcpy(mirrorPrevious, frame, size);
+    mirrorBaseSequence = frameSequence;
+    mirrorDeltasSinceKeyframe = keyframe ? 0 : mirrorDeltasSinceKeyframe + 1;
+    mirrorKeyframePending = false;
+  } else {
+    // Receiver state is now unknown - resynchronise with a keyframe
+    mirrorKeyframePending = true;
+    DEBUG_PRINT("Failed to publish to ");
+    DEBUG_PRINTLN(topic);
+  }
+  
+  releaseDisplayBuffer();
+  lastMirrorPublish = millis();
+}
+
+// Called every updateMQTT() pass while connected
+static void updateDisplayMirror() {
+  if (!mirrorActive) {
+    return;
+  }
+  
+  unsigned long now = millis();
+  
+  if (now - mirrorStartedAt >= mirrorTtlMs) {
+    mirrorActive = false;
+    DEBUG_PRINTLN("Display mirror TTL expired, stopping delta stream");
+    return;
+  }
+  
+  if (now - lastMirrorPublish < DISPLAY_MIRROR_MIN_INTERVAL) {
+    return;
+  }
+  
+  bool keyframe = mirrorKeyframePending || mirrorDeltasSinceKeyframe >= DISPLAY_MIRROR_KEYFRAME_EVERY;
+  if (!keyframe && getFrameSequence() == mirrorBaseSequence) {
+    return;  // Nothing new since the last message
+  }
+  
+  publishDisplayDelta(keyframe);
+}
+
+// Command: {"command":"mirror","ttl":300} starts or extends a session,
+// "ttl":0 stops it. TTL is in seconds, capped at DISPLAY_MIRROR_MAX_TTL.
+void handleMirrorCommand(const char* json, size_t length) {
+  long ttlSeconds = DISPLAY_MIRROR_DEFAULT_TTL;
+  jsonGetLong(json, length, "ttl", &ttlSeconds);
+  
+  if (ttlSeconds <= 0) {
+    mirrorActive = false;
+    DEBUG_PRINTLN("Display mirror stopped");
+    return;
   }
   
-  payload += "}";
+  if ((unsigned long)ttlSeconds > DISPLAY_MIRROR_MAX_TTL) {
+    ttlSeconds = DISPLAY_MIRROR_MAX_TTL;
+  }
   
-  if (publishMqttPayload(buildDeviceTopic(MQTT_TOPIC_DISPLAY_SNAPSHOT), payload)) {
-    DEBUG_PRINTLN("Display snapshot published successfully");
+  // A new session always starts from a keyframe; renewing a live one keeps the chain
+  if (!mirrorActive) {
+    mirrorKeyframePending = true;
   }
+  mirrorActive = true;
+  mirrorStartedAt = millis();
+  mirrorTtlMs = (unsigned long)ttlSeconds * 1000UL;
+  
+  DEBUG_PRINT("Display mirror active for ");
+  DEBUG_PRINT(ttlSeconds);
+  DEBUG_PRINTLN("s");
 }
 
 // ============================================================================
-// COMMAND HANDLERS
+// TIMING STATISTICS
+// ============================================================================
+// Full dump on MQTT_TOPIC_STATS (all durations in microseconds):
+//   {"uptime":s,"timers":[{"name":..,"interval_ms":..,"dedicated":bool,
+//     "stack_free":bytes,"late_us":{stat},"run_us":{stat}},...],
+//    "render":{"build_us":{stat},"show_us":{stat}},
+//    "brightness":{"level","target","scale","night",["ambient",]"power_limited"},
+//    "mqtt_queue":{"queued","high_water","published","coalesced","dropped","failed"}}
+// where {stat} is {"n","min","avg","max","hist":[<100us,<1ms,<10ms,<100ms,more]}
 // ============================================================================
 
-void handleRollbackCommand(String message) {
-  int versionIndex = message.indexOf("\"version\"");
-  if (versionIndex > 0) {
-    int colonIndex = message.indexOf(":", versionIndex);
-    int quoteStart = message.indexOf("\"", colonIndex + 1);
-    int quoteEnd = message.indexOf("\"", quoteStart + 1);
-    
-    if (quoteStart > 0 && quoteEnd > quoteStart) {
-      String version = message.substring(quoteStart + 1, quoteEnd);
-      DEBUG_PRINT("Rolling back to version: ");
-      DEBUG_PRINTLN(version);
-      triggerOTAUpdate(version, true);
+// Snapshot taken before streaming so both passes emit identical bytes
+static TimerStats statsTimers[MAX_TIMERS];
+static uint8_t statsTimerCount = 0;
+static TimingStat statsBuild;
+static TimingStat statsShow;
+static unsigned long statsUptime = 0;
+static MqttQueueStats statsQueue;
+static BrightnessStats statsBrightness;
+
+static void printTimingStat(MqttPayloadStream& out, const TimingStat& stat) {
+  char json[96];
+  formatTimingStat(stat, json, sizeof(json));
+  out.print(json);
+}
+
+static void writeStatsPayload(MqttPayloadStream& out) {
+  out.print("{\"uptime\":");
+  out.printUnsigned(statsUptime);
+  out.print(",\"timers\":[");
+  
+  for (uint8_t i = 0; i < statsTimerCount; i++) {
+    const TimerStats& stats = statsTimers[i];
+    if (i > 0) out.put(',');
+    out.print("{\"name\":");
+    out.printJsonString(stats.name, 32);
+    out.print(",\"interval_ms\":");
+    out.printUnsigned(stats.intervalMs);
+    out.print(",\"dedicated\":");
+    out.print(stats.dedicatedTask ? "true" : "false");
+    out.print(",\"stack_free\":");
+    out.printUnsigned(stats.stackFree);
+    out.print(",\"late_us\":");
+    printTimingStat(out, stats.lateness);
+    out.print(",\"run_us\":");
+    printTimingStat(out, stats.runtime);
+    out.put('}');
+  }
+  
+  out.print("],\"render\":{\"build_us\":");
+  printTimingStat(out, statsBuild);
+  out.print(",\"show_us\":");
+  printTimingStat(out, statsShow);
+  
+  out.print("},\"brightness\":{\"level\":");
+  out.printUnsigned(statsBrightness.level);
+  out.print(",\"target\":");
+  out.printUnsigned(statsBrightness.target);
+  out.print(",\"scale\":");
+  out.printUnsigned(statsBrightness.scale);
+  out.print(",\"night\":");
+  out.print(statsBrightness.night ? "true" : "false");
+  if (statsBrightness.sensorPresent) {
+    out.print(",\"ambient\":");
+    out.printUnsigned(statsBrightness.ambient);
+  }
+  out.print(",\"power_limited\":");
+  out.printUnsigned(statsBrightness.powerLimitedFrames);
+  
+  out.print("},\"mqtt_queue\":{\"queued\":");
+  out.printUnsigned(statsQueue.queued);
+  out.print(",\"high_water\":");
+  out.printUnsigned(statsQueue.highWater);
+  out.print(",\"published\":");
+  out.printUnsigned(statsQueue.published);
+  out.print(",\"coalesced\":");
+  out.printUnsigned(statsQueue.coalesced);
+  out.print(",\"dropped\":");
+  out.printUnsigned(statsQueue.dropped);
+  out.print(",\"failed\":");
+  out.printUnsigned(statsQueue.failed);
+  out.print("}}");
+}
+
+void publishTimingStats() {
+  if (!mqttClient.connected()) {
+    return;
+  }
+  
+  statsTimerCount = 0;
+  for (uint8_t i = 0; i < getTimerCount() && statsTimerCount < MAX_TIMERS; i++) {
+    if (getTimerStats(i, statsTimers[statsTimerCount])) {
+      statsTimerCount++;
+    }
+  }
+  getRenderTimingStats(statsBuild, statsShow);
+  getMqttQueueStats(statsQueue);
+  getBrightnessStats(statsBrightness);
+  statsUptime = millis() / 1000;
+  
+  MqttPayloadStream counter(true);
+  writeStatsPayload(counter);
+  
+  const char* topic = mqttTopic(TOPIC_STATS);
+  bool published = false;
+  
+  if (mqttClient.beginPublish(topic, counter.size(), false)) {
+    MqttPayloadStream out(false);
+    writeStatsPayload(out);
+    bool streamed = out.flush();
+    published = (mqttClient.endPublish() == 1) && streamed;
+  }
+  
+  if (published) {
+    DEBUG_PRINT("Timing stats published (");
+    DEBUG_PRINT(counter.size());
+    DEBUG_PRINTLN(" bytes)");
+  } else {
+    DEBUG_PRINT("Failed to publish to ");
+    DEBUG_PRINTLN(topic);
+  }
+}
+
+// Command: {"command":"stats"} publishes the dump; "reset":true also clears
+// all counters afterwards so the next dump covers a fresh window
+void handleStatsCommand(const char* json, size_t length) {
+  publishTimingStats();
+  
+  bool reset = false;
+  if (jsonGetBool(json, length, "reset", &reset) && reset) {
+    resetTimerStats();
+    resetRenderTimingStats();
+    DEBUG_PRINTLN("Timing stats reset");
+  }
+}
+
+// ============================================================================
+// RENDER BENCHMARK
+// ============================================================================
+// Report on MQTT_TOPIC_BENCH (sample times in microseconds):
+//   {"uptime":s,"benchmarks":[{"name":..,"calls":N,"us":{stat}},...],
+//    "golden":{"passed":n,"failed":n,"fail_mask":bits,"skipped":bool}}
+// Each sample times `calls` back-to-back invocations. The display runs the
+// benchmark in its render context; the report is published from updateMQTT().
+// ============================================================================
+
+#if DISPLAY_BENCHMARK
+
+static DisplayBenchmarkReport benchReport;
+static unsigned long benchUptime = 0;
+
+// Snapshot JSON encoding, timed here because the encoder lives in this file
+static void benchSnapshotEncoding(BenchmarkResult& result) {
+  DisplayConfig cfg = getDisplayConfig();
+  char textSnapshot[DISPLAY_ROWS][MAX_TEXT_LENGTH];
+  snapshotAllText(textSnapshot);
+  uint8_t shownScale;
+  uint32_t powerLimitedFrames;
+  getShownBrightness(shownScale, powerLimitedFrames);
+  
+  const uint8_t* buffer = acquireDisplayBuffer();
+  for (uint8_t s = 0; s < BENCHMARK_SAMPLES; s++) {
+    uint32_t start = micros();
+    MqttPayloadStream counter(true);
+    writeSnapshotPayload(counter, cfg, buffer, textSnapshot, shownScale, 0);
+    recordTiming(result.sample, micros() - start);
+  }
+  releaseDisplayBuffer();
+}
+
+static void writeBenchPayload(MqttPayloadStream& out) {
+  out.print("{\"uptime\":");
+  out.printUnsigned(benchUptime);
+  out.print(",\"benchmarks\":[");
+  
+  for (uint8_t i = 0; i < benchReport.resultCount; i++) {
+    const BenchmarkResult& result = benchReport.results[i];
+    if (i > 0) out.put(',');
+    out.print("{\"name\":");
+    out.printJsonString(result.name, 32);
+    out.print(",\"calls\":");
+    out.printUnsigned(result.calls);
+    out.print(",\"us\":");
+    printTimingStat(out, result.sample);
+    out.put('}');
+  }
+  
+  out.print("],\"golden\":{\"passed\":");
+  out.printUnsigned(benchReport.goldenPassed);
+  out.print(",\"failed\":");
+  out.printUnsigned(benchReport.goldenFailed);
+  out.print(",\"fail_mask\":");
+  out.printUnsigned(benchReport.goldenFailMask);
+  out.print(",\"skipped\":");
+  out.print(benchReport.goldenSkipped ? "true" : "false");
+  out.print("}}");
+}
+
+// Publish a finished report, if the display has one for us
+static void publishBenchmarkReport() {
+  if (!takeDisplayBenchmarkReport(benchReport)) {
+    return;
+  }
+  
+  BenchmarkResult* encoding = addBenchmarkResult(benchReport, "snapshot_encode", 1);
+  if (encoding != nullptr) {
+    benchSnapshotEncoding(*encoding);
+  }
+  benchUptime = millis() / 1000;
+  
+  MqttPayloadStream counter(true);
+  writeBenchPayload(counter);
+  
+  const char* topic = mqttTopic(TOPIC_BENCH);
+  bool published = false;
+  
+  if (mqttClient.beginPublish(topic, counter.size(), false)) {
+    MqttPayloadStream out(false);
+    writeBenchPayload(out);
+    bool streamed = out.flush();
+    published = (mqttClient.endPublish() == 1) && streamed;
+  }
+  
+  if (published) {
+    DEBUG_PRINT("Benchmark report published (");
+    DEBUG_PRINT(counter.size());
+    DEBUG_PRINTLN(" bytes)");
+  } else {
+    DEBUG_PRINT("Failed to publish to ");
+    DEBUG_PRINTLN(topic);
+  }
+}
+
+#endif // DISPLAY_BENCHMARK
+
+// Command: {"command":"bench"} - the display briefly shows the benchmark
+// texts, then its own content again
+void handleBenchCommand() {
+  #if DISPLAY_BENCHMARK
+    if (!requestDisplayBenchmark()) {
+      DEBUG_PRINTLN("Benchmark already running");
     }
+  #else
+    DEBUG_PRINTLN("Benchmark not compiled in (build with -DDISPLAY_BENCHMARK=1)");
+  #endif
+}
+
+// ============================================================================
+// COMMAND HANDLERS
+// ============================================================================
+
+// Command: {"command":"rollback","target_version":"x.y.z"} (the dashboard's
+// key; a plain "version" is accepted too)
+void handleRollbackCommand(const char* json, size_t length) {
+  char version[32];
+  if (jsonGetString(json, length, "target_version", version, sizeof(version)) ||
+      jsonGetString(json, length, "version", version, sizeof(version))) {
+    DEBUG_PRINT("Rolling back to version: ");
+    DEBUG_PRINTLN(version);
+    triggerOTAUpdate(version, true);
   }
 }
 
 void handleRestartCommand() {
   DEBUG_PRINTLN("Restart command received, rebooting in 2 seconds...");
-  logEvent("restart_command");
+  logEvent(EVT_RESTART_COMMAND);
+  flushDeviceConfig();
   delay(2000);
   ESP.restart();
 }
 
+// Command: {"command":"marquee","text":"...","row":1} scrolls the text across
+// the row (default: bottom row); empty or missing text stops the marquee
+void handleMarqueeCommand(const char* json, size_t length) {
+  long row = DISPLAY_ROWS - 1;
+  jsonGetLong(json, length, "row", &row);
+  if (row < 0 || row >= DISPLAY_ROWS) {
+    DEBUG_PRINTLN("Marquee row out of range");
+    return;
+  }
+  
+  char text[MAX_TEXT_LENGTH];
+  if (jsonGetString(json, length, "text", text, sizeof(text)) && text[0] != '\0') {
+    startMarquee((uint8_t)row, text);
+  } else {
+    stopMarquee((uint8_t)row);
+  }
+}
+
 // ============================================================================
 // WIFI EVENT HANDLERS
 // ============================================================================
@@ -40,7 +40,32 @@ extern const char MQTT_TOPIC_OTA_START[];
 extern const char MQTT_TOPIC_OTA_PROGRESS[];
 extern const char MQTT_TOPIC_OTA_COMPLETE[];
 extern const char MQTT_TOPIC_DISPLAY_SNAPSHOT[];
+extern const char MQTT_TOPIC_DISPLAY_DELTA[];
 extern const char MQTT_TOPIC_EVENTS[];
+extern const char MQTT_TOPIC_EVENTS_BATCH[];
+extern const char MQTT_TOPIC_STATS[];
+extern const char MQTT_TOPIC_BENCH[];
+extern const char MQTT_TOPIC_DISPLAY_FRAME[];
+
+// Slots of the prebuilt device topic table (see mqttTopic())
+enum MqttTopicId {
+  TOPIC_HEARTBEAT,
+  TOPIC_INFO,
+  TOPIC_VERSION_RESPONSE,
+  TOPIC_COMMAND,
+  TOPIC_CONFIG,
+  TOPIC_OTA_START,
+  TOPIC_OTA_PROGRESS,
+  TOPIC_OTA_COMPLETE,
+  TOPIC_DISPLAY_SNAPSHOT,
+  TOPIC_DISPLAY_DELTA,
+  TOPIC_EVENTS,
+  TOPIC_EVENTS_BATCH,
+  TOPIC_STATS,
+  TOPIC_BENCH,
+  TOPIC_DISPLAY_FRAME,
+  TOPIC_COUNT
+};
 
 extern WiFiClientSecure wifiSecureClient;
 extern PubSubClient mqttClient;
@@ -58,18 +83,37 @@ void disconnectMQTT();
 void updateMQTT();
 void resetMQTTReconnectTimer();
 void processDeferredMQTT();
-void publishHeartbeat();
-void publishDeviceInfo();
-void publishDisplaySnapshot();
+
+// Connect/disconnect from the MQTT worker on its next pass (safe from WiFi
+// event handlers and other tasks)
+void requestMQTTConnect();
+void requestMQTTDisconnect();
+// MQTT worker jobs (see MqttPublishJob): false if the publish was rejected
+bool publishHeartbeat();
+bool publishDeviceInfo();
+bool publishDisplaySnapshot();
+void publishTimingStats();
 void mqttCallback(char* topic, byte* payload, unsigned int length);
-void handleRollbackCommand(String message);
+void handleRollbackCommand(const char* json, size_t length);
 void handleRestartCommand();
-String base64Encode(const uint8_t* data, uint16_t length);
+void handleMirrorCommand(const char* json, size_t length);
+void handleStatsCommand(const char* json, size_t length);
+void handleBenchCommand();
+void handleMarqueeCommand(const char* json, size_t length);
+
+// Reformat every device topic for the current environment and device ID.
+// Called by connectMQTT() and setEnvironmentScope().
+void rebuildMqttTopics();
+
+// Full device topic for a table slot (stable pointer, no allocation)
+const char* mqttTopic(MqttTopicId id);
 
-String buildDeviceTopic(const char* baseTopic);
+// Publish immediately - MQTT worker only. Anything else queues through
+// mqtt_queue.h so it never blocks on the socket.
 bool publishMqttPayload(const char* topic, const char* payload);
-bool publishMqttPayload(const String& topic, const char* payload);
-bool publishMqttPayload(const String& topic, const String& payload);
+bool publishMqttPayload(const char* topic, const uint8_t* payload, unsigned int length);
+bool publishMqttPayload(MqttTopicId topic, const char* payload);
+bool publishMqttPayload(MqttTopicId topic, const uint8_t* payload, unsigned int length);
 
 #if defined(ESP32)
   void onWiFiConnected(WiFiEvent_t event, WiFiEventInfo_t info);
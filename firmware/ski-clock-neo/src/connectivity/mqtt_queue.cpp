@@ -0,0 +1,385 @@
+// ============================================================================
+// mqtt_queue.cpp - Prioritized outbound MQTT queue
+// ============================================================================
+// Producers never touch the socket. They either copy a small payload into a
+// fixed slot (queueMqttMessage) or name a function that builds the payload
+// when it is sent (requestMqttJob); one worker drains both:
+// - Most urgent class first (OTA > events > heartbeat > snapshots), FIFO
+//   within a class
+// - Coalescing: a waiting job is never queued twice and coalesced messages
+//   overwrite the waiting one, so only the latest heartbeat/snapshot is sent
+// - Backpressure: slots are fixed; when full, less urgent messages make room
+//   for more urgent ones and everything else is dropped and counted
+// - A failed publish leaves its message queued (a failed job is queued again,
+//   up to MQTT_JOB_MAX_ATTEMPTS runs) and ends the drain pass, so a stalled
+//   socket costs one attempt per pass rather than one per message
+// ============================================================================
+
+// ============================================================================
+// INCLUDES
+// ============================================================================
+
+#include "mqtt_queue.h"         // This file's header
+#include "../core/debug.h"      // For debug logging
+
+// ============================================================================
+// PLATFORM-SPECIFIC MACROS
+// ============================================================================
+
+#if defined(ESP32)
+  static portMUX_TYPE mqttQueueMux = portMUX_INITIALIZER_UNLOCKED;
+  #define QUEUE_ENTER_CRITICAL() portENTER_CRITICAL(&mqttQueueMux)
+  #define QUEUE_EXIT_CRITICAL() portEXIT_CRITICAL(&mqttQueueMux)
+#else
+  #define QUEUE_ENTER_CRITICAL() noInterrupts()
+  #define QUEUE_EXIT_CRITICAL() interrupts()
+#endif
+
+// ============================================================================
+// CONSTANTS
+// ============================================================================
+
+#define MQTT_QUEUE_SLOTS 6             // Buffered messages
+#define MQTT_QUEUE_PAYLOAD_SIZE 320    // Largest buffered payload (OTA start)
+#define MQTT_QUEUE_JOBS 8              // Distinct jobs waiting at once
+#define MQTT_JOB_MAX_ATTEMPTS 3        // Sends of a failing job or message before it is dropped
+
+// ============================================================================
+// STATE VARIABLES
+// ============================================================================
+
+struct QueuedMessage {
+  bool used;
+  bool sending;                 // Being published by the worker - left alone
+  MqttPriority priority;
+  MqttTopicId topic;
+  uint32_t order;               // Arrival order, FIFO within a class
+  uint8_t attempts;             // Failed publishes of this payload so far
+  char payload[MQTT_QUEUE_PAYLOAD_SIZE];
+};
+
+struct PendingJob {
+  MqttPublishJob job;           // nullptr = free
+  MqttPriority priority;
+  uint32_t order;
+  uint8_t attempts;             // Failed runs so far
+};
+
+static QueuedMessage messages[MQTT_QUEUE_SLOTS];
+static PendingJob jobs[MQTT_QUEUE_JOBS];
+static uint32_t nextOrder = 0;
+static MqttQueueStats queueStats = {0, 0, 0, 0, 0, 0};
+
+#if defined(ESP32)
+  static TaskHandle_t workerTask = NULL;
+#endif
+
+// ============================================================================
+// HELPERS
+// ============================================================================
+
+// Caller holds the critical section
+static void noteQueued() {
+  queueStats.queued++;
+  if (queueStats.queued > queueStats.highWater) {
+    queueStats.highWater = queueStats.queued;
+  }
+}
+
+// Free slot, or the victim to replace for a `priority` message (-1 if none)
+static int8_t findMessageSlot(MqttPriority priority) {
+  int8_t victim = -1;
+  for (uint8_t i = 0; i < MQTT_QUEUE_SLOTS; i++) {
+    const QueuedMessage& msg = messages[i];
+    if (!msg.used) {
+      return i;
+    }
+    if (msg.sending || msg.priority <= priority) {
+      continue;
+    }
+    if (victim < 0 ||
+        msg.priority > messages[victim].priority ||
+        (msg.priority == messages[victim].priority && msg.order < messages[victim].order)) {
+      victim = i;
+    }
+  }
+  return victim;
+}
+
+static void wakeWorker() {
+  #if defined(ESP32)
+    if (workerTask != NULL && xTaskGetCurrentTaskHandle() != workerTask) {
+      xTaskNotifyGive(workerTask);
+    }
+  #endif
+}
+
+// ============================================================================
+// PRODUCERS
+// ============================================================================
+
+bool queueMqttMessage(MqttTopicId topic, const char* payload, MqttPriority priority, bool coalesce) {
+  if (strlen(payload) >= MQTT_QUEUE_PAYLOAD_SIZE) {
+    DEBUG_PRINT("MQTT payload too large to queue for ");
+    DEBUG_PRINTLN(mqttTopic(topic));
+    return false;
+  }
+
+  bool dropped = false;
+  bool queued = true;
+
+  QUEUE_ENTER_CRITICAL();
+  int8_t slot = -1;
+  if (coalesce) {
+    for (uint8_t i = 0; i < MQTT_QUEUE_SLOTS; i++) {
+      if (messages[i].used && !messages[i].sending && messages[i].topic == topic) {
+        slot = i;
+        queueStats.coalesced++;
+        break;
+      }
+    }
+  }
+  if (slot < 0) {
+    slot = findMessageSlot(priority);
+    if (slot < 0) {
+      queued = false;
+    } else {
+      if (messages[slot].used) {
+        dropped = true;  // Evicted a less urgent message
+      } else {
+        noteQueued();
+      }
+      messages[slot].used = true;
+      messages[slot].sending = false;
+      messages[slot].priority = priority;
+      messages[slot].topic = topic;
+      messages[slot].order = nextOrder++;
+    }
+  }
+  if (queued) {
+    strlcpy(messages[slot].payload, payload, MQTT_QUEUE_PAYLOAD_SIZE);
+    messages[slot].attempts = 0;  // New payload, fresh attempts
+  }
+  if (dropped || !queued) {
+    queueStats.dropped++;
+  }
+  QUEUE_EXIT_CRITICAL();
+
+  if (!queued) {
+    DEBUG_PRINT("MQTT queue full, dropped message for ");
+    DEBUG_PRINTLN(mqttTopic(topic));
+    return false;
+  }
+
+  wakeWorker();
+  return true;
+}
+
+bool requestMqttJob(MqttPublishJob job, MqttPriority priority) {
+  bool queued = false;
+
+  QUEUE_ENTER_CRITICAL();
+  int8_t freeSlot = -1;
+  for (uint8_t i = 0; i < MQTT_QUEUE_JOBS; i++) {
+    if (jobs[i].job == job) {
+      // Already waiting - it will read the latest state when it runs
+      if (priority < jobs[i].priority) {
+        jobs[i].priority = priority;
+      }
+      queueStats.coalesced++;
+      queued = true;
+      break;
+    }
+    if (jobs[i].job == nullptr && freeSlot < 0) {
+      freeSlot = i;
+    }
+  }
+  if (!queued && freeSlot >= 0) {
+    jobs[freeSlot].job = job;
+    jobs[freeSlot].priority = priority;
+    jobs[freeSlot].order = nextOrder++;
+    jobs[freeSlot].attempts = 0;
+    noteQueued();
+    queued = true;
+  }
+  if (!queued) {
+    queueStats.dropped++;
+  }
+  QUEUE_EXIT_CRITICAL();
+
+  if (!queued) {
+    DEBUG_PRINTLN("MQTT job queue full, request dropped");
+    return false;
+  }
+
+  wakeWorker();
+  return true;
+}
+
+// ============================================================================
+// WORKER
+// ============================================================================
+
+// Queue a job again after a failed run, behind what is already waiting in its
+// class. A request for it made during the run already re-queued it.
+static void requeueFailedJob(MqttPublishJob job, MqttPriority priority, uint8_t attempts) {
+  bool requeued = false;
+
+  QUEUE_ENTER_CRITICAL();
+  queueStats.failed++;
+  int8_t freeSlot = -1;
+  for (uint8_t i = 0; i < MQTT_QUEUE_JOBS; i++) {
+    if (jobs[i].job == job) {
+      requeued = true;
+      break;
+    }
+    if (jobs[i].job == nullptr && freeSlot < 0) {
+      freeSlot = i;
+    }
+  }
+  if (!requeued && attempts < MQTT_JOB_MAX_ATTEMPTS && freeSlot >= 0) {
+    jobs[freeSlot].job = job;
+    jobs[freeSlot].priority = priority;
+    jobs[freeSlot].order = nextOrder++;
+    jobs[freeSlot].attempts = attempts;
+    noteQueued();
+    requeued = true;
+  }
+  if (!requeued) {
+    queueStats.dropped++;
+  }
+  QUEUE_EXIT_CRITICAL();
+
+  if (!requeued) {
+    DEBUG_PRINT("MQTT job dropped after ");
+    DEBUG_PRINT(attempts);
+    DEBUG_PRINTLN(" failed attempt(s)");
+  }
+}
+
+bool drainMqttQueue(uint8_t budget, MqttPriority maxPriority) {
+  while (budget > 0) {
+    budget--;
+
+    // Pick the most urgent, oldest item across messages and jobs
+    QUEUE_ENTER_CRITICAL();
+    int8_t message = -1;
+    int8_t job = -1;
+    MqttPriority bestPriority = MQTT_PRIORITY_COUNT;
+    uint32_t bestOrder = 0;
+
+    for (uint8_t i = 0; i < MQTT_QUEUE_SLOTS; i++) {
+      const QueuedMessage& msg = messages[i];
+      if (!msg.used || msg.sending || msg.priority > maxPriority) continue;
+      if (msg.priority < bestPriority || (msg.priority == bestPriority && (int32_t)(msg.order - bestOrder) < 0)) {
+        bestPriority = msg.priority;
+        bestOrder = msg.order;
+        message = i;
+      }
+    }
+    for (uint8_t i = 0; i < MQTT_QUEUE_JOBS; i++) {
+      const PendingJob& pending = jobs[i];
+      if (pending.job == nullptr || pending.priority > maxPriority) continue;
+      if (pending.priority < bestPriority || (pending.priority == bestPriority && (int32_t)(pending.order - bestOrder) < 0)) {
+        bestPriority = pending.priority;
+        bestOrder = pending.order;
+        job = i;
+        message = -1;
+      }
+    }
+
+    MqttPublishJob run = nullptr;
+    MqttPriority runPriority = bestPriority;
+    uint8_t runAttempts = 0;
+    if (job >= 0) {
+      // Free the slot before running so a request made meanwhile queues again
+      run = jobs[job].job;
+      runAttempts = jobs[job].attempts;
+      jobs[job].job = nullptr;
+      queueStats.queued--;
+    } else if (message >= 0) {
+      messages[message].sending = true;
+    }
+    QUEUE_EXIT_CRITICAL();
+
+    if (run != nullptr) {
+      if (run()) {
+        QUEUE_ENTER_CRITICAL();
+        queueStats.published++;
+        QUEUE_EXIT_CRITICAL();
+        continue;
+      }
+      requeueFailedJob(run, runPriority, runAttempts + 1);
+      return false;
+    }
+    if (message < 0) {
+      return true;  // Nothing left
+    }
+
+    // Producers skip a slot while it is sending, so the payload is stable
+    QueuedMessage& msg = messages[message];
+    MqttTopicId topic = msg.topic;
+    bool published = publishMqttPayload(topic, msg.payload);
+
+    bool expired = false;
+    QUEUE_ENTER_CRITICAL();
+    msg.sending = false;
+    if (published) {
+      msg.used = false;
+      queueStats.queued--;
+      queueStats.published++;
+    } else {
+      // Same cap as jobs, so a message that can never be sent (e.g. larger
+      // than the client buffer) does not hold up its class for good
+      queueStats.failed++;
+      if (++msg.attempts >= MQTT_JOB_MAX_ATTEMPTS) {
+        msg.used = false;
+        queueStats.queued--;
+        queueStats.dropped++;
+        expired = true;
+      }
+    }
+    QUEUE_EXIT_CRITICAL();
+
+    if (expired) {
+      DEBUG_PRINT("MQTT message for ");
+      DEBUG_PRINT(mqttTopic(topic));  // Slot may be reused already
+      DEBUG_PRINT(" dropped after ");
+      DEBUG_PRINT(MQTT_JOB_MAX_ATTEMPTS);
+      DEBUG_PRINTLN(" failed attempt(s)");
+    }
+
+    if (!published) {
+      return false;
+    }
+  }
+
+  return !isMqttQueuePending(maxPriority);
+}
+
+bool isMqttQueuePending(MqttPriority maxPriority) {
+  bool pending = false;
+
+  QUEUE_ENTER_CRITICAL();
+  for (uint8_t i = 0; i < MQTT_QUEUE_SLOTS && !pending; i++) {
+    pending = messages[i].used && messages[i].priority <= maxPriority;
+  }
+  for (uint8_t i = 0; i < MQTT_QUEUE_JOBS && !pending; i++) {
+    pending = jobs[i].job != nullptr && jobs[i].priority <= maxPriority;
+  }
+  QUEUE_EXIT_CRITICAL();
+
+  return pending;
+}
+
+void getMqttQueueStats(MqttQueueStats& stats) {
+  QUEUE_ENTER_CRITICAL();
+  stats = queueStats;
+  QUEUE_EXIT_CRITICAL();
+}
+
+#if defined(ESP32)
+void setMqttQueueWorker(TaskHandle_t task) {
+  workerTask = task;
+}
+#endif
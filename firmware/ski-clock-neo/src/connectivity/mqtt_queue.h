@@ -0,0 +1,58 @@
+#ifndef MQTT_QUEUE_H
+#define MQTT_QUEUE_H
+
+#include <Arduino.h>
+#include "mqtt_client.h"
+
+// Outbound priority classes, most urgent first
+enum MqttPriority {
+  MQTT_PRIORITY_OTA,        // OTA start/progress/complete
+  MQTT_PRIORITY_EVENT,      // Event log flushes
+  MQTT_PRIORITY_HEARTBEAT,  // Heartbeat and device info
+  MQTT_PRIORITY_SNAPSHOT,   // Display snapshots and mirror deltas
+  MQTT_PRIORITY_COUNT
+};
+
+// Builds its payload and publishes it when the worker gets to it. Returns
+// false if the client rejected a publish, the worker then runs it again
+// later (up to MQTT_JOB_MAX_ATTEMPTS runs); true if it was sent or had
+// nothing to send.
+typedef bool (*MqttPublishJob)();
+
+// Counters for the stats dump
+struct MqttQueueStats {
+  uint8_t queued;       // Messages and jobs waiting now
+  uint8_t highWater;    // Most ever waiting at once
+  uint32_t published;   // Messages sent and jobs run
+  uint32_t coalesced;   // Requests merged into one already waiting
+  uint32_t dropped;     // Messages and jobs discarded (queue full, or a job out of attempts)
+  uint32_t failed;      // Publish attempts the client rejected (retried later)
+};
+
+// Copy a payload into the queue - safe from any task or Ticker callback.
+// coalesce: replace a message already waiting on the same topic, so only
+// the latest is sent. When every slot is taken, the oldest message of the
+// least urgent class below `priority` is dropped; false if none was.
+bool queueMqttMessage(MqttTopicId topic, const char* payload, MqttPriority priority, bool coalesce = false);
+
+// Ask the worker to run `job`. A job that is already waiting isn't added
+// again, so the payload it builds always reflects the latest state.
+bool requestMqttJob(MqttPublishJob job, MqttPriority priority);
+
+// Worker side: send up to `budget` waiting items with priority up to
+// maxPriority, most urgent first. Stops early if a publish fails (the message
+// stays queued, the job is queued again). Returns true if nothing up to
+// maxPriority is left.
+bool drainMqttQueue(uint8_t budget, MqttPriority maxPriority = MQTT_PRIORITY_SNAPSHOT);
+
+// True if anything up to maxPriority is waiting
+bool isMqttQueuePending(MqttPriority maxPriority);
+
+void getMqttQueueStats(MqttQueueStats& stats);
+
+#if defined(ESP32)
+// Task notified whenever work is queued (the MQTT worker)
+void setMqttQueueWorker(TaskHandle_t task);
+#endif
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef MQTT_WIRE_FORMAT_H
+#define MQTT_WIRE_FORMAT_H
+
+// ============================================================================
+// Binary MQTT payload schema
+// ============================================================================
+// Constants for the compact payloads the firmware publishes. This file is the
+// single definition shared with the dashboard: dashboard/wire_format.py reads
+// these #defines at import, so the encoders (event_log.cpp, mqtt_client.cpp)
+// and the subscriber can't drift apart. Keep every value a plain integer
+// literal on one line.
+// ============================================================================
+
+// ----------------------------------------------------------------------------
+// Event batches (event/batch), integers little-endian
+// ----------------------------------------------------------------------------
+//   [0]     format version (EVENT_BATCH_BINARY_VERSION, never '{')
+//   [1]     flags (EVENT_BATCH_FLAG_UNIX_BASE: base is Unix seconds;
+//           EVENT_BATCH_FLAG_PREVIOUS_BOOT: base is millis() in an earlier
+//           boot; neither: offset ms)
+//   [2..5]  base (u32)
+//   [6]     event count
+//   records: [tag u8][length u8][value]; unknown tags are skipped by length
+//     EVENT_TLV_EVENT value: dt (LEB128 varint ms), type length (u8), type,
+//                            data JSON (remaining bytes, may be empty)
+// A JSON batch starts with '{' instead (see BATCH ENCODING in event_log.cpp).
+
+#define EVENT_BATCH_BINARY_VERSION     1
+#define EVENT_BATCH_FLAG_UNIX_BASE     0x01
+#define EVENT_BATCH_FLAG_PREVIOUS_BOOT 0x02
+#define EVENT_TLV_EVENT                0x01
+#define EVENT_BATCH_HEADER_SIZE        7
+
+// ----------------------------------------------------------------------------
+// Display mirror (display/delta), integers little-endian
+// ----------------------------------------------------------------------------
+//   [0]      format version (DISPLAY_DELTA_VERSION)
+//   [1]      frame type (DISPLAY_DELTA_KEYFRAME or DISPLAY_DELTA_XOR)
+//   [2..5]   frame sequence of this frame (getFrameSequence())
+//   [6..9]   frame sequence the delta applies to (0 for keyframes)
+//   [10..13] display update sequence when sent (getUpdateSequence())
+//   [14..15] frame size in bytes (getDisplayBufferSize())
+//   keyframe only: [16] row count, then per row width (u16) and height (u8)
+//   body: RLE of the frame (keyframe) or of frame XOR previous (delta)
+//     0x00-0x7F  run of (n + 1) zero bytes
+//     0x80-0xFF  ((n & 0x7F) + 1) literal bytes follow
+// A delta whose base doesn't match the receiver's frame means a message was
+// lost; the receiver waits for the next keyframe.
+
+#define DISPLAY_DELTA_VERSION     1
+#define DISPLAY_DELTA_KEYFRAME    0
+#define DISPLAY_DELTA_XOR         1
+#define DISPLAY_DELTA_HEADER_SIZE 16
+#define DISPLAY_DELTA_ROW_SIZE    3     // Keyframe geometry per row
+#define DISPLAY_RLE_LITERAL       0x80  // Token bit: literal bytes follow
+#define DISPLAY_RLE_MAX_RUN       128   // Longest run or literal per token
+
+#endif
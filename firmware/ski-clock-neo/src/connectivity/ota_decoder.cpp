@@ -0,0 +1,554 @@
+// ============================================================================
+// ota_decoder.cpp - Streaming decoders for compressed and delta OTA images
+// ============================================================================
+// Sits between the OTA download and Update.write():
+// - identity: bytes are written as received
+// - gzip: ESP32 inflates with the ROM miniz decoder (32KB window);
+//   ESP8266 flashes the .gz as-is and its eboot bootloader inflates on boot
+// - delta: rebuilds the new image from the running one plus a patch, reading
+//   old bytes straight from flash
+// Every decoder is a single pass over the download, so a Range resume is
+// invisible to it. Update.end() checks the MD5 of the result when the
+// server supplies one.
+//
+// SKD1 delta format (little-endian, generated by the dashboard from bsdiff):
+//   "SKD1"  u32 new_size  u32 old_size
+//   then operations - a 1-byte opcode followed by a LEB128 varint:
+//     0 END
+//     1 COPY n      - n bytes of the old image at the cursor (cursor += n)
+//     2 ADD n ...   - n patch bytes, each added to old[cursor++]
+//     3 INSERT n ...- n literal bytes
+//     4 SEEK z      - cursor += zigzag-decoded z
+// ============================================================================
+
+// ============================================================================
+// INCLUDES
+// ============================================================================
+
+#include "ota_decoder.h"           // This file's header
+#include "../core/debug.h"         // For debug logging
+
+#if defined(ESP32)
+  #include <Update.h>
+  #include <esp_ota_ops.h>         // For the running partition (delta source)
+  #include <esp_partition.h>
+  // ROM inflate (tinfl) - header location differs per target
+  #if CONFIG_IDF_TARGET_ESP32C3
+    #include "esp32c3/rom/miniz.h"
+  #elif CONFIG_IDF_TARGET_ESP32S3
+    #include "esp32s3/rom/miniz.h"
+  #elif CONFIG_IDF_TARGET_ESP32S2
+    #include "esp32s2/rom/miniz.h"
+  #else
+    #include "esp32/rom/miniz.h"
+  #endif
+#elif defined(ESP8266)
+  #include <Updater.h>
+#endif
+
+// ============================================================================
+// CONSTANTS
+// ============================================================================
+
+#define OTA_OUTPUT_BUFFER_SIZE 512   // Decoded bytes batched per Update.write()
+#define OTA_OLD_READ_SIZE 256        // Old image bytes read from flash at a time
+
+#define DELTA_HEADER_SIZE 12
+#define DELTA_OP_END 0
+#define DELTA_OP_COPY 1
+#define DELTA_OP_ADD 2
+#define DELTA_OP_INSERT 3
+#define DELTA_OP_SEEK 4
+
+#define GZIP_HEADER_SIZE 10
+
+// ============================================================================
+// STATE VARIABLES
+// ============================================================================
+
+static OtaEncoding activeEncoding = OTA_ENCODING_IDENTITY;
+static bool passthrough = false;           // Download is written to flash unchanged
+static uint32_t expectedSize = 0;          // Bytes Update.begin() was told to expect
+static uint32_t producedSize = 0;          // Bytes handed to the output so far
+static const char* decoderError = "";
+
+static uint8_t outputBuffer[OTA_OUTPUT_BUFFER_SIZE];
+static uint16_t outputUsed = 0;
+
+// Delta decoder
+enum DeltaState { DELTA_HEADER, DELTA_OPCODE, DELTA_ARGUMENT, DELTA_ADD, DELTA_INSERT, DELTA_DONE };
+static DeltaState deltaState = DELTA_HEADER;
+static uint8_t deltaHeader[DELTA_HEADER_SIZE];
+static uint8_t deltaHeaderUsed = 0;
+static uint8_t deltaOp = 0;
+static uint32_t deltaArgument = 0;
+static uint8_t deltaArgumentShift = 0;
+static uint32_t deltaRemaining = 0;        // Payload bytes left in the current ADD/INSERT
+static uint32_t deltaCursor = 0;           // Read position in the old image
+static uint32_t deltaOldSize = 0;
+static uint8_t oldChunk[OTA_OLD_READ_SIZE];
+
+#if defined(ESP32)
+  static const esp_partition_t* runningPartition = NULL;
+  
+  // Gzip decoder (window doubles as tinfl's circular output buffer)
+  static tinfl_decompressor* inflator = NULL;
+  static uint8_t* inflateWindow = NULL;
+  static size_t windowPos = 0;
+  static uint8_t gzipHeader[GZIP_HEADER_SIZE];
+  static uint8_t gzipHeaderUsed = 0;
+  static bool inflateDone = false;
+#endif
+
+// ============================================================================
+// OUTPUT
+// ============================================================================
+
+static bool fail(const char* reason) {
+  if (decoderError[0] == '\0') {
+    decoderError = reason;
+  }
+  return false;
+}
+
+static bool flushOutput() {
+  if (outputUsed == 0) {
+    return true;
+  }
+  if (Update.write(outputBuffer, outputUsed) != outputUsed) {
+    return fail("Flash write failed");
+  }
+  outputUsed = 0;
+  return true;
+}
+
+static bool emitBytes(const uint8_t* data, size_t length) {
+  if (producedSize + length > expectedSize) {
+    return fail("Decoded image larger than expected");
+  }
+  
+  while (length > 0) {
+    size_t space = sizeof(outputBuffer) - outputUsed;
+    size_t count = (length < space) ? length : space;
+    memcpy(outputBuffer + outputUsed, data, count);
+    outputUsed += count;
+    producedSize += count;
+    data += count;
+    length -= count;
+  
+    if (outputUsed == sizeof(outputBuffer) && !flushOutput()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool writePassthrough(const uint8_t* data, size_t length) {
+  if (producedSize + length > expectedSize) {
+    return fail("Download larger than expected");
+  }
+  if (Update.write(const_cast<uint8_t*>(data), length) != length) {
+    return fail("Flash write failed");
+  }
+  producedSize += length;
+  return true;
+}
+
+// ============================================================================
+// OLD IMAGE ACCESS (delta source)
+// ============================================================================
+// The running image is the delta base: the app partition on ESP32, the
+// start of flash (eboot + sketch, exactly the .bin layout) on ESP8266.
+
+static bool openOldImage() {
+  #if defined(ESP32)
+    runningPartition = esp_ota_get_running_partition();
+    return runningPartition != NULL;
+  #elif defined(ESP8266)
+    return true;
+  #endif
+}
+
+static uint32_t oldImageLimit() {
+  #if defined(ESP32)
+    return runningPartition ? runningPartition->size : 0;
+  #elif defined(ESP8266)
+    // The published .bin may be padded past the parsed sketch size; the MD5
+    // check catches a base that really differs
+    return (ESP.getSketchSize() + FLASH_SECTOR_SIZE - 1) & ~(FLASH_SECTOR_SIZE - 1);
+  #endif
+}
+
+static bool readOldImage(uint32_t offset, uint8_t* dest, size_t length) {
+  #if defined(ESP32)
+    return esp_partition_read(runningPartition, offset, dest, length) == ESP_OK;
+  #elif defined(ESP8266)
+    return ESP.flashRead(offset, dest, length);
+  #endif
+}
+
+// ============================================================================
+// DELTA DECODER
+// ============================================================================
+
+static uint32_t readLE32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static bool beginDeltaHeader() {
+  if (memcmp(deltaHeader, "SKD1", 4) != 0) {
+    return fail("Not an SKD1 delta");
+  }
+  if (readLE32(deltaHeader + 4) != expectedSize) {
+    return fail("Delta size does not match image size");
+  }
+  deltaOldSize = readLE32(deltaHeader + 8);
+  if (deltaOldSize > oldImageLimit()) {
+    return fail("Delta base larger than running image");
+  }
+  deltaState = DELTA_OPCODE;
+  return true;
+}
+
+// Copy n unchanged old bytes from the cursor
+static bool deltaCopy(uint32_t count) {
+  while (count > 0) {
+    uint32_t chunk = (count < sizeof(oldChunk)) ? count : sizeof(oldChunk);
+    if (!readOldImage(deltaCursor, oldChunk, chunk)) {
+      return fail("Failed to read running image");
+    }
+    if (!emitBytes(oldChunk, chunk)) {
+      return false;
+    }
+    deltaCursor += chunk;
+    count -= chunk;
+  }
+  return true;
+}
+
+// Run the operation whose argument was just decoded
+static bool deltaExecute() {
+  uint32_t n = deltaArgument;
+  deltaState = DELTA_OPCODE;
+  
+  switch (deltaOp) {
+    case DELTA_OP_COPY:
+    case DELTA_OP_ADD:
+      if (n > deltaOldSize - deltaCursor) {
+        return fail("Delta reads past old image");
+      }
+      if (deltaOp == DELTA_OP_COPY) {
+        return deltaCopy(n);
+      }
+      deltaRemaining = n;
+      if (n > 0) deltaState = DELTA_ADD;
+      return true;
+  
+    case DELTA_OP_INSERT:
+      deltaRemaining = n;
+      if (n > 0) deltaState = DELTA_INSERT;
+      return true;
+  
+    case DELTA_OP_SEEK: {
+      int32_t offset = (int32_t)(n >> 1) ^ -(int32_t)(n & 1);
+      int64_t target = (int64_t)deltaCursor + offset;
+      if (target < 0 || target > deltaOldSize) {
+        return fail("Delta seeks outside old image");
+      }
+      deltaCursor = (uint32_t)target;
+      return true;
+    }
+  }
+  
+  return fail("Unknown delta operation");
+}
+
+static bool deltaWrite(const uint8_t* data, size_t length) {
+  while (length > 0) {
+    switch (deltaState) {
+      case DELTA_HEADER: {
+        size_t count = DELTA_HEADER_SIZE - deltaHeaderUsed;
+        if (count > length) count = length;
+        memcpy(deltaHeader + deltaHeaderUsed, data, count);
+        deltaHeaderUsed += count;
+        data += count;
+        length -= count;
+        if (deltaHeaderUsed == DELTA_HEADER_SIZE && !beginDeltaHeader()) {
+          return false;
+        }
+        break;
+      }
+  
+      case DELTA_OPCODE:
+        deltaOp = *data++;
+        length--;
+        if (deltaOp == DELTA_OP_END) {
+          deltaState = DELTA_DONE;
+        } else if (deltaOp > DELTA_OP_SEEK) {
+          return fail("Unknown delta operation");
+        } else {
+          deltaArgument = 0;
+          deltaArgumentShift = 0;
+          deltaState = DELTA_ARGUMENT;
+        }
+        break;
+  
+      case DELTA_ARGUMENT: {
+        uint8_t b = *data++;
+        length--;
+        if (deltaArgumentShift > 28) {
+          return fail("Malformed delta length");
+        }
+        deltaArgument |= (uint32_t)(b & 0x7F) << deltaArgumentShift;
+        deltaArgumentShift += 7;
+        if ((b & 0x80) == 0 && !deltaExecute()) {
+          return false;
+        }
+        break;
+      }
+  
+      case DELTA_ADD: {
+        size_t count = (deltaRemaining < sizeof(oldChunk)) ? deltaRemaining : sizeof(oldChunk);
+        if (count > length) count = length;
+        if (!readOldImage(deltaCursor, oldChunk, count)) {
+          return fail("Failed to read running image");
+        }
+        for (size_t i = 0; i < count; i++) {
+          oldChunk[i] += data[i];
+        }
+        if (!emitBytes(oldChunk, count)) {
+          return false;
+        }
+        deltaCursor += count;
+        deltaRemaining -= count;
+        data += count;
+        length -= count;
+        if (deltaRemaining == 0) deltaState = DELTA_OPCODE;
+        break;
+      }
+  
+      case DELTA_INSERT: {
+        size_t count = (deltaRemaining < length) ? deltaRemaining : length;
+        if (!emitBytes(data, count)) {
+          return false;
+        }
+        deltaRemaining -= count;
+        data += count;
+        length -= count;
+        if (deltaRemaining == 0) deltaState = DELTA_OPCODE;
+        break;
+      }
+  
+      case DELTA_DONE:
+        return fail("Data after end of delta");
+    }
+  }
+  return true;
+}
+
+// ============================================================================
+// GZIP DECODER (ESP32)
+// ============================================================================
+
+#if defined(ESP32)
+
+static void releaseInflator() {
+  free(inflator);
+  free(inflateWindow);
+  inflator = NULL;
+  inflateWindow = NULL;
+}
+
+static bool beginInflate() {
+  inflator = (tinfl_decompressor*)malloc(sizeof(tinfl_decompressor));
+  inflateWindow = (uint8_t*)malloc(TINFL_LZ_DICT_SIZE);
+  if (!inflator || !inflateWindow) {
+    releaseInflator();
+    return fail("Not enough memory to inflate");
+  }
+  tinfl_init(inflator);
+  windowPos = 0;
+  gzipHeaderUsed = 0;
+  inflateDone = false;
+  return true;
+}
+
+static bool gzipWrite(const uint8_t* data, size_t length) {
+  // Fixed 10-byte header; the server never sets optional fields
+  if (gzipHeaderUsed < GZIP_HEADER_SIZE) {
+    size_t count = GZIP_HEADER_SIZE - gzipHeaderUsed;
+    if (count > length) count = length;
+    memcpy(gzipHeader + gzipHeaderUsed, data, count);
+    gzipHeaderUsed += count;
+    data += count;
+    length -= count;
+  
+    if (gzipHeaderUsed < GZIP_HEADER_SIZE) {
+      return true;
+    }
+    if (gzipHeader[0] != 0x1F || gzipHeader[1] != 0x8B || gzipHeader[2] != 8 || gzipHeader[3] != 0) {
+      return fail("Unsupported gzip header");
+    }
+  }
+  
+  // Inflate until the input is used up. HAS_MORE_OUTPUT means the window
+  // filled before the input ran out: flush it and go round again.
+  // The 8-byte trailer after the deflate stream is ignored (MD5 covers integrity).
+  while (!inflateDone) {
+    size_t inBytes = length;
+    size_t outBytes = TINFL_LZ_DICT_SIZE - windowPos;
+    tinfl_status status = tinfl_decompress(inflator, data, &inBytes,
+                                           inflateWindow, inflateWindow + windowPos, &outBytes,
+                                           TINFL_FLAG_HAS_MORE_INPUT);
+    data += inBytes;
+    length -= inBytes;
+  
+    if (outBytes > 0) {
+      if (!emitBytes(inflateWindow + windowPos, outBytes)) {
+        return false;
+      }
+      windowPos = (windowPos + outBytes) & (TINFL_LZ_DICT_SIZE - 1);
+    }
+  
+    if (status == TINFL_STATUS_DONE) {
+      inflateDone = true;
+    } else if (status < 0) {
+      return fail("Corrupt gzip stream");
+    } else if (status == TINFL_STATUS_NEEDS_MORE_INPUT) {
+      break;
+    }
+  }
+  return true;
+}
+
+#endif
+
+// ============================================================================
+// PUBLIC API
+// ============================================================================
+
+OtaEncoding parseOtaEncoding(const String& value) {
+  if (value.length() == 0 || value == "identity") return OTA_ENCODING_IDENTITY;
+  if (value == "gzip") return OTA_ENCODING_GZIP;
+  if (value == "delta") return OTA_ENCODING_DELTA;
+  return OTA_ENCODING_UNKNOWN;
+}
+
+const char* otaEncodingName(OtaEncoding encoding) {
+  switch (encoding) {
+    case OTA_ENCODING_IDENTITY: return "identity";
+    case OTA_ENCODING_GZIP: return "gzip";
+    case OTA_ENCODING_DELTA: return "delta";
+    default: return "unknown";
+  }
+}
+
+bool otaDecoderBegin(OtaEncoding encoding, uint32_t streamSize, uint32_t imageSize, const String& md5) {
+  activeEncoding = encoding;
+  decoderError = "";
+  producedSize = 0;
+  outputUsed = 0;
+  passthrough = false;
+  expectedSize = imageSize;
+  bool verifyMd5 = (md5.length() == 32);
+  
+  switch (encoding) {
+    case OTA_ENCODING_IDENTITY:
+      passthrough = true;
+      expectedSize = streamSize;
+      break;
+  
+    case OTA_ENCODING_GZIP:
+      #if defined(ESP32)
+        if (!beginInflate()) return false;
+      #elif defined(ESP8266)
+        // Flashed compressed; eboot inflates it on the next boot. The MD5 is
+        // of the inflated image, so Updater can't check it here.
+        passthrough = true;
+        expectedSize = streamSize;
+        verifyMd5 = false;
+      #endif
+      break;
+  
+    case OTA_ENCODING_DELTA:
+      if (!openOldImage()) {
+        return fail("Running partition not found");
+      }
+      deltaState = DELTA_HEADER;
+      deltaHeaderUsed = 0;
+      deltaCursor = 0;
+      deltaRemaining = 0;
+      break;
+  
+    default:
+      return fail("Unsupported firmware encoding");
+  }
+  
+  if (expectedSize == 0 || !Update.begin(expectedSize)) {
+    otaDecoderAbort();
+    return fail("Not enough space for OTA");
+  }
+  
+  if (verifyMd5) {
+    Update.setMD5(md5.c_str());
+  }
+  
+  DEBUG_PRINT("OTA decoder: ");
+  DEBUG_PRINT(otaEncodingName(encoding));
+  DEBUG_PRINT(", ");
+  DEBUG_PRINT(streamSize);
+  DEBUG_PRINT(" bytes -> ");
+  DEBUG_PRINT(expectedSize);
+  DEBUG_PRINTLN(" bytes");
+  return true;
+}
+
+bool otaDecoderWrite(const uint8_t* data, size_t length) {
+  if (decoderError[0] != '\0') {
+    return false;
+  }
+  if (passthrough) {
+    return writePassthrough(data, length);
+  }
+  
+  switch (activeEncoding) {
+    case OTA_ENCODING_DELTA:
+      return deltaWrite(data, length);
+    #if defined(ESP32)
+    case OTA_ENCODING_GZIP:
+      return gzipWrite(data, length);
+    #endif
+    default:
+      return fail("Unsupported firmware encoding");
+  }
+}
+
+bool otaDecoderEnd() {
+  bool ok = (decoderError[0] == '\0') && flushOutput();
+  
+  if (ok && activeEncoding == OTA_ENCODING_DELTA && deltaState != DELTA_DONE) {
+    ok = fail("Delta ended early");
+  }
+  #if defined(ESP32)
+  if (ok && activeEncoding == OTA_ENCODING_GZIP && !inflateDone) {
+    ok = fail("Gzip stream truncated");
+  }
+  #endif
+  if (ok && producedSize != expectedSize) {
+    ok = fail("Decoded size mismatch");
+  }
+  
+  otaDecoderAbort();
+  return ok;
+}
+
+void otaDecoderAbort() {
+  #if defined(ESP32)
+  releaseInflator();
+  #endif
+  outputUsed = 0;
+}
+
+const char* otaDecoderError() {
+  return decoderError;
+}
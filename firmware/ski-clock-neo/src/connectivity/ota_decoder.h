@@ -0,0 +1,39 @@
+#ifndef OTA_DECODER_H
+#define OTA_DECODER_H
+
+#include <Arduino.h>
+
+// Firmware representations the update server may send (X-Firmware-Encoding)
+enum OtaEncoding {
+  OTA_ENCODING_IDENTITY,  // Plain .bin
+  OTA_ENCODING_GZIP,      // gzip of the .bin (no header flags)
+  OTA_ENCODING_DELTA,     // SKD1 delta against the running image (see ota_decoder.cpp)
+  OTA_ENCODING_UNKNOWN
+};
+
+// Encodings this build can apply, sent as &accept=... on the download URL
+#define OTA_ACCEPT_ENCODINGS "gzip,delta"
+
+// Map an X-Firmware-Encoding header value (empty = identity, older servers)
+OtaEncoding parseOtaEncoding(const String& value);
+const char* otaEncodingName(OtaEncoding encoding);
+
+// Start decoding a streamSize-byte download that expands to imageSize bytes
+// and call Update.begin(). md5 (32 hex chars, may be empty) is checked by
+// Update.end() against the bytes written to flash.
+bool otaDecoderBegin(OtaEncoding encoding, uint32_t streamSize, uint32_t imageSize, const String& md5);
+
+// Decode the next chunk of the download straight into Update.write()
+bool otaDecoderWrite(const uint8_t* data, size_t length);
+
+// True if the stream ended cleanly with exactly imageSize bytes written.
+// Always releases decoder buffers.
+bool otaDecoderEnd();
+
+// Release decoder buffers after a failed update
+void otaDecoderAbort();
+
+// Reason for the last failure
+const char* otaDecoderError();
+
+#endif
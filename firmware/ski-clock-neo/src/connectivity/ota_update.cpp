@@ -3,8 +3,11 @@
 // ============================================================================
 // This library handles OTA firmware updates:
 // - Secure HTTPS downloads from update server
+// - Resume after dropped connections via HTTP Range requests
+// - ESP32: download and flash writes pipelined through a ring of sector buffers
+// - Compressed (gzip) and delta images, decoded on the fly by ota_decoder
 // - API key authentication
-// - Progress reporting via MQTT
+// - Progress reporting via MQTT (most urgent class of the outbound queue)
 // - LED indication during update
 // - Supports both ESP32 and ESP8266
 // ============================================================================
@@ -16,9 +19,34 @@
 #include "ota_update.h"               // This file's header
 #include "../../ski-clock-neo_config.h" // For PRODUCT_NAME
 #include "../core/led_indicator.h"    // For LED status patterns when OTA is in progress
-#include "../core/device_config.h"    // For getEnvironmentScope()
+#include "../core/device_config.h"    // For getEnvironmentScope(), flushing config before reboot
 #include "../data/data_time.h"        // For timestamp functions
-#include "mqtt_client.h"              // For publishing OTA progress to MQTT
+#include "mqtt_client.h"              // For OTA topic IDs
+#include "mqtt_queue.h"               // For publishing OTA progress to MQTT
+#include "ota_decoder.h"              // For gzip/delta images
+
+// ============================================================================
+// CONSTANTS
+// ============================================================================
+
+const uint8_t OTA_MAX_RESUMES = 8;                // Range reconnects per update before giving up
+const unsigned long OTA_STALL_TIMEOUT = 15000;    // No data for this long counts as a dropped connection
+const unsigned long OTA_RESUME_BACKOFF = 2000;    // Resume attempt N waits N * this first
+const uint8_t OTA_STATUS_DRAIN_BUDGET = 4;        // Queued OTA messages sent per status update
+
+#if defined(ESP32)
+  #define OTA_SLOT_SIZE 4096                      // One flash sector per ring slot
+  #define OTA_RING_SLOTS 4                        // 16KB of download buffering
+  #define OTA_BUFFER_SIZE OTA_SLOT_SIZE
+  #define OTA_WRITER_STACK_SIZE 4096
+  #define OTA_WRITER_PRIORITY 2
+  #define OTA_WRITER_TIMEOUT 30000                // ms to wait for a slot/the writer to stop
+  #define OTA_UPDATE_ERROR_STRING() String(Update.errorString())
+#elif defined(ESP8266)
+  #define OTA_CHUNK_SIZE 1024
+  #define OTA_BUFFER_SIZE OTA_CHUNK_SIZE
+  #define OTA_UPDATE_ERROR_STRING() Update.getErrorString()
+#endif
 
 // ============================================================================
 // STATE VARIABLES
@@ -26,6 +54,10 @@
 
 bool otaUpdateInProgress = false;
 
+// Set when a delta update fails (e.g. the running image isn't the exact
+// published build) so retries fetch a full image instead
+static bool otaDeltaDisabled = false;
+
 // ============================================================================
 // MQTT PROGRESS REPORTING
 // ============================================================================
@@ -44,20 +76,29 @@ static void appendTimestamp(char* payload, size_t payloadSize) {
   }
 }
 
+// Queue an OTA status message and send it straight away. The update runs on
+// the MQTT worker (it is started by an inbound message), which is blocked
+// until it finishes, so OTA messages are drained here rather than waiting for
+// the next pass. If MQTT is down they stay queued and go out on reconnect.
+static void sendOTAStatus(MqttTopicId topic, const char* payload, bool coalesce) {
+  queueMqttMessage(topic, payload, MQTT_PRIORITY_OTA, coalesce);
+  drainMqttQueue(OTA_STATUS_DRAIN_BUDGET, MQTT_PRIORITY_OTA);
+}
+
 // Publish OTA start message (to device-specific topic)
 void publishOTAStart(String newVersion) {
   static char payload[320];
   snprintf(payload, sizeof(payload),
     "{\"product\":\"%s\",\"platform\":\"%s\",\"old_version\":\"%s\",\"new_version\":\"%s\"}",
     PRODUCT_NAME,
-    getPlatform().c_str(),
+    getPlatform(),
     FIRMWARE_VERSION,
     newVersion.c_str()
   );
   
   appendTimestamp(payload, sizeof(payload));
   
-  publishMqttPayload(buildDeviceTopic(MQTT_TOPIC_OTA_START), payload);
+  sendOTAStatus(TOPIC_OTA_START, payload, false);
 }
 
 // Publish OTA progress message (0-100%, to device-specific topic)
@@ -67,401 +108,494 @@ void publishOTAProgress(int progress) {
   
   appendTimestamp(payload, sizeof(payload));
   
-  publishMqttPayload(buildDeviceTopic(MQTT_TOPIC_OTA_PROGRESS), payload);
+  sendOTAStatus(TOPIC_OTA_PROGRESS, payload, true);  // Only the latest progress matters
 }
 
 // Publish OTA complete message (to device-specific topic)
-void publishOTAComplete(bool success, String errorMessage) {
+void publishOTAComplete(bool success, const char* errorMessage) {
   static char payload[320];
   if (success) {
     snprintf(payload, sizeof(payload), "{\"status\":\"success\"}");
   } else {
     snprintf(payload, sizeof(payload),
       "{\"status\":\"failed\",\"error\":\"%s\"}",
-      errorMessage.c_str()
+      errorMessage
     );
   }
   
   appendTimestamp(payload, sizeof(payload));
   
-  publishMqttPayload(buildDeviceTopic(MQTT_TOPIC_OTA_COMPLETE), payload);
+  sendOTAStatus(TOPIC_OTA_COMPLETE, payload, false);
 }
 
 // ============================================================================
-// OTA UPDATE EXECUTION
+// DOWNLOAD SESSION
 // ============================================================================
+// One HTTP(S) connection to the update server. After a drop the session is
+// reopened with "Range: bytes=<received>-" and the image continues where it
+// stopped, so flaky WiFi costs a reconnect rather than a full re-download.
 
-// Perform OTA update from custom server
-bool performOTAUpdate(String version) {
-  if (!WiFi.isConnected()) {
-    DEBUG_PRINTLN("OTA: WiFi not connected");
-    publishOTAComplete(false, "WiFi not connected");
-    return false;
-  }
-
-  // Enter LED override mode for OTA progress indication
-  beginLedOverride(LED_OTA_PROGRESS);
-  
-  String binaryUrl = String(UPDATE_SERVER_URL) + "/api/firmware/" + getPlatform() + "?product=" + PRODUCT_NAME + "&env=" + getEnvironmentScope();
-  
-  DEBUG_PRINTLN("===========================================");
-  DEBUG_PRINTLN("OTA UPDATE STARTING");
-  DEBUG_PRINTLN("===========================================");
-  DEBUG_PRINT("Current version: ");
-  DEBUG_PRINTLN(FIRMWARE_VERSION);
-  DEBUG_PRINT("New version: ");
-  DEBUG_PRINTLN(version);
-  DEBUG_PRINT("Download URL: ");
-  DEBUG_PRINTLN(binaryUrl);
-  DEBUG_PRINTLN("===========================================");
-  
-  publishOTAStart(version);
-  otaUpdateInProgress = true;
-  
-#if defined(ESP32)
-  // ESP32 - Manual download with authentication
+struct OtaDownload {
   HTTPClient http;
-  bool isHttps = binaryUrl.startsWith("https://");
+  WiFiClientSecure* secureClientPtr;  // Track client type for proper cleanup
+  WiFiClient* plainClientPtr;
+  String url;
+  size_t total;                       // Full download size (from the first response)
+  bool rangeRejected;                 // Server answered a Range request with the whole image
+  OtaEncoding encoding;               // Representation the server chose (X-Firmware-Encoding)
+  uint32_t imageSize;                 // Decoded image size (X-Firmware-Size, else total)
+  String md5;                         // MD5 of the decoded image (X-Firmware-MD5, may be empty)
+};
+
+static const char* OTA_RESPONSE_HEADERS[] = {"X-Firmware-Encoding", "X-Firmware-Size", "X-Firmware-MD5"};
+
+static void closeDownload(OtaDownload& dl) {
+  dl.http.end();
+  if (dl.secureClientPtr) delete dl.secureClientPtr;
+  if (dl.plainClientPtr) delete dl.plainClientPtr;
+  dl.secureClientPtr = nullptr;
+  dl.plainClientPtr = nullptr;
+}
+
+// Connect and request the image from byte `offset` onwards
+// Returns false with a reason in `error` if the response can't be used
+static bool openDownload(OtaDownload& dl, size_t offset, char* error, size_t errorSize) {
+  closeDownload(dl);
   
-  // Track client type for proper cleanup
-  WiFiClientSecure* secureClientPtr = nullptr;
-  WiFiClient* plainClientPtr = nullptr;
   WiFiClient* clientPtr = nullptr;
-  
-  // Setup HTTP connection
-  if (isHttps) {
-    secureClientPtr = new WiFiClientSecure();
-    secureClientPtr->setInsecure();
-    clientPtr = secureClientPtr;
-    
-    if (!http.begin(*clientPtr, binaryUrl)) {
-      DEBUG_PRINTLN("Failed to begin HTTP connection");
-      publishOTAComplete(false, "Failed to begin HTTP connection");
-      delete secureClientPtr;
-      endLedOverride();
-      otaUpdateInProgress = false;
-      return false;
-    }
+  if (dl.url.startsWith("https://")) {
+    dl.secureClientPtr = new WiFiClientSecure();
+    dl.secureClientPtr->setInsecure();
+    clientPtr = dl.secureClientPtr;
   } else {
-    plainClientPtr = new WiFiClient();
-    clientPtr = plainClientPtr;
-    
-    if (!http.begin(*clientPtr, binaryUrl)) {
-      DEBUG_PRINTLN("Failed to begin HTTP connection");
-      publishOTAComplete(false, "Failed to begin HTTP connection");
-      delete plainClientPtr;
-      endLedOverride();
-      otaUpdateInProgress = false;
-      return false;
-    }
+    dl.plainClientPtr = new WiFiClient();
+    clientPtr = dl.plainClientPtr;
   }
   
-  // Add authentication headers
-  http.addHeader("X-API-Key", DOWNLOAD_API_KEY);
-  http.addHeader("User-Agent", "SkiClockNeo-OTA");
-  
-  DEBUG_PRINTLN("Starting ESP32 OTA download...");
-  int httpCode = http.GET();
-  
-  if (httpCode != HTTP_CODE_OK) {
-    DEBUG_PRINT("HTTP GET failed: ");
-    DEBUG_PRINTLN(httpCode);
-    char errorMsg[64];
-    snprintf(errorMsg, sizeof(errorMsg), "HTTP GET failed: %d", httpCode);
-    publishOTAComplete(false, errorMsg);
-    http.end();
-    if (secureClientPtr) delete secureClientPtr;
-    if (plainClientPtr) delete plainClientPtr;
-    endLedOverride();
-    otaUpdateInProgress = false;
+  if (!dl.http.begin(*clientPtr, dl.url)) {
+    snprintf(error, errorSize, "Failed to begin HTTP connection");
     return false;
   }
   
-  int contentLength = http.getSize();
-  DEBUG_PRINT("Firmware size: ");
-  DEBUG_PRINTLN(contentLength);
-  
-  if (contentLength <= 0) {
-    DEBUG_PRINTLN("Invalid content length");
-    publishOTAComplete(false, "Invalid content length");
-    http.end();
-    if (secureClientPtr) delete secureClientPtr;
-    if (plainClientPtr) delete plainClientPtr;
-    endLedOverride();
-    otaUpdateInProgress = false;
-    return false;
+  // Add authentication headers
+  dl.http.addHeader("X-API-Key", DOWNLOAD_API_KEY);
+  dl.http.addHeader("User-Agent", "SkiClockNeo-OTA");
+  
+  if (offset > 0) {
+    char range[32];
+    snprintf(range, sizeof(range), "bytes=%lu-", (unsigned long)offset);
+    dl.http.addHeader("Range", range);
+    // Ask for the same representation again so the offset means the same byte
+    dl.http.addHeader("X-Firmware-Encoding", otaEncodingName(dl.encoding));
   }
+  dl.http.collectHeaders(OTA_RESPONSE_HEADERS, sizeof(OTA_RESPONSE_HEADERS) / sizeof(OTA_RESPONSE_HEADERS[0]));
   
-  // Begin OTA update
-  bool canBegin = Update.begin(contentLength);
-  if (!canBegin) {
-    DEBUG_PRINTLN("Not enough space for OTA");
-    publishOTAComplete(false, "Not enough space for OTA");
-    http.end();
-    if (secureClientPtr) delete secureClientPtr;
-    if (plainClientPtr) delete plainClientPtr;
-    endLedOverride();
-    otaUpdateInProgress = false;
+  int httpCode = dl.http.GET();
+  int expectedCode = (offset > 0) ? HTTP_CODE_PARTIAL_CONTENT : HTTP_CODE_OK;
+  
+  if (httpCode != expectedCode) {
+    if (offset > 0 && httpCode == HTTP_CODE_OK) {
+      dl.rangeRejected = true;
+      snprintf(error, errorSize, "Server ignored Range, cannot resume");
+    } else {
+      snprintf(error, errorSize, "HTTP GET failed: %d", httpCode);
+    }
     return false;
   }
   
-  WiFiClient * stream = http.getStreamPtr();
+  int length = dl.http.getSize();
+  OtaEncoding encoding = parseOtaEncoding(dl.http.header("X-Firmware-Encoding"));
   
-  // Download in chunks with progress reporting
-  uint8_t buff[512] = { 0 };
-  size_t written = 0;
-  int lastReportedProgress = 0;
+  if (offset == 0) {
+    if (length <= 0) {
+      snprintf(error, errorSize, "Invalid content length");
+      return false;
+    }
+    if (encoding == OTA_ENCODING_UNKNOWN) {
+      snprintf(error, errorSize, "Unsupported firmware encoding");
+      return false;
+    }
+    dl.total = length;
+    dl.encoding = encoding;
+    dl.imageSize = (encoding == OTA_ENCODING_IDENTITY) ? length : dl.http.header("X-Firmware-Size").toInt();
+    dl.md5 = dl.http.header("X-Firmware-MD5");
+  } else if (length <= 0 || (size_t)length != dl.total - offset) {
+    snprintf(error, errorSize, "Resume length mismatch: %d", length);
+    return false;
+  } else if (encoding != dl.encoding) {
+    // The ranges would come from a different byte stream
+    snprintf(error, errorSize, "Firmware encoding changed on resume");
+    return false;
+  }
+  
+  return true;
+}
+
+// Read up to len bytes. Returns 0 once the connection is closed or has been
+// silent for OTA_STALL_TIMEOUT - the caller then resumes with a Range request.
+static size_t readDownload(OtaDownload& dl, uint8_t* dest, size_t len) {
+  WiFiClient* stream = dl.http.getStreamPtr();
+  unsigned long waitStart = millis();
   
-  while (http.connected() && (written < contentLength)) {
+  while (millis() - waitStart < OTA_STALL_TIMEOUT) {
     size_t available = stream->available();
     if (available) {
-      size_t bytesToRead = ((available > sizeof(buff)) ? sizeof(buff) : available);
-      size_t bytesRead = stream->readBytes(buff, bytesToRead);
-      
-      size_t bytesWritten = Update.write(buff, bytesRead);
-      if (bytesWritten != bytesRead) {
-        DEBUG_PRINTLN("Write error during OTA");
-        publishOTAComplete(false, "Write error during OTA");
-        http.end();
-        if (secureClientPtr) delete secureClientPtr;
-        if (plainClientPtr) delete plainClientPtr;
-        endLedOverride();
-        otaUpdateInProgress = false;
-        return false;
-      }
-      
-      written += bytesWritten;
-      
-      // Report progress every 10%
-      int progress = (written * 100) / contentLength;
-      if (progress >= lastReportedProgress + 10) {
-        publishOTAProgress(progress);
-        lastReportedProgress = progress;
+      size_t bytesToRead = (available > len) ? len : available;
+      size_t bytesRead = stream->readBytes(dest, bytesToRead);
+      if (bytesRead > 0) {
+        return bytesRead;
       }
+    } else if (!dl.http.connected()) {
+      return 0;
     }
     delay(1);
   }
   
-  if (written == contentLength) {
-    DEBUG_PRINTLN("Firmware written successfully");
-    publishOTAProgress(100);
-  } else {
-    DEBUG_PRINT("Written only ");
-    DEBUG_PRINT(written);
-    DEBUG_PRINT(" / ");
-    DEBUG_PRINTLN(contentLength);
-    publishOTAComplete(false, "Incomplete download");
-    http.end();
-    if (secureClientPtr) delete secureClientPtr;
-    if (plainClientPtr) delete plainClientPtr;
-    endLedOverride();
-    otaUpdateInProgress = false;
+  return 0;
+}
+
+// ============================================================================
+// FLASH WRITER
+// ============================================================================
+// ESP32: the download fills sector-sized slots while a writer task commits
+// them with Update.write(), so the TCP window keeps draining during flash
+// erases. Slots cycle free -> filled -> written -> free through two queues.
+// ESP8266: no spare core or RAM for a ring - one chunk buffer, written inline
+// (Updater already collects a full sector before each flash write).
+
+// A writer that did not stop may still be inside the decoder, so its buffers
+// and the decoder state are left alone until the next restart
+static bool otaWriterStuck = false;
+
+#if defined(ESP32)
+
+#define OTA_WRITER_STOP 0xFF
+
+static uint8_t* otaSlots[OTA_RING_SLOTS] = {nullptr};
+static uint16_t otaSlotLength[OTA_RING_SLOTS];
+static QueueHandle_t otaFreeSlots = NULL;           // Slots the download may fill
+static QueueHandle_t otaFilledSlots = NULL;         // Slots waiting for the writer (or OTA_WRITER_STOP)
+static TaskHandle_t otaDownloadTask = NULL;         // Notified when the writer exits
+static volatile bool otaWriteFailed = false;
+
+static void otaWriterTask(void* parameter) {
+  uint8_t slot;
+  
+  for (;;) {
+    if (xQueueReceive(otaFilledSlots, &slot, portMAX_DELAY) != pdTRUE) {
+      continue;
+    }
+    if (slot == OTA_WRITER_STOP) {
+      break;
+    }
+    
+    // After a failure keep draining slots so the download side never blocks
+    if (!otaWriteFailed) {
+      if (!otaDecoderWrite(otaSlots[slot], otaSlotLength[slot])) {
+        otaWriteFailed = true;
+      }
+    }
+    xQueueSend(otaFreeSlots, &slot, portMAX_DELAY);
+  }
+  
+  xTaskNotifyGive(otaDownloadTask);
+  vTaskDelete(NULL);
+}
+
+static void freeFlashWriter() {
+  for (uint8_t i = 0; i < OTA_RING_SLOTS; i++) {
+    free(otaSlots[i]);
+    otaSlots[i] = nullptr;
+  }
+  if (otaFreeSlots) vQueueDelete(otaFreeSlots);
+  if (otaFilledSlots) vQueueDelete(otaFilledSlots);
+  otaFreeSlots = NULL;
+  otaFilledSlots = NULL;
+}
+
+static bool beginFlashWriter() {
+  otaWriteFailed = false;
+  otaDownloadTask = xTaskGetCurrentTaskHandle();
+  
+  otaFreeSlots = xQueueCreate(OTA_RING_SLOTS, sizeof(uint8_t));
+  otaFilledSlots = xQueueCreate(OTA_RING_SLOTS + 1, sizeof(uint8_t));  // +1 for the stop marker
+  if (!otaFreeSlots || !otaFilledSlots) {
+    freeFlashWriter();
     return false;
   }
   
-  // Finalize update
-  if (Update.end()) {
-    if (Update.isFinished()) {
-      DEBUG_PRINTLN("OTA Update successful! Rebooting...");
-      publishOTAComplete(true);
-      http.end();
-      if (secureClientPtr) delete secureClientPtr;
-      if (plainClientPtr) delete plainClientPtr;
-      delay(2000);
-      ESP.restart();
-      return true;
-    } else {
-      DEBUG_PRINTLN("Update not finished");
-      endLedOverride();
-      otaUpdateInProgress = false;
-      publishOTAComplete(false, "Update not finished");
+  for (uint8_t i = 0; i < OTA_RING_SLOTS; i++) {
+    otaSlots[i] = (uint8_t*)malloc(OTA_SLOT_SIZE);
+    if (!otaSlots[i]) {
+      freeFlashWriter();
+      return false;
     }
-  } else {
-    String errorMsg = Update.errorString();
-    DEBUG_PRINT("Update error: ");
-    DEBUG_PRINTLN(errorMsg);
-    publishOTAComplete(false, errorMsg);
+    xQueueSend(otaFreeSlots, &i, 0);
+  }
+  
+  if (xTaskCreate(otaWriterTask, "OTAWriter", OTA_WRITER_STACK_SIZE, NULL, OTA_WRITER_PRIORITY, NULL) != pdPASS) {
+    freeFlashWriter();
+    return false;
+  }
+  
+  return true;
+}
+
+// Next empty slot (blocks while the writer is behind)
+static uint8_t* acquireWriteBuffer(uint8_t& slot) {
+  if (xQueueReceive(otaFreeSlots, &slot, pdMS_TO_TICKS(OTA_WRITER_TIMEOUT)) != pdTRUE) {
+    return nullptr;
+  }
+  return otaSlots[slot];
+}
+
+static bool commitWriteBuffer(uint8_t slot, uint16_t length) {
+  otaSlotLength[slot] = length;
+  xQueueSend(otaFilledSlots, &slot, portMAX_DELAY);
+  return !otaWriteFailed;
+}
+
+// Flush queued slots and stop the writer; false if any write failed
+static bool endFlashWriter() {
+  uint8_t stop = OTA_WRITER_STOP;
+  xQueueSend(otaFilledSlots, &stop, portMAX_DELAY);
+  
+  if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(OTA_WRITER_TIMEOUT)) == 0) {
+    // Writer is stuck in a flash operation - leak its buffers rather than free them under it
+    DEBUG_PRINTLN("OTA writer did not stop in time");
+    otaWriterStuck = true;
+    return false;
   }
   
-  http.end();
-  if (secureClientPtr) delete secureClientPtr;
-  if (plainClientPtr) delete plainClientPtr;
+  freeFlashWriter();
+  return !otaWriteFailed;
+}
+
+#elif defined(ESP8266)
+
+static uint8_t otaChunk[OTA_CHUNK_SIZE];
+
+static bool beginFlashWriter() {
+  return true;
+}
+
+static uint8_t* acquireWriteBuffer(uint8_t& slot) {
+  slot = 0;
+  return otaChunk;
+}
+
+static bool commitWriteBuffer(uint8_t slot, uint16_t length) {
+  (void)slot;
+  return otaDecoderWrite(otaChunk, length);
+}
+
+static bool endFlashWriter() {
+  return true;
+}
+
+#endif
+
+// ============================================================================
+// OTA UPDATE EXECUTION
+// ============================================================================
+
+// Shared failure exit
+static bool failOTA(OtaDownload& dl, const char* error) {
+  DEBUG_PRINT("OTA failed: ");
+  DEBUG_PRINTLN(error);
+  publishOTAComplete(false, error);
+  if (!otaWriterStuck) {
+    otaDecoderAbort();
+  }
+  if (dl.encoding == OTA_ENCODING_DELTA) {
+    otaDeltaDisabled = true;
+  }
+  closeDownload(dl);
   endLedOverride();
   otaUpdateInProgress = false;
   return false;
-  
-#elif defined(ESP8266)
-  // ESP8266 - Manual download with authentication
-  HTTPClient http;
-  bool isHttps = binaryUrl.startsWith("https://");
-  
-  // Track client type for proper cleanup
-  WiFiClientSecure* secureClientPtr = nullptr;
-  WiFiClient* plainClientPtr = nullptr;
-  WiFiClient* clientPtr = nullptr;
-  
-  // Setup HTTP connection
-  if (isHttps) {
-    secureClientPtr = new WiFiClientSecure();
-    secureClientPtr->setInsecure();
-    clientPtr = secureClientPtr;
+}
+
+// Reopen the download at `offset` after a drop, with growing backoff
+static bool resumeDownload(OtaDownload& dl, size_t offset, uint8_t& resumes, char* error, size_t errorSize) {
+  while (resumes < OTA_MAX_RESUMES) {
+    resumes++;
+    DEBUG_PRINT("OTA connection lost at ");
+    DEBUG_PRINT(offset);
+    DEBUG_PRINT(" bytes, resume attempt ");
+    DEBUG_PRINTLN(resumes);
     
-    if (!http.begin(*clientPtr, binaryUrl)) {
-      DEBUG_PRINTLN("Failed to begin HTTP connection");
-      publishOTAComplete(false, "Failed to begin HTTP connection");
-      delete secureClientPtr;
-      endLedOverride();
-      otaUpdateInProgress = false;
-      return false;
-    }
-  } else {
-    plainClientPtr = new WiFiClient();
-    clientPtr = plainClientPtr;
+    closeDownload(dl);
+    delay(OTA_RESUME_BACKOFF * resumes);
     
-    if (!http.begin(*clientPtr, binaryUrl)) {
-      DEBUG_PRINTLN("Failed to begin HTTP connection");
-      publishOTAComplete(false, "Failed to begin HTTP connection");
-      delete plainClientPtr;
-      endLedOverride();
-      otaUpdateInProgress = false;
-      return false;
+    if (!WiFi.isConnected()) {
+      snprintf(error, errorSize, "WiFi not connected");
+      continue;
+    }
+    if (openDownload(dl, offset, error, errorSize)) {
+      error[0] = '\0';
+      return true;
+    }
+    DEBUG_PRINTLN(error);
+    if (dl.rangeRejected) {
+      break;  // Retrying won't help - the server only sends whole images
     }
   }
   
-  // Add authentication headers
-  http.addHeader("X-API-Key", DOWNLOAD_API_KEY);
-  http.addHeader("User-Agent", "SkiClockNeo-OTA");
-  
-  DEBUG_PRINTLN("Starting ESP8266 OTA download...");
-  int httpCode = http.GET();
-  
-  if (httpCode != HTTP_CODE_OK) {
-    DEBUG_PRINT("HTTP GET failed: ");
-    DEBUG_PRINTLN(httpCode);
-    char errorMsg[64];
-    snprintf(errorMsg, sizeof(errorMsg), "HTTP GET failed: %d", httpCode);
-    publishOTAComplete(false, errorMsg);
-    http.end();
-    if (secureClientPtr) delete secureClientPtr;
-    if (plainClientPtr) delete plainClientPtr;
-    endLedOverride();
-    otaUpdateInProgress = false;
+  if (error[0] == '\0') {
+    snprintf(error, errorSize, "Connection lost %u times, giving up", resumes);
+  }
+  return false;
+}
+
+// Perform OTA update from custom server
+bool performOTAUpdate(String version) {
+  if (!WiFi.isConnected()) {
+    DEBUG_PRINTLN("OTA: WiFi not connected");
+    publishOTAComplete(false, "WiFi not connected");
     return false;
   }
+
+  // Enter LED override mode for OTA progress indication
+  beginLedOverride(LED_OTA_PROGRESS);
   
-  int contentLength = http.getSize();
-  DEBUG_PRINT("Firmware size: ");
-  DEBUG_PRINTLN(contentLength);
-  
-  if (contentLength <= 0) {
-    DEBUG_PRINTLN("Invalid content length");
-    publishOTAComplete(false, "Invalid content length");
-    http.end();
-    if (secureClientPtr) delete secureClientPtr;
-    if (plainClientPtr) delete plainClientPtr;
-    endLedOverride();
-    otaUpdateInProgress = false;
-    return false;
+  // Ask for this exact version so a resumed download can't switch images midway
+  OtaDownload dl;
+  dl.secureClientPtr = nullptr;
+  dl.plainClientPtr = nullptr;
+  dl.total = 0;
+  dl.rangeRejected = false;
+  dl.encoding = OTA_ENCODING_IDENTITY;
+  dl.imageSize = 0;
+  // from= lets the server pick a delta against the image we are running
+  dl.url = String(UPDATE_SERVER_URL) + "/api/firmware/" + getPlatform() + "?product=" + PRODUCT_NAME + "&env=" + getEnvironmentScope() + "&version=" + version
+    + "&from=" + FIRMWARE_VERSION + "&accept=" + (otaDeltaDisabled ? "gzip" : OTA_ACCEPT_ENCODINGS);
+  
+  DEBUG_PRINTLN("===========================================");
+  DEBUG_PRINTLN("OTA UPDATE STARTING");
+  DEBUG_PRINTLN("===========================================");
+  DEBUG_PRINT("Current version: ");
+  DEBUG_PRINTLN(FIRMWARE_VERSION);
+  DEBUG_PRINT("New version: ");
+  DEBUG_PRINTLN(version);
+  DEBUG_PRINT("Download URL: ");
+  DEBUG_PRINTLN(dl.url);
+  DEBUG_PRINTLN("===========================================");
+  
+  publishOTAStart(version);
+  otaUpdateInProgress = true;
+  
+  char errorMsg[64];
+  
+  DEBUG_PRINTLN("Starting OTA download...");
+  if (!openDownload(dl, 0, errorMsg, sizeof(errorMsg))) {
+    return failOTA(dl, errorMsg);
   }
   
+  DEBUG_PRINT("Firmware size: ");
+  DEBUG_PRINT(dl.total);
+  DEBUG_PRINT(" (");
+  DEBUG_PRINT(otaEncodingName(dl.encoding));
+  DEBUG_PRINTLN(")");
+  
   // Begin OTA update
-  bool canBegin = Update.begin(contentLength);
-  if (!canBegin) {
-    DEBUG_PRINTLN("Not enough space for OTA");
-    publishOTAComplete(false, "Not enough space for OTA");
-    http.end();
-    if (secureClientPtr) delete secureClientPtr;
-    if (plainClientPtr) delete plainClientPtr;
-    endLedOverride();
-    otaUpdateInProgress = false;
-    return false;
+  if (otaWriterStuck) {
+    return failOTA(dl, "Previous OTA writer still busy, restart required");
+  }
+  if (!otaDecoderBegin(dl.encoding, dl.total, dl.imageSize, dl.md5)) {
+    return failOTA(dl, otaDecoderError());
   }
   
-  WiFiClient * stream = http.getStreamPtr();
+  if (!beginFlashWriter()) {
+    return failOTA(dl, "Failed to start flash writer");
+  }
   
-  // Download in chunks with progress reporting
-  uint8_t buff[512] = { 0 };
-  size_t written = 0;
+  // Fill write buffers completely (except the last) and hand them to the writer
+  size_t received = 0;
+  uint8_t resumes = 0;
   int lastReportedProgress = 0;
-  
-  while (http.connected() && (written < contentLength)) {
-    size_t available = stream->available();
-    if (available) {
-      size_t bytesToRead = ((available > sizeof(buff)) ? sizeof(buff) : available);
-      size_t bytesRead = stream->readBytes(buff, bytesToRead);
-      
-      size_t bytesWritten = Update.write(buff, bytesRead);
-      if (bytesWritten != bytesRead) {
-        DEBUG_PRINTLN("Write error during OTA");
-        publishOTAComplete(false, "Write error during OTA");
-        http.end();
-        if (secureClientPtr) delete secureClientPtr;
-        if (plainClientPtr) delete plainClientPtr;
-        endLedOverride();
-        otaUpdateInProgress = false;
-        return false;
-      }
-      
-      written += bytesWritten;
-      
-      // Report progress every 10%
-      int progress = (written * 100) / contentLength;
-      if (progress >= lastReportedProgress + 10) {
-        publishOTAProgress(progress);
-        lastReportedProgress = progress;
+  bool writeOk = true;
+  errorMsg[0] = '\0';
+  
+  while (received < dl.total && writeOk && errorMsg[0] == '\0') {
+    uint8_t slot;
+    uint8_t* buffer = acquireWriteBuffer(slot);
+    if (!buffer) {
+      snprintf(errorMsg, sizeof(errorMsg), "Flash writer stalled");
+      break;
+    }
+    
+    size_t remaining = dl.total - received;
+    uint16_t capacity = (remaining < OTA_BUFFER_SIZE) ? remaining : OTA_BUFFER_SIZE;
+    uint16_t filled = 0;
+    
+    while (filled < capacity) {
+      size_t bytesRead = readDownload(dl, buffer + filled, capacity - filled);
+      if (bytesRead == 0) {
+        if (!resumeDownload(dl, received + filled, resumes, errorMsg, sizeof(errorMsg))) {
+          break;
+        }
+        continue;
       }
+      filled += bytesRead;
+    }
+    
+    // Give the slot back even on failure so the ring drains cleanly
+    writeOk = commitWriteBuffer(slot, filled);
+    received += filled;
+    
+    // Report progress every 10%
+    int progress = (received * 100) / dl.total;
+    if (progress >= lastReportedProgress + 10) {
+      publishOTAProgress(progress);
+      lastReportedProgress = progress;
     }
-    delay(1);
   }
   
-  if (written == contentLength) {
-    DEBUG_PRINTLN("Firmware written successfully");
-    publishOTAProgress(100);
-  } else {
+  if (!endFlashWriter()) {
+    writeOk = false;
+  }
+  
+  if (!writeOk) {
+    const char* decoderError = otaDecoderError();
+    return failOTA(dl, decoderError[0] != '\0' ? decoderError : "Write error during OTA");
+  }
+  
+  if (received != dl.total) {
     DEBUG_PRINT("Written only ");
-    DEBUG_PRINT(written);
+    DEBUG_PRINT(received);
     DEBUG_PRINT(" / ");
-    DEBUG_PRINTLN(contentLength);
-    publishOTAComplete(false, "Incomplete download");
-    http.end();
-    if (secureClientPtr) delete secureClientPtr;
-    if (plainClientPtr) delete plainClientPtr;
-    endLedOverride();
-    otaUpdateInProgress = false;
-    return false;
+    DEBUG_PRINTLN(dl.total);
+    return failOTA(dl, errorMsg[0] != '\0' ? errorMsg : "Incomplete download");
   }
   
+  DEBUG_PRINT("Firmware written successfully (");
+  DEBUG_PRINT(resumes);
+  DEBUG_PRINTLN(" resumes)");
+  
+  // Flush the decoder and check it produced the whole image
+  if (!otaDecoderEnd()) {
+    return failOTA(dl, otaDecoderError());
+  }
+  publishOTAProgress(100);
+  
   // Finalize update
-  if (Update.end()) {
-    if (Update.isFinished()) {
-      DEBUG_PRINTLN("OTA Update successful! Rebooting...");
-      publishOTAComplete(true);
-      http.end();
-      if (secureClientPtr) delete secureClientPtr;
-      if (plainClientPtr) delete plainClientPtr;
-      delay(2000);
-      ESP.restart();
-      return true;
-    } else {
-      DEBUG_PRINTLN("Update not finished");
-      publishOTAComplete(false, "Update not finished");
-    }
-  } else {
-    String errorMsg = Update.getErrorString();
-    DEBUG_PRINT("Update error: ");
-    DEBUG_PRINTLN(errorMsg);
-    publishOTAComplete(false, errorMsg);
+  if (!Update.end()) {
+    String updateError = OTA_UPDATE_ERROR_STRING();
+    return failOTA(dl, updateError.c_str());
   }
   
-  http.end();
-  if (secureClientPtr) delete secureClientPtr;
-  if (plainClientPtr) delete plainClientPtr;
-  endLedOverride();
-  otaUpdateInProgress = false;
-  return false;
-#endif
+  if (!Update.isFinished()) {
+    return failOTA(dl, "Update not finished");
+  }
   
-  return false;
+  DEBUG_PRINTLN("OTA Update successful! Rebooting...");
+  publishOTAComplete(true);
+  closeDownload(dl);
+  flushDeviceConfig();
+  delay(2000);
+  ESP.restart();
+  return true;
 }
 
 // ============================================================================
@@ -45,6 +45,6 @@ void triggerOTAUpdate(String newVersion, bool isPinned = false);
 bool performOTAUpdate(String version);
 void publishOTAStart(String newVersion);
 void publishOTAProgress(int progress);
-void publishOTAComplete(bool success, String errorMessage = "");
+void publishOTAComplete(bool success, const char* errorMessage = "");
 
 #endif
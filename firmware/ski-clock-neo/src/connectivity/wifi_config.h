@@ -16,6 +16,7 @@
 #include "../core/device_info.h"   // For getDeviceID()
 #include "../core/led_indicator.h" // For LED status patterns when WiFi connection state changes
 #include "mqtt_client.h"           // For MQTT connection management when WiFi connection state changes
+#include "wifi_fast_connect.h"     // For the directed reconnect to the last access point
 #include "../core/event_log.h"     // For logging WiFi events
 #include "../core/debug.h"         // For debug logging
 
@@ -115,6 +116,10 @@ void initWiFi() {
   // Apply configuration
   portal.config(config);
 
+  // Rejoin the last access point directly (no scan) - AutoConnect then finds
+  // the station already connected and only starts the portal
+  fastConnectWiFi();
+
   // Start AutoConnect
   // This will:
   // - Try to connect to previously saved networks (in order of signal strength)
@@ -165,56 +170,44 @@ void updateWiFi() {
   void onWiFiConnected(WiFiEvent_t event, WiFiEventInfo_t info) {
     DEBUG_PRINTLN("WiFi connected, connecting to MQTT...");
     
-    // Log wifi_connect event with connection details
-    String wifiData = "{\"ssid\":\"";
-    wifiData += WiFi.SSID();
-    wifiData += "\",\"rssi\":";
-    wifiData += WiFi.RSSI();
-    wifiData += ",\"ip\":\"";
-    wifiData += WiFi.localIP().toString();
-    wifiData += "\"}";
-    logEvent("wifi_connect", wifiData.c_str());
+    // Log wifi_connect event with connection details (SSID is copied into the log)
+    logEventWithString(EVT_WIFI_CONNECT, WiFi.SSID().c_str(), WiFi.RSSI(), (uint32_t)WiFi.localIP());
+    saveWiFiFastConnect();
     
     setConnectivityState(true, false);  // WiFi=connected, MQTT=disconnected
     
-    // Connect to MQTT (safe - connectMQTT checks if initialized)
+    // Connect to MQTT from the MQTT worker (safe - connectMQTT checks if initialized)
     resetMQTTReconnectTimer();
-    connectMQTT();
+    requestMQTTConnect();
   }
 
   void onWiFiDisconnected(WiFiEvent_t event, WiFiEventInfo_t info) {
     DEBUG_PRINTLN("WiFi disconnected, disconnecting MQTT...");
-    logEvent("wifi_disconnect");
+    logEvent(EVT_WIFI_DISCONNECT);
     
-    disconnectMQTT();
+    requestMQTTDisconnect();
     setConnectivityState(false, false);  // WiFi=disconnected, MQTT=disconnected
   }
 #elif defined(ESP8266)
   void onWiFiConnected(const WiFiEventStationModeGotIP& event) {
     DEBUG_PRINTLN("WiFi connected, connecting to MQTT...");
     
-    // Log wifi_connect event with connection details
-    String wifiData = "{\"ssid\":\"";
-    wifiData += WiFi.SSID();
-    wifiData += "\",\"rssi\":";
-    wifiData += WiFi.RSSI();
-    wifiData += ",\"ip\":\"";
-    wifiData += WiFi.localIP().toString();
-    wifiData += "\"}";
-    logEvent("wifi_connect", wifiData.c_str());
+    // Log wifi_connect event with connection details (SSID is copied into the log)
+    logEventWithString(EVT_WIFI_CONNECT, WiFi.SSID().c_str(), WiFi.RSSI(), (uint32_t)WiFi.localIP());
+    saveWiFiFastConnect();
     
     setConnectivityState(true, false);  // WiFi=connected, MQTT=disconnected
     
-    // Connect to MQTT (safe - connectMQTT checks if initialized)
+    // Connect to MQTT from the MQTT worker (safe - connectMQTT checks if initialized)
     resetMQTTReconnectTimer();
-    connectMQTT();
+    requestMQTTConnect();
   }
 
   void onWiFiDisconnected(const WiFiEventStationModeDisconnected& event) {
     DEBUG_PRINTLN("WiFi disconnected, disconnecting MQTT...");
-    logEvent("wifi_disconnect");
+    logEvent(EVT_WIFI_DISCONNECT);
     
-    disconnectMQTT();
+    requestMQTTDisconnect();
     setConnectivityState(false, false);  // WiFi=disconnected, MQTT=disconnected
   }
 #endif
@@ -0,0 +1,197 @@
+// ============================================================================
+// wifi_fast_connect.cpp - Directed WiFi reconnect from a cached AP
+// ============================================================================
+// AutoConnect scans every channel before it associates, then DHCP runs, so a
+// brownout or OTA reboot leaves the clock offline for several seconds. The
+// last good connection (SSID, BSSID, channel, lease) is cached instead:
+// - ESP32: NVS (Preferences), survives power loss
+// - ESP8266: RTC user memory, survives resets but not power loss (flash is
+//   left alone; the SDK already stores the credentials there)
+// At boot WiFi.begin() targets that BSSID on that channel, skipping the scan.
+// The password is not cached - it comes from AutoConnect's credential store.
+// Anything unexpected falls back to AutoConnect's normal path.
+// ============================================================================
+
+// ============================================================================
+// INCLUDES
+// ============================================================================
+
+#include "wifi_fast_connect.h"            // This file's header
+#include "../../ski-clock-neo_config.h"   // For WIFI_FAST_CONNECT_REUSE_IP
+#include "../core/debug.h"                // For debug logging
+#include <AutoConnectCredential.h>        // For the saved password
+
+#if defined(ESP32)
+  #include <WiFi.h>
+  #include <Preferences.h>
+#elif defined(ESP8266)
+  #include <ESP8266WiFi.h>
+#endif
+
+// ============================================================================
+// CONSTANTS
+// ============================================================================
+
+#define WIFI_CACHE_MAGIC 0x57464331  // "WFC1" - bump when the layout changes
+
+#if defined(ESP32)
+  #define WIFI_CACHE_NAMESPACE "wifi_fast"
+  #define WIFI_CACHE_KEY "ap"
+#elif defined(ESP8266)
+  // In 4-byte blocks; the first 128 bytes of user memory hold the OTA
+  // bootloader command, so stay clear of them
+  #define WIFI_CACHE_RTC_OFFSET 32
+#endif
+
+// ============================================================================
+// STATE VARIABLES
+// ============================================================================
+
+struct WiFiCache {
+  uint32_t magic;
+  uint32_t ip;                 // Last lease (network byte order as IPAddress stores it)
+  uint32_t gateway;
+  uint32_t subnet;
+  uint32_t dns;
+  uint8_t bssid[6];
+  uint8_t channel;
+  char ssid[33];
+  uint32_t checksum;           // Over everything above
+};
+
+static WiFiCache cache;
+static bool cacheValid = false;
+
+// ============================================================================
+// STORAGE
+// ============================================================================
+
+static uint32_t cacheChecksum(const WiFiCache& entry) {
+  // FNV-1a - only has to catch stale or garbage RTC memory
+  const uint8_t* bytes = (const uint8_t*)&entry;
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < offsetof(WiFiCache, checksum); i++) {
+    hash = (hash ^ bytes[i]) * 16777619u;
+  }
+  return hash;
+}
+
+static bool loadCache() {
+  memset(&cache, 0, sizeof(cache));
+  #if defined(ESP32)
+    Preferences prefs;
+    if (!prefs.begin(WIFI_CACHE_NAMESPACE, true)) return false;
+    size_t length = prefs.getBytes(WIFI_CACHE_KEY, &cache, sizeof(cache));
+    prefs.end();
+    if (length != sizeof(cache)) return false;
+  #elif defined(ESP8266)
+    if (!ESP.rtcUserMemoryRead(WIFI_CACHE_RTC_OFFSET, (uint32_t*)&cache, sizeof(cache))) return false;
+  #endif
+  return cache.magic == WIFI_CACHE_MAGIC && cache.checksum == cacheChecksum(cache) &&
+         cache.ssid[0] != '\0' && cache.channel != 0;
+}
+
+static void storeCache() {
+  cache.checksum = cacheChecksum(cache);
+  #if defined(ESP32)
+    Preferences prefs;
+    if (prefs.begin(WIFI_CACHE_NAMESPACE, false)) {
+      prefs.putBytes(WIFI_CACHE_KEY, &cache, sizeof(cache));
+      prefs.end();
+    }
+  #elif defined(ESP8266)
+    ESP.rtcUserMemoryWrite(WIFI_CACHE_RTC_OFFSET, (uint32_t*)&cache, sizeof(cache));
+  #endif
+}
+
+static void clearCache() {
+  cacheValid = false;
+  #if defined(ESP32)
+    Preferences prefs;
+    if (prefs.begin(WIFI_CACHE_NAMESPACE, false)) {
+      prefs.remove(WIFI_CACHE_KEY);
+      prefs.end();
+    }
+  #elif defined(ESP8266)
+    memset(&cache, 0, sizeof(cache));
+    ESP.rtcUserMemoryWrite(WIFI_CACHE_RTC_OFFSET, (uint32_t*)&cache, sizeof(cache));
+  #endif
+}
+
+// ============================================================================
+// PUBLIC API
+// ============================================================================
+
+bool fastConnectWiFi() {
+  cacheValid = loadCache();
+  if (!cacheValid) {
+    DEBUG_PRINTLN("WiFi fast connect: no cached access point");
+    return false;
+  }
+  
+  AutoConnectCredential credential;
+  station_config_t saved;
+  if (credential.load(cache.ssid, &saved) < 0) {
+    DEBUG_PRINTLN("WiFi fast connect: cached SSID no longer saved");
+    clearCache();
+    return false;
+  }
+  char password[sizeof(saved.password) + 1];
+  memcpy(password, saved.password, sizeof(saved.password));
+  password[sizeof(saved.password)] = '\0';
+  
+  unsigned long start = millis();
+  WiFi.mode(WIFI_STA);
+  #if WIFI_FAST_CONNECT_REUSE_IP
+    if (cache.ip != 0) {
+      WiFi.config(IPAddress(cache.ip), IPAddress(cache.gateway), IPAddress(cache.subnet), IPAddress(cache.dns));
+    }
+  #endif
+  WiFi.begin(cache.ssid, password, cache.channel, cache.bssid);
+  
+  while (WiFi.status() != WL_CONNECTED && millis() - start < WIFI_FAST_CONNECT_TIMEOUT_MS) {
+    delay(10);
+  }
+  
+  if (WiFi.status() != WL_CONNECTED) {
+    DEBUG_PRINTLN("WiFi fast connect: cached access point didn't answer, scanning");
+    WiFi.disconnect();
+    #if WIFI_FAST_CONNECT_REUSE_IP
+      WiFi.config(IPAddress(0, 0, 0, 0), IPAddress(0, 0, 0, 0), IPAddress(0, 0, 0, 0));  // Back to DHCP
+    #endif
+    clearCache();
+    return false;
+  }
+  
+  DEBUG_PRINT("WiFi fast connect: connected in ");
+  DEBUG_PRINT(millis() - start);
+  DEBUG_PRINT(" ms on channel ");
+  DEBUG_PRINTLN(cache.channel);
+  return true;
+}
+
+void saveWiFiFastConnect() {
+  WiFiCache current;
+  memset(&current, 0, sizeof(current));
+  current.magic = WIFI_CACHE_MAGIC;
+  current.ip = (uint32_t)WiFi.localIP();
+  current.gateway = (uint32_t)WiFi.gatewayIP();
+  current.subnet = (uint32_t)WiFi.subnetMask();
+  current.dns = (uint32_t)WiFi.dnsIP();
+  current.channel = WiFi.channel();
+  strlcpy(current.ssid, WiFi.SSID().c_str(), sizeof(current.ssid));
+  
+  const uint8_t* bssid = WiFi.BSSID();
+  if (bssid == nullptr || current.channel == 0) return;
+  memcpy(current.bssid, bssid, sizeof(current.bssid));
+  
+  // Compare before writing - NVS wear and the write's latency are only paid
+  // when the AP, channel or lease actually changed
+  if (cacheValid && memcmp(&current, &cache, offsetof(WiFiCache, checksum)) == 0) {
+    return;
+  }
+  cache = current;
+  cacheValid = true;
+  storeCache();
+  DEBUG_PRINTLN("WiFi fast connect: cached current access point");
+}
@@ -0,0 +1,18 @@
+#ifndef WIFI_FAST_CONNECT_H
+#define WIFI_FAST_CONNECT_H
+
+#include <Arduino.h>
+
+#define WIFI_FAST_CONNECT_TIMEOUT_MS 2000  // Give up on the cached AP after this long
+
+// Join the cached access point directly (BSSID + channel, no scan); call
+// before AutoConnect's portal.begin(). True once connected - the portal then
+// finds the station up. On failure the cache is cleared and the station left
+// idle for AutoConnect's normal scan.
+bool fastConnectWiFi();
+
+// Remember the connected AP, channel and lease; call when an IP is obtained.
+// Storage is only written when something changed.
+void saveWiFiFastConnect();
+
+#endif
@@ -4,6 +4,17 @@
 // This module handles device-specific configuration that can be modified
 // remotely via MQTT and persists across reboots using NVS (ESP32) or
 // EEPROM (ESP8266).
+//
+// All keys live in one versioned struct in RAM. Updates change the struct
+// and mark their fields dirty; the write-back waits until updates have
+// settled for CONFIG_SAVE_DELAY_MS and then stores every dirty field with
+// a single commit (one NVS blob / one EEPROM sector erase), however many
+// messages arrived. A config message is applied as one change: all keys
+// are validated first, then applied together under one revision, with one
+// device-info publish as the acknowledgement.
+//
+// Schema 2 added the brightness schedule; schema 1 records load with the
+// compile-time brightness defaults and are upgraded on the next write.
 // ============================================================================
 
 // ============================================================================
@@ -14,11 +25,17 @@
 #include "../../ski-clock-neo_config.h"
 #include "debug.h"
 #include "event_log.h"
+#include "json_scan.h"
+#include "timer_helpers.h"
 #include "../connectivity/mqtt_client.h"
+#include "../connectivity/mqtt_queue.h"
 
 #if defined(ESP32)
   #include <Preferences.h>
   static Preferences preferences;
+  static portMUX_TYPE configMux = portMUX_INITIALIZER_UNLOCKED;
+  #define CONFIG_ENTER_CRITICAL() portENTER_CRITICAL(&configMux)
+  #define CONFIG_EXIT_CRITICAL() portEXIT_CRITICAL(&configMux)
 #elif defined(ESP8266)
   #include <EEPROM.h>
   #define EEPROM_SIZE 16
@@ -26,6 +43,12 @@
   #define EEPROM_MAGIC_ADDR 0
   #define EEPROM_TEMP_OFFSET_ADDR 1
   #define EEPROM_ENV_SCOPE_ADDR 5
+  #define EEPROM_SCHEMA_ADDR 6
+  #define EEPROM_REVISION_ADDR 8
+  #define EEPROM_BRIGHTNESS_ADDR 12   // Schema 2: day, night, night start, night end
+  // Config is only touched from loop() context (MQTT and timers both run there)
+  #define CONFIG_ENTER_CRITICAL()
+  #define CONFIG_EXIT_CRITICAL()
 #endif
 
 // ============================================================================
@@ -40,12 +63,76 @@
 #define ENV_SCOPE_DEV     1
 #define ENV_SCOPE_PROD    2
 
+// ============================================================================
+// CONSTANTS
+// ============================================================================
+
+#define CONFIG_SCHEMA_VERSION 2       // Layout of StoredConfig / the EEPROM map
+#define CONFIG_SCHEMA_V1      1       // No brightness schedule
+#define CONFIG_SAVE_DELAY_MS  2000    // Quiet time before dirty fields are written
+
+#define TEMP_OFFSET_MIN -20.0
+#define TEMP_OFFSET_MAX 20.0
+
+// Dirty field bits
+#define CONFIG_FIELD_TEMP_OFFSET 0x01
+#define CONFIG_FIELD_ENVIRONMENT 0x02
+#define CONFIG_FIELD_BRIGHTNESS_DAY   0x04
+#define CONFIG_FIELD_BRIGHTNESS_NIGHT 0x08
+#define CONFIG_FIELD_NIGHT_START      0x10
+#define CONFIG_FIELD_NIGHT_END        0x20
+
 // ============================================================================
 // STATE VARIABLES
 // ============================================================================
 
-static float temperatureOffset = TEMPERATURE_OFFSET;
-static uint8_t environmentScopeEnum = ENV_SCOPE_DEFAULT;
+struct DeviceConfig {
+  float temperatureOffset;
+  uint8_t environmentScope;
+  uint8_t brightnessDay;
+  uint8_t brightnessNight;
+  uint8_t nightStartHour;
+  uint8_t nightEndHour;
+  uint32_t revision;            // Bumped once per applied change
+};
+
+// Single-byte keys: MQTT name, dirty bit and largest valid value
+struct ByteConfigKey {
+  const char* name;
+  uint8_t field;
+  uint8_t maxValue;
+};
+
+static const ByteConfigKey BYTE_CONFIG_KEYS[] = {
+  {"brightness_day",   CONFIG_FIELD_BRIGHTNESS_DAY,   255},
+  {"brightness_night", CONFIG_FIELD_BRIGHTNESS_NIGHT, 255},
+  {"night_start",      CONFIG_FIELD_NIGHT_START,      23},
+  {"night_end",        CONFIG_FIELD_NIGHT_END,        23},
+};
+
+#if defined(ESP32)
+// NVS blob layout (key "config"); older firmware stored one key per field
+struct StoredConfig {
+  uint8_t schema;
+  uint8_t environmentScope;
+  uint16_t reserved;
+  float temperatureOffset;
+  uint32_t revision;
+  // Schema 2 (a schema 1 blob ends here)
+  uint8_t brightnessDay;
+  uint8_t brightnessNight;
+  uint8_t nightStartHour;
+  uint8_t nightEndHour;
+};
+
+#define STORED_CONFIG_V1_SIZE offsetof(StoredConfig, brightnessDay)
+#endif
+
+#define DEVICE_CONFIG_DEFAULTS {TEMPERATURE_OFFSET, ENV_SCOPE_DEFAULT, \
+  BRIGHTNESS, BRIGHTNESS_NIGHT, NIGHT_START_HOUR, NIGHT_END_HOUR, 0}
+
+static DeviceConfig config = DEVICE_CONFIG_DEFAULTS;
+static uint8_t dirtyFields = 0;       // CONFIG_FIELD_* bits awaiting write-back
 static bool configInitialized = false;
 
 // ============================================================================
@@ -67,155 +154,333 @@ static uint8_t envStringToEnum(const char* envString) {
   return ENV_SCOPE_DEFAULT;
 }
 
+static bool isValidOffset(float offset) {
+  return !isnan(offset) && offset >= TEMP_OFFSET_MIN && offset <= TEMP_OFFSET_MAX;
+}
+
+static uint8_t getByteField(const DeviceConfig& cfg, uint8_t field) {
+  switch (field) {
+    case CONFIG_FIELD_BRIGHTNESS_DAY:   return cfg.brightnessDay;
+    case CONFIG_FIELD_BRIGHTNESS_NIGHT: return cfg.brightnessNight;
+    case CONFIG_FIELD_NIGHT_START:      return cfg.nightStartHour;
+    case CONFIG_FIELD_NIGHT_END:        return cfg.nightEndHour;
+    default: return 0;
+  }
+}
+
+static void setByteField(DeviceConfig& cfg, uint8_t field, uint8_t value) {
+  switch (field) {
+    case CONFIG_FIELD_BRIGHTNESS_DAY:   cfg.brightnessDay = value; break;
+    case CONFIG_FIELD_BRIGHTNESS_NIGHT: cfg.brightnessNight = value; break;
+    case CONFIG_FIELD_NIGHT_START:      cfg.nightStartHour = value; break;
+    case CONFIG_FIELD_NIGHT_END:        cfg.nightEndHour = value; break;
+    default: break;
+  }
+}
+
 // ============================================================================
-// INITIALIZATION
+// STORAGE
 // ============================================================================
 
-void initDeviceConfig() {
-  DEBUG_PRINTLN("Initializing device configuration...");
-  
-  // Default environment is "dev" (ENV_SCOPE_DEFAULT behaves as dev)
-  environmentScopeEnum = ENV_SCOPE_DEFAULT;
-  
+// Write the whole struct with one commit
+static bool writeConfig(const DeviceConfig& snapshot) {
 #if defined(ESP32)
-  preferences.begin("norrtek", false);
-  
-  // Load temperature offset (only if explicitly set)
-  if (preferences.isKey("temp_offset")) {
-    temperatureOffset = preferences.getFloat("temp_offset", TEMPERATURE_OFFSET);
-    DEBUG_PRINT("Loaded temperature offset from NVS: ");
-    DEBUG_PRINTLN(temperatureOffset);
-  } else {
-    temperatureOffset = TEMPERATURE_OFFSET;
-    DEBUG_PRINT("Using default temperature offset: ");
-    DEBUG_PRINTLN(temperatureOffset);
+  StoredConfig stored = {};
+  stored.schema = CONFIG_SCHEMA_VERSION;
+  stored.environmentScope = snapshot.environmentScope;
+  stored.temperatureOffset = snapshot.temperatureOffset;
+  stored.revision = snapshot.revision;
+  stored.brightnessDay = snapshot.brightnessDay;
+  stored.brightnessNight = snapshot.brightnessNight;
+  stored.nightStartHour = snapshot.nightStartHour;
+  stored.nightEndHour = snapshot.nightEndHour;
+  return preferences.putBytes("config", &stored, sizeof(stored)) == sizeof(stored);
+#elif defined(ESP8266)
+  EEPROM.write(EEPROM_MAGIC_ADDR, EEPROM_MAGIC);
+  EEPROM.put(EEPROM_TEMP_OFFSET_ADDR, snapshot.temperatureOffset);
+  EEPROM.write(EEPROM_ENV_SCOPE_ADDR, snapshot.environmentScope);
+  EEPROM.write(EEPROM_SCHEMA_ADDR, CONFIG_SCHEMA_VERSION);
+  EEPROM.put(EEPROM_REVISION_ADDR, snapshot.revision);
+  EEPROM.write(EEPROM_BRIGHTNESS_ADDR, snapshot.brightnessDay);
+  EEPROM.write(EEPROM_BRIGHTNESS_ADDR + 1, snapshot.brightnessNight);
+  EEPROM.write(EEPROM_BRIGHTNESS_ADDR + 2, snapshot.nightStartHour);
+  EEPROM.write(EEPROM_BRIGHTNESS_ADDR + 3, snapshot.nightEndHour);
+  return EEPROM.commit();
+#else
+  return false;
+#endif
+}
+
+// Load the stored struct; false on first boot (nothing valid stored)
+// Fields missing from older layouts keep the values `loaded` came in with
+static bool readConfig(DeviceConfig& loaded) {
+#if defined(ESP32)
+  StoredConfig stored;
+  size_t storedSize = preferences.getBytesLength("config");
+  if ((storedSize == sizeof(stored) || storedSize == STORED_CONFIG_V1_SIZE) &&
+      preferences.getBytes("config", &stored, storedSize) == storedSize) {
+    bool current = storedSize == sizeof(stored) && stored.schema == CONFIG_SCHEMA_VERSION;
+    if (current || (storedSize == STORED_CONFIG_V1_SIZE && stored.schema == CONFIG_SCHEMA_V1)) {
+      loaded.temperatureOffset = stored.temperatureOffset;
+      loaded.environmentScope = stored.environmentScope;
+      loaded.revision = stored.revision;
+      if (current) {
+        loaded.brightnessDay = stored.brightnessDay;
+        loaded.brightnessNight = stored.brightnessNight;
+        loaded.nightStartHour = stored.nightStartHour;
+        loaded.nightEndHour = stored.nightEndHour;
+      }
+      return true;
+    }
   }
   
-  // Load environment scope (only if explicitly set)
-  if (preferences.isKey("env_scope")) {
-    uint8_t storedEnv = preferences.getUChar("env_scope", ENV_SCOPE_DEFAULT);
-    if (storedEnv == ENV_SCOPE_DEV || storedEnv == ENV_SCOPE_PROD) {
-      environmentScopeEnum = storedEnv;
-      DEBUG_PRINT("Loaded environment scope from NVS: ");
-      DEBUG_PRINTLN(envEnumToString(environmentScopeEnum));
-    }
+  // Older firmware: one NVS key per field (left in place for rollbacks)
+  if (!preferences.isKey("env_scope")) {
+    return false;
+  }
+  loaded.temperatureOffset = preferences.getFloat("temp_offset", TEMPERATURE_OFFSET);
+  loaded.environmentScope = preferences.getUChar("env_scope", ENV_SCOPE_DEFAULT);
+  loaded.revision = 0;
+  DEBUG_PRINTLN("Migrating per-key NVS config to versioned blob");
+  writeConfig(loaded);
+  return true;
+#elif defined(ESP8266)
+  if (EEPROM.read(EEPROM_MAGIC_ADDR) != EEPROM_MAGIC) {
+    return false;
+  }
+  EEPROM.get(EEPROM_TEMP_OFFSET_ADDR, loaded.temperatureOffset);
+  loaded.environmentScope = EEPROM.read(EEPROM_ENV_SCOPE_ADDR);
+  uint8_t schema = EEPROM.read(EEPROM_SCHEMA_ADDR);
+  if (schema == CONFIG_SCHEMA_VERSION || schema == CONFIG_SCHEMA_V1) {
+    EEPROM.get(EEPROM_REVISION_ADDR, loaded.revision);
   } else {
-    // First boot: apply pending environment from compile-time flag and persist
-    #if PENDING_ENV_SCOPE == ENV_SCOPE_PROD
-      environmentScopeEnum = ENV_SCOPE_PROD;
-      preferences.putUChar("env_scope", ENV_SCOPE_PROD);
-      DEBUG_PRINTLN("First boot: provisioned to PROD environment");
-    #elif PENDING_ENV_SCOPE == ENV_SCOPE_DEV
-      environmentScopeEnum = ENV_SCOPE_DEV;
-      preferences.putUChar("env_scope", ENV_SCOPE_DEV);
-      DEBUG_PRINTLN("First boot: provisioned to DEV environment");
-    #else
-      // Default case: persist DEV so subsequent boots read from storage
-      environmentScopeEnum = ENV_SCOPE_DEV;
-      preferences.putUChar("env_scope", ENV_SCOPE_DEV);
-      DEBUG_PRINTLN("First boot: provisioned to DEV environment (default)");
-    #endif
+    loaded.revision = 0;  // Older layout without schema/revision bytes
+  }
+  if (schema == CONFIG_SCHEMA_VERSION) {
+    loaded.brightnessDay = EEPROM.read(EEPROM_BRIGHTNESS_ADDR);
+    loaded.brightnessNight = EEPROM.read(EEPROM_BRIGHTNESS_ADDR + 1);
+    loaded.nightStartHour = EEPROM.read(EEPROM_BRIGHTNESS_ADDR + 2);
+    loaded.nightEndHour = EEPROM.read(EEPROM_BRIGHTNESS_ADDR + 3);
   }
+  return true;
+#else
+  return false;
+#endif
+}
+
+// Timer callback - the write-back once updates have settled
+static void configSaveCallback() {
+  flushDeviceConfig();
+}
+
+// ============================================================================
+// INITIALIZATION
+// ============================================================================
+
+void initDeviceConfig() {
+  DEBUG_PRINTLN("Initializing device configuration...");
   
+#if defined(ESP32)
+  preferences.begin("norrtek", false);
 #elif defined(ESP8266)
   EEPROM.begin(EEPROM_SIZE);
+#endif
   
-  uint8_t magic = EEPROM.read(EEPROM_MAGIC_ADDR);
-  if (magic == EEPROM_MAGIC) {
-    // Load temperature offset
-    float stored;
-    EEPROM.get(EEPROM_TEMP_OFFSET_ADDR, stored);
-    if (!isnan(stored) && stored >= -20.0 && stored <= 20.0) {
-      temperatureOffset = stored;
-      DEBUG_PRINT("Loaded temperature offset from EEPROM: ");
-      DEBUG_PRINTLN(temperatureOffset);
+  DeviceConfig loaded = DEVICE_CONFIG_DEFAULTS;
+  if (readConfig(loaded)) {
+    if (isValidOffset(loaded.temperatureOffset)) {
+      DEBUG_PRINT("Loaded temperature offset: ");
+      DEBUG_PRINTLN(loaded.temperatureOffset);
     } else {
-      temperatureOffset = TEMPERATURE_OFFSET;
-      DEBUG_PRINT("Invalid EEPROM value, using default: ");
-      DEBUG_PRINTLN(temperatureOffset);
+      loaded.temperatureOffset = TEMPERATURE_OFFSET;
+      DEBUG_PRINT("Invalid stored offset, using default: ");
+      DEBUG_PRINTLN(loaded.temperatureOffset);
     }
-    
-    // Load environment scope (single byte enum)
-    uint8_t storedEnv = EEPROM.read(EEPROM_ENV_SCOPE_ADDR);
-    if (storedEnv == ENV_SCOPE_DEV || storedEnv == ENV_SCOPE_PROD) {
-      environmentScopeEnum = storedEnv;
-      DEBUG_PRINT("Loaded environment scope from EEPROM: ");
-      DEBUG_PRINTLN(envEnumToString(environmentScopeEnum));
+    if (loaded.environmentScope == ENV_SCOPE_DEV || loaded.environmentScope == ENV_SCOPE_PROD) {
+      DEBUG_PRINT("Loaded environment scope: ");
+      DEBUG_PRINTLN(envEnumToString(loaded.environmentScope));
     } else {
+      loaded.environmentScope = ENV_SCOPE_DEFAULT;
       DEBUG_PRINTLN("Using default environment scope: dev");
     }
+    if (loaded.nightStartHour > 23 || loaded.nightEndHour > 23) {
+      loaded.nightStartHour = NIGHT_START_HOUR;
+      loaded.nightEndHour = NIGHT_END_HOUR;
+      DEBUG_PRINTLN("Invalid stored night window, using default");
+    }
+    config = loaded;
   } else {
-    // First boot: no valid EEPROM data - initialize and persist
-    temperatureOffset = TEMPERATURE_OFFSET;
-    
-    // Apply pending environment from compile-time flag and persist
+    // First boot: apply pending environment from compile-time flag and persist
+    config.temperatureOffset = TEMPERATURE_OFFSET;
     #if PENDING_ENV_SCOPE == ENV_SCOPE_PROD
-      environmentScopeEnum = ENV_SCOPE_PROD;
-      EEPROM.write(EEPROM_MAGIC_ADDR, EEPROM_MAGIC);
-      EEPROM.put(EEPROM_TEMP_OFFSET_ADDR, temperatureOffset);
-      EEPROM.write(EEPROM_ENV_SCOPE_ADDR, ENV_SCOPE_PROD);
-      EEPROM.commit();
+      config.environmentScope = ENV_SCOPE_PROD;
       DEBUG_PRINTLN("First boot: provisioned to PROD environment");
     #elif PENDING_ENV_SCOPE == ENV_SCOPE_DEV
-      environmentScopeEnum = ENV_SCOPE_DEV;
-      EEPROM.write(EEPROM_MAGIC_ADDR, EEPROM_MAGIC);
-      EEPROM.put(EEPROM_TEMP_OFFSET_ADDR, temperatureOffset);
-      EEPROM.write(EEPROM_ENV_SCOPE_ADDR, ENV_SCOPE_DEV);
-      EEPROM.commit();
+      config.environmentScope = ENV_SCOPE_DEV;
       DEBUG_PRINTLN("First boot: provisioned to DEV environment");
     #else
       // Default case: persist DEV so subsequent boots read from storage
-      environmentScopeEnum = ENV_SCOPE_DEV;
-      EEPROM.write(EEPROM_MAGIC_ADDR, EEPROM_MAGIC);
-      EEPROM.put(EEPROM_TEMP_OFFSET_ADDR, temperatureOffset);
-      EEPROM.write(EEPROM_ENV_SCOPE_ADDR, ENV_SCOPE_DEV);
-      EEPROM.commit();
+      config.environmentScope = ENV_SCOPE_DEV;
       DEBUG_PRINTLN("First boot: provisioned to DEV environment (default)");
     #endif
+    writeConfig(config);
   }
-#endif
+  
+  // Deferred write-back - re-triggering restarts the delay, so a burst of
+  // updates is written once, CONFIG_SAVE_DELAY_MS after the last one
+  createOneShotTimer("ConfigSave", CONFIG_SAVE_DELAY_MS, configSaveCallback);
   
   configInitialized = true;
   DEBUG_PRINT("Device configuration initialized (env: ");
-  DEBUG_PRINT(envEnumToString(environmentScopeEnum));
+  DEBUG_PRINT(envEnumToString(config.environmentScope));
+  DEBUG_PRINT(", revision ");
+  DEBUG_PRINT(config.revision);
   DEBUG_PRINTLN(")");
 }
 
+// ============================================================================
+// CONFIG UPDATES
+// ============================================================================
+
+// Apply the `fields` of `next` as one change: one revision, one write-back,
+// one acknowledgement. Unchanged fields are reported as no-ops.
+static void applyConfigChange(const DeviceConfig& next, uint8_t fields) {
+  uint8_t changed = 0;
+  if ((fields & CONFIG_FIELD_TEMP_OFFSET) && next.temperatureOffset != config.temperatureOffset) {
+    changed |= CONFIG_FIELD_TEMP_OFFSET;
+  }
+  if ((fields & CONFIG_FIELD_ENVIRONMENT) &&
+      strcmp(envEnumToString(next.environmentScope), envEnumToString(config.environmentScope)) != 0) {
+    changed |= CONFIG_FIELD_ENVIRONMENT;
+  }
+  for (const ByteConfigKey& key : BYTE_CONFIG_KEYS) {
+    if ((fields & key.field) && getByteField(next, key.field) != getByteField(config, key.field)) {
+      changed |= key.field;
+    }
+  }
+  
+  if ((fields & CONFIG_FIELD_TEMP_OFFSET) && !(changed & CONFIG_FIELD_TEMP_OFFSET)) {
+    logEvent(EVT_CONFIG_NOOP_KEY, "temp_offset");
+  }
+  if ((fields & CONFIG_FIELD_ENVIRONMENT) && !(changed & CONFIG_FIELD_ENVIRONMENT)) {
+    DEBUG_PRINT("Environment scope unchanged: ");
+    DEBUG_PRINTLN(envEnumToString(next.environmentScope));
+    logEvent(EVT_CONFIG_NOOP_KEY, "environment");
+  }
+  for (const ByteConfigKey& key : BYTE_CONFIG_KEYS) {
+    if ((fields & key.field) && !(changed & key.field)) {
+      logEvent(EVT_CONFIG_NOOP_KEY, key.name);
+    }
+  }
+  if (changed == 0) {
+    requestMqttJob(publishDeviceInfo, MQTT_PRIORITY_HEARTBEAT);
+    return;
+  }
+  
+  CONFIG_ENTER_CRITICAL();
+  if (changed & CONFIG_FIELD_TEMP_OFFSET) {
+    config.temperatureOffset = next.temperatureOffset;
+  }
+  if (changed & CONFIG_FIELD_ENVIRONMENT) {
+    config.environmentScope = next.environmentScope;
+  }
+  for (const ByteConfigKey& key : BYTE_CONFIG_KEYS) {
+    if (changed & key.field) {
+      setByteField(config, key.field, getByteField(next, key.field));
+    }
+  }
+  config.revision++;
+  dirtyFields |= changed;
+  CONFIG_EXIT_CRITICAL();
+  
+  DEBUG_PRINT("Config revision ");
+  DEBUG_PRINT(config.revision);
+  DEBUG_PRINTLN(" applied, write-back pending");
+  triggerTimer("ConfigSave");
+  
+  if (changed & CONFIG_FIELD_TEMP_OFFSET) {
+    DEBUG_PRINT("Temperature offset set to: ");
+    DEBUG_PRINTLN(next.temperatureOffset);
+    logEvent(EVT_CONFIG_UPDATED_TEMP_OFFSET, eventTenths(next.temperatureOffset));
+  }
+  
+  for (const ByteConfigKey& key : BYTE_CONFIG_KEYS) {
+    if (changed & key.field) {
+      DEBUG_PRINT(key.name);
+      DEBUG_PRINT(" set to: ");
+      DEBUG_PRINTLN(getByteField(next, key.field));
+      logEvent(EVT_CONFIG_UPDATED_KEY, key.name, getByteField(next, key.field));
+    }
+  }
+  
+  if (changed & CONFIG_FIELD_ENVIRONMENT) {
+    DEBUG_PRINT("Environment scope set to: ");
+    DEBUG_PRINTLN(envEnumToString(next.environmentScope));
+    logEvent(EVT_CONFIG_UPDATED_ENVIRONMENT, envEnumToString(next.environmentScope));
+    
+    // Reconnect to switch topics - connecting publishes device info on the
+    // new environment's topics, which is the acknowledgement
+    rebuildMqttTopics();
+    DEBUG_PRINTLN("Environment changed - triggering MQTT reconnect...");
+    disconnectMQTT();
+  } else {
+    // Publish updated device info to confirm config change
+    requestMqttJob(publishDeviceInfo, MQTT_PRIORITY_HEARTBEAT);
+  }
+}
+
+bool flushDeviceConfig() {
+  if (!configInitialized) {
+    return false;
+  }
+  
+  CONFIG_ENTER_CRITICAL();
+  uint8_t fields = dirtyFields;
+  DeviceConfig snapshot = config;
+  dirtyFields = 0;
+  CONFIG_EXIT_CRITICAL();
+  
+  if (fields == 0) {
+    return true;
+  }
+  
+  if (!writeConfig(snapshot)) {
+    DEBUG_PRINTLN("ERROR: Config write-back failed, will retry");
+    CONFIG_ENTER_CRITICAL();
+    dirtyFields |= fields;
+    CONFIG_EXIT_CRITICAL();
+    triggerTimer("ConfigSave");
+    return false;
+  }
+  
+  DEBUG_PRINT("Config revision ");
+  DEBUG_PRINT(snapshot.revision);
+  DEBUG_PRINTLN(" saved (one commit)");
+  return true;
+}
+
+uint32_t getDeviceConfigRevision() {
+  return config.revision;
+}
+
 // ============================================================================
 // TEMPERATURE OFFSET
 // ============================================================================
 
 float getTemperatureOffset() {
-  return temperatureOffset;
+  return config.temperatureOffset;
 }
 
 void setTemperatureOffset(float offset) {
-  if (offset < -20.0 || offset > 20.0) {
+  if (!isValidOffset(offset)) {
     DEBUG_PRINT("Temperature offset out of range: ");
     DEBUG_PRINTLN(offset);
     return;
   }
   
-  temperatureOffset = offset;
-  DEBUG_PRINT("Temperature offset set to: ");
-  DEBUG_PRINTLN(offset);
-  
-#if defined(ESP32)
-  preferences.putFloat("temp_offset", offset);
-  DEBUG_PRINTLN("Saved to NVS");
-#elif defined(ESP8266)
-  EEPROM.write(EEPROM_MAGIC_ADDR, EEPROM_MAGIC);
-  EEPROM.put(EEPROM_TEMP_OFFSET_ADDR, offset);
-  EEPROM.commit();
-  DEBUG_PRINTLN("Saved to EEPROM");
-#endif
-  
-  static char eventData[48];
-  snprintf(eventData, sizeof(eventData), "{\"temp_offset\":%.1f}", offset);
-  logEvent("config_updated", eventData);
-  
-  // Publish updated device info to confirm config change
-  publishDeviceInfo();
+  DeviceConfig next = config;
+  next.temperatureOffset = offset;
+  applyConfigChange(next, CONFIG_FIELD_TEMP_OFFSET);
 }
 
 // ============================================================================
@@ -223,7 +488,7 @@ void setTemperatureOffset(float offset) {
 // ============================================================================
 
 const char* getEnvironmentScope() {
-  return envEnumToString(environmentScopeEnum);
+  return envEnumToString(config.environmentScope);
 }
 
 void setEnvironmentScope(const char* scope) {
@@ -231,161 +496,111 @@ void setEnvironmentScope(const char* scope) {
   if (strcmp(scope, "dev") != 0 && strcmp(scope, "prod") != 0) {
     DEBUG_PRINT("Invalid environment scope: ");
     DEBUG_PRINTLN(scope);
-    static char errData[64];
-    snprintf(errData, sizeof(errData), "{\"error\":\"invalid_scope\",\"value\":\"%s\"}", scope);
-    logEvent("config_error", errData);
+    logEventWithString(EVT_CONFIG_INVALID_SCOPE, scope);
     return;
   }
   
-  uint8_t newEnvEnum = envStringToEnum(scope);
-  
-  // Check if scope is actually changing (compare effective values)
-  const char* currentScope = envEnumToString(environmentScopeEnum);
-  if (strcmp(currentScope, scope) == 0) {
-    DEBUG_PRINT("Environment scope unchanged: ");
-    DEBUG_PRINTLN(scope);
-    logEvent("config_noop", "{\"key\":\"environment\"}");
-    return;
-  }
-  
-  environmentScopeEnum = newEnvEnum;
-  DEBUG_PRINT("Environment scope set to: ");
-  DEBUG_PRINTLN(scope);
-  
-#if defined(ESP32)
-  preferences.putUChar("env_scope", newEnvEnum);
-  DEBUG_PRINTLN("Saved to NVS (1 byte)");
-#elif defined(ESP8266)
-  EEPROM.write(EEPROM_MAGIC_ADDR, EEPROM_MAGIC);
-  EEPROM.write(EEPROM_ENV_SCOPE_ADDR, newEnvEnum);
-  EEPROM.commit();
-  DEBUG_PRINTLN("Saved to EEPROM (1 byte)");
-#endif
-  
-  static char eventData[48];
-  snprintf(eventData, sizeof(eventData), "{\"environment\":\"%s\"}", scope);
-  logEvent("config_updated", eventData);
-  
-  // Publish updated device info before reconnecting
-  publishDeviceInfo();
-  
-  // Trigger MQTT reconnect to switch topics
-  DEBUG_PRINTLN("Environment changed - triggering MQTT reconnect...");
-  disconnectMQTT();
+  DeviceConfig next = config;
+  next.environmentScope = envStringToEnum(scope);
+  applyConfigChange(next, CONFIG_FIELD_ENVIRONMENT);
 }
 
 // ============================================================================
-// CONFIG MESSAGE HANDLER
+// BRIGHTNESS SCHEDULE
 // ============================================================================
 
-static bool parseJsonFloat(const String& json, const char* key, float* value) {
-  String searchKey = String("\"") + key + "\"";
-  int keyIndex = json.indexOf(searchKey);
-  if (keyIndex < 0) return false;
-  
-  int colonIndex = json.indexOf(":", keyIndex + searchKey.length());
-  if (colonIndex < 0) return false;
-  
-  int startIndex = colonIndex + 1;
-  while (startIndex < (int)json.length() && (json.charAt(startIndex) == ' ' || json.charAt(startIndex) == '\t' || json.charAt(startIndex) == '\n' || json.charAt(startIndex) == '\r')) {
-    startIndex++;
-  }
-  
-  if (startIndex >= (int)json.length()) return false;
-  
-  int endIndex = startIndex;
-  bool hasDecimal = false;
-  bool hasDigit = false;
-  
-  if (json.charAt(endIndex) == '-' || json.charAt(endIndex) == '+') {
-    endIndex++;
-  }
-  
-  while (endIndex < (int)json.length()) {
-    char c = json.charAt(endIndex);
-    if (c >= '0' && c <= '9') {
-      hasDigit = true;
-      endIndex++;
-    } else if (c == '.' && !hasDecimal) {
-      hasDecimal = true;
-      endIndex++;
-    } else {
-      break;
-    }
-  }
-  
-  if (!hasDigit) return false;
-  
-  String valueStr = json.substring(startIndex, endIndex);
-  *value = valueStr.toFloat();
-  return true;
+BrightnessSchedule getBrightnessSchedule() {
+  CONFIG_ENTER_CRITICAL();
+  BrightnessSchedule schedule = {
+    config.brightnessDay,
+    config.brightnessNight,
+    config.nightStartHour,
+    config.nightEndHour
+  };
+  CONFIG_EXIT_CRITICAL();
+  return schedule;
 }
 
-static bool parseJsonString(const String& json, const char* key, String* value) {
-  String searchKey = String("\"") + key + "\"";
-  int keyIndex = json.indexOf(searchKey);
-  if (keyIndex < 0) return false;
-  
-  int colonIndex = json.indexOf(":", keyIndex + searchKey.length());
-  if (colonIndex < 0) return false;
-  
-  int quoteStart = json.indexOf("\"", colonIndex + 1);
-  if (quoteStart < 0) return false;
-  
-  int quoteEnd = json.indexOf("\"", quoteStart + 1);
-  if (quoteEnd < 0) return false;
-  
-  *value = json.substring(quoteStart + 1, quoteEnd);
-  return true;
-}
+// ============================================================================
+// CONFIG MESSAGE HANDLER
+// ============================================================================
 
-void handleConfigMessage(const String& message) {
-  DEBUG_PRINT("Processing config message: ");
-  DEBUG_PRINTLN(message);
+void handleConfigMessage(const char* json, size_t length) {
+  DEBUG_PRINTF("Processing config message: %.*s\n", (int)length, json);
   
-  bool configUpdated = false;
-  bool parseAttempted = false;
+  // Validate every key before applying any - one bad key rejects the message
+  DeviceConfig next = config;
+  uint8_t fields = 0;
+  JsonValue present;
   
   // Parse temperature offset
-  float tempOffset;
-  if (parseJsonFloat(message, "temp_offset", &tempOffset)) {
-    parseAttempted = true;
-    if (tempOffset >= -20.0 && tempOffset <= 20.0) {
-      setTemperatureOffset(tempOffset);
-      configUpdated = true;
-      DEBUG_PRINT("Parsed temp_offset: ");
-      DEBUG_PRINTLN(tempOffset);
-    } else {
+  if (jsonFind(json, length, "temp_offset", present)) {
+    float tempOffset;
+    if (!jsonGetFloat(json, length, "temp_offset", &tempOffset)) {
+      DEBUG_PRINTLN("Failed to parse temp_offset value");
+      logEvent(EVT_CONFIG_PARSE_FAILED, "temp_offset");
+      return;
+    }
+    if (!isValidOffset(tempOffset)) {
       DEBUG_PRINT("temp_offset out of range: ");
       DEBUG_PRINTLN(tempOffset);
-      static char errData[64];
-      snprintf(errData, sizeof(errData), "{\"error\":\"out_of_range\",\"value\":%.1f}", tempOffset);
-      logEvent("config_error", errData);
+      logEvent(EVT_CONFIG_OUT_OF_RANGE, eventTenths(tempOffset));
+      return;
     }
+    DEBUG_PRINT("Parsed temp_offset: ");
+    DEBUG_PRINTLN(tempOffset);
+    next.temperatureOffset = tempOffset;
+    fields |= CONFIG_FIELD_TEMP_OFFSET;
   }
   
   // Parse environment scope
-  String envScope;
-  if (parseJsonString(message, "environment", &envScope)) {
-    parseAttempted = true;
-    setEnvironmentScope(envScope.c_str());
-    configUpdated = true;
+  if (jsonFind(json, length, "environment", present)) {
+    char envScope[16];
+    if (!jsonGetString(json, length, "environment", envScope, sizeof(envScope))) {
+      DEBUG_PRINTLN("Failed to parse environment value");
+      logEvent(EVT_CONFIG_PARSE_FAILED, "environment");
+      return;
+    }
+    if (strcmp(envScope, "dev") != 0 && strcmp(envScope, "prod") != 0) {
+      DEBUG_PRINT("Invalid environment scope: ");
+      DEBUG_PRINTLN(envScope);
+      logEventWithString(EVT_CONFIG_INVALID_SCOPE, envScope);
+      return;
+    }
     DEBUG_PRINT("Parsed environment: ");
     DEBUG_PRINTLN(envScope);
+    next.environmentScope = envStringToEnum(envScope);
+    fields |= CONFIG_FIELD_ENVIRONMENT;
   }
   
-  if (!configUpdated) {
-    if (parseAttempted) {
-      DEBUG_PRINTLN("Config value rejected");
-    } else if (message.indexOf("temp_offset") >= 0) {
-      DEBUG_PRINTLN("Failed to parse temp_offset value");
-      logEvent("config_error", "{\"error\":\"parse_failed\",\"key\":\"temp_offset\"}");
-    } else if (message.indexOf("environment") >= 0) {
-      DEBUG_PRINTLN("Failed to parse environment value");
-      logEvent("config_error", "{\"error\":\"parse_failed\",\"key\":\"environment\"}");
-    } else {
-      DEBUG_PRINTLN("No recognized config keys in message");
-      logEvent("config_noop", nullptr);
+  // Parse brightness schedule (whole numbers)
+  for (const ByteConfigKey& key : BYTE_CONFIG_KEYS) {
+    if (!jsonFind(json, length, key.name, present)) {
+      continue;
+    }
+    long value;
+    if (!jsonGetLong(json, length, key.name, &value)) {
+      DEBUG_PRINT("Failed to parse ");
+      DEBUG_PRINTLN(key.name);
+      logEvent(EVT_CONFIG_PARSE_FAILED, key.name);
+      return;
     }
+    if (value < 0 || value > key.maxValue) {
+      DEBUG_PRINT(key.name);
+      DEBUG_PRINT(" out of range: ");
+      DEBUG_PRINTLN(value);
+      logEvent(EVT_CONFIG_KEY_OUT_OF_RANGE, key.name, value);
+      return;
+    }
+    setByteField(next, key.field, (uint8_t)value);
+    fields |= key.field;
   }
+  
+  if (fields == 0) {
+    DEBUG_PRINTLN("No recognized config keys in message");
+    logEvent(EVT_CONFIG_NOOP);
+    return;
+  }
+  
+  applyConfigChange(next, fields);
 }
@@ -3,14 +3,40 @@
 
 #include <Arduino.h>
 
+// Load the config struct from NVS/EEPROM (migrating older layouts)
 void initDeviceConfig();
 
+// Setters update the RAM copy at once; the write-back is deferred until
+// updates have settled, then done with one commit for all dirty fields
+
 float getTemperatureOffset();
 void setTemperatureOffset(float offset);
 
 const char* getEnvironmentScope();
 void setEnvironmentScope(const char* scope);
 
-void handleConfigMessage(const String& message);
+// Display brightness caps (perceptual 0-255) and the local hours the night
+// cap applies between (nightStartHour == nightEndHour: no night window)
+struct BrightnessSchedule {
+  uint8_t dayLevel;
+  uint8_t nightLevel;
+  uint8_t nightStartHour;
+  uint8_t nightEndHour;
+};
+
+BrightnessSchedule getBrightnessSchedule();
+
+// Apply {"temp_offset": 1.5}, {"environment": "prod"} and/or the brightness
+// keys ("brightness_day", "brightness_night", "night_start", "night_end")
+// from a raw MQTT payload
+// All keys are validated first and applied as one change (one revision, one
+// device-info acknowledgement); any invalid key rejects the whole message
+void handleConfigMessage(const char* json, size_t length);
+
+// Write dirty fields now (call before a restart). False if the write failed
+bool flushDeviceConfig();
+
+// Incremented once per applied change, persisted with the config
+uint32_t getDeviceConfigRevision();
 
 #endif
@@ -29,7 +29,7 @@ String getDeviceID() {
 }
 
 // Get board type as human-readable string (for display/logging)
-String getBoardType() {
+const char* getBoardType() {
   #if defined(BOARD_ESP32)
     return "ESP32";
   #elif defined(BOARD_ESP32C3)
@@ -48,7 +48,7 @@ String getBoardType() {
 }
 
 // Get platform identifier for firmware downloads (matches server naming)
-String getPlatform() {
+const char* getPlatform() {
 #if defined(ESP32)
   // Detect ESP32 variant using Arduino board defines
   #if defined(BOARD_ESP32S3)
@@ -12,11 +12,12 @@
 // Get unique device ID
 String getDeviceID();
 
-// Get board type as human-readable string
-String getBoardType();
+// Get board type as human-readable string (fixed at compile time, so a
+// constant - no String allocation per publish)
+const char* getBoardType();
 
-// Get platform identifier for firmware downloads
-String getPlatform();
+// Get platform identifier for firmware downloads (constant, as above)
+const char* getPlatform();
 
 // Parse version string to comparable integer
 long parseVersion(String version);
@@ -3,9 +3,18 @@
 // ============================================================================
 // This library provides event logging with automatic MQTT publishing:
 // - Ring buffer stores events when MQTT is disconnected
-// - Events are flushed to MQTT when connection is established
+// - Flash spool behind the ring (event_spool.cpp): while offline, events are
+//   moved to LittleFS in batched appends, so they survive long outages and
+//   reboots; capacity is bounded by flash rather than RAM
+// - Events are fixed-width records (kind + two arguments); the type name and
+//   data JSON come from the EVENT_KINDS table and are rendered at flush time
+// - Events are flushed to MQTT when connection is established, oldest first:
+//   the spool, then the ring, a few messages per MQTT worker job
+// - Batched publishing (JSON array or binary TLV, see EVENT_BATCH_FORMAT):
+//   one message per batch, with a base time and per-event millisecond deltas
 // - Thread-safe access using critical sections
-// - Includes reset reason detection for boot events
+// - Includes reset reason detection for boot events; the boot event waits
+//   for the first heartbeat so it can carry the boot-to-online time
 // - Timestamp handling: waits for RTC/NTP sync (max 60s) before flushing
 //   - If time syncs within 60s: uses Unix timestamp
 //   - If timeout: uses offset_ms for server-side time calculation
@@ -17,9 +26,12 @@
 
 #include "event_log.h"                   // This file's header
 #include "../connectivity/mqtt_client.h" // For MQTT publishing
+#include "../connectivity/mqtt_queue.h"  // For handing flushes to the MQTT worker
 #include "../data/data_time.h"           // For time sync and timestamp functions
 #include "device_info.h"                 // For device ID and version info
 #include "debug.h"                       // For debug logging
+#include "event_spool.h"                 // For the flash-backed spool
+#include "../connectivity/mqtt_wire_format.h" // Binary batch layout shared with the dashboard
 
 #if defined(ESP32)
   #include "esp_system.h"
@@ -45,16 +57,99 @@
 // Maximum time to wait for RTC/NTP sync before using offset fallback
 static const unsigned long TIME_SYNC_TIMEOUT_MS = 60000;  // 60 seconds
 
+// Longest the boot event waits for the first heartbeat before it is logged
+// without the boot-to-online time
+static const unsigned long BOOT_EVENT_MAX_WAIT_MS = 60000;
+
+// While offline, spool once this many events are waiting or the oldest is this
+// old - one flash write per pass rather than per event, and a crash loses at
+// most EVENT_SPOOL_MAX_AGE_MS of events
+static const uint16_t EVENT_SPOOL_THRESHOLD = 32;
+static const unsigned long EVENT_SPOOL_MAX_AGE_MS = 30000;
+
+// Messages per flush job; a longer backlog re-queues the job so other MQTT
+// traffic can go out in between
+static const uint8_t EVENT_FLUSH_BUDGET = 8;
+
 // ============================================================================
 // STATE VARIABLES
 // ============================================================================
 
 static EventEntry eventQueue[EVENT_QUEUE_SIZE];
-static volatile uint8_t queueHead = 0;
-static volatile uint8_t queueTail = 0;
-static volatile uint8_t queueCount = 0;
+static volatile uint16_t queueHead = 0;
+static volatile uint16_t queueTail = 0;
+static volatile uint16_t queueCount = 0;
+static volatile uint32_t queueRemovedCount = 0;  // Entries ever removed from head (sent or overwritten)
 static bool eventLogReady = false;
 static uint32_t bootMillis = 0;  // millis() at boot, for timeout calculation
+static bool bootEventPending = false;   // logBootEvent() called, event not yet queued
+
+// Interned strings for events that carry runtime text (SSID, rejected input).
+// Slots are reused round-robin; the generation lets a flush detect that an old
+// event's slot has since been overwritten.
+static char internPool[EVENT_INTERN_SLOTS][EVENT_INTERN_MAX_LEN];
+static uint8_t internGeneration[EVENT_INTERN_SLOTS];
+static uint8_t internNext = 0;
+
+// ============================================================================
+// EVENT KINDS
+// ============================================================================
+// Per-kind type name and data template (order must match EventKind).
+// Template placeholders consume EventEntry::values in order, except %s:
+//   %d  signed integer           %u  unsigned integer
+//   %t  tenths as one decimal    %i  IPv4 address (IPAddress as uint32_t)
+//   %c  constant string (quoted by the template, JSON-escaped)
+//   %s  the event's interned string (quoted by the template, JSON-escaped)
+// An empty template publishes the event without a data field.
+// ============================================================================
+
+struct EventKindInfo {
+  char type[EVENT_TYPE_MAX_LEN];
+  char data[48];
+};
+
+static const EventKindInfo EVENT_KINDS[EVT_KIND_COUNT] PROGMEM = {
+  {"", ""},                                                               // EVT_NONE
+  {"boot", "{\"reason\":\"%c\",\"version\":\"%c\"}"},                     // EVT_BOOT
+  {"boot", "{\"reason\":\"%c\",\"version\":\"%s\",\"online_ms\":%u}"},    // EVT_BOOT_ONLINE
+  {"boot_stage", "{\"stage\":\"%c\",\"ms\":%u}"},                         // EVT_BOOT_STAGE
+  {"wifi_connect", "{\"ssid\":\"%s\",\"rssi\":%d,\"ip\":\"%i\"}"},        // EVT_WIFI_CONNECT
+  {"wifi_disconnect", ""},                                                // EVT_WIFI_DISCONNECT
+  {"mqtt_connect", ""},                                                   // EVT_MQTT_CONNECT
+  {"mqtt_disconnect", ""},                                                // EVT_MQTT_DISCONNECT
+  {"wifi_rssi_low", "{\"rssi\":%d,\"threshold\":%d}"},                    // EVT_WIFI_RSSI_LOW
+  {"low_heap_warning", "{\"free_heap\":%u,\"threshold\":%u}"},            // EVT_LOW_HEAP_WARNING
+  {"timer_alloc_failed", "{\"name\":\"%c\",\"max\":%u}"},                // EVT_TIMER_ALLOC_FAILED
+  {"restart_command", ""},                                                // EVT_RESTART_COMMAND
+  {"button_press", ""},                                                   // EVT_BUTTON_PRESS
+  {"button_press", "{\"action\":\"%c\"}"},                                // EVT_BUTTON_ACTION
+  {"display_mode_change", "{\"from\":\"%c\",\"to\":\"%c\"}"},             // EVT_DISPLAY_MODE_CHANGE
+  {"display_frame_rejected", "{\"length\":%u,\"expected\":%u}"},         // EVT_DISPLAY_FRAME_REJECTED
+  {"display_frame_rejected", "{\"mode\":\"%c\"}"},                        // EVT_DISPLAY_FRAME_BUSY
+  {"temperature_read", "{\"celsius\":%t}"},                               // EVT_TEMPERATURE_READ
+  {"temp_sensor_not_found", ""},                                          // EVT_TEMP_SENSOR_NOT_FOUND
+  {"temp_read_invalid", "{\"raw\":%t,\"reason\":\"%c\"}"},                // EVT_TEMP_READ_INVALID
+  {"temperature_read", "{\"celsius\":%t,\"sensor\":%u}"},                 // EVT_TEMPERATURE_READ_SENSOR
+  {"temp_read_crc_error", "{\"sensor\":%u}"},                             // EVT_TEMP_READ_CRC_ERROR
+  {"rtc_initialized", ""},                                                // EVT_RTC_INITIALIZED
+  {"rtc_lost_power", ""},                                                 // EVT_RTC_LOST_POWER
+  {"rtc_time_invalid", ""},                                               // EVT_RTC_TIME_INVALID
+  {"rtc_not_found", ""},                                                  // EVT_RTC_NOT_FOUND
+  {"rtc_sync_failed", "{\"reason\":\"%c\"}"},                             // EVT_RTC_SYNC_FAILED
+  {"rtc_drift_corrected", "{\"drift_seconds\":%d}"},                      // EVT_RTC_DRIFT_CORRECTED
+  {"rtc_synced_from_ntp", ""},                                            // EVT_RTC_SYNCED_FROM_NTP
+  {"ntp_sync_success", ""},                                               // EVT_NTP_SYNC_SUCCESS
+  {"dst_changed", "{\"dst\":%u}"},                                        // EVT_TIME_DST_CHANGED
+  {"config_updated", "{\"temp_offset\":%t}"},                             // EVT_CONFIG_UPDATED_TEMP_OFFSET
+  {"config_updated", "{\"environment\":\"%c\"}"},                         // EVT_CONFIG_UPDATED_ENVIRONMENT
+  {"config_updated", "{\"%c\":%u}"},                                      // EVT_CONFIG_UPDATED_KEY
+  {"config_error", "{\"error\":\"invalid_scope\",\"value\":\"%s\"}"},     // EVT_CONFIG_INVALID_SCOPE
+  {"config_error", "{\"error\":\"out_of_range\",\"value\":%t}"},          // EVT_CONFIG_OUT_OF_RANGE
+  {"config_error", "{\"error\":\"out_of_range\",\"key\":\"%c\",\"value\":%d}"}, // EVT_CONFIG_KEY_OUT_OF_RANGE
+  {"config_error", "{\"error\":\"parse_failed\",\"key\":\"%c\"}"},        // EVT_CONFIG_PARSE_FAILED
+  {"config_noop", ""},                                                    // EVT_CONFIG_NOOP
+  {"config_noop", "{\"key\":\"%c\"}"},                                    // EVT_CONFIG_NOOP_KEY
+};
 
 // ============================================================================
 // RESET REASON DETECTION
@@ -103,8 +198,11 @@ void initEventLog() {
   
   // Clear event queue
   for (int i = 0; i < EVENT_QUEUE_SIZE; i++) {
-    eventQueue[i].valid = false;
+    eventQueue[i].kind = EVT_NONE;
   }
+  memset(internPool, 0, sizeof(internPool));
+  memset(internGeneration, 0, sizeof(internGeneration));
+  internNext = 0;
   queueHead = 0;
   queueTail = 0;
   queueCount = 0;
@@ -112,14 +210,12 @@ void initEventLog() {
   DEBUG_PRINTLN("Event log initialized");
 }
 
-// Log boot event with reset reason and firmware version
+// Log boot event with reset reason and firmware version. It is queued by
+// logBootOnline() at the first heartbeat, or by updateEventLog() if that
+// takes longer than BOOT_EVENT_MAX_WAIT_MS; either way it is stamped with
+// the time of this call.
 void logBootEvent() {
-  String bootData = "{\"reason\":\"";
-  bootData += getResetReason();
-  bootData += "\",\"version\":\"";
-  bootData += FIRMWARE_VERSION;
-  bootData += "\"}";
-  logEvent("boot", bootData.c_str());
+  bootEventPending = true;
 }
 
 // ============================================================================
@@ -131,25 +227,39 @@ void setEventLogReady(bool ready) {
   eventLogReady = ready;
 }
 
-// Log an event to the ring buffer (thread-safe)
-void logEvent(const char* type, const char* dataJson) {
-  if (!type) return;
+// Copy a string into the intern pool, reusing a slot that already holds it.
+// Caller must hold the critical section.
+static uint8_t internString(const char* str, uint8_t& generation) {
+  for (uint8_t i = 0; i < EVENT_INTERN_SLOTS; i++) {
+    if (internPool[i][0] != '\0' &&
+        strncmp(internPool[i], str, EVENT_INTERN_MAX_LEN - 1) == 0) {
+      generation = internGeneration[i];
+      return i;
+    }
+  }
+  
+  uint8_t slot = internNext;
+  internNext = (internNext + 1) % EVENT_INTERN_SLOTS;
+  strncpy(internPool[slot], str, EVENT_INTERN_MAX_LEN - 1);
+  internPool[slot][EVENT_INTERN_MAX_LEN - 1] = '\0';
+  generation = ++internGeneration[slot];
+  return slot;
+}
+
+// Queue an event record (thread-safe)
+static void queueEvent(EventKind kind, const char* str, EventValue a, EventValue b,
+                       uint32_t timestamp_ms) {
+  if (kind <= EVT_NONE || kind >= EVT_KIND_COUNT) return;
   
   EVENT_ENTER_CRITICAL();
   
   // Store event in ring buffer
   EventEntry& entry = eventQueue[queueTail];
-  entry.timestamp_ms = millis();
-  strncpy(entry.type, type, EVENT_TYPE_MAX_LEN - 1);
-  entry.type[EVENT_TYPE_MAX_LEN - 1] = '\0';
-  
-  if (dataJson) {
-    strncpy(entry.data, dataJson, EVENT_DATA_MAX_LEN - 1);
-    entry.data[EVENT_DATA_MAX_LEN - 1] = '\0';
-  } else {
-    entry.data[0] = '\0';
-  }
-  entry.valid = true;
+  entry.timestamp_ms = timestamp_ms;
+  entry.kind = kind;
+  entry.internSlot = str ? internString(str, entry.internGen) : EVENT_NO_INTERN;
+  entry.values[0] = a;
+  entry.values[1] = b;
   
   // Advance tail pointer
   queueTail = (queueTail + 1) % EVENT_QUEUE_SIZE;
@@ -158,29 +268,48 @@ void logEvent(const char* type, const char* dataJson) {
   } else {
     // Buffer full, overwrite oldest entry
     queueHead = (queueHead + 1) % EVENT_QUEUE_SIZE;
+    queueRemovedCount++;
   }
   
-  uint8_t currentCount = queueCount;
+  uint16_t currentCount = queueCount;
   bool shouldFlush = eventLogReady && mqttIsConnected;
   
   EVENT_EXIT_CRITICAL();
   
+#if DEBUG_LOGGING
+  char type[EVENT_TYPE_MAX_LEN];
+  memcpy_P(type, EVENT_KINDS[kind].type, sizeof(type));
   DEBUG_PRINT("Event queued: ");
   DEBUG_PRINT(type);
-  if (dataJson) {
-    DEBUG_PRINT(" ");
-    DEBUG_PRINT(dataJson);
-  }
   DEBUG_PRINT(" (queue: ");
   DEBUG_PRINT(currentCount);
   DEBUG_PRINTLN(")");
+#endif
   
-  // Flush if MQTT is ready
+  // Flush from the MQTT worker if MQTT is ready (never from the caller's context)
   if (shouldFlush) {
-    flushEventQueue();
+    requestMqttJob(flushEventQueue, MQTT_PRIORITY_EVENT);
   }
 }
 
+// Log an event with numeric or constant-string arguments
+void logEvent(EventKind kind, EventValue a, EventValue b) {
+  queueEvent(kind, nullptr, a, b, millis());
+}
+
+// Log an event whose %s field is copied now (for strings that won't outlive the call)
+void logEventWithString(EventKind kind, const char* str, EventValue a, EventValue b) {
+  queueEvent(kind, str ? str : "", a, b, millis());
+}
+
+// First heartbeat published: queue the boot event with the boot-to-online
+// time (runs on the MQTT worker)
+void logBootOnline() {
+  if (!bootEventPending) return;
+  bootEventPending = false;
+  queueEvent(EVT_BOOT_ONLINE, FIRMWARE_VERSION, getResetReason(), (uint32_t)millis(), bootMillis);
+}
+
 // ============================================================================
 // EVENT FLUSHING
 // ============================================================================
@@ -203,30 +332,298 @@ static bool shouldFlushEvents() {
   return false;
 }
 
-// Flush all queued events to MQTT
-void flushEventQueue() {
-  if (!mqttIsConnected) return;
+// ============================================================================
+// EVENT RENDERING
+// ============================================================================
+
+// A queued event plus its interned string, copied out under the lock
+struct QueuedEvent {
+  EventEntry entry;
+  char str[EVENT_INTERN_MAX_LEN];
+};
+
+// Copy the event at ring position `index` (caller holds the critical section)
+static void copyQueuedEvent(uint16_t index, QueuedEvent& out) {
+  out.entry = eventQueue[index];
+  uint8_t slot = out.entry.internSlot;
+  if (slot < EVENT_INTERN_SLOTS && internGeneration[slot] == out.entry.internGen) {
+    memcpy(out.str, internPool[slot], EVENT_INTERN_MAX_LEN);
+  } else {
+    out.str[0] = '\0';  // Unused, or slot reused by a newer event
+  }
+}
+
+// Copy the event at `offset` entries past the head as it was when the batch
+// started; fails if the ring has since moved under us (overflow)
+static bool peekEvent(uint32_t startRemoved, uint16_t offset, QueuedEvent& out) {
+  bool ok = false;
+  EVENT_ENTER_CRITICAL();
+  if (queueRemovedCount == startRemoved && offset < queueCount) {
+    copyQueuedEvent((queueHead + offset) % EVENT_QUEUE_SIZE, out);
+    ok = true;
+  }
+  EVENT_EXIT_CRITICAL();
+  return ok;
+}
+
+// Drop the first `count` events of a sent (or spooled) batch, skipping any the ring has
+// already overwritten while the publish was in flight
+static void consumeEvents(uint32_t startRemoved, uint16_t count) {
+  EVENT_ENTER_CRITICAL();
+  uint32_t alreadyGone = queueRemovedCount - startRemoved;
+  while (count > alreadyGone && queueCount > 0) {
+    eventQueue[queueHead].kind = EVT_NONE;
+    queueHead = (queueHead + 1) % EVENT_QUEUE_SIZE;
+    queueCount--;
+    queueRemovedCount++;
+    count--;
+  }
+  EVENT_EXIT_CRITICAL();
+}
+
+// Append a JSON-escaped string, leaving room for the terminator
+static size_t appendEscaped(char* buf, size_t pos, size_t size, const char* str) {
+  for (; *str && pos + 2 < size; str++) {
+    char c = *str;
+    if (c == '"' || c == '\\') {
+      buf[pos++] = '\\';
+      buf[pos++] = c;
+    } else if ((uint8_t)c >= 0x20) {
+      buf[pos++] = c;  // Control characters are dropped
+    }
+  }
+  return pos;
+}
+
+// Render the type name and data JSON of a queued event into
+// type[EVENT_TYPE_MAX_LEN] and data[EVENT_DATA_MAX_LEN] (empty if no template)
+static void renderEvent(const QueuedEvent& event, char* type, char* data) {
+  EventKindInfo info;
+  memcpy_P(&info, &EVENT_KINDS[event.entry.kind], sizeof(info));
+  memcpy(type, info.type, EVENT_TYPE_MAX_LEN);
   
-  // Check if we should flush (time synced or timeout elapsed)
-  if (!shouldFlushEvents()) {
-    DEBUG_PRINTLN("Waiting for time sync before flushing events...");
-    return;
+  const size_t size = EVENT_DATA_MAX_LEN;
+  size_t pos = 0;
+  uint8_t arg = 0;
+  
+  for (const char* t = info.data; *t && pos < size - 1; t++) {
+    if (*t != '%' || t[1] == '\0') {
+      data[pos++] = *t;
+      continue;
+    }
+    
+    char spec = *++t;
+    if (spec == 's') {
+      pos = appendEscaped(data, pos, size, event.str);
+      continue;
+    }
+    
+    EventValue v = (arg < EVENT_MAX_VALUES) ? event.entry.values[arg++] : EventValue();
+    int n = 0;
+    switch (spec) {
+      case 'd':
+        n = snprintf(data + pos, size - pos, "%ld", (long)v.i);
+        break;
+      case 'u':
+        n = snprintf(data + pos, size - pos, "%lu", (unsigned long)v.u);
+        break;
+      case 't': {
+        uint32_t mag = (v.i < 0) ? 0u - v.u : v.u;
+        n = snprintf(data + pos, size - pos, "%s%lu.%lu", (v.i < 0) ? "-" : "",
+                     (unsigned long)(mag / 10), (unsigned long)(mag % 10));
+        break;
+      }
+      case 'i':
+        n = snprintf(data + pos, size - pos, "%u.%u.%u.%u",
+                     (unsigned)(v.u & 0xFF), (unsigned)((v.u >> 8) & 0xFF),
+                     (unsigned)((v.u >> 16) & 0xFF), (unsigned)(v.u >> 24));
+        break;
+      case 'c':
+        pos = appendEscaped(data, pos, size, v.c ? v.c : "");
+        break;
+      default:
+        data[pos++] = spec;
+        break;
+    }
+    if (n > 0) pos = (pos + n < size - 1) ? pos + n : size - 1;
+  }
+  data[pos] = '\0';
+}
+
+// ============================================================================
+// EVENT TIME
+// ============================================================================
+// Every message carries one of three time bases:
+// - EVENT_TIME_UNIX: Unix seconds (time was synced when the event was logged
+//   or is synced now)
+// - EVENT_TIME_OFFSET: the event's age in ms at send time; the receiver uses
+//   receive_time - offset
+// - EVENT_TIME_PREVIOUS_BOOT: millis() in an earlier boot, from the spool -
+//   only the spacing between events is known, so the receiver anchors them
+//   at receive time
+// ============================================================================
+
+enum EventTimeBase {
+  EVENT_TIME_UNIX,
+  EVENT_TIME_OFFSET,
+  EVENT_TIME_PREVIOUS_BOOT
+};
+
+// Time base of a RAM event; `time` is its value for that base
+static EventTimeBase queuedEventTime(const QueuedEvent& event, bool timeAvailable,
+                                     uint32_t now, uint32_t& time) {
+  if (timeAvailable) {
+    time = (uint32_t)getTimestampForEvent(event.entry.timestamp_ms);
+    return EVENT_TIME_UNIX;
+  }
+  time = now - event.entry.timestamp_ms;
+  return EVENT_TIME_OFFSET;
+}
+
+// Time base of a spooled event; `time` is its value for that base
+static EventTimeBase spooledEventTime(const SpooledEvent& event, bool previousBoot,
+                                      uint32_t now, uint32_t& time) {
+  if (event.flags & EVENT_SPOOL_UNIX_TIME) {
+    time = event.time;
+    return EVENT_TIME_UNIX;
   }
+  if (!previousBoot) {
+    time = now - event.time;
+    return EVENT_TIME_OFFSET;
+  }
+  time = event.time;
+  return EVENT_TIME_PREVIOUS_BOOT;
+}
+
+// ============================================================================
+// SPOOLING
+// ============================================================================
+
+// Move the whole ring into the flash spool, one append per write buffer
+static void spoolQueuedEvents() {
+  bool timeAvailable = isTimeSynced();
+  uint16_t spooled = 0;
   
-  EVENT_ENTER_CRITICAL();
-  if (queueCount == 0) {
+  while (true) {
+    EVENT_ENTER_CRITICAL();
+    uint16_t available = queueCount;
+    uint32_t startRemoved = queueRemovedCount;
     EVENT_EXIT_CRITICAL();
+    
+    if (available == 0) break;
+    
+    QueuedEvent queued;
+    SpooledEvent event;
+    uint16_t buffered = 0;
+    
+    while (buffered < available && peekEvent(startRemoved, buffered, queued)) {
+      renderEvent(queued, event.type, event.data);
+      event.flags = timeAvailable ? EVENT_SPOOL_UNIX_TIME : 0;
+      event.time = timeAvailable ? (uint32_t)getTimestampForEvent(queued.entry.timestamp_ms)
+                                 : queued.entry.timestamp_ms;
+      if (!spoolEvent(event)) break;  // Write buffer full
+      buffered++;
+    }
+    
+    if (buffered == 0) break;
+    if (!commitSpool()) break;  // Flash error - they stay in RAM
+    
+    consumeEvents(startRemoved, buffered);
+    spooled += buffered;
+  }
+  
+  if (spooled > 0) {
+    DEBUG_PRINT("Spooled ");
+    DEBUG_PRINT(spooled);
+    DEBUG_PRINT(" events to flash (");
+    DEBUG_PRINT(getEventSpoolBytes());
+    DEBUG_PRINTLN(" bytes waiting)");
+  }
+}
+
+// Spool while events can't be sent, once enough have gathered or the oldest
+// has waited long enough (runs on the MQTT worker, see updateMQTT())
+void updateEventLog() {
+  // Not online in time - don't hold the boot event back any longer
+  if (bootEventPending && millis() - bootMillis >= BOOT_EVENT_MAX_WAIT_MS) {
+    bootEventPending = false;
+    queueEvent(EVT_BOOT, nullptr, getResetReason(), FIRMWARE_VERSION, bootMillis);
+  }
+  
+  if (!isEventSpoolAvailable() || (eventLogReady && mqttIsConnected)) {
     return;
   }
+  
+  EVENT_ENTER_CRITICAL();
+  uint16_t count = queueCount;
+  uint32_t oldest = (queueCount > 0) ? eventQueue[queueHead].timestamp_ms : 0;
   EVENT_EXIT_CRITICAL();
   
-  String topic = buildDeviceTopic(MQTT_TOPIC_EVENTS);
+  if (count == 0) return;
+  if (count < EVENT_SPOOL_THRESHOLD && millis() - oldest < EVENT_SPOOL_MAX_AGE_MS) {
+    return;
+  }
+  
+  spoolQueuedEvents();
+}
+
+#if EVENT_BATCH_FORMAT == EVENT_BATCH_DISABLED
+
+// Build one event message; an event from an earlier boot gets no time field
+// and the receiver stamps it on arrival
+static void formatEventPayload(char* payload, size_t size, const char* type, const char* data,
+                               EventTimeBase timeBase, uint32_t time) {
+  char timeField[32] = "";
+  if (timeBase == EVENT_TIME_UNIX) {
+    snprintf(timeField, sizeof(timeField), ",\"timestamp\":%lu", (unsigned long)time);
+  } else if (timeBase == EVENT_TIME_OFFSET) {
+    snprintf(timeField, sizeof(timeField), ",\"offset_ms\":%lu", (unsigned long)time);
+  }
+  
+  if (data[0] != '\0') {
+    snprintf(payload, size, "{\"type\":\"%s\",\"data\":%s%s}", type, data, timeField);
+  } else {
+    snprintf(payload, size, "{\"type\":\"%s\"%s}", type, timeField);
+  }
+}
+
+// Static buffer for event payloads (reused across iterations)
+static char eventPayload[EVENT_TYPE_MAX_LEN + EVENT_DATA_MAX_LEN + 64];
+
+// Publish spooled events, one message each; false if a publish failed
+static bool flushSpool(uint8_t& budget) {
+  const char* topic = mqttTopic(TOPIC_EVENTS);
+  uint32_t now = millis();
+  SpooledEvent event;
+  bool previousBoot;
+  
+  while (budget > 0 && spoolReadBegin(previousBoot)) {
+    bool sent = true;
+    while (budget > 0 && spoolReadNext(event)) {
+      uint32_t time;
+      EventTimeBase timeBase = spooledEventTime(event, previousBoot, now, time);
+      formatEventPayload(eventPayload, sizeof(eventPayload), event.type, event.data, timeBase, time);
+      
+      if (!publishMqttPayload(topic, eventPayload)) {
+        sent = false;
+        break;
+      }
+      spoolReadAccept();
+      budget--;
+    }
+    spoolReadEnd(true);  // Keep what went out
+    if (!sent) return false;
+  }
+  return true;
+}
+
+// Publish each queued event as its own JSON message
+static bool flushEventsIndividually(uint8_t& budget) {
+  const char* topic = mqttTopic(TOPIC_EVENTS);
   uint32_t now = millis();
   bool timeAvailable = isTimeSynced();
   int flushed = 0;
-  
-  // Static buffer for event payloads (reused across iterations)
-  static char payload[256];
+  bool sent = true;
   
   // Log which mode we're using
   if (timeAvailable) {
@@ -235,64 +632,38 @@ void flushEventQueue() {
     DEBUG_PRINTLN("Flushing events with offset_ms (time sync timeout)");
   }
   
-  // Process all queued events
-  while (true) {
+  // Process queued events up to the budget
+  while (budget > 0) {
     EVENT_ENTER_CRITICAL();
     if (queueCount == 0) {
       EVENT_EXIT_CRITICAL();
       break;
     }
     
-    // Copy event data (thread-safe)
-    EventEntry& entry = eventQueue[queueHead];
-    uint32_t event_millis = entry.timestamp_ms;
-    char type[EVENT_TYPE_MAX_LEN];
-    char data[EVENT_DATA_MAX_LEN];
-    bool valid = entry.valid;
-    
-    strncpy(type, entry.type, EVENT_TYPE_MAX_LEN);
-    strncpy(data, entry.data, EVENT_DATA_MAX_LEN);
-    
-    entry.valid = false;
+    // Copy event record (thread-safe)
+    QueuedEvent event;
+    copyQueuedEvent(queueHead, event);
+    eventQueue[queueHead].kind = EVT_NONE;
     queueHead = (queueHead + 1) % EVENT_QUEUE_SIZE;
     queueCount--;
+    queueRemovedCount++;
     
     EVENT_EXIT_CRITICAL();
     
-    if (valid) {
-      if (timeAvailable) {
-        // Use Unix timestamp - calculate when event actually occurred
-        time_t eventTimestamp = getTimestampForEvent(event_millis);
-        
-        // Build JSON payload with timestamp
-        if (data[0] != '\0') {
-          snprintf(payload, sizeof(payload),
-            "{\"type\":\"%s\",\"data\":%s,\"timestamp\":%lu}",
-            type, data, (unsigned long)eventTimestamp);
-        } else {
-          snprintf(payload, sizeof(payload),
-            "{\"type\":\"%s\",\"timestamp\":%lu}",
-            type, (unsigned long)eventTimestamp);
-        }
-      } else {
-        // Fallback: use offset_ms - server calculates receive_time - offset
-        uint32_t offset_ms = now - event_millis;
-        
-        // Build JSON payload with offset
-        if (data[0] != '\0') {
-          snprintf(payload, sizeof(payload),
-            "{\"type\":\"%s\",\"data\":%s,\"offset_ms\":%lu}",
-            type, data, offset_ms);
-        } else {
-          snprintf(payload, sizeof(payload),
-            "{\"type\":\"%s\",\"offset_ms\":%lu}",
-            type, offset_ms);
-        }
-      }
+    if (event.entry.kind != EVT_NONE) {
+      char type[EVENT_TYPE_MAX_LEN];
+      char data[EVENT_DATA_MAX_LEN];
+      renderEvent(event, type, data);
       
-      if (publishMqttPayload(topic, payload)) {
+      uint32_t time;
+      EventTimeBase timeBase = queuedEventTime(event, timeAvailable, now, time);
+      formatEventPayload(eventPayload, sizeof(eventPayload), type, data, timeBase, time);
+      
+      if (publishMqttPayload(topic, eventPayload)) {
         flushed++;
+        budget--;
       } else {
+        sent = false;
         break;
       }
     }
@@ -303,15 +674,297 @@ void flushEventQueue() {
     DEBUG_PRINT(flushed);
     DEBUG_PRINTLN(" events from queue");
   }
+  return sent;
+}
+
+#else
+
+// ============================================================================
+// BATCH ENCODING
+// ============================================================================
+// Both formats carry one base time for the batch plus a per-event delta in
+// milliseconds from the first event. The base follows the batch's time base
+// (see EVENT TIME): Unix seconds, the first event's age in ms at send time
+// (receiver computes receive_time - base + delta), or the first event's
+// millis() in an earlier boot (receiver anchors the batch at receive time).
+// A batch never mixes time bases.
+//
+// JSON (EVENT_BATCH_JSON):
+//   {"base":1733580123,"events":[{"type":"boot","data":{...},"dt":0},...]}
+//   ("base_offset_ms" or "base_boot_ms" replaces "base" for the other bases)
+//
+// Binary (EVENT_BATCH_BINARY): version/flags/base/count header and TLV
+// records - layout and constants in mqtt_wire_format.h
+// ============================================================================
+
+static uint8_t batchBuffer[EVENT_BATCH_BUFFER_SIZE];
+
+#if EVENT_BATCH_FORMAT == EVENT_BATCH_JSON
+
+static uint16_t writeBatchHeader(uint8_t* buf, EventTimeBase timeBase, uint32_t base) {
+  const char* key = "base";
+  if (timeBase == EVENT_TIME_OFFSET) key = "base_offset_ms";
+  if (timeBase == EVENT_TIME_PREVIOUS_BOOT) key = "base_boot_ms";
+  return snprintf((char*)buf, EVENT_BATCH_BUFFER_SIZE, "{\"%s\":%lu,\"events\":[",
+                  key, (unsigned long)base);
+}
+
+// Returns bytes written, or 0 if the event doesn't fit in `space`
+static uint16_t writeBatchEvent(uint8_t* buf, uint16_t space, bool first,
+                                const char* type, const char* data, uint32_t dt) {
+  int len;
+  if (data[0] != '\0') {
+    len = snprintf((char*)buf, space, "%s{\"type\":\"%s\",\"data\":%s,\"dt\":%lu}",
+                   first ? "" : ",", type, data, (unsigned long)dt);
+  } else {
+    len = snprintf((char*)buf, space, "%s{\"type\":\"%s\",\"dt\":%lu}",
+                   first ? "" : ",", type, (unsigned long)dt);
+  }
+  return (len > 0 && len < space) ? len : 0;
+}
+
+static uint16_t finishBatch(uint8_t* buf, uint16_t len, uint8_t count) {
+  buf[len++] = ']';
+  buf[len++] = '}';
+  return len;
+}
+
+#define EVENT_BATCH_TRAILER_SIZE 2
+
+#else  // EVENT_BATCH_BINARY
+
+static uint16_t writeBatchHeader(uint8_t* buf, EventTimeBase timeBase, uint32_t base) {
+  buf[0] = EVENT_BATCH_BINARY_VERSION;
+  buf[1] = (timeBase == EVENT_TIME_UNIX) ? EVENT_BATCH_FLAG_UNIX_BASE
+         : (timeBase == EVENT_TIME_PREVIOUS_BOOT) ? EVENT_BATCH_FLAG_PREVIOUS_BOOT : 0;
+  buf[2] = base & 0xFF;
+  buf[3] = (base >> 8) & 0xFF;
+  buf[4] = (base >> 16) & 0xFF;
+  buf[5] = (base >> 24) & 0xFF;
+  buf[6] = 0;  // Event count, filled in by finishBatch()
+  return EVENT_BATCH_HEADER_SIZE;
+}
+
+// Returns bytes written, or 0 if the event doesn't fit in `space`
+static uint16_t writeBatchEvent(uint8_t* buf, uint16_t space, bool first,
+                                const char* type, const char* data, uint32_t dt) {
+  uint8_t typeLen = strnlen(type, EVENT_TYPE_MAX_LEN - 1);
+  uint8_t dataLen = strnlen(data, EVENT_DATA_MAX_LEN - 1);
+  
+  uint8_t varint[5];
+  uint8_t varintLen = 0;
+  do {
+    uint8_t b = dt & 0x7F;
+    dt >>= 7;
+    varint[varintLen++] = dt ? (b | 0x80) : b;
+  } while (dt);
+  
+  uint16_t valueLen = varintLen + 1 + typeLen + dataLen;
+  if (valueLen > 255 || 2 + valueLen > space) return 0;
+  
+  uint16_t pos = 0;
+  buf[pos++] = EVENT_TLV_EVENT;
+  buf[pos++] = valueLen;
+  memcpy(&buf[pos], varint, varintLen);
+  pos += varintLen;
+  buf[pos++] = typeLen;
+  memcpy(&buf[pos], type, typeLen);
+  pos += typeLen;
+  memcpy(&buf[pos], data, dataLen);
+  pos += dataLen;
+  return pos;
+}
+
+static uint16_t finishBatch(uint8_t* buf, uint16_t len, uint8_t count) {
+  buf[6] = count;
+  return len;
+}
+
+#define EVENT_BATCH_TRAILER_SIZE 0
+
+#endif
+
+// Publish spooled events in batches; a batch stays within one segment and one
+// time base. False if a publish failed.
+static bool flushSpool(uint8_t& budget) {
+  const char* topic = mqttTopic(TOPIC_EVENTS_BATCH);
+  uint32_t now = millis();
+  SpooledEvent event;
+  bool previousBoot;
+  int flushed = 0;
+  bool sent = true;
+  
+  while (budget > 0 && spoolReadBegin(previousBoot)) {
+    uint16_t len = 0;
+    uint8_t packed = 0;  // One byte on the wire
+    EventTimeBase batchBase = EVENT_TIME_UNIX;
+    uint32_t baseTime = 0;
+    
+    while (packed < 255 && spoolReadNext(event)) {
+      uint32_t time;
+      EventTimeBase timeBase = spooledEventTime(event, previousBoot, now, time);
+      if (packed == 0) {
+        batchBase = timeBase;
+        baseTime = event.time;
+        len = writeBatchHeader(batchBuffer, timeBase, time);
+      } else if (timeBase != batchBase) {
+        break;  // Time was synced mid-segment - next batch
+      }
+      
+      // Deltas are in ms; Unix-stamped records only have whole seconds
+      uint32_t dt = event.time - baseTime;
+      if (timeBase == EVENT_TIME_UNIX) dt *= 1000;
+      
+      uint16_t space = sizeof(batchBuffer) - len - EVENT_BATCH_TRAILER_SIZE;
+      uint16_t eventLen = writeBatchEvent(batchBuffer + len, space, packed == 0,
+                                          event.type, event.data, dt);
+      if (eventLen == 0) break;  // Batch full (the record is read again next time)
+      
+      len += eventLen;
+      packed++;
+      spoolReadAccept();
+    }
+    
+    if (packed == 0) {
+      spoolReadEnd(true);  // End of the segment
+      continue;
+    }
+    
+    len = finishBatch(batchBuffer, len, packed);
+    sent = publishMqttPayload(topic, batchBuffer, len);
+    spoolReadEnd(sent);
+    if (!sent) break;
+    
+    flushed += packed;
+    budget--;
+  }
+  
+  if (flushed > 0) {
+    DEBUG_PRINT("Flushed ");
+    DEBUG_PRINT(flushed);
+    DEBUG_PRINTLN(" events from the flash spool");
+  }
+  return sent;
+}
+
+// Publish queued events in as few messages as possible
+static bool flushEventBatches(uint8_t& budget) {
+  const char* topic = mqttTopic(TOPIC_EVENTS_BATCH);
+  uint32_t now = millis();
+  bool timeAvailable = isTimeSynced();
+  int flushed = 0;
+  int batches = 0;
+  bool sent = true;
+  
+  while (budget > 0) {
+    EVENT_ENTER_CRITICAL();
+    uint16_t available = queueCount;
+    uint32_t startRemoved = queueRemovedCount;
+    EVENT_EXIT_CRITICAL();
+    
+    if (available == 0) break;
+    
+    QueuedEvent event;
+    char type[EVENT_TYPE_MAX_LEN];
+    char data[EVENT_DATA_MAX_LEN];
+    uint16_t len = 0;
+    uint8_t packed = 0;  // One byte on the wire
+    uint32_t baseMillis = 0;
+    bool ringMoved = false;
+    
+    for (uint16_t i = 0; i < available && packed < 255; i++) {
+      if (!peekEvent(startRemoved, i, event)) {
+        ringMoved = true;
+        break;
+      }
+      
+      if (i == 0) {
+        baseMillis = event.entry.timestamp_ms;
+        uint32_t base;
+        EventTimeBase timeBase = queuedEventTime(event, timeAvailable, now, base);
+        len = writeBatchHeader(batchBuffer, timeBase, base);
+      }
+      
+      uint16_t space = sizeof(batchBuffer) - len - EVENT_BATCH_TRAILER_SIZE;
+      renderEvent(event, type, data);
+      uint16_t eventLen = writeBatchEvent(batchBuffer + len, space, packed == 0, type, data,
+                                          event.entry.timestamp_ms - baseMillis);
+      if (eventLen == 0) break;  // Batch full
+      
+      len += eventLen;
+      packed++;
+    }
+    
+    if (ringMoved) continue;  // Overflow while packing - rebuild from the new head
+    if (packed == 0) break;   // Nothing fits (cannot happen with current size limits)
+    
+    len = finishBatch(batchBuffer, len, packed);
+    
+    if (!publishMqttPayload(topic, batchBuffer, len)) {
+      sent = false;
+      break;
+    }
+    
+    consumeEvents(startRemoved, packed);
+    flushed += packed;
+    batches++;
+    budget--;
+  }
+  
+  if (flushed > 0) {
+    DEBUG_PRINT("Flushed ");
+    DEBUG_PRINT(flushed);
+    DEBUG_PRINT(" events from queue in ");
+    DEBUG_PRINT(batches);
+    DEBUG_PRINTLN(" batch(es)");
+  }
+  return sent;
+}
+
+#endif
+
+// Flush queued events to MQTT, oldest first (runs as an MQTT worker job, see
+// queueEvent()). Each run sends at most EVENT_FLUSH_BUDGET messages and
+// queues itself again if more are waiting.
+bool flushEventQueue() {
+  if (!mqttIsConnected) return true;  // Reconnecting queues a flush again
+  
+  // Check if we should flush (time synced or timeout elapsed)
+  if (!shouldFlushEvents()) {
+    DEBUG_PRINTLN("Waiting for time sync before flushing events...");
+    return true;
+  }
+  
+  if (!hasQueuedEvents()) return true;
+  
+  // The spool holds events older than anything in RAM, so it goes first
+  uint8_t budget = EVENT_FLUSH_BUDGET;
+  bool sent = flushSpool(budget);
+  if (sent && isEventSpoolEmpty()) {
+#if EVENT_BATCH_FORMAT == EVENT_BATCH_DISABLED
+    sent = flushEventsIndividually(budget);
+#else
+    sent = flushEventBatches(budget);
+#endif
+  }
+  
+  // Budget spent with events left - continue after more urgent traffic
+  if (sent && budget == 0 && hasQueuedEvents()) {
+    requestMqttJob(flushEventQueue, MQTT_PRIORITY_EVENT);
+  }
+  return sent;  // Unsent events stay queued for the retry
 }
 
 // ============================================================================
 // PUBLIC API
 // ============================================================================
 
-// Check if there are queued events
+// Check if there are queued events (RAM or flash)
 bool hasQueuedEvents() {
-  return queueCount > 0;
+  EVENT_ENTER_CRITICAL();
+  bool queued = queueCount > 0;
+  EVENT_EXIT_CRITICAL();
+  return queued || !isEventSpoolEmpty();
 }
 
 // Get count of queued events
@@ -3,21 +3,107 @@
 
 #include <Arduino.h>
 
-#define EVENT_TYPE_MAX_LEN 32
-#define EVENT_DATA_MAX_LEN 64
-#define EVENT_QUEUE_SIZE 50
+#define EVENT_TYPE_MAX_LEN 24    // Longest event type name (incl. terminator)
+#define EVENT_DATA_MAX_LEN 128   // Rendered data JSON buffer (built at flush time)
+#define EVENT_QUEUE_SIZE 300     // 16-byte records - same RAM as the old 50-entry text queue
+#define EVENT_MAX_VALUES 2       // Numeric/constant arguments per event
+#define EVENT_INTERN_SLOTS 4     // Copied strings (SSID, rejected user input) held at once
+#define EVENT_INTERN_MAX_LEN 33  // Longest copied string (incl. terminator) - fits a 32-char SSID
+#define EVENT_NO_INTERN 0xFF
 
+// Event publishing format (override with -DEVENT_BATCH_FORMAT=...)
+#define EVENT_BATCH_DISABLED 0  // One JSON message per event on MQTT_TOPIC_EVENTS
+#define EVENT_BATCH_JSON     1  // JSON array batches on MQTT_TOPIC_EVENTS_BATCH
+#define EVENT_BATCH_BINARY   2  // Compact binary TLV batches on MQTT_TOPIC_EVENTS_BATCH
+#ifndef EVENT_BATCH_FORMAT
+  #define EVENT_BATCH_FORMAT EVENT_BATCH_BINARY
+#endif
+
+#define EVENT_BATCH_BUFFER_SIZE 1024  // Max payload per batch (fits PubSubClient's 2048-byte buffer)
+
+// Event kinds - each one is a published type name plus a data JSON template
+// (EVENT_KINDS table in event_log.cpp, which must match this order)
+enum EventKind {
+  EVT_NONE,                        // Empty slot
+  EVT_BOOT,                        // boot {reason, version} (never got online)
+  EVT_BOOT_ONLINE,                 // boot {reason, version (interned), online_ms}
+  EVT_BOOT_STAGE,                  // boot_stage {stage, ms}
+  EVT_WIFI_CONNECT,                // wifi_connect {ssid (interned), rssi, ip}
+  EVT_WIFI_DISCONNECT,             // wifi_disconnect
+  EVT_MQTT_CONNECT,                // mqtt_connect
+  EVT_MQTT_DISCONNECT,             // mqtt_disconnect
+  EVT_WIFI_RSSI_LOW,               // wifi_rssi_low {rssi, threshold}
+  EVT_LOW_HEAP_WARNING,            // low_heap_warning {free_heap, threshold}
+  EVT_TIMER_ALLOC_FAILED,          // timer_alloc_failed {name, max}
+  EVT_RESTART_COMMAND,             // restart_command
+  EVT_BUTTON_PRESS,                // button_press
+  EVT_BUTTON_ACTION,               // button_press {action}
+  EVT_DISPLAY_MODE_CHANGE,         // display_mode_change {from, to}
+  EVT_DISPLAY_FRAME_REJECTED,      // display_frame_rejected {length, expected}
+  EVT_DISPLAY_FRAME_BUSY,          // display_frame_rejected {mode}
+  EVT_TEMPERATURE_READ,            // temperature_read {celsius (tenths)}
+  EVT_TEMP_SENSOR_NOT_FOUND,       // temp_sensor_not_found
+  EVT_TEMP_READ_INVALID,           // temp_read_invalid {raw (tenths), reason}
+  EVT_TEMPERATURE_READ_SENSOR,     // temperature_read {celsius (tenths), sensor}
+  EVT_TEMP_READ_CRC_ERROR,         // temp_read_crc_error {sensor}
+  EVT_RTC_INITIALIZED,             // rtc_initialized
+  EVT_RTC_LOST_POWER,              // rtc_lost_power
+  EVT_RTC_TIME_INVALID,            // rtc_time_invalid
+  EVT_RTC_NOT_FOUND,               // rtc_not_found
+  EVT_RTC_SYNC_FAILED,             // rtc_sync_failed {reason}
+  EVT_RTC_DRIFT_CORRECTED,         // rtc_drift_corrected {drift_seconds}
+  EVT_RTC_SYNCED_FROM_NTP,         // rtc_synced_from_ntp
+  EVT_NTP_SYNC_SUCCESS,            // ntp_sync_success
+  EVT_TIME_DST_CHANGED,            // dst_changed {dst}
+  EVT_CONFIG_UPDATED_TEMP_OFFSET,  // config_updated {temp_offset (tenths)}
+  EVT_CONFIG_UPDATED_ENVIRONMENT,  // config_updated {environment}
+  EVT_CONFIG_UPDATED_KEY,          // config_updated {<key>: value}
+  EVT_CONFIG_INVALID_SCOPE,        // config_error {error, value (interned)}
+  EVT_CONFIG_OUT_OF_RANGE,         // config_error {error, value (tenths)}
+  EVT_CONFIG_KEY_OUT_OF_RANGE,     // config_error {error, key, value}
+  EVT_CONFIG_PARSE_FAILED,         // config_error {error, key}
+  EVT_CONFIG_NOOP,                 // config_noop
+  EVT_CONFIG_NOOP_KEY,             // config_noop {key}
+  EVT_KIND_COUNT
+};
+
+// One event argument: an integer, or a pointer to a string that outlives the
+// queue (literals, enum-to-string tables). Only the pointer is stored.
+struct EventValue {
+  union {
+    int32_t i;
+    uint32_t u;
+    const char* c;
+  };
+  EventValue() : i(0) {}
+  EventValue(int v) : i(v) {}
+  EventValue(long v) : i(v) {}
+  EventValue(unsigned int v) : u(v) {}
+  EventValue(unsigned long v) : u(v) {}
+  EventValue(const char* v) : c(v) {}
+};
+
+// Fixed-width queued event (16 bytes); JSON is only rendered when flushing
 struct EventEntry {
-    uint32_t timestamp_ms;
-    char type[EVENT_TYPE_MAX_LEN];
-    char data[EVENT_DATA_MAX_LEN];
-    bool valid;
+  uint32_t timestamp_ms;                // millis() when logged
+  uint8_t kind;                         // EventKind (EVT_NONE = empty)
+  uint8_t internSlot;                   // Interned string slot, or EVENT_NO_INTERN
+  uint8_t internGen;                    // Slot generation when logged (detects reuse)
+  EventValue values[EVENT_MAX_VALUES];  // Template arguments in order
 };
 
+// Fixed-point tenths for "%.1f"-style fields (e.g. temperatures)
+inline int32_t eventTenths(float value) {
+  return (int32_t)(value * 10.0f + (value < 0 ? -0.5f : 0.5f));
+}
+
 void initEventLog();
-void logEvent(const char* type, const char* dataJson = nullptr);
+void logEvent(EventKind kind, EventValue a = EventValue(), EventValue b = EventValue());
+void logEventWithString(EventKind kind, const char* str, EventValue a = EventValue(), EventValue b = EventValue());
 void logBootEvent();
-void flushEventQueue();
+void logBootOnline();   // MQTT worker: first heartbeat sent
+bool flushEventQueue();  // MQTT worker job: false if a publish was rejected
+void updateEventLog();  // MQTT worker: move events to the flash spool while offline
 bool hasQueuedEvents();
 int getQueuedEventCount();
 void setEventLogReady(bool ready);
@@ -0,0 +1,353 @@
+// ============================================================================
+// event_spool.cpp - Flash-backed event spool (LittleFS)
+// ============================================================================
+// Second tier behind the RAM ring in event_log.cpp, used while events can't
+// be sent:
+// - Append-only segment files /events/<sequence>.evs of up to
+//   EVENT_SPOOL_SEGMENT_SIZE bytes; a boot never appends to an earlier
+//   boot's segment
+// - Events are buffered and written in one append per batch, so flash is
+//   touched once per spool pass rather than once per event
+// - Segments are deleted once every record has been published; LittleFS
+//   spreads the writes over the whole partition (wear levelling) and keeps
+//   files consistent across power loss
+// - When the spool reaches its limit the oldest segment is dropped
+//
+// Record layout (integers little-endian):
+//   [0]    length of the rest of the record
+//   [1]    flags (EVENT_SPOOL_UNIX_TIME)
+//   [2..5] time (Unix seconds, or millis() in the boot that logged it)
+//   [6]    type length, then type, then data JSON (remaining bytes)
+// A record cut short by a reset ends the segment.
+//
+// Not thread-safe: the writer and reader both run on the MQTT worker.
+// ============================================================================
+
+// ============================================================================
+// INCLUDES
+// ============================================================================
+
+#include "event_spool.h"  // This file's header
+#include "debug.h"        // For debug logging
+#include <LittleFS.h>     // For the spool files
+
+// ============================================================================
+// CONSTANTS
+// ============================================================================
+
+#define EVENT_SPOOL_DIR "/events"
+#define EVENT_SPOOL_SUFFIX ".evs"
+#define EVENT_SPOOL_PATH_SIZE 24
+#define EVENT_SPOOL_WRITE_BUFFER 512    // Bytes gathered before one append
+#define EVENT_SPOOL_RECORD_HEADER 7     // Length, flags, time, type length
+
+// ============================================================================
+// STATE VARIABLES
+// ============================================================================
+
+static bool spoolMounted = false;
+static uint32_t spoolLimit = 0;          // Max bytes across all segments
+static uint32_t spoolBytes = 0;          // Bytes in segment files now
+static uint32_t spoolDropped = 0;
+
+// Segments [firstSegment, nextSegment) exist; those from bootFirstSegment on
+// were written by this boot
+static uint32_t firstSegment = 1;
+static uint32_t nextSegment = 1;
+static uint32_t bootFirstSegment = 1;
+
+// Writer
+static bool writeSegmentOpen = false;    // nextSegment - 1 may be appended to
+static uint32_t writeSegmentSize = 0;
+static uint8_t writeBuffer[EVENT_SPOOL_WRITE_BUFFER];
+static uint16_t writeUsed = 0;
+
+// Reader (position in firstSegment)
+static uint32_t readOffset = 0;          // Committed: records before this were sent
+static File readFile;
+static uint32_t readSize = 0;            // End of valid records in the open segment
+static uint32_t readNextPos = 0;
+static uint32_t readAccepted = 0;
+
+// ============================================================================
+// HELPERS
+// ============================================================================
+
+static void segmentPath(uint32_t segment, char* path) {
+  snprintf(path, EVENT_SPOOL_PATH_SIZE, EVENT_SPOOL_DIR "/%08lu" EVENT_SPOOL_SUFFIX, (unsigned long)segment);
+}
+
+// Record a segment found at boot; names that aren't ours are ignored
+static void noteSegment(const char* name, uint32_t size, bool& found) {
+  char* end;
+  unsigned long segment = strtoul(name, &end, 10);
+  if (end == name || strcmp(end, EVENT_SPOOL_SUFFIX) != 0 || segment == 0) {
+    return;
+  }
+  if (!found || segment < firstSegment) firstSegment = segment;
+  if (!found || segment >= nextSegment) nextSegment = segment + 1;
+  found = true;
+  spoolBytes += size;
+}
+
+// Count the records in a segment (only needed when dropping one)
+static uint32_t countRecords(File& file) {
+  uint32_t count = 0;
+  uint32_t pos = 0;
+  uint32_t size = file.size();
+  while (pos < size) {
+    file.seek(pos);
+    int length = file.read();
+    if (length <= 0 || pos + 1 + length > size) break;
+    pos += 1 + length;
+    count++;
+  }
+  return count;
+}
+
+// Delete the oldest segment; `sent` is false when events are being lost
+static void removeFirstSegment(bool sent) {
+  char path[EVENT_SPOOL_PATH_SIZE];
+  segmentPath(firstSegment, path);
+  
+  File file = LittleFS.open(path, "r");
+  if (file) {
+    uint32_t size = file.size();
+    if (!sent) {
+      spoolDropped += countRecords(file);
+    }
+    file.close();
+    spoolBytes = (spoolBytes > size) ? spoolBytes - size : 0;
+  }
+  LittleFS.remove(path);
+  
+  if (firstSegment == nextSegment - 1) {
+    writeSegmentOpen = false;  // Next write starts a new segment
+  }
+  firstSegment++;
+  readOffset = 0;
+}
+
+// ============================================================================
+// INITIALIZATION
+// ============================================================================
+
+bool initEventSpool() {
+  #if defined(ESP32)
+    spoolMounted = LittleFS.begin(true);  // Format on first use
+  #elif defined(ESP8266)
+    spoolMounted = LittleFS.begin();      // Formats an unmountable partition itself
+  #endif
+  
+  if (!spoolMounted) {
+    DEBUG_PRINTLN("Event spool: no filesystem, events are RAM-only");
+    return false;
+  }
+  
+  uint32_t fsBytes = 0;
+  #if defined(ESP32)
+    fsBytes = LittleFS.totalBytes();
+  #elif defined(ESP8266)
+    FSInfo info;
+    if (LittleFS.info(info)) fsBytes = info.totalBytes;
+  #endif
+  spoolLimit = fsBytes / 2;
+  if (spoolLimit > EVENT_SPOOL_MAX_BYTES) spoolLimit = EVENT_SPOOL_MAX_BYTES;
+  if (spoolLimit < EVENT_SPOOL_SEGMENT_SIZE) {
+    DEBUG_PRINTLN("Event spool: filesystem too small, events are RAM-only");
+    spoolMounted = false;
+    return false;
+  }
+  
+  if (!LittleFS.exists(EVENT_SPOOL_DIR)) {
+    LittleFS.mkdir(EVENT_SPOOL_DIR);
+  }
+  
+  bool found = false;
+  #if defined(ESP32)
+    File dir = LittleFS.open(EVENT_SPOOL_DIR);
+    File entry = dir.openNextFile();
+    while (entry) {
+      noteSegment(entry.name(), entry.size(), found);
+      entry = dir.openNextFile();
+    }
+    dir.close();
+  #elif defined(ESP8266)
+    Dir dir = LittleFS.openDir(EVENT_SPOOL_DIR);
+    while (dir.next()) {
+      noteSegment(dir.fileName().c_str(), dir.fileSize(), found);
+    }
+  #endif
+  
+  bootFirstSegment = nextSegment;
+  
+  DEBUG_PRINT("Event spool ready: ");
+  DEBUG_PRINT(spoolBytes);
+  DEBUG_PRINT(" bytes from earlier boots, limit ");
+  DEBUG_PRINTLN(spoolLimit);
+  return true;
+}
+
+bool isEventSpoolAvailable() {
+  return spoolMounted;
+}
+
+bool isEventSpoolEmpty() {
+  return firstSegment >= nextSegment && writeUsed == 0;
+}
+
+uint32_t getEventSpoolBytes() {
+  return spoolBytes + writeUsed;
+}
+
+uint32_t getEventSpoolDropped() {
+  return spoolDropped;
+}
+
+// ============================================================================
+// WRITER
+// ============================================================================
+
+// False if the write buffer is full (commitSpool() and retry)
+bool spoolEvent(const SpooledEvent& event) {
+  if (!spoolMounted) return false;
+  
+  uint8_t typeLength = strnlen(event.type, EVENT_TYPE_MAX_LEN - 1);
+  uint8_t dataLength = strnlen(event.data, EVENT_DATA_MAX_LEN - 1);
+  uint16_t recordLength = EVENT_SPOOL_RECORD_HEADER + typeLength + dataLength;
+  if (writeUsed + recordLength > sizeof(writeBuffer)) {
+    return false;
+  }
+  
+  uint8_t* out = writeBuffer + writeUsed;
+  out[0] = recordLength - 1;
+  out[1] = event.flags;
+  out[2] = event.time & 0xFF;
+  out[3] = (event.time >> 8) & 0xFF;
+  out[4] = (event.time >> 16) & 0xFF;
+  out[5] = (event.time >> 24) & 0xFF;
+  out[6] = typeLength;
+  memcpy(out + EVENT_SPOOL_RECORD_HEADER, event.type, typeLength);
+  memcpy(out + EVENT_SPOOL_RECORD_HEADER + typeLength, event.data, dataLength);
+  writeUsed += recordLength;
+  return true;
+}
+
+// Append the buffered records to the current segment (one flash write)
+bool commitSpool() {
+  if (!spoolMounted || writeUsed == 0) return true;
+  
+  if (!writeSegmentOpen || writeSegmentSize + writeUsed > EVENT_SPOOL_SEGMENT_SIZE) {
+    nextSegment++;
+    writeSegmentOpen = true;
+    writeSegmentSize = 0;
+  }
+  
+  // Make room by dropping the oldest segments (never the one being written)
+  while (spoolBytes + writeUsed > spoolLimit && firstSegment < nextSegment - 1) {
+    DEBUG_PRINTLN("Event spool full, dropping oldest segment");
+    removeFirstSegment(false);
+  }
+  
+  char path[EVENT_SPOOL_PATH_SIZE];
+  segmentPath(nextSegment - 1, path);
+  File file = LittleFS.open(path, "a");
+  if (!file) {
+    DEBUG_PRINT("Event spool: cannot open ");
+    DEBUG_PRINTLN(path);
+    writeUsed = 0;
+    return false;
+  }
+  size_t written = file.write(writeBuffer, writeUsed);
+  file.close();
+  
+  spoolBytes += written;
+  writeSegmentSize += written;
+  bool ok = (written == writeUsed);
+  writeUsed = 0;
+  
+  if (!ok) {
+    DEBUG_PRINTLN("Event spool: short write");
+    writeSegmentOpen = false;  // Don't append after a partial record
+  }
+  return ok;
+}
+
+// ============================================================================
+// READER
+// ============================================================================
+
+bool spoolReadBegin(bool& previousBoot) {
+  if (!spoolMounted) return false;
+  commitSpool();  // Buffered records are older than anything still in RAM
+  
+  while (firstSegment < nextSegment) {
+    char path[EVENT_SPOOL_PATH_SIZE];
+    segmentPath(firstSegment, path);
+    readFile = LittleFS.open(path, "r");
+    if (!readFile) {
+      firstSegment++;  // Missing - skip it
+      readOffset = 0;
+      continue;
+    }
+    
+    readSize = readFile.size();
+    if (readOffset >= readSize) {
+      readFile.close();
+      removeFirstSegment(true);
+      continue;
+    }
+    
+    readFile.seek(readOffset);
+    readNextPos = readOffset;
+    readAccepted = readOffset;
+    previousBoot = firstSegment < bootFirstSegment;
+    return true;
+  }
+  return false;
+}
+
+bool spoolReadNext(SpooledEvent& event) {
+  if (!readFile || readNextPos >= readSize) return false;
+  
+  uint8_t record[256];
+  int length = readFile.read();
+  bool valid = length >= EVENT_SPOOL_RECORD_HEADER - 1 &&
+               readNextPos + 1 + length <= readSize &&
+               readFile.read(record, length) == (size_t)length;
+  
+  uint8_t typeLength = valid ? record[5] : 0;
+  uint16_t dataLength = valid ? length - (EVENT_SPOOL_RECORD_HEADER - 1) - typeLength : 0;
+  if (!valid || typeLength >= EVENT_TYPE_MAX_LEN ||
+      length < EVENT_SPOOL_RECORD_HEADER - 1 + typeLength || dataLength >= EVENT_DATA_MAX_LEN) {
+    readSize = readNextPos;  // Truncated or corrupt - the segment ends here
+    return false;
+  }
+  
+  event.flags = record[0];
+  event.time = (uint32_t)record[1] | ((uint32_t)record[2] << 8) |
+               ((uint32_t)record[3] << 16) | ((uint32_t)record[4] << 24);
+  memcpy(event.type, record + 6, typeLength);
+  event.type[typeLength] = '\0';
+  memcpy(event.data, record + 6 + typeLength, dataLength);
+  event.data[dataLength] = '\0';
+  
+  readNextPos += 1 + length;
+  return true;
+}
+
+void spoolReadAccept() {
+  readAccepted = readNextPos;
+}
+
+void spoolReadEnd(bool commit) {
+  if (readFile) {
+    readFile.close();
+  }
+  if (!commit) return;
+  
+  readOffset = readAccepted;
+  if (readOffset >= readSize) {
+    removeFirstSegment(true);
+  }
+}
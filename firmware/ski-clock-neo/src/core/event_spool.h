@@ -0,0 +1,50 @@
+#ifndef EVENT_SPOOL_H
+#define EVENT_SPOOL_H
+
+#include <Arduino.h>
+#include "event_log.h"
+
+// Spool limits (override with -DEVENT_SPOOL_...=...)
+#ifndef EVENT_SPOOL_MAX_BYTES
+  #define EVENT_SPOOL_MAX_BYTES 262144  // Upper bound; also capped at half the filesystem
+#endif
+#define EVENT_SPOOL_SEGMENT_SIZE 4096   // Bytes per segment file (one flash block)
+
+#define EVENT_SPOOL_UNIX_TIME 0x01      // time is Unix seconds, else millis() in its boot
+
+// One rendered event as stored in flash - needs nothing from the boot that
+// logged it (no pointers, no interned string slots)
+struct SpooledEvent {
+  uint8_t flags;                  // EVENT_SPOOL_UNIX_TIME
+  uint32_t time;
+  char type[EVENT_TYPE_MAX_LEN];
+  char data[EVENT_DATA_MAX_LEN];
+};
+
+// Mount the filesystem and find segments left by earlier boots.
+// False if there is no usable filesystem (events then stay RAM-only).
+bool initEventSpool();
+bool isEventSpoolAvailable();
+bool isEventSpoolEmpty();
+uint32_t getEventSpoolBytes();
+uint32_t getEventSpoolDropped();  // Events lost to the size limit
+
+// Writer: buffer events in RAM and append them to flash in one write
+bool spoolEvent(const SpooledEvent& event);
+bool commitSpool();
+
+// Reader - one segment at a time, oldest first:
+//   spoolReadBegin()  open the oldest segment where the last read stopped;
+//                     previousBoot is true if an earlier boot wrote it
+//   spoolReadNext()   next record (false at the end of the segment)
+//   spoolReadAccept() the record just read was sent - consume it on commit
+//   spoolReadEnd()    close; commit drops accepted records, deleting the
+//                     segment once all of it has been accepted
+// The read position isn't persisted, so a reboot mid-segment re-sends that
+// segment (at-least-once delivery).
+bool spoolReadBegin(bool& previousBoot);
+bool spoolReadNext(SpooledEvent& event);
+void spoolReadAccept();
+void spoolReadEnd(bool commit);
+
+#endif
@@ -0,0 +1,185 @@
+// ============================================================================
+// json_scan.cpp - Allocation-free key lookup in MQTT JSON payloads
+// ============================================================================
+// Inbound payloads are small flat objects such as
+// {"command": "mirror", "ttl": 300}. Instead of copying them into a String
+// and searching with indexOf(), lookups walk the raw buffer:
+// - Strings are skipped as whole tokens, so text inside a value never
+//   matches a key
+// - Only a string followed by ':' is compared against the key
+// - Nothing is allocated and the buffer needs no NUL terminator
+// ============================================================================
+
+// ============================================================================
+// INCLUDES
+// ============================================================================
+
+#include "json_scan.h"  // This file's header
+
+// ============================================================================
+// CONSTANTS
+// ============================================================================
+
+#define JSON_NUMBER_MAX_LENGTH 24  // Longest numeric token accepted
+
+// ============================================================================
+// TOKENIZER
+// ============================================================================
+
+static bool isJsonWhitespace(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static size_t skipWhitespace(const char* json, size_t length, size_t pos) {
+  while (pos < length && isJsonWhitespace(json[pos])) {
+    pos++;
+  }
+  return pos;
+}
+
+// pos is at an opening quote. Returns the index just past the closing quote,
+// or length + 1 if the string is unterminated.
+static size_t skipString(const char* json, size_t length, size_t pos) {
+  for (size_t i = pos + 1; i < length; i++) {
+    if (json[i] == '\\') {
+      i++;
+    } else if (json[i] == '"') {
+      return i + 1;
+    }
+  }
+  return length + 1;
+}
+
+// Copy a non-string value into a NUL-terminated buffer for strtol/strtod
+static bool copyNumber(const JsonValue& value, char* out, size_t outSize) {
+  if (value.isString || value.length == 0 || value.length >= outSize) {
+    return false;
+  }
+  memcpy(out, value.start, value.length);
+  out[value.length] = '\0';
+  return true;
+}
+
+// ============================================================================
+// PUBLIC API
+// ============================================================================
+
+bool jsonFind(const char* json, size_t length, const char* key, JsonValue& value) {
+  size_t keyLength = strlen(key);
+  size_t pos = 0;
+
+  while (pos < length) {
+    if (json[pos] != '"') {
+      pos++;
+      continue;
+    }
+
+    size_t tokenStart = pos + 1;
+    size_t tokenEnd = skipString(json, length, pos);
+    if (tokenEnd > length) {
+      return false;
+    }
+    size_t tokenLength = tokenEnd - tokenStart - 1;
+
+    pos = skipWhitespace(json, length, tokenEnd);
+    if (pos >= length || json[pos] != ':') {
+      continue;  // A value, not a key
+    }
+    pos++;
+    if (tokenLength != keyLength || memcmp(json + tokenStart, key, keyLength) != 0) {
+      continue;
+    }
+
+    pos = skipWhitespace(json, length, pos);
+    if (pos >= length) {
+      return false;
+    }
+
+    if (json[pos] == '"') {
+      size_t end = skipString(json, length, pos);
+      if (end > length) {
+        return false;
+      }
+      value.start = json + pos + 1;
+      value.length = end - pos - 2;
+      value.isString = true;
+    } else {
+      size_t end = pos;
+      while (end < length && json[end] != ',' && json[end] != '}' && json[end] != ']' && !isJsonWhitespace(json[end])) {
+        end++;
+      }
+      value.start = json + pos;
+      value.length = end - pos;
+      value.isString = false;
+    }
+    return true;
+  }
+
+  return false;
+}
+
+bool jsonValueEquals(const JsonValue& value, const char* text) {
+  size_t textLength = strlen(text);
+  return value.length == textLength && memcmp(value.start, text, textLength) == 0;
+}
+
+bool jsonGetString(const char* json, size_t length, const char* key, char* out, size_t outSize) {
+  JsonValue value;
+  if (!jsonFind(json, length, key, value) || !value.isString || value.length >= outSize) {
+    return false;
+  }
+  memcpy(out, value.start, value.length);
+  out[value.length] = '\0';
+  return true;
+}
+
+bool jsonGetLong(const char* json, size_t length, const char* key, long* value) {
+  JsonValue found;
+  char number[JSON_NUMBER_MAX_LENGTH];
+  if (!jsonFind(json, length, key, found) || !copyNumber(found, number, sizeof(number))) {
+    return false;
+  }
+  char* end;
+  long parsed = strtol(number, &end, 10);
+  if (*end != '\0') {
+    return false;
+  }
+  *value = parsed;
+  return true;
+}
+
+bool jsonGetFloat(const char* json, size_t length, const char* key, float* value) {
+  JsonValue found;
+  char number[JSON_NUMBER_MAX_LENGTH];
+  if (!jsonFind(json, length, key, found) || !copyNumber(found, number, sizeof(number))) {
+    return false;
+  }
+  // strtod would also take "nan"/"inf", which aren't JSON
+  char first = (number[0] == '-' || number[0] == '+') ? number[1] : number[0];
+  if (first < '0' || first > '9') {
+    return false;
+  }
+  char* end;
+  double parsed = strtod(number, &end);
+  if (*end != '\0') {
+    return false;
+  }
+  *value = (float)parsed;
+  return true;
+}
+
+bool jsonGetBool(const char* json, size_t length, const char* key, bool* value) {
+  JsonValue found;
+  if (!jsonFind(json, length, key, found) || found.isString) {
+    return false;
+  }
+  if (jsonValueEquals(found, "true")) {
+    *value = true;
+    return true;
+  }
+  if (jsonValueEquals(found, "false")) {
+    *value = false;
+    return true;
+  }
+  return false;
+}
@@ -0,0 +1,27 @@
+#ifndef JSON_SCAN_H
+#define JSON_SCAN_H
+
+#include <Arduino.h>
+
+// Value of one "key": pair, pointing into the scanned buffer
+struct JsonValue {
+  const char* start;   // First character (inside the quotes for strings)
+  uint16_t length;
+  bool isString;       // Quoted string; escapes are left as-is
+};
+
+// Find the value of `key` in a JSON object of `length` bytes (need not be
+// NUL-terminated). Keys inside string values never match.
+bool jsonFind(const char* json, size_t length, const char* key, JsonValue& value);
+
+// True if the value is exactly `text`
+bool jsonValueEquals(const JsonValue& value, const char* text);
+
+// Typed lookups - false if the key is missing or its value has the wrong
+// type. Strings that don't fit `outSize` (including the NUL) are rejected.
+bool jsonGetString(const char* json, size_t length, const char* key, char* out, size_t outSize);
+bool jsonGetLong(const char* json, size_t length, const char* key, long* value);
+bool jsonGetFloat(const char* json, size_t length, const char* key, float* value);
+bool jsonGetBool(const char* json, size_t length, const char* key, bool* value);
+
+#endif
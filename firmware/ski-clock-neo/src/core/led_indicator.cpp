@@ -1,5 +1,5 @@
 // ============================================================================
-// led_indicator.cpp - Status LED control using hardware interrupts
+// led_indicator.cpp - Status LED control with hardware-generated patterns
 // ============================================================================
 // This library manages the onboard LED to indicate connectivity status:
 // - 1 flash = WiFi + MQTT connected (healthy)
@@ -7,8 +7,18 @@
 // - 3 flashes = WiFi disconnected
 // - Quick flashing = OTA update in progress
 //
-// Uses hardware timers (ESP32 Timer0 / ESP8266 Timer1) for freeze-proof
-// operation even during blocking network operations.
+// Flashes are 100 ms on / 100 ms off, and each pattern repeats every 2 s.
+// Nothing runs on a fixed tick; the CPU only steps in where the hardware
+// can't carry the whole pattern:
+// - ESP32: an LEDC channel generates the 5 Hz flash train. OTA lets it run
+//   free; the others gate it with one esp_timer (esp_timer task), at the
+//   start of each burst and after the last flash - two wakes per 2 s cycle.
+//   The gate timer and the LEDC channel are only touched with ledMutex held,
+//   by setLedPattern() (any task) or the gate callback
+// - ESP8266: the pattern is precomputed as a waveform (edge durations) and
+//   a Ticker is armed for the next edge only. Ticker runs in SDK task
+//   context, so no ISR can land in the middle of the WS2812 bit-banging,
+//   and Timer1 is left free
 // ============================================================================
 
 // ============================================================================
@@ -17,20 +27,52 @@
 
 #include "led_indicator.h"  // This file's header
 
-#if defined(ESP8266)
-  extern "C" {
-    #include "user_interface.h"
-  }
+#if defined(ESP32)
+  #include <driver/ledc.h>         // Hardware flash train
+  #include <esp_timer.h>           // Pattern gate
+  #include <freertos/FreeRTOS.h>   // Required before semphr.h
+  #include <freertos/semphr.h>     // ledMutex
+#elif defined(ESP8266)
+  #include <Ticker.h>              // Waveform edges
+#endif
+
+// ============================================================================
+// CONSTANTS
+// ============================================================================
+
+#define LED_FLASH_MS   100   // On time, and the gap between flashes
+#define LED_CYCLE_MS   2000  // Pattern period (flashes + pause)
+
+#if defined(ESP32)
+  // Timer 3 / channel 5 exist on every ESP32 variant and sit clear of the
+  // low numbers the Arduino ledc helpers hand out first
+  #define LED_LEDC_MODE       LEDC_LOW_SPEED_MODE
+  #define LED_LEDC_TIMER      LEDC_TIMER_3
+  #define LED_LEDC_CHANNEL    LEDC_CHANNEL_5
+  #define LED_LEDC_RESOLUTION LEDC_TIMER_14_BIT     // Lets 5 Hz divide down from APB
+  #define LED_LEDC_HALF       (1 << (LED_LEDC_RESOLUTION - 1))
+#elif defined(ESP8266)
+  #define LED_WAVEFORM_MAX_EDGES 6  // 3 flashes: on/off x3
 #endif
 
 // ============================================================================
 // STATE VARIABLES
 // ============================================================================
 
-// Hardware timer for LED updates
 #if defined(ESP32)
-  hw_timer_t *ledTimer = NULL;
-  portMUX_TYPE ledTimerMux = portMUX_INITIALIZER_UNLOCKED;
+  // setLedPattern() may run on any task (WiFi events, MQTT worker, OTA) while
+  // the gate fires on the esp_timer task. A mutex rather than a spinlock, as
+  // the LEDC driver and esp_timer calls take their own locks
+  static SemaphoreHandle_t ledMutex = NULL;
+  static esp_timer_handle_t ledGateTimer = NULL;
+  static bool ledcReady = false;
+  static bool ledBurstActive = false;  // Flash train running (gate open)
+  static int64_t ledCycleStartUs = 0;  // When the current pattern's first burst began
+#elif defined(ESP8266)
+  static Ticker ledTicker;
+  static uint16_t ledWaveform[LED_WAVEFORM_MAX_EDGES];  // Edge durations (ms), first edge LED on
+  static uint8_t ledWaveformLength = 0;
+  static uint8_t ledWaveformIndex = 0;
 #endif
 
 // Connectivity state tracking
@@ -40,101 +82,107 @@ ConnectivityState currentConnectivity = {false, false};
 bool ledOverrideActive = false;
 LedPattern ledOverridePattern = LED_OFF;
 
-// Current pattern and state (volatile for interrupt safety)
+// Current pattern (volatile - read from the Ticker context)
 volatile LedPattern currentPattern = LED_OFF;
-volatile uint8_t flashCount = 0;
-volatile bool ledState = false;
 
 // ============================================================================
-// HARDWARE TIMER CALLBACK
+// PATTERN HELPERS
 // ============================================================================
 
-// LED update callback - called by hardware interrupt timer every 100ms
-// IRAM_ATTR ensures function is in RAM for ESP32/ESP8266 interrupt execution
-void IRAM_ATTR ledTimerCallback() {
-  #if defined(ESP32)
-    portENTER_CRITICAL_ISR(&ledTimerMux);
-  #endif
-  
-  switch (currentPattern) {
-    case LED_OTA_PROGRESS:
-      // Quick flashing (100ms on/off) during OTA
-      ledState = !ledState;
-      if (ledState) {
-        ledOn();
-      } else {
-        ledOff();
-      }
-      break;
-      
-    case LED_CONNECTED:
-      // 1 quick flash followed by 2 second pause
-      if (flashCount == 0) {
-        ledOn();
-        flashCount = 1;
-      } else if (flashCount == 1) {
-        ledOff();
-        flashCount = 2;
-      } else {
-        flashCount++;
-        if (flashCount >= 20) {  // 20 * 100ms = 2 seconds
-          flashCount = 0;
-        }
-      }
-      break;
-
-    case LED_MQTT_DISCONNECTED:
-      // 2 quick flashes followed by 2 second pause
-      if (flashCount < 4) {
-        ledState = (flashCount % 2 == 0);
-        if (ledState) {
-          ledOn();
-        } else {
-          ledOff();
-        }
-        flashCount++;
-      } else {
-        flashCount++;
-        if (flashCount >= 20) {
-          flashCount = 0;
-        }
-      }
-      break;
-    
-    case LED_WIFI_DISCONNECTED:
-      // 3 quick flashes followed by 2 second pause
-      if (flashCount < 6) {
-        ledState = (flashCount % 2 == 0);
-        if (ledState) {
-          ledOn();
-        } else {
-          ledOff();
-        }
-        flashCount++;
-      } else {
-        flashCount++;
-        if (flashCount >= 20) {
-          flashCount = 0;
-        }
-      }
-      break;
-      
+// Flashes per cycle (0 = off, 255 = continuous)
+static uint8_t patternFlashes(LedPattern pattern) {
+  switch (pattern) {
+    case LED_OTA_PROGRESS:      return 255;
+    case LED_CONNECTED:         return 1;
+    case LED_MQTT_DISCONNECTED: return 2;
+    case LED_WIFI_DISCONNECTED: return 3;
     case LED_OFF:
-    default:
-      ledOff();
-      break;
+    default:                    return 0;
+  }
+}
+
+#if defined(ESP32)
+// Start the 5 Hz train from its "on" half (timer reset to period start)
+static void startFlashTrain() {
+  // LEDC drives the pin high from hpoint for duty ticks; with an active-low
+  // LED the high half goes second so each period starts with the LED on
+  uint32_t hpoint = (LED_GPIO_ON == LOW) ? LED_LEDC_HALF : 0;
+  ledc_set_duty_with_hpoint(LED_LEDC_MODE, LED_LEDC_CHANNEL, LED_LEDC_HALF, hpoint);
+  ledc_update_duty(LED_LEDC_MODE, LED_LEDC_CHANNEL);
+  ledc_timer_rst(LED_LEDC_MODE, LED_LEDC_TIMER);
+}
+
+static void stopFlashTrain() {
+  ledc_stop(LED_LEDC_MODE, LED_LEDC_CHANNEL, LED_GPIO_OFF);
+}
+
+// Open or close the gate for where the cycle is now, and arm for the next
+// change (caller holds ledMutex). Worked out from the cycle start rather than
+// toggled, so a callback that lost the race with setLedPattern() only re-arms
+// the same deadline
+static void updateLedGate() {
+  uint8_t flashes = patternFlashes(currentPattern);
+  if (flashes == 0 || flashes == 255) {
+    return;  // Not gated
   }
   
-  #if defined(ESP32)
-    portEXIT_CRITICAL_ISR(&ledTimerMux);
-  #endif
+  // Close halfway through the last "off" half so the edge isn't raced
+  uint32_t burstUs = (flashes * 2 * LED_FLASH_MS - LED_FLASH_MS / 2) * 1000UL;
+  uint32_t cycleUs = LED_CYCLE_MS * 1000UL;
+  uint32_t phaseUs = (uint32_t)((esp_timer_get_time() - ledCycleStartUs) % cycleUs);
+  bool open = phaseUs < burstUs;
+  if (open && !ledBurstActive) {
+    startFlashTrain();
+  } else if (!open && ledBurstActive) {
+    stopFlashTrain();
+  }
+  ledBurstActive = open;
+  
+  esp_timer_stop(ledGateTimer);  // Not armed is fine
+  esp_timer_start_once(ledGateTimer, open ? burstUs - phaseUs : cycleUs - phaseUs);
+}
+
+// Gate timer callback (esp_timer task)
+static void ledGateCallback(void*) {
+  xSemaphoreTake(ledMutex, portMAX_DELAY);
+  updateLedGate();
+  xSemaphoreGive(ledMutex);
+}
+#elif defined(ESP8266)
+// Precompute the edge durations for a pattern (LED on at even indices)
+static void buildWaveform(LedPattern pattern) {
+  uint8_t flashes = patternFlashes(pattern);
+  ledWaveformLength = 0;
+  ledWaveformIndex = 0;
+  if (flashes == 0) {
+    return;
+  }
+  if (flashes == 255) {
+    ledWaveform[ledWaveformLength++] = LED_FLASH_MS;
+    ledWaveform[ledWaveformLength++] = LED_FLASH_MS;
+    return;
+  }
+  for (uint8_t i = 0; i < flashes; i++) {
+    ledWaveform[ledWaveformLength++] = LED_FLASH_MS;
+    ledWaveform[ledWaveformLength++] = LED_FLASH_MS;
+  }
+  // Last gap stretches to the end of the cycle
+  ledWaveform[ledWaveformLength - 1] = LED_CYCLE_MS - (2 * flashes - 1) * LED_FLASH_MS;
 }
 
-// ESP8266 Timer1 ISR wrapper
-#if defined(ESP8266)
-void ICACHE_RAM_ATTR onTimer1ISR() {
-  ledTimerCallback();
-  timer1_write(500000);  // Reset timer for next interrupt (100ms at 5MHz)
+// Ticker callback: take the next edge and arm for the one after
+static void ledEdgeCallback() {
+  if (ledWaveformLength == 0) {
+    return;
+  }
+  if (ledWaveformIndex % 2 == 0) {
+    ledOn();
+  } else {
+    ledOff();
+  }
+  uint16_t durationMs = ledWaveform[ledWaveformIndex];
+  ledWaveformIndex = (ledWaveformIndex + 1) % ledWaveformLength;
+  ledTicker.once_ms(durationMs, ledEdgeCallback);
 }
 #endif
 
@@ -149,35 +197,43 @@ void initLedIndicator() {
   DEBUG_PRINT("LED indicator initialized on GPIO");
   DEBUG_PRINTLN(LED_PIN);
   
-  // Initialize hardware timer
   #if defined(ESP32)
-    // ESP32 Arduino Core 3.x changed the timer API significantly
-    // Core 3.x: timerBegin(frequency), timerAlarm(timer, us, reload, count)
-    // Core 2.x: timerBegin(num, divider, countUp), timerAlarmWrite(), timerAlarmEnable()
-    #if ESP_ARDUINO_VERSION_MAJOR >= 3
-      // ESP32 Arduino Core 3.x API
-      ledTimer = timerBegin(1000000);  // 1MHz timer frequency
-      timerAttachInterrupt(ledTimer, &ledTimerCallback);
-      timerAlarm(ledTimer, 100000, true, 0);  // 100000us = 100ms, auto-reload, unlimited
-      DEBUG_PRINTLN("ESP32 hardware timer initialized (Core 3.x, 100ms interval)");
-    #else
-      // ESP32 Arduino Core 2.x API
-      ledTimer = timerBegin(0, 80, true);  // Timer 0, divider 80 (1MHz)
-      timerAttachInterrupt(ledTimer, &ledTimerCallback, true);
-      timerAlarmWrite(ledTimer, 100000, true);  // 100ms interval
-      timerAlarmEnable(ledTimer);
-      DEBUG_PRINTLN("ESP32 hardware timer initialized (Core 2.x, 100ms interval)");
-    #endif
-    
+    // 5 Hz, 50% - one flash per period; APB clock keeps the divider exact
+    ledc_timer_config_t timerConfig = {};
+    timerConfig.speed_mode = LED_LEDC_MODE;
+    timerConfig.duty_resolution = LED_LEDC_RESOLUTION;
+    timerConfig.timer_num = LED_LEDC_TIMER;
+    timerConfig.freq_hz = 1000 / (2 * LED_FLASH_MS);
+    timerConfig.clk_cfg = LEDC_USE_APB_CLK;
+  
+    ledc_channel_config_t channelConfig = {};
+    channelConfig.gpio_num = LED_PIN;
+    channelConfig.speed_mode = LED_LEDC_MODE;
+    channelConfig.channel = LED_LEDC_CHANNEL;
+    channelConfig.timer_sel = LED_LEDC_TIMER;
+    channelConfig.duty = 0;
+    channelConfig.hpoint = 0;
+  
+    esp_timer_create_args_t gateArgs = {};
+    gateArgs.callback = ledGateCallback;
+    gateArgs.dispatch_method = ESP_TIMER_TASK;
+    gateArgs.name = "led_gate";
+  
+    ledMutex = xSemaphoreCreateMutex();
+    ledcReady = ledMutex != NULL &&
+                ledc_timer_config(&timerConfig) == ESP_OK &&
+                ledc_channel_config(&channelConfig) == ESP_OK &&
+                esp_timer_create(&gateArgs, &ledGateTimer) == ESP_OK;
+    if (ledcReady) {
+      stopFlashTrain();
+      DEBUG_PRINTLN("ESP32 LEDC status LED initialized (5Hz flash train)");
+    } else {
+      DEBUG_PRINTLN("ERROR: LEDC setup failed, status LED disabled");
+    }
   #elif defined(ESP8266)
-    // ESP8266: Use Timer1 (hardware timer)
-    timer1_isr_init();
-    timer1_attachInterrupt(onTimer1ISR);
-    timer1_enable(TIM_DIV16, TIM_EDGE, TIM_LOOP);  // 5MHz tick rate
-    timer1_write(500000);  // 100ms at 5MHz
-    DEBUG_PRINTLN("ESP8266 Timer1 initialized (100ms interval)");
+    DEBUG_PRINTLN("ESP8266 status LED waveform initialized (Ticker edges)");
   #endif
-
+  
   // Start with "disconnected" status
   setLedPattern(LED_WIFI_DISCONNECTED);
 }
@@ -188,45 +244,40 @@ void initLedIndicator() {
 
 // Internal function to set LED pattern
 void setLedPattern(LedPattern pattern) {
-  if (pattern == currentPattern) {
-    return;
-  }
-  
   #if defined(ESP32)
-    // Stop current timer
-    #if ESP_ARDUINO_VERSION_MAJOR >= 3
-      timerStop(ledTimer);
-    #else
-      timerAlarmDisable(ledTimer);
-    #endif
-    
-    // Reset state (use critical section for volatile variables)
-    portENTER_CRITICAL(&ledTimerMux);
-    flashCount = 0;
-    ledState = false;
-    currentPattern = pattern;
-    portEXIT_CRITICAL(&ledTimerMux);
-    
-    ledOff();
-    
-    // Start new pattern
-    if (pattern != LED_OFF) {
-      #if ESP_ARDUINO_VERSION_MAJOR >= 3
-        timerStart(ledTimer);
-      #else
-        timerAlarmEnable(ledTimer);
-      #endif
+    if (!ledcReady) {
+      currentPattern = pattern;
+      return;
+    }
+  
+    xSemaphoreTake(ledMutex, portMAX_DELAY);
+    if (pattern != currentPattern) {
+      esp_timer_stop(ledGateTimer);  // Not armed is fine
+      currentPattern = pattern;
+      ledBurstActive = false;
+      uint8_t flashes = patternFlashes(pattern);
+      if (flashes == 0) {
+        stopFlashTrain();
+      } else if (flashes == 255) {
+        startFlashTrain();  // OTA runs free from here
+      } else {
+        ledCycleStartUs = esp_timer_get_time();
+        updateLedGate();  // First burst starts now
+      }
     }
-    
+    xSemaphoreGive(ledMutex);
+  
   #elif defined(ESP8266)
-    // ESP8266: Timer1 is always running, just update the pattern
-    noInterrupts();
-    flashCount = 0;
-    ledState = false;
+    if (pattern == currentPattern) {
+      return;
+    }
+  
+    // Ticker runs in the same SDK context as loop(), so no lock is needed
+    ledTicker.detach();
     currentPattern = pattern;
-    interrupts();
-    
+    buildWaveform(pattern);
     ledOff();
+    ledEdgeCallback();
   #endif
 }
 
@@ -34,7 +34,7 @@ enum LedPattern {
   #define LED_GPIO_OFF LOW
 #endif
 
-// Direct port manipulation for fast GPIO operations in interrupt context
+// Direct port manipulation for fast GPIO operations
 #if defined(ESP8266)
   #include <esp8266_peri.h>
   #define FAST_PIN_HIGH(pin) GPOS = (1 << (pin))
@@ -98,17 +98,10 @@ struct ConnectivityState {
 };
 
 // External variable declarations (definitions in led_indicator.cpp)
-#if defined(ESP32)
-  extern hw_timer_t *ledTimer;
-  extern portMUX_TYPE ledTimerMux;
-#endif
-
 extern ConnectivityState currentConnectivity;
 extern bool ledOverrideActive;
 extern LedPattern ledOverridePattern;
 extern volatile LedPattern currentPattern;
-extern volatile uint8_t flashCount;
-extern volatile bool ledState;
 
 // Function declarations
 void initLedIndicator();
@@ -118,10 +111,4 @@ void setConnectivityState(bool wifiConnected, bool mqttConnected);
 void beginLedOverride(LedPattern pattern);
 void endLedOverride();
 
-// ISR callbacks (declared but not exposed as public API)
-void IRAM_ATTR ledTimerCallback();
-#if defined(ESP8266)
-  void ICACHE_RAM_ATTR onTimer1ISR();
-#endif
-
 #endif
@@ -2,12 +2,17 @@
 // timer_helpers.cpp - Unified timer abstraction for ESP32 and ESP8266
 // ============================================================================
 // This library provides a consistent timer API across platforms:
-// - ESP32: Uses FreeRTOS tasks with vTaskDelayUntil for periodic timers
-// - ESP8266: Uses TickTwo library for non-blocking timer callbacks
+// - ESP32: One scheduler task runs every timer from a min-heap of deadlines,
+//   sleeping until the earliest is due (or until a timer is added/changed)
+// - ESP8266: The same deadline heap, dispatched from loop() by updateTimers();
+//   a pass returns after one comparison when nothing is due
 // 
 // Features:
 // - Periodic timers via createTimer()
-// - One-shot timers via createOneShotTimer() and triggerTimer()
+// - Per-timer FreeRTOS tasks via createDedicatedTimer() (ESP32, opt-in)
+// - One-shot timers via createOneShotTimer() and triggerTimer(), optionally
+//   with a per-trigger delay
+// - Per-timer dispatch lateness and run-time statistics via getTimerStats()
 // - Notification-based tasks via createNotificationTask() (ESP32 only)
 // - Zero runtime overhead (inline wrappers in header)
 // ============================================================================
@@ -17,6 +22,47 @@
 // ============================================================================
 
 #include "timer_helpers.h"  // This file's header
+#include "event_log.h"      // For reporting allocation failures
+
+// ============================================================================
+// PLATFORM-SPECIFIC MACROS
+// ============================================================================
+
+#if defined(ESP32)
+  // Heap is shared between the scheduler task and callers on other tasks
+  #define TIMER_ENTER_CRITICAL() portENTER_CRITICAL(&schedulerMux)
+  #define TIMER_EXIT_CRITICAL() portEXIT_CRITICAL(&schedulerMux)
+#else
+  // ESP8266 timers are only touched from loop() context
+  #define TIMER_ENTER_CRITICAL()
+  #define TIMER_EXIT_CRITICAL()
+#endif
+
+// Current scheduler time and interval in scheduler units
+static inline TimerTime timerNow() {
+  #if defined(ESP32)
+    return xTaskGetTickCount();
+  #else
+    return millis();
+  #endif
+}
+
+static inline TimerTime intervalTicks(uint32_t intervalMs) {
+  #if defined(ESP32)
+    TickType_t ticks = pdMS_TO_TICKS(intervalMs);
+    return ticks > 0 ? ticks : 1;
+  #else
+    return intervalMs;
+  #endif
+}
+
+static inline uint32_t timerUnitsToUs(TimerTime units) {
+  #if defined(ESP32)
+    return units * portTICK_PERIOD_MS * 1000UL;
+  #else
+    return units * 1000UL;
+  #endif
+}
 
 // ============================================================================
 // SINGLETON INSTANCE
@@ -32,18 +78,26 @@ TimerTaskManager& TimerTaskManager::getInstance() {
 // CONSTRUCTOR
 // ============================================================================
 
-TimerTaskManager::TimerTaskManager() : timerCount(0) {
+TimerTaskManager::TimerTaskManager() : timerCount(0), heapSize(0) {
+  #if defined(ESP32)
+    schedulerHandle = nullptr;
+    schedulerStackSize = 0;
+    schedulerMux = portMUX_INITIALIZER_UNLOCKED;
+  #endif
+  
   // Initialize all timer slots to inactive
   for (uint8_t i = 0; i < MAX_TIMERS; i++) {
     timers[i].isActive = false;
     timers[i].isOneShot = false;
     timers[i].name = nullptr;
     timers[i].callback = nullptr;
+    timers[i].nextDue = 0;
+    timers[i].heapPos = TIMER_NOT_SCHEDULED;
+    resetTimingStat(timers[i].lateness);
+    resetTimingStat(timers[i].runtime);
     #if defined(ESP32)
+      timers[i].dedicatedTask = false;
       timers[i].taskHandle = nullptr;
-      timers[i].espTicker = nullptr;
-    #elif defined(ESP8266)
-      timers[i].ticker = nullptr;
     #endif
   }
 }
@@ -62,12 +116,212 @@ TimerConfig* TimerTaskManager::findTimer(const char* name) {
   return nullptr;
 }
 
+// Find a timer's slot for reuse (cleaned up) or claim a new one
+TimerConfig* TimerTaskManager::allocateTimer(const char* name) {
+  TimerConfig* config = findTimer(name);
+  if (config != nullptr) {
+    // Fully clean up existing timer first
+    cleanupTimerConfig(config);
+    DEBUG_PRINT("Reusing timer slot: ");
+    DEBUG_PRINTLN(name);
+  } else {
+    if (timerCount >= MAX_TIMERS) {
+      // Reported to the dashboard too - a missing timer silently disables a feature
+      DEBUG_PRINT("ERROR: Maximum timer count reached, not created: ");
+      DEBUG_PRINTLN(name);
+      logEvent(EVT_TIMER_ALLOC_FAILED, name, (unsigned int)MAX_TIMERS);
+      return nullptr;
+    }
+    config = &timers[timerCount++];
+  }
+  
+  resetTimingStat(config->lateness);
+  resetTimingStat(config->runtime);
+  return config;
+}
+
+// Record one dispatch of a timer
+void TimerTaskManager::recordDispatch(TimerConfig* config, TimerTime late, uint32_t runUs) {
+  TIMER_ENTER_CRITICAL();
+  recordTiming(config->lateness, timerUnitsToUs(late));
+  recordTiming(config->runtime, runUs);
+  TIMER_EXIT_CRITICAL();
+}
+
 // ============================================================================
-// ESP32 TASK WRAPPER
+// DEADLINE HEAP
+// ============================================================================
+// Binary min-heap over timer slot indices keyed by nextDue. Deadlines are
+// compared as a signed difference so tick/millis wraparound is harmless.
+// On ESP32 all functions here require schedulerMux to be held.
+// ============================================================================
+
+bool TimerTaskManager::heapLess(uint8_t a, uint8_t b) {
+  return (int32_t)(timers[deadlineHeap[a]].nextDue - timers[deadlineHeap[b]].nextDue) < 0;
+}
+
+void TimerTaskManager::heapSwap(uint8_t a, uint8_t b) {
+  uint8_t slot = deadlineHeap[a];
+  deadlineHeap[a] = deadlineHeap[b];
+  deadlineHeap[b] = slot;
+  timers[deadlineHeap[a]].heapPos = a;
+  timers[deadlineHeap[b]].heapPos = b;
+}
+
+void TimerTaskManager::siftUp(uint8_t pos) {
+  while (pos > 0) {
+    uint8_t parent = (pos - 1) / 2;
+    if (!heapLess(pos, parent)) break;
+    heapSwap(pos, parent);
+    pos = parent;
+  }
+}
+
+void TimerTaskManager::siftDown(uint8_t pos) {
+  for (;;) {
+    uint8_t smallest = pos;
+    uint8_t left = 2 * pos + 1;
+    uint8_t right = left + 1;
+    if (left < heapSize && heapLess(left, smallest)) smallest = left;
+    if (right < heapSize && heapLess(right, smallest)) smallest = right;
+    if (smallest == pos) break;
+    heapSwap(pos, smallest);
+    pos = smallest;
+  }
+}
+
+// Insert a timer, or move it if already scheduled
+void TimerTaskManager::scheduleTimer(TimerConfig* config, TimerTime due) {
+  config->nextDue = due;
+  if (config->heapPos == TIMER_NOT_SCHEDULED) {
+    config->heapPos = heapSize;
+    deadlineHeap[heapSize++] = (uint8_t)(config - timers);
+  }
+  siftUp(config->heapPos);
+  siftDown(config->heapPos);
+}
+
+void TimerTaskManager::unscheduleTimer(TimerConfig* config) {
+  uint8_t pos = config->heapPos;
+  if (pos == TIMER_NOT_SCHEDULED) return;
+  
+  config->heapPos = TIMER_NOT_SCHEDULED;
+  heapSize--;
+  if (pos == heapSize) return;
+  
+  // Move the last entry into the hole and restore heap order
+  deadlineHeap[pos] = deadlineHeap[heapSize];
+  timers[deadlineHeap[pos]].heapPos = pos;
+  siftUp(pos);
+  siftDown(pos);
+}
+
+// ============================================================================
+// ESP32 SCHEDULER TASK
 // ============================================================================
 
 #if defined(ESP32)
-// FreeRTOS task wrapper for periodic timers
+// Runs due callbacks in deadline order, then sleeps until the next deadline.
+// Any change to the heap from another context wakes it via wakeScheduler().
+void TimerTaskManager::schedulerTask(void* parameter) {
+  TimerTaskManager* self = static_cast<TimerTaskManager*>(parameter);
+  
+  DEBUG_PRINTLN("Timer scheduler task started");
+  
+  for (;;) {
+    TimerCallback callback = nullptr;
+    TimerConfig* due = nullptr;
+    TickType_t late = 0;
+    TickType_t wait = portMAX_DELAY;
+    
+    portENTER_CRITICAL(&self->schedulerMux);
+    if (self->heapSize > 0) {
+      TimerConfig* next = &self->timers[self->deadlineHeap[0]];
+      TimerTime now = timerNow();
+      int32_t remaining = (int32_t)(next->nextDue - now);
+      
+      if (remaining <= 0) {
+        callback = next->callback;
+        due = next;
+        late = (TickType_t)(-remaining);
+        if (next->isOneShot) {
+          self->unscheduleTimer(next);
+          next->isActive = false;
+        } else {
+          // Keep the phase, but skip ticks missed during a stall instead of bursting
+          TimerTime nextDue = next->nextDue + intervalTicks(next->intervalMs);
+          if ((int32_t)(nextDue - now) <= 0) {
+            nextDue = now + intervalTicks(next->intervalMs);
+          }
+          self->scheduleTimer(next, nextDue);
+        }
+      } else {
+        wait = remaining;
+      }
+    }
+    portEXIT_CRITICAL(&self->schedulerMux);
+    
+    if (callback != nullptr) {
+      uint32_t start = micros();
+      callback();
+      self->recordDispatch(due, late, micros() - start);
+    } else {
+      ulTaskNotifyTake(pdTRUE, wait);
+    }
+  }
+}
+
+// Start the scheduler task on first use
+bool TimerTaskManager::ensureScheduler(uint16_t stackSize) {
+  if (schedulerHandle != nullptr) {
+    return true;
+  }
+  
+  uint16_t schedulerStack = stackSize > TIMER_SCHEDULER_STACK_SIZE ? stackSize : TIMER_SCHEDULER_STACK_SIZE;
+  
+  #if defined(CONFIG_IDF_TARGET_ESP32C3)
+    // ESP32-C3: Single-core RISC-V, use xTaskCreate
+    xTaskCreate(
+      schedulerTask,
+      "Timers",
+      schedulerStack,
+      this,
+      TIMER_SCHEDULER_PRIORITY,
+      &schedulerHandle
+    );
+  #else
+    // ESP32/ESP32-S3: Dual-core Xtensa, pin to Core 1
+    xTaskCreatePinnedToCore(
+      schedulerTask,
+      "Timers",
+      schedulerStack,
+      this,
+      TIMER_SCHEDULER_PRIORITY,
+      &schedulerHandle,
+      1
+    );
+  #endif
+  
+  if (schedulerHandle == nullptr) {
+    DEBUG_PRINTLN("ERROR: Failed to create timer scheduler task");
+    return false;
+  }
+  schedulerStackSize = schedulerStack;
+  return true;
+}
+
+// Make the scheduler re-read the heap (no-op when called from the scheduler itself)
+void TimerTaskManager::wakeScheduler() {
+  if (schedulerHandle != nullptr && xTaskGetCurrentTaskHandle() != schedulerHandle) {
+    xTaskNotifyGive(schedulerHandle);
+  }
+}
+
+// ============================================================================
+// ESP32 TASK WRAPPER
+// ============================================================================
+
+// FreeRTOS task wrapper for dedicated periodic timers
 void TimerTaskManager::taskWrapper(void* parameter) {
   TimerConfig* config = static_cast<TimerConfig*>(parameter);
   
@@ -80,10 +334,40 @@ void TimerTaskManager::taskWrapper(void* parameter) {
   for(;;) {
     vTaskDelayUntil(&lastWakeTime, interval);
     if (config->callback != nullptr) {
+      TickType_t late = xTaskGetTickCount() - lastWakeTime;
+      uint32_t start = micros();
       config->callback();
+      getInstance().recordDispatch(config, late, micros() - start);
     }
   }
 }
+
+// Create the FreeRTOS task for a dedicated timer
+bool TimerTaskManager::startDedicatedTask(TimerConfig* config) {
+  #if defined(CONFIG_IDF_TARGET_ESP32C3)
+    // ESP32-C3: Single-core RISC-V, use xTaskCreate
+    xTaskCreate(
+      taskWrapper,
+      config->name,
+      config->stackSize,
+      config,
+      2,
+      &config->taskHandle
+    );
+  #else
+    // ESP32/ESP32-S3: Dual-core Xtensa, pin to Core 1
+    xTaskCreatePinnedToCore(
+      taskWrapper,
+      config->name,
+      config->stackSize,
+      config,
+      2,
+      &config->taskHandle,
+      1
+    );
+  #endif
+  return config->taskHandle != nullptr;
+}
 #endif
 
 // ============================================================================
@@ -99,87 +383,85 @@ void TimerTaskManager::cleanupTimerConfig(TimerConfig* config) {
       vTaskDelete(config->taskHandle);
       config->taskHandle = nullptr;
     }
-    if (config->espTicker != nullptr) {
-      config->espTicker->detach();
-      delete config->espTicker;
-      config->espTicker = nullptr;
-    }
-  #elif defined(ESP8266)
-    if (config->ticker != nullptr) {
-      config->ticker->stop();
-      delete config->ticker;
-      config->ticker = nullptr;
-    }
   #endif
   
+  TIMER_ENTER_CRITICAL();
+  unscheduleTimer(config);
   config->isActive = false;
+  TIMER_EXIT_CRITICAL();
 }
 
 // Create a periodic timer that fires at regular intervals
 bool TimerTaskManager::createTimer(const char* name, uint32_t intervalMs, TimerCallback callback, uint16_t stackSize) {
+  return createPeriodicTimer(name, intervalMs, callback, stackSize, false);
+}
+
+// Create a periodic timer that runs in its own task (ESP32)
+bool TimerTaskManager::createDedicatedTimer(const char* name, uint32_t intervalMs, TimerCallback callback, uint16_t stackSize) {
+  return createPeriodicTimer(name, intervalMs, callback, stackSize, true);
+}
+
+bool TimerTaskManager::createPeriodicTimer(const char* name, uint32_t intervalMs, TimerCallback callback, uint16_t stackSize, bool dedicated) {
   if (callback == nullptr) {
     DEBUG_PRINTLN("ERROR: Timer callback is null");
     return false;
   }
   
-  // Check if timer with this name already exists - reuse the slot
-  TimerConfig* config = findTimer(name);
-  if (config != nullptr) {
-    // Fully clean up existing timer first
-    cleanupTimerConfig(config);
-    DEBUG_PRINT("Reusing timer slot: ");
-    DEBUG_PRINTLN(name);
-  } else {
-    // Need a new slot
-    if (timerCount >= MAX_TIMERS) {
-      DEBUG_PRINTLN("ERROR: Maximum timer count reached");
+  #if defined(ESP32)
+    // The scheduler stack is fixed once it runs - a callback that needs more
+    // gets its own task rather than overflowing the shared one
+    if (!dedicated && schedulerHandle != nullptr && stackSize > schedulerStackSize) {
+      DEBUG_PRINT("Timer stack request exceeds scheduler stack, using a dedicated task: ");
+      DEBUG_PRINTLN(name);
+      dedicated = true;
+    }
+    if (!dedicated && !ensureScheduler(stackSize)) {
       return false;
     }
-    config = &timers[timerCount];
-    timerCount++;
+  #endif
+  
+  // Reuse the slot of a timer with this name, or claim a new one
+  TimerConfig* config = allocateTimer(name);
+  if (config == nullptr) {
+    return false;
   }
   
   // Initialize all fields for periodic timer
   config->name = name;
   config->intervalMs = intervalMs;
-  config->callback = callback;
   config->stackSize = stackSize;
-  config->isActive = true;
   config->isOneShot = false;
   
   // Platform-specific timer creation
   #if defined(ESP32)
-    config->espTicker = nullptr;
     config->taskHandle = nullptr;
-    #if defined(CONFIG_IDF_TARGET_ESP32C3)
-      // ESP32-C3: Single-core RISC-V, use xTaskCreate
-      xTaskCreate(
-        taskWrapper,
-        name,
-        stackSize,
-        config,
-        2,
-        &config->taskHandle
-      );
-      DEBUG_PRINT("Timer created (ESP32-C3 FreeRTOS): ");
-    #else
-      // ESP32/ESP32-S3: Dual-core Xtensa, pin to Core 1
-      xTaskCreatePinnedToCore(
-        taskWrapper,
-        name,
-        stackSize,
-        config,
-        2,
-        &config->taskHandle,
-        1
-      );
-      DEBUG_PRINT("Timer created (ESP32 FreeRTOS, Core 1): ");
-    #endif
+    config->dedicatedTask = dedicated;
+    
+    if (dedicated) {
+      config->callback = callback;
+      config->isActive = true;
+      if (!startDedicatedTask(config)) {
+        DEBUG_PRINT("ERROR: Failed to create timer task: ");
+        DEBUG_PRINTLN(name);
+        config->isActive = false;
+        return false;
+      }
+      DEBUG_PRINT("Timer created (ESP32 dedicated task): ");
+    } else {
+      TIMER_ENTER_CRITICAL();
+      config->callback = callback;
+      config->isActive = true;
+      scheduleTimer(config, timerNow() + intervalTicks(intervalMs));
+      TIMER_EXIT_CRITICAL();
+      wakeScheduler();
+      DEBUG_PRINT("Timer created (ESP32 scheduler): ");
+    }
   #elif defined(ESP8266)
-    // ESP8266: Use TickTwo library
-    config->ticker = new TickTwo(callback, intervalMs, 0, MILLIS);
-    config->ticker->start();
-    DEBUG_PRINT("Timer created (ESP8266 TickTwo): ");
+    // ESP8266: Deadline heap dispatched from updateTimers()
+    config->callback = callback;
+    config->isActive = true;
+    scheduleTimer(config, timerNow() + intervalTicks(intervalMs));
+    DEBUG_PRINT("Timer created (ESP8266 scheduler): ");
   #endif
   
   DEBUG_PRINT(name);
@@ -201,21 +483,16 @@ bool TimerTaskManager::createOneShotTimer(const char* name, uint32_t intervalMs,
     return false;
   }
   
-  // Check if timer with this name already exists - reuse the slot
-  TimerConfig* config = findTimer(name);
-  if (config != nullptr) {
-    // Fully clean up existing timer first
-    cleanupTimerConfig(config);
-    DEBUG_PRINT("Reusing one-shot timer slot: ");
-    DEBUG_PRINTLN(name);
-  } else {
-    // Need a new slot
-    if (timerCount >= MAX_TIMERS) {
-      DEBUG_PRINTLN("ERROR: Maximum timer count reached");
+  #if defined(ESP32)
+    if (!ensureScheduler(0)) {
       return false;
     }
-    config = &timers[timerCount];
-    timerCount++;
+  #endif
+  
+  // Reuse the slot of a timer with this name, or claim a new one
+  TimerConfig* config = allocateTimer(name);
+  if (config == nullptr) {
+    return false;
   }
   
   // Initialize all fields for one-shot timer
@@ -229,9 +506,7 @@ bool TimerTaskManager::createOneShotTimer(const char* name, uint32_t intervalMs,
   // Platform-specific timer setup
   #if defined(ESP32)
     config->taskHandle = nullptr;
-    config->espTicker = new Ticker();
-  #elif defined(ESP8266)
-    config->ticker = new TickTwo(callback, intervalMs, 1, MILLIS);
+    config->dedicatedTask = false;
   #endif
   
   DEBUG_PRINT("One-shot timer registered: ");
@@ -249,6 +524,12 @@ bool TimerTaskManager::createOneShotTimer(const char* name, uint32_t intervalMs,
 
 // Trigger a previously registered one-shot timer
 bool TimerTaskManager::triggerTimer(const char* name) {
+  TimerConfig* config = findTimer(name);
+  return triggerTimer(name, config != nullptr ? config->intervalMs : 0);
+}
+
+// Trigger a one-shot timer with an explicit delay
+bool TimerTaskManager::triggerTimer(const char* name, uint32_t delayMs) {
   TimerConfig* config = findTimer(name);
   if (config == nullptr) {
     DEBUG_PRINT("ERROR: Timer not found: ");
@@ -262,20 +543,16 @@ bool TimerTaskManager::triggerTimer(const char* name) {
     return false;
   }
   
-  // Platform-specific trigger
+  // Schedule the callback (re-triggering restarts the delay)
+  TIMER_ENTER_CRITICAL();
+  scheduleTimer(config, timerNow() + intervalTicks(delayMs));
+  config->isActive = true;
+  TIMER_EXIT_CRITICAL();
   #if defined(ESP32)
-    if (config->espTicker != nullptr) {
-      config->espTicker->once_ms(config->intervalMs, config->callback);
-    }
-  #elif defined(ESP8266)
-    if (config->ticker != nullptr) {
-      config->ticker->start();
-    }
+    wakeScheduler();
   #endif
   
-  config->isActive = true;
-  DEBUG_PRINT("One-shot timer triggered: ");
-  DEBUG_PRINTLN(name);
+  // No logging here: the display triggers a render per text change
   return true;
 }
 
@@ -337,13 +614,35 @@ bool TimerTaskManager::notifyTask(TaskHandle_t taskHandle) {
 // ESP8266 UPDATE LOOP
 // ============================================================================
 
-// Update all TickTwo timers (ESP8266 only, call from main loop)
+// Run due timers (ESP8266 only, call from main loop)
+// Returns after one deadline comparison when nothing is due. A pass runs at
+// most MAX_TIMERS callbacks so a slow callback can't starve WiFi/MQTT.
 void TimerTaskManager::updateAll() {
   #if defined(ESP8266)
-    for (uint8_t i = 0; i < timerCount; i++) {
-      if (timers[i].isActive && timers[i].ticker != nullptr) {
-        timers[i].ticker->update();
+    for (uint8_t fired = 0; fired < MAX_TIMERS && heapSize > 0; fired++) {
+      TimerConfig* next = &timers[deadlineHeap[0]];
+      TimerTime now = timerNow();
+      if ((int32_t)(next->nextDue - now) > 0) {
+        return;
+      }
+      
+      TimerCallback callback = next->callback;
+      TimerTime late = now - next->nextDue;
+      if (next->isOneShot) {
+        unscheduleTimer(next);
+        next->isActive = false;
+      } else {
+        // Keep the phase, but skip ticks missed during a stall instead of bursting
+        TimerTime due = next->nextDue + intervalTicks(next->intervalMs);
+        if ((int32_t)(due - now) <= 0) {
+          due = now + intervalTicks(next->intervalMs);
+        }
+        scheduleTimer(next, due);
       }
+      
+      uint32_t start = micros();
+      callback();
+      recordDispatch(next, late, micros() - start);
     }
   #endif
 }
@@ -364,16 +663,12 @@ void TimerTaskManager::stopTimer(const char* name) {
       vTaskDelete(config->taskHandle);
       config->taskHandle = nullptr;
     }
-    if (config->espTicker != nullptr) {
-      config->espTicker->detach();
-    }
-  #elif defined(ESP8266)
-    if (config->ticker != nullptr) {
-      config->ticker->stop();
-    }
   #endif
   
+  TIMER_ENTER_CRITICAL();
+  unscheduleTimer(config);
   config->isActive = false;
+  TIMER_EXIT_CRITICAL();
   DEBUG_PRINT("Timer stopped: ");
   DEBUG_PRINTLN(name);
 }
@@ -393,44 +688,31 @@ bool TimerTaskManager::restartTimer(const char* name) {
     return false;
   }
   
+  bool dedicated = false;
   #if defined(ESP32)
-    // ESP32: Delete and recreate the FreeRTOS task to reset timing
-    if (config->taskHandle != nullptr) {
-      vTaskDelete(config->taskHandle);
-      config->taskHandle = nullptr;
-    }
-    
-    #if defined(CONFIG_IDF_TARGET_ESP32C3)
-      xTaskCreate(
-        taskWrapper,
-        name,
-        config->stackSize,
-        config,
-        2,
-        &config->taskHandle
-      );
-    #else
-      xTaskCreatePinnedToCore(
-        taskWrapper,
-        name,
-        config->stackSize,
-        config,
-        2,
-        &config->taskHandle,
-        1
-      );
-    #endif
-  #elif defined(ESP8266)
-    // ESP8266: Delete and recreate the TickTwo timer to guarantee fresh phase
-    if (config->ticker != nullptr) {
-      config->ticker->stop();
-      delete config->ticker;
-      config->ticker = new TickTwo(config->callback, config->intervalMs, 0, MILLIS);
-      config->ticker->start();
+    dedicated = config->dedicatedTask;
+    if (dedicated) {
+      // Dedicated timer: delete and recreate the FreeRTOS task to reset timing
+      if (config->taskHandle != nullptr) {
+        vTaskDelete(config->taskHandle);
+        config->taskHandle = nullptr;
+      }
+      config->isActive = startDedicatedTask(config);
     }
   #endif
   
-  config->isActive = true;
+  if (!dedicated) {
+    // Scheduler timer: next tick one full interval from now (safe from within
+    // the timer's own callback, unlike deleting a task from itself)
+    TIMER_ENTER_CRITICAL();
+    scheduleTimer(config, timerNow() + intervalTicks(config->intervalMs));
+    config->isActive = true;
+    TIMER_EXIT_CRITICAL();
+    #if defined(ESP32)
+      wakeScheduler();
+    #endif
+  }
+  
   DEBUG_PRINT("Timer restarted: ");
   DEBUG_PRINTLN(name);
   return true;
@@ -445,16 +727,57 @@ void TimerTaskManager::stopAll() {
           vTaskDelete(timers[i].taskHandle);
           timers[i].taskHandle = nullptr;
         }
-        if (timers[i].espTicker != nullptr) {
-          timers[i].espTicker->detach();
-        }
-      #elif defined(ESP8266)
-        if (timers[i].ticker != nullptr) {
-          timers[i].ticker->stop();
-        }
       #endif
+      TIMER_ENTER_CRITICAL();
+      unscheduleTimer(&timers[i]);
       timers[i].isActive = false;
+      TIMER_EXIT_CRITICAL();
     }
   }
   DEBUG_PRINTLN("All timers stopped");
 }
+
+// ============================================================================
+// STATISTICS
+// ============================================================================
+
+uint8_t TimerTaskManager::getTimerCount() {
+  return timerCount;
+}
+
+// Copy statistics for the timer in slot `index` (0..getTimerCount()-1)
+bool TimerTaskManager::getTimerStats(uint8_t index, TimerStats& out) {
+  if (index >= timerCount || timers[index].name == nullptr) {
+    return false;
+  }
+  
+  TimerConfig* config = &timers[index];
+  out.name = config->name;
+  out.intervalMs = config->intervalMs;
+  out.stackFree = 0;
+  out.dedicatedTask = false;
+  
+  #if defined(ESP32)
+    out.dedicatedTask = config->dedicatedTask;
+    TaskHandle_t task = config->dedicatedTask ? config->taskHandle : schedulerHandle;
+    if (task != nullptr) {
+      out.stackFree = uxTaskGetStackHighWaterMark(task);
+    }
+  #endif
+  
+  TIMER_ENTER_CRITICAL();
+  out.lateness = config->lateness;
+  out.runtime = config->runtime;
+  TIMER_EXIT_CRITICAL();
+  return true;
+}
+
+// Clear statistics for all timers
+void TimerTaskManager::resetTimerStats() {
+  for (uint8_t i = 0; i < timerCount; i++) {
+    TIMER_ENTER_CRITICAL();
+    resetTimingStat(timers[i].lateness);
+    resetTimingStat(timers[i].runtime);
+    TIMER_EXIT_CRITICAL();
+  }
+}
@@ -3,18 +3,27 @@
 
 #include <Arduino.h>
 #include "debug.h"
+#include "timing_stats.h"
 
 #if defined(ESP32)
   #include <freertos/FreeRTOS.h>
   #include <freertos/task.h>
   #include <Ticker.h>
-#elif defined(ESP8266)
-  #include <TickTwo.h>
 #endif
 
 typedef void (*TimerCallback)();
 
-#define MAX_TIMERS 10
+#define MAX_TIMERS 16  // 10 registered with every sensor fitted, plus headroom
+#define TIMER_NOT_SCHEDULED 0xFF
+
+#if defined(ESP32)
+  // Shared scheduler task that runs every non-dedicated timer callback
+  #define TIMER_SCHEDULER_STACK_SIZE 4096  // Raised by the first createTimer() that asks for more
+  #define TIMER_SCHEDULER_PRIORITY   2
+  typedef TickType_t TimerTime;           // Deadlines in FreeRTOS ticks
+#else
+  typedef uint32_t TimerTime;             // Deadlines in millis()
+#endif
 
 struct TimerConfig {
   const char* name;
@@ -23,14 +32,26 @@ struct TimerConfig {
   uint16_t stackSize;
   bool isActive;
   bool isOneShot;
+  TimerTime nextDue;        // Scheduler deadline
+  uint8_t heapPos;          // Position in the deadline heap, or TIMER_NOT_SCHEDULED
+  TimingStat lateness;      // How long after its deadline each dispatch started
+  TimingStat runtime;       // Callback duration
   #if defined(ESP32)
+    bool dedicatedTask;     // Runs in its own FreeRTOS task instead of the scheduler
     TaskHandle_t taskHandle;
-    Ticker* espTicker;
-  #elif defined(ESP8266)
-    TickTwo* ticker;
   #endif
 };
 
+// Copy of one timer's statistics (see getTimerStats())
+struct TimerStats {
+  const char* name;
+  uint32_t intervalMs;
+  bool dedicatedTask;
+  TimingStat lateness;
+  TimingStat runtime;
+  uint32_t stackFree;       // ESP32: minimum free stack (bytes) of the task running it; 0 on ESP8266
+};
+
 // Task function type for notification-based tasks (ESP32 only)
 typedef void (*TaskFunction)(void* parameter);
 
@@ -38,12 +59,22 @@ class TimerTaskManager {
 public:
   static TimerTaskManager& getInstance();
   
+  // Periodic timer run by the shared scheduler task on ESP32; a later request
+  // for more stack than the running scheduler has gets its own task instead
   bool createTimer(const char* name, uint32_t intervalMs, TimerCallback callback, uint16_t stackSize = 2048);
   
+  // Periodic timer with its own FreeRTOS task on ESP32 (for callbacks that block
+  // or need a large stack); same as createTimer() on ESP8266
+  bool createDedicatedTimer(const char* name, uint32_t intervalMs, TimerCallback callback, uint16_t stackSize = 2048);
+  
   bool createOneShotTimer(const char* name, uint32_t intervalMs, TimerCallback callback);
   
   bool triggerTimer(const char* name);
   
+  // Trigger a one-shot timer to fire after delayMs instead of its registered
+  // interval (for deadlines that move, e.g. the next wall-clock minute)
+  bool triggerTimer(const char* name, uint32_t delayMs);
+  
   #if defined(ESP32)
     // Create a notification-based task (ESP32 only)
     // Task blocks on ulTaskNotifyTake() and wakes when notifyTask() is called
@@ -61,6 +92,11 @@ public:
   bool restartTimer(const char* name);
   
   void stopAll();
+  
+  // Statistics (dispatch lateness, callback run time, stack headroom)
+  uint8_t getTimerCount();
+  bool getTimerStats(uint8_t index, TimerStats& out);
+  void resetTimerStats();
 
 private:
   TimerTaskManager();
@@ -68,10 +104,32 @@ private:
   uint8_t timerCount;
   
   TimerConfig* findTimer(const char* name);
+  TimerConfig* allocateTimer(const char* name);
   void cleanupTimerConfig(TimerConfig* config);
+  bool createPeriodicTimer(const char* name, uint32_t intervalMs, TimerCallback callback, uint16_t stackSize, bool dedicated);
+  void recordDispatch(TimerConfig* config, TimerTime late, uint32_t runUs);
+  
+  // Min-heap of timer slots ordered by nextDue (ESP32: caller holds schedulerMux)
+  void scheduleTimer(TimerConfig* config, TimerTime due);
+  void unscheduleTimer(TimerConfig* config);
+  void heapSwap(uint8_t a, uint8_t b);
+  bool heapLess(uint8_t a, uint8_t b);
+  void siftUp(uint8_t pos);
+  void siftDown(uint8_t pos);
+  
+  uint8_t deadlineHeap[MAX_TIMERS];  // Timer slot indices, earliest deadline first
+  uint8_t heapSize;
   
   #if defined(ESP32)
     static void taskWrapper(void* parameter);
+    static void schedulerTask(void* parameter);
+    bool startDedicatedTask(TimerConfig* config);
+    bool ensureScheduler(uint16_t stackSize);
+    void wakeScheduler();
+    
+    TaskHandle_t schedulerHandle;
+    uint16_t schedulerStackSize;       // Stack the scheduler task was created with
+    portMUX_TYPE schedulerMux;
   #endif
 };
 
@@ -79,6 +137,10 @@ inline bool createTimer(const char* name, uint32_t intervalMs, TimerCallback cal
   return TimerTaskManager::getInstance().createTimer(name, intervalMs, callback, stackSize);
 }
 
+inline bool createDedicatedTimer(const char* name, uint32_t intervalMs, TimerCallback callback, uint16_t stackSize = 2048) {
+  return TimerTaskManager::getInstance().createDedicatedTimer(name, intervalMs, callback, stackSize);
+}
+
 inline bool createOneShotTimer(const char* name, uint32_t intervalMs, TimerCallback callback) {
   return TimerTaskManager::getInstance().createOneShotTimer(name, intervalMs, callback);
 }
@@ -87,6 +149,10 @@ inline bool triggerTimer(const char* name) {
   return TimerTaskManager::getInstance().triggerTimer(name);
 }
 
+inline bool triggerTimer(const char* name, uint32_t delayMs) {
+  return TimerTaskManager::getInstance().triggerTimer(name, delayMs);
+}
+
 #if defined(ESP32)
 inline TaskHandle_t createNotificationTask(const char* name, TaskFunction taskFn, uint16_t stackSize = 2048, uint8_t priority = 2) {
   return TimerTaskManager::getInstance().createNotificationTask(name, taskFn, stackSize, priority);
@@ -113,4 +179,16 @@ inline void stopAllTimers() {
   TimerTaskManager::getInstance().stopAll();
 }
 
+inline uint8_t getTimerCount() {
+  return TimerTaskManager::getInstance().getTimerCount();
+}
+
+inline bool getTimerStats(uint8_t index, TimerStats& out) {
+  return TimerTaskManager::getInstance().getTimerStats(index, out);
+}
+
+inline void resetTimerStats() {
+  TimerTaskManager::getInstance().resetTimerStats();
+}
+
 #endif
@@ -0,0 +1,73 @@
+// ============================================================================
+// timing_stats.cpp - Latency and run-time statistics
+// ============================================================================
+// Small fixed-size accumulators for durations (timer dispatch lateness,
+// callback run time, frame build and LED output time):
+// - Count, min, max and total for the average
+// - Decade histogram so rare long stalls stand out from the average
+// - No allocation; callers guard concurrent access themselves
+// ============================================================================
+
+// ============================================================================
+// INCLUDES
+// ============================================================================
+
+#include "timing_stats.h"  // This file's header
+
+// ============================================================================
+// CONSTANTS
+// ============================================================================
+
+// Upper bounds (exclusive) of all but the last, open-ended bucket
+static const uint32_t TIMING_BUCKET_LIMITS_US[TIMING_HISTOGRAM_BUCKETS - 1] = {
+  100, 1000, 10000, 100000
+};
+
+static_assert(TIMING_HISTOGRAM_BUCKETS == 5, "formatTimingStat() prints five buckets");
+
+// ============================================================================
+// ACCUMULATION
+// ============================================================================
+
+void resetTimingStat(TimingStat& stat) {
+  memset(&stat, 0, sizeof(stat));
+  stat.minUs = UINT32_MAX;
+}
+
+void recordTiming(TimingStat& stat, uint32_t us) {
+  stat.count++;
+  stat.totalUs += us;
+  if (us < stat.minUs) stat.minUs = us;
+  if (us > stat.maxUs) stat.maxUs = us;
+  
+  uint8_t bucket = 0;
+  while (bucket < TIMING_HISTOGRAM_BUCKETS - 1 && us >= TIMING_BUCKET_LIMITS_US[bucket]) {
+    bucket++;
+  }
+  if (stat.histogram[bucket] < UINT16_MAX) {
+    stat.histogram[bucket]++;
+  }
+}
+
+// ============================================================================
+// REPORTING
+// ============================================================================
+
+uint32_t timingAverage(const TimingStat& stat) {
+  return stat.count > 0 ? (uint32_t)(stat.totalUs / stat.count) : 0;
+}
+
+uint32_t timingMinimum(const TimingStat& stat) {
+  return stat.count > 0 ? stat.minUs : 0;
+}
+
+int formatTimingStat(const TimingStat& stat, char* buf, size_t size) {
+  return snprintf(buf, size,
+    "{\"n\":%lu,\"min\":%lu,\"avg\":%lu,\"max\":%lu,\"hist\":[%u,%u,%u,%u,%u]}",
+    (unsigned long)stat.count,
+    (unsigned long)timingMinimum(stat),
+    (unsigned long)timingAverage(stat),
+    (unsigned long)stat.maxUs,
+    stat.histogram[0], stat.histogram[1], stat.histogram[2],
+    stat.histogram[3], stat.histogram[4]);
+}
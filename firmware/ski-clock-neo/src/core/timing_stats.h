@@ -0,0 +1,34 @@
+#ifndef TIMING_STATS_H
+#define TIMING_STATS_H
+
+#include <Arduino.h>
+
+// Histogram buckets by decade: <100us, <1ms, <10ms, <100ms, >=100ms
+#define TIMING_HISTOGRAM_BUCKETS 5
+
+// Running min/avg/max and histogram of a duration, in microseconds
+struct TimingStat {
+  uint32_t count;
+  uint32_t minUs;
+  uint32_t maxUs;
+  uint64_t totalUs;
+  uint16_t histogram[TIMING_HISTOGRAM_BUCKETS];  // Saturates at 65535
+};
+
+// Clear all samples
+void resetTimingStat(TimingStat& stat);
+
+// Add one sample
+void recordTiming(TimingStat& stat, uint32_t us);
+
+// Mean of all samples (0 if none)
+uint32_t timingAverage(const TimingStat& stat);
+
+// Smallest sample (0 if none)
+uint32_t timingMinimum(const TimingStat& stat);
+
+// Write {"n":N,"min":us,"avg":us,"max":us,"hist":[...]} into buf
+// Returns the snprintf length (may exceed size on truncation)
+int formatTimingStat(const TimingStat& stat, char* buf, size_t size);
+
+#endif
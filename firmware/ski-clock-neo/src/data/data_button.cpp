@@ -178,7 +178,7 @@ void updateButton() {
       interrupts();
       
       DEBUG_PRINTLN("Button pressed (debounced)");
-      logEvent("button_press", nullptr);
+      logEvent(EVT_BUTTON_PRESS);
       
       if (pressCallback != nullptr) {
         pressCallback();
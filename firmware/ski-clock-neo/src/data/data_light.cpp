@@ -0,0 +1,102 @@
+// ============================================================================
+// data_light.cpp - Ambient light sensor (LDR on the ADC)
+// ============================================================================
+// This library reads an optional light-dependent resistor divider on
+// LIGHT_SENSOR_PIN for the brightness controller:
+// - One analogRead() per 250 ms poll, on the timer scheduler
+// - Exponential moving average (1/8 per sample, ~2 s to settle), so a
+//   passing headlight or shadow doesn't flick the display brightness
+// - Scaled to 0-255 whatever the ADC width (12-bit ESP32, 10-bit ESP8266)
+// - Without a sensor (LIGHT_SENSOR_PIN -1) nothing is read or scheduled
+// ============================================================================
+
+// ============================================================================
+// INCLUDES
+// ============================================================================
+
+#include "data_light.h"                    // This file's header
+#include "../../ski-clock-neo_config.h"    // For LIGHT_SENSOR_PIN definition
+#include "../core/timer_helpers.h"         // For timer management
+#include "../core/debug.h"                 // For debug logging
+
+// ============================================================================
+// CONSTANTS
+// ============================================================================
+
+#define LIGHT_POLL_MS 250
+#define LIGHT_FILTER_SHIFT 3            // EMA weight 1/8 per sample
+#define LIGHT_FIXED_SHIFT 4             // Fractional bits kept by the filter
+
+#if defined(ESP32)
+  #define LIGHT_ADC_MAX 4095
+#else
+  #define LIGHT_ADC_MAX 1023
+#endif
+
+// ============================================================================
+// STATE VARIABLES
+// ============================================================================
+
+static bool sensorPresent = false;
+static int32_t filteredLight = 0;       // ADC counts << LIGHT_FIXED_SHIFT
+static volatile uint8_t ambientLight = 0;
+
+// ============================================================================
+// FORWARD DECLARATIONS
+// ============================================================================
+
+void lightPollCallback();
+
+// ============================================================================
+// SAMPLING
+// ============================================================================
+
+static uint8_t scaleToByte(int32_t filtered) {
+  int32_t counts = filtered >> LIGHT_FIXED_SHIFT;
+  if (counts <= 0) return 0;
+  if (counts >= LIGHT_ADC_MAX) return 255;
+  return (uint8_t)((counts * 255 + LIGHT_ADC_MAX / 2) / LIGHT_ADC_MAX);
+}
+
+// Timer callback - one ADC sample into the moving average
+void lightPollCallback() {
+  int32_t sample = (int32_t)analogRead(LIGHT_SENSOR_PIN) << LIGHT_FIXED_SHIFT;
+  filteredLight += (sample - filteredLight) >> LIGHT_FILTER_SHIFT;
+  ambientLight = scaleToByte(filteredLight);
+}
+
+// ============================================================================
+// INITIALIZATION
+// ============================================================================
+
+void initLightData() {
+  #if LIGHT_SENSOR_PIN >= 0
+    pinMode(LIGHT_SENSOR_PIN, INPUT);
+  
+    // Seed the filter so the first brightness decision isn't a ramp from dark
+    filteredLight = (int32_t)analogRead(LIGHT_SENSOR_PIN) << LIGHT_FIXED_SHIFT;
+    ambientLight = scaleToByte(filteredLight);
+    sensorPresent = true;
+  
+    createTimer("LightPoll", LIGHT_POLL_MS, lightPollCallback);
+  
+    DEBUG_PRINT("Light sensor on pin ");
+    DEBUG_PRINT(LIGHT_SENSOR_PIN);
+    DEBUG_PRINT(", ambient ");
+    DEBUG_PRINTLN(ambientLight);
+  #else
+    DEBUG_PRINTLN("No light sensor configured - brightness follows the schedule");
+  #endif
+}
+
+// ============================================================================
+// PUBLIC API
+// ============================================================================
+
+bool isLightSensorPresent() {
+  return sensorPresent;
+}
+
+uint8_t getAmbientLight() {
+  return ambientLight;
+}
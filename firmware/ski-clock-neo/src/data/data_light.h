@@ -0,0 +1,17 @@
+#ifndef DATA_LIGHT_H
+#define DATA_LIGHT_H
+
+#include <Arduino.h>
+
+// Start polling the ambient light sensor on LIGHT_SENSOR_PIN
+// Does nothing when LIGHT_SENSOR_PIN is -1. Must be called once during setup
+void initLightData();
+
+// True if a light sensor is configured
+bool isLightSensorPresent();
+
+// Smoothed ambient light, 0 (dark) to 255 (full scale on the ADC)
+// Never touches the ADC - returns the latest polled value (0 without a sensor)
+uint8_t getAmbientLight();
+
+#endif
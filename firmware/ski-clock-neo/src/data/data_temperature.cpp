@@ -1,9 +1,16 @@
 // ============================================================================
 // data_temperature.cpp - DS18B20 temperature sensor management
 // ============================================================================
-// This library handles the DS18B20 temperature sensor using non-blocking reads:
-// - 30-second polling interval for temperature requests
-// - 750ms one-shot delay for sensor conversion (12-bit resolution)
+// This library runs every DS18B20 on TEMPERATURE_PIN (e.g. one in the snow,
+// one in the air) straight over OneWire, without DallasTemperature:
+// - Sensors found once at init and addressed by ROM from then on
+// - TEMPERATURE_RESOLUTION (9-12 bit) on every sensor; conversion takes
+//   94 ms at 9 bits up to 750 ms at 12
+// - 30-second polling: one broadcast Convert T starts every sensor, then a
+//   one-shot timer reads one scratchpad per dispatch, so no callback holds
+//   the bus (or the timer scheduler) for more than one short transaction
+// - Scratchpads are CRC-checked; each sensor keeps its own readings,
+//   filtered by a moving median to reject spikes
 // - Automatic display update via callback to display_controller
 // - Event logging for temperature readings
 // ============================================================================
@@ -19,19 +26,45 @@
 #include "../core/timer_helpers.h"         // For timer management
 #include "../core/debug.h"                 // For debug logging
 #include "../core/device_config.h"         // For temperature offset
-#include <OneWire.h>                       // OneWire library for DS18B20 communication
-#include <DallasTemperature.h>             // DallasTemperature library for DS18B20
+#include <OneWire.h>                       // OneWire bus for DS18B20 communication
+
+// ============================================================================
+// CONSTANTS
+// ============================================================================
+
+#define DS18B20_FAMILY          0x28
+#define DS18B20_CONVERT_T       0x44
+#define DS18B20_WRITE_SCRATCH   0x4E
+#define DS18B20_READ_SCRATCH    0xBE
+#define DS18B20_SCRATCHPAD_SIZE 9
+#define DS18B20_CONFIG_BYTE     4
+#define DS18B20_POWER_ON_RAW    0x0550   // 85.0 C - reset value, never converted
+
+#define TEMPERATURE_POLL_MS 30000
+#define TEMPERATURE_MAX_SENSORS 4       // Sensors tracked on the bus
+#define TEMPERATURE_MEDIAN_WINDOW 5     // Readings per median (2.5 min at 30 s polling)
+#define TEMPERATURE_MAX_FAILURES 3      // Failed reads in a row before a sensor goes invalid
 
 // ============================================================================
 // STATE VARIABLES
 // ============================================================================
 
+struct TemperatureSensor {
+  uint8_t rom[8];
+  int16_t samples[TEMPERATURE_MEDIAN_WINDOW];     // Raw readings (1/16 C)
+  uint8_t sampleCount;
+  uint8_t sampleNext;
+  float celsius;                                  // Median, offset applied
+  bool valid;                                     // celsius holds a reading
+  uint8_t failures;                               // Failed reads since the last good one
+};
+
 static OneWire* oneWire = nullptr;              // OneWire bus instance
-static DallasTemperature* sensors = nullptr;    // DallasTemperature library instance
+static TemperatureSensor sensorTable[TEMPERATURE_MAX_SENSORS];
+static uint8_t sensorCount = 0;
 static bool initialized = false;                // True after successful init
-static float lastTemperature = 0.0;             // Last valid temperature reading
-static bool lastReadValid = false;              // True if last reading was valid
-static bool temperatureRequestPending = false;  // True while waiting for conversion
+static bool temperatureRequestPending = false;  // True while a conversion/read cycle runs
+static uint8_t nextSensorToRead = 0;            // Scratchpad read position in the cycle
 static bool firstTemperatureRead = true;        // True until first successful read
 
 // ============================================================================
@@ -41,50 +74,189 @@ static bool firstTemperatureRead = true;        // True until first successful r
 void temperaturePollCallback();
 void temperatureReadCallback();
 
+// ============================================================================
+// BUS OPERATIONS
+// ============================================================================
+
+static uint16_t conversionTimeMs(uint8_t resolution) {
+  return (94u << (resolution - 9)) + 6;  // 94/188/375/750 ms, plus margin
+}
+
+// Write TH/TL/config to the scratchpad only (not EEPROM - no wear; redone
+// at boot and whenever a sensor reports it has reset)
+static bool writeResolution(const TemperatureSensor& sensor) {
+  if (!oneWire->reset()) return false;
+  oneWire->select(sensor.rom);
+  oneWire->write(DS18B20_WRITE_SCRATCH);
+  oneWire->write(0x4B);  // TH: unused alarm registers, datasheet defaults
+  oneWire->write(0x46);  // TL
+  oneWire->write(((TEMPERATURE_RESOLUTION - 9) << 5) | 0x1F);
+  return true;
+}
+
+static bool readScratchpad(const TemperatureSensor& sensor, uint8_t* scratchpad) {
+  if (!oneWire->reset()) return false;
+  oneWire->select(sensor.rom);
+  oneWire->write(DS18B20_READ_SCRATCH);
+  oneWire->read_bytes(scratchpad, DS18B20_SCRATCHPAD_SIZE);
+  return true;
+}
+
+// Median of the sensor's recent raw readings
+static int16_t medianSample(const TemperatureSensor& sensor) {
+  int16_t sorted[TEMPERATURE_MEDIAN_WINDOW];
+  uint8_t count = sensor.sampleCount;
+  for (uint8_t i = 0; i < count; i++) {
+    // Insertion sort - at most TEMPERATURE_MEDIAN_WINDOW entries
+    int16_t value = sensor.samples[i];
+    int8_t j = i - 1;
+    while (j >= 0 && sorted[j] > value) {
+      sorted[j + 1] = sorted[j];
+      j--;
+    }
+    sorted[j + 1] = value;
+  }
+  if (count % 2 == 1) return sorted[count / 2];
+  return (sorted[count / 2 - 1] + sorted[count / 2]) / 2;
+}
+
+// Read one sensor's result; false on any bus, CRC or range error (logged)
+static bool readSensor(uint8_t index) {
+  TemperatureSensor& sensor = sensorTable[index];
+  uint8_t scratchpad[DS18B20_SCRATCHPAD_SIZE];
+
+  bool allZero = true;
+  bool present = readScratchpad(sensor, scratchpad);
+  for (uint8_t i = 0; present && i < DS18B20_SCRATCHPAD_SIZE; i++) {
+    if (scratchpad[i] != 0) allZero = false;
+  }
+  if (!present || allZero) {
+    // No presence pulse, or the bus held low - sensor gone
+    DEBUG_PRINT("Temperature sensor ");
+    DEBUG_PRINT(index);
+    DEBUG_PRINTLN(" disconnected");
+    logEvent(EVT_TEMP_SENSOR_NOT_FOUND);
+    return false;
+  }
+  if (OneWire::crc8(scratchpad, DS18B20_SCRATCHPAD_SIZE - 1) != scratchpad[DS18B20_SCRATCHPAD_SIZE - 1]) {
+    DEBUG_PRINT("Temperature sensor ");
+    DEBUG_PRINT(index);
+    DEBUG_PRINTLN(" scratchpad CRC error");
+    logEvent(EVT_TEMP_READ_CRC_ERROR, index);
+    return false;
+  }
+
+  // Undefined low bits at reduced resolution are masked off
+  int16_t raw = (int16_t)((scratchpad[1] << 8) | scratchpad[0]);
+  raw &= ~((1 << (12 - TEMPERATURE_RESOLUTION)) - 1);
+
+  // A sensor that lost power comes back at its EEPROM resolution with the
+  // 85 C reset value - restore the resolution and skip the reading
+  uint8_t resolution = ((scratchpad[DS18B20_CONFIG_BYTE] >> 5) & 0x03) + 9;
+  if (resolution != TEMPERATURE_RESOLUTION) {
+    writeResolution(sensor);
+  }
+  if (raw == DS18B20_POWER_ON_RAW) {
+    DEBUG_PRINTLN("Temperature read invalid: power-on reset value");
+    logEvent(EVT_TEMP_READ_INVALID, eventTenths(raw / 16.0f), "power_on_reset");
+    return false;
+  }
+
+  // DS18B20 valid range: -55°C to +125°C
+  float tempC = raw / 16.0f;
+  if (tempC < -55.0 || tempC > 125.0) {
+    DEBUG_PRINT("Temperature read invalid, raw value: ");
+    DEBUG_PRINTLN(tempC);
+    logEvent(EVT_TEMP_READ_INVALID, eventTenths(tempC), "out_of_range");
+    return false;
+  }
+
+  sensor.samples[sensor.sampleNext] = raw;
+  sensor.sampleNext = (sensor.sampleNext + 1) % TEMPERATURE_MEDIAN_WINDOW;
+  if (sensor.sampleCount < TEMPERATURE_MEDIAN_WINDOW) sensor.sampleCount++;
+
+  // Apply calibration offset from device config (stored in NVS/EEPROM)
+  sensor.celsius = medianSample(sensor) / 16.0f + getTemperatureOffset();
+  sensor.valid = true;
+  return true;
+}
+
 // ============================================================================
 // TIMER CALLBACKS
 // ============================================================================
 
 // Called every 30 seconds to start a new temperature conversion
 void temperaturePollCallback() {
-  if (!temperatureRequestPending) {
+  if (!temperatureRequestPending && sensorCount > 0) {
     // Request new temperature reading
     requestTemperature();
     temperatureRequestPending = true;
+    nextSensorToRead = 0;
     DEBUG_PRINTLN("Temperature read requested (timer)");
-    
-    // Trigger one-shot read timer (750ms delay for sensor conversion)
+
+    // Trigger one-shot read timer (conversion time at TEMPERATURE_RESOLUTION)
     triggerTimer("TemperatureRead");
   }
 }
 
-// Called 750ms after temperature request to read the result
+// Called once the conversion is done, then again for each further sensor -
+// one scratchpad read per dispatch
 void temperatureReadCallback() {
-  float temp;
-  if (getTemperature(&temp)) {
-    // Update display via callback to display_controller
-    updateTemperatureDisplay();
-    DEBUG_PRINT("Temperature updated: ");
-    DEBUG_PRINTLN(temp);
-    
+  uint8_t index = nextSensorToRead++;
+
+  if (readSensor(index)) {
+    TemperatureSensor& sensor = sensorTable[index];
+    sensor.failures = 0;
+    DEBUG_PRINT("Temperature updated (sensor ");
+    DEBUG_PRINT(index);
+    DEBUG_PRINT("): ");
+    DEBUG_PRINTLN(sensor.celsius);
+
     // Log temperature_read event with temperature value
-    static char tempEventData[32];
-    snprintf(tempEventData, sizeof(tempEventData), "{\"celsius\":%.1f}", temp);
-    logEvent("temperature_read", tempEventData);
-    
+    if (sensorCount > 1) {
+      logEvent(EVT_TEMPERATURE_READ_SENSOR, eventTenths(sensor.celsius), index);
+    } else {
+      logEvent(EVT_TEMPERATURE_READ, eventTenths(sensor.celsius));
+    }
+
+    // Update display via callback to display_controller
+    if (index == TEMPERATURE_DISPLAY_SENSOR) {
+      updateTemperatureDisplay();
+    }
+
     // First read complete
     if (firstTemperatureRead) {
       firstTemperatureRead = false;
       DEBUG_PRINTLN("First temperature read complete");
     }
   } else {
-    // Failed to read temperature - retry on next poll
-    // (specific error already logged by getTemperature)
+    // Failed to read temperature - last good value is kept, retry on next poll
+    // (specific error already logged by readSensor). After
+    // TEMPERATURE_MAX_FAILURES in a row the value is too old to show
+    TemperatureSensor& sensor = sensorTable[index];
     DEBUG_PRINTLN("Temperature read failed, will retry on next poll");
+    if (sensor.failures < TEMPERATURE_MAX_FAILURES) {
+      sensor.failures++;
+    }
+    if (sensor.valid && sensor.failures >= TEMPERATURE_MAX_FAILURES) {
+      sensor.valid = false;
+      sensor.sampleCount = 0;  // Restart the median from fresh readings
+      sensor.sampleNext = 0;
+      DEBUG_PRINT("Temperature sensor ");
+      DEBUG_PRINT(index);
+      DEBUG_PRINTLN(" reading expired");
+      if (index == TEMPERATURE_DISPLAY_SENSOR) {
+        updateTemperatureDisplay();
+      }
+    }
+  }
+
+  if (nextSensorToRead < sensorCount) {
+    triggerTimer("TemperatureRead", 0);  // Next sensor, one dispatch later (already converted)
+  } else {
+    // Cycle done - clear flag to allow next poll (ensures recovery from failed reads)
+    temperatureRequestPending = false;
   }
-  
-  // Always clear flag to allow next poll (ensures recovery from failed reads)
-  temperatureRequestPending = false;
 }
 
 // ============================================================================
@@ -92,104 +264,70 @@ void temperatureReadCallback() {
 // ============================================================================
 
 void initTemperatureData() {
-  DEBUG_PRINT("Initializing DS18B20 temperature sensor on GPIO ");
+  DEBUG_PRINT("Initializing DS18B20 temperature sensors on GPIO ");
   DEBUG_PRINTLN(TEMPERATURE_PIN);
-  
+
   // Initialize OneWire on specified pin
   oneWire = new OneWire(TEMPERATURE_PIN);
-  sensors = new DallasTemperature(oneWire);
-  
-  // Start the sensor library
-  sensors->begin();
-  
-  // Check how many devices are connected
-  uint8_t deviceCount = sensors->getDeviceCount();
+
+  // Find every DS18B20 on the bus (search order is by ROM, so stable)
+  uint8_t rom[8];
+  sensorCount = 0;
+  oneWire->reset_search();
+  while (sensorCount < TEMPERATURE_MAX_SENSORS && oneWire->search(rom)) {
+    if (OneWire::crc8(rom, 7) != rom[7] || rom[0] != DS18B20_FAMILY) {
+      continue;
+    }
+    TemperatureSensor& sensor = sensorTable[sensorCount++];
+    memset(&sensor, 0, sizeof(sensor));
+    memcpy(sensor.rom, rom, sizeof(sensor.rom));
+    writeResolution(sensor);
+  }
+
   DEBUG_PRINT("Found ");
-  DEBUG_PRINT(deviceCount);
+  DEBUG_PRINT(sensorCount);
   DEBUG_PRINTLN(" DS18B20 device(s)");
-  
-  if (deviceCount == 0) {
+
+  if (sensorCount == 0) {
     DEBUG_PRINTLN("WARNING: No DS18B20 sensor detected!");
-    logEvent("temp_sensor_not_found", nullptr);
-  }
-  
-  // Set resolution to 12-bit for best accuracy (conversion time ~750ms)
-  sensors->setResolution(12);
-  
-  // Disable blocking wait - we handle conversion time with one-shot timer
-  sensors->setWaitForConversion(false);
-  
+    logEvent(EVT_TEMP_SENSOR_NOT_FOUND);
+  }
+
   initialized = true;
-  
+
   // Create temperature timers using timing_helpers library
   // Poll timer: 30-second interval for triggering temperature conversions
-  createTimer("TemperaturePoll", 30000, temperaturePollCallback);
-  
-  // Read timer: 750ms one-shot, triggered after conversion starts
-  createOneShotTimer("TemperatureRead", 750, temperatureReadCallback);
-  
+  createTimer("TemperaturePoll", TEMPERATURE_POLL_MS, temperaturePollCallback);
+
+  // Read timer: one-shot after the conversion time
+  createOneShotTimer("TemperatureRead", conversionTimeMs(TEMPERATURE_RESOLUTION), temperatureReadCallback);
+
   // Trigger first poll immediately
   temperatureRequestPending = false;
   temperaturePollCallback();
-  DEBUG_PRINTLN("Temperature sensor initialized (non-blocking mode, first poll triggered)");
+  DEBUG_PRINTLN("Temperature sensors initialized (non-blocking mode, first poll triggered)");
 }
 
 // ============================================================================
 // SENSOR OPERATIONS
 // ============================================================================
 
-// Request temperature conversion (non-blocking)
+// Start a conversion on every sensor at once (non-blocking)
 void requestTemperature() {
-  if (!initialized || sensors == nullptr) {
+  if (!initialized || oneWire == nullptr || !oneWire->reset()) {
     return;
   }
-  sensors->requestTemperatures();
+  oneWire->skip();
+  oneWire->write(DS18B20_CONVERT_T);
 }
 
-// Read temperature from sensor (call 750ms after request)
+// Filtered temperature of the display sensor
 bool getTemperature(float* temperature) {
-  if (!initialized || sensors == nullptr || temperature == nullptr) {
-    DEBUG_PRINTLN("getTemperature: Not initialized or null pointer");
-    return false;
-  }
-  
-  // Get temperature from first sensor (index 0)
-  float tempC = sensors->getTempCByIndex(0);
-  
-  // Check for device disconnected error (DS18B20 returns -127°C)
-  if (tempC == DEVICE_DISCONNECTED_C) {
-    DEBUG_PRINTLN("Temperature sensor disconnected");
-    lastReadValid = false;
-    logEvent("temp_sensor_not_found", nullptr);
+  uint8_t index = TEMPERATURE_DISPLAY_SENSOR;
+  if (!initialized || index >= sensorCount || temperature == nullptr || !sensorTable[index].valid) {
     return false;
   }
-  
-  // Check for out-of-range values (DS18B20 valid range: -55°C to +125°C)
-  // Values outside this range indicate CRC errors or power issues
-  if (tempC < -55.0 || tempC > 125.0) {
-    DEBUG_PRINT("Temperature read invalid, raw value: ");
-    DEBUG_PRINTLN(tempC);
-    lastReadValid = false;
-    
-    // 85°C is the power-on reset value - indicates underpowered sensor
-    if (tempC == 85.0) {
-      static char eventData[48];
-      snprintf(eventData, sizeof(eventData), "{\"raw\":%.1f,\"reason\":\"power_on_reset\"}", tempC);
-      logEvent("temp_read_invalid", eventData);
-    } else {
-      static char eventData[48];
-      snprintf(eventData, sizeof(eventData), "{\"raw\":%.1f,\"reason\":\"out_of_range\"}", tempC);
-      logEvent("temp_read_invalid", eventData);
-    }
-    return false;
-  }
-  
-  // Apply calibration offset from device config (stored in NVS/EEPROM)
-  tempC += getTemperatureOffset();
-  
-  *temperature = tempC;
-  lastTemperature = tempC;
-  lastReadValid = true;
+  *temperature = sensorTable[index].celsius;
   return true;
 }
 
@@ -199,14 +337,15 @@ bool getTemperature(float* temperature) {
 
 // Format temperature as string (e.g., "23,5*C" or "-5,2*C")
 bool formatTemperature(char* output, size_t outputSize) {
-  if (!initialized || !lastReadValid || output == nullptr || outputSize < 8) {
+  float temperature;
+  if (output == nullptr || outputSize < 8 || !getTemperature(&temperature)) {
     return false;
   }
-  
+
   // Format with one decimal place using comma as separator (e.g., "25,7*C", "-2,7*C", "-28,9*C")
   // First format with period, then replace with comma
-  snprintf(output, outputSize, "%.1f*C", lastTemperature);
-  
+  snprintf(output, outputSize, "%.1f*C", temperature);
+
   // Replace the decimal point with a comma
   for (int i = 0; output[i] != '\0'; i++) {
     if (output[i] == '.') {
@@ -219,8 +358,5 @@ bool formatTemperature(char* output, size_t outputSize) {
 
 // Check if sensor is connected
 bool isSensorConnected() {
-  if (!initialized || sensors == nullptr) {
-    return false;
-  }
-  return (sensors->getDeviceCount() > 0);
+  return initialized && sensorCount > 0;
 }
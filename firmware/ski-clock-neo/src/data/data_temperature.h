@@ -3,17 +3,18 @@
 
 #include <Arduino.h>
 
-// Initialize DS18B20 temperature sensor on specified GPIO pin
+// Find every DS18B20 on TEMPERATURE_PIN and start polling them
 // Must be called once during setup
 void initTemperatureData();
 
-// Request a new temperature reading from the sensor
-// This is non-blocking and starts the conversion process
-// Call this, then wait ~750ms, then call getTemperature()
+// Start a conversion on every sensor at once (broadcast Convert T)
+// This is non-blocking; the poll timer reads the results once the conversion
+// time for TEMPERATURE_RESOLUTION has passed
 void requestTemperature();
 
-// Get the last temperature reading in Celsius
-// Returns true if valid, false if sensor error or not initialized
+// Get the filtered temperature of the display sensor (TEMPERATURE_DISPLAY_SENSOR)
+// in Celsius. Never touches the bus - returns the latest polled value
+// Returns true if valid, false if no good reading yet or not initialized
 // Temperature range: -55°C to +125°C
 bool getTemperature(float* temperature);
 
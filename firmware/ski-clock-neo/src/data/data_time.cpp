@@ -5,7 +5,12 @@
 // - RTC provides instant time on boot (before WiFi/NTP connects)
 // - NTP syncs RTC hourly to maintain accuracy
 // - Falls back gracefully to NTP-only if no RTC present
-// - Detects minute and date changes via 1-second polling timer
+// - Works out the local time once per minute edge and caches the formatted
+//   time/date strings, so display ticks never run TZ rules or snprintf
+// - The TimeCheck one-shot sleeps until the next minute boundary instead of
+//   polling every second (1 s retries only until the time is known)
+// - DST transitions are detected (tm_isdst) and logged; they fall on a
+//   minute edge, and local and UTC edges coincide, so the wake lands on them
 // - Configured for Sweden timezone (CET/CEST)
 // ============================================================================
 
@@ -17,7 +22,7 @@
 #include "../../ski-clock-neo_config.h" // For RTC pin definitions
 #include "../core/event_log.h"       // For logging time events
 #include "../core/debug.h"           // For debug logging
-#include "../core/timer_helpers.h"   // For 1-second polling timer
+#include "../core/timer_helpers.h"   // For the minute-edge timer
 #include "../display/display_controller.h" // For forceDisplayUpdate after RTC init
 #include <time.h>                    // For time functions
 #include <sys/time.h>                // For settimeofday
@@ -43,6 +48,24 @@ const unsigned long RTC_SYNC_INTERVAL = 3600000;   // Sync RTC from NTP every ho
 // Minimum valid timestamp (2020-01-01 00:00:00 UTC)
 const time_t MIN_VALID_TIME = 1577836800;
 
+// Minute-edge wakeups
+const uint32_t TIME_UNSYNCED_RETRY_MS = 1000;     // Poll interval until time is known
+const uint32_t MINUTE_EDGE_GUARD_MS = 20;         // Wake this far past the edge
+
+// ============================================================================
+// PLATFORM-SPECIFIC MACROS
+// ============================================================================
+
+#if defined(ESP32)
+  // Cache is written on the timer scheduler task and read by the display task
+  #define TIME_ENTER_CRITICAL() portENTER_CRITICAL(&timeCacheMux)
+  #define TIME_EXIT_CRITICAL() portEXIT_CRITICAL(&timeCacheMux)
+#else
+  // ESP8266 timers and display ticks all run from loop()
+  #define TIME_ENTER_CRITICAL()
+  #define TIME_EXIT_CRITICAL()
+#endif
+
 // ============================================================================
 // STATE VARIABLES
 // ============================================================================
@@ -55,11 +78,26 @@ static bool ntpSynced = false;                      // True after first NTP sync
 static unsigned long lastNtpCheck = 0;              // Last NTP check timestamp
 static unsigned long lastRtcSync = 0;               // Last RTC sync timestamp
 
-// Time change detection
-static int8_t lastMinute = -1;                      // Last known minute (-1 = uninitialized)
-static int8_t lastDay = -1;                         // Last known day of month
+// Minute-edge cache (written by checkTimeChange() only)
+static volatile bool timeCacheValid = false;        // True once the cache has been filled
+static char cachedTime[6];                          // "hh:mm"
+static char cachedDate[6];                          // "dd-mm"
+static uint8_t cachedHour = 0;                      // Local hour (0-23)
+static int8_t lastDay = -1;                         // Day of month of the cache
+static int8_t lastDst = -1;                         // tm_isdst of the cache (-1 = unknown)
 static TimeChangeCallback timeChangeCallback = nullptr;
 
+#if defined(ESP32)
+  static portMUX_TYPE timeCacheMux = portMUX_INITIALIZER_UNLOCKED;
+#endif
+
+// ============================================================================
+// FORWARD DECLARATIONS
+// ============================================================================
+
+void timeCheckCallback();
+static void scheduleMinuteWake();
+
 // ============================================================================
 // INITIALIZATION
 // ============================================================================
@@ -74,13 +112,13 @@ void initTimeData() {
   if (rtc.begin()) {
     rtcAvailable = true;
     DEBUG_PRINTLN("DS3231 RTC found on I2C bus");
-    logEvent("rtc_initialized", nullptr);
+    logEvent(EVT_RTC_INITIALIZED);
     
     // Check if RTC lost power (time invalid)
     if (rtc.lostPower()) {
       DEBUG_PRINTLN("RTC lost power - time invalid, waiting for NTP sync");
       rtcTimeValid = false;
-      logEvent("rtc_lost_power", nullptr);
+      logEvent(EVT_RTC_LOST_POWER);
     } else {
       // Check if RTC time is reasonable (after 2020)
       DateTime rtcTime = rtc.now();
@@ -108,13 +146,13 @@ void initTimeData() {
       } else {
         DEBUG_PRINTLN("RTC time invalid (before 2020), waiting for NTP sync");
         rtcTimeValid = false;
-        logEvent("rtc_time_invalid", nullptr);
+        logEvent(EVT_RTC_TIME_INVALID);
       }
     }
   } else {
     rtcAvailable = false;
     DEBUG_PRINTLN("DS3231 RTC not found - using NTP only");
-    logEvent("rtc_not_found", nullptr);
+    logEvent(EVT_RTC_NOT_FOUND);
   }
   
   // Initialize NTP (syncs in background)
@@ -126,10 +164,14 @@ void initTimeData() {
     configTime(SWEDEN_TZ, NTP_SERVER_1, NTP_SERVER_2, NTP_SERVER_3);
   #endif
   
-  // Create 1-second timer for time change detection
-  createTimer("TimeCheck", 1000, []() { checkTimeChange(); });
+  // One-shot re-armed for every minute edge (see scheduleMinuteWake())
+  createOneShotTimer("TimeCheck", TIME_UNSYNCED_RETRY_MS, timeCheckCallback);
   
   timeInitialized = true;
+  
+  // Fill the cache now (RTC time may already be valid), then sleep to the edge
+  checkTimeChange();
+  scheduleMinuteWake();
   DEBUG_PRINTLN("Time system initialized");
   
   // Trigger display update now that time is available
@@ -148,7 +190,7 @@ void syncRtcFromNtp() {
   time_t now = time(nullptr);
   if (now <= MIN_VALID_TIME) {
     DEBUG_PRINTLN("Cannot sync RTC - NTP time not valid");
-    logEvent("rtc_sync_failed", "{\"reason\":\"ntp_invalid\"}");
+    logEvent(EVT_RTC_SYNC_FAILED, "ntp_invalid");
     return;
   }
   
@@ -188,22 +230,48 @@ void syncRtcFromNtp() {
   
   // Log drift correction if significant (>1 second)
   if (abs(driftSeconds) > 1) {
-    static char eventData[48];
-    snprintf(eventData, sizeof(eventData), "{\"drift_seconds\":%ld}", driftSeconds);
-    logEvent("rtc_drift_corrected", eventData);
+    logEvent(EVT_RTC_DRIFT_CORRECTED, driftSeconds);
     DEBUG_PRINT("RTC drift corrected: ");
     DEBUG_PRINT(driftSeconds);
     DEBUG_PRINTLN(" seconds");
   }
   
-  logEvent("rtc_synced_from_ntp", nullptr);
+  logEvent(EVT_RTC_SYNCED_FROM_NTP);
 }
 
 // ============================================================================
 // TIME CHANGE DETECTION
 // ============================================================================
 
-// Check for minute or date changes (called every 1 second)
+// Sleep until just past the next minute boundary. Local and UTC minute edges
+// coincide (whole-hour offsets, DST included), so the delay comes straight
+// from the system clock. A wake that lands early just re-arms for the rest
+static void scheduleMinuteWake() {
+  uint32_t delayMs = TIME_UNSYNCED_RETRY_MS;
+  
+  if (timeCacheValid) {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    uint32_t intoMinuteMs = (uint32_t)(tv.tv_sec % 60) * 1000 + tv.tv_usec / 1000;
+    delayMs = 60000 - intoMinuteMs + MINUTE_EDGE_GUARD_MS;
+  }
+  
+  triggerTimer("TimeCheck", delayMs);
+}
+
+// Timer callback - refresh the cache at the minute edge, then sleep again
+void timeCheckCallback() {
+  checkTimeChange();
+  
+  // Periodic RTC sync from NTP (every hour)
+  if (rtcAvailable && ntpSynced && (millis() - lastRtcSync > RTC_SYNC_INTERVAL)) {
+    syncRtcFromNtp();
+  }
+  
+  scheduleMinuteWake();
+}
+
+// Rebuild the cached local time and report minute or date changes
 bool checkTimeChange() {
   if (!isTimeSynced()) {
     return false;
@@ -211,40 +279,51 @@ bool checkTimeChange() {
   
   time_t now = time(nullptr);
   struct tm timeinfo;
+  localtime_r(&now, &timeinfo);
   
-  #if defined(ESP32)
-    if (!getLocalTime(&timeinfo)) {
-      return false;
-    }
-  #elif defined(ESP8266)
-    localtime_r(&now, &timeinfo);
-  #endif
+  char timeText[sizeof(cachedTime)];
+  char dateText[sizeof(cachedDate)];
+  snprintf(timeText, sizeof(timeText), "%02d:%02d", timeinfo.tm_hour, timeinfo.tm_min);
+  snprintf(dateText, sizeof(dateText), "%02d-%02d", timeinfo.tm_mday, timeinfo.tm_mon + 1);
   
   uint8_t changeFlags = 0;
-  
-  // Check minute change
-  if (lastMinute != timeinfo.tm_min) {
-    if (lastMinute >= 0) {  // Skip first call (initialization)
-      changeFlags |= TIME_CHANGE_MINUTE;
-      DEBUG_PRINT("Minute changed: ");
-      DEBUG_PRINT(lastMinute);
-      DEBUG_PRINT(" -> ");
-      DEBUG_PRINTLN(timeinfo.tm_min);
-    }
-    lastMinute = timeinfo.tm_min;
+  bool firstFill = !timeCacheValid;  // Nothing to compare against yet
+  
+  // Compare the whole hh:mm, not just the minute - a clock step of whole
+  // hours (e.g. NTP correcting an RTC that was an hour off) keeps the minute
+  if (!firstFill && strcmp(timeText, cachedTime) != 0) {
+    changeFlags |= TIME_CHANGE_MINUTE;
+    DEBUG_PRINT("Minute changed: ");
+    DEBUG_PRINT(cachedTime);
+    DEBUG_PRINT(" -> ");
+    DEBUG_PRINTLN(timeText);
   }
   
   // Check date change (day of month)
-  if (lastDay != timeinfo.tm_mday) {
-    if (lastDay >= 0) {  // Skip first call (initialization)
-      changeFlags |= TIME_CHANGE_DATE;
-      DEBUG_PRINT("Date changed: day ");
-      DEBUG_PRINT(lastDay);
-      DEBUG_PRINT(" -> ");
-      DEBUG_PRINTLN(timeinfo.tm_mday);
-    }
-    lastDay = timeinfo.tm_mday;
+  if (!firstFill && lastDay != timeinfo.tm_mday) {
+    changeFlags |= TIME_CHANGE_DATE;
+    DEBUG_PRINT("Date changed: day ");
+    DEBUG_PRINT(lastDay);
+    DEBUG_PRINT(" -> ");
+    DEBUG_PRINTLN(timeinfo.tm_mday);
   }
+  lastDay = timeinfo.tm_mday;
+  
+  // DST switch (last Sunday of March/October): the wall clock jumped an hour
+  int8_t dst = timeinfo.tm_isdst > 0 ? 1 : 0;
+  if (lastDst >= 0 && dst != lastDst) {
+    DEBUG_PRINT("DST transition: now ");
+    DEBUG_PRINTLN(dst ? "CEST" : "CET");
+    logEvent(EVT_TIME_DST_CHANGED, (unsigned int)dst);
+  }
+  lastDst = dst;
+  
+  TIME_ENTER_CRITICAL();
+  memcpy(cachedTime, timeText, sizeof(cachedTime));
+  memcpy(cachedDate, dateText, sizeof(cachedDate));
+  cachedHour = (uint8_t)timeinfo.tm_hour;
+  timeCacheValid = true;
+  TIME_EXIT_CRITICAL();
   
   // Call callback if registered and changes detected
   if (changeFlags != 0 && timeChangeCallback != nullptr) {
@@ -279,7 +358,10 @@ bool isTimeSynced() {
       if (now > MIN_VALID_TIME) {
         ntpSynced = true;
         DEBUG_PRINTLN("NTP sync detected");
-        logEvent("ntp_sync_success", nullptr);
+        logEvent(EVT_NTP_SYNC_SUCCESS);
+        
+        // The clock may have stepped - rebuild the cache and re-align the wake
+        triggerTimer("TimeCheck", 0);
         
         // Update RTC from NTP immediately if available
         if (rtcAvailable) {
@@ -308,53 +390,37 @@ bool isRtcAvailable() {
   return rtcAvailable;
 }
 
-// Format time as "hh:mm"
-bool formatTime(char* output, size_t outputSize) {
-  if (!isTimeSynced() || outputSize < 6) {
+// Current local hour, for schedules (from the minute-edge cache)
+bool getLocalHour(uint8_t* hour) {
+  if (!timeCacheValid) {
     return false;
   }
   
-  time_t now = time(nullptr);
-  struct tm timeinfo;
-  
-  #if defined(ESP32)
-    if (!getLocalTime(&timeinfo)) {
-      return false;
-    }
-  #elif defined(ESP8266)
-    localtime_r(&now, &timeinfo);
-  #endif
-  
-  // Format as "hh:mm" (with leading zeros)
-  snprintf(output, outputSize, "%02d:%02d", timeinfo.tm_hour, timeinfo.tm_min);
-  
-  // Periodic RTC sync from NTP (every hour)
-  if (rtcAvailable && ntpSynced && (millis() - lastRtcSync > RTC_SYNC_INTERVAL)) {
-    syncRtcFromNtp();
+  *hour = cachedHour;
+  return true;
+}
+
+// Copy the cached "hh:mm"
+bool formatTime(char* output, size_t outputSize) {
+  if (!timeCacheValid || outputSize < sizeof(cachedTime)) {
+    return false;
   }
   
+  TIME_ENTER_CRITICAL();
+  memcpy(output, cachedTime, sizeof(cachedTime));
+  TIME_EXIT_CRITICAL();
   return true;
 }
 
-// Format date as "dd-mm"
+// Copy the cached "dd-mm"
 bool formatDate(char* output, size_t outputSize) {
-  if (!isTimeSynced() || outputSize < 6) {
+  if (!timeCacheValid || outputSize < sizeof(cachedDate)) {
     return false;
   }
   
-  time_t now = time(nullptr);
-  struct tm timeinfo;
-  
-  #if defined(ESP32)
-    if (!getLocalTime(&timeinfo)) {
-      return false;
-    }
-  #elif defined(ESP8266)
-    localtime_r(&now, &timeinfo);
-  #endif
-  
-  // Format as "dd-mm" (with leading zeros)
-  snprintf(output, outputSize, "%02d-%02d", timeinfo.tm_mday, timeinfo.tm_mon + 1);
+  TIME_ENTER_CRITICAL();
+  memcpy(output, cachedDate, sizeof(cachedDate));
+  TIME_EXIT_CRITICAL();
   return true;
 }
 
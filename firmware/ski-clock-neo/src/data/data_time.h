@@ -29,16 +29,22 @@ bool isTimeSynced();
 // Check if RTC is present and operational
 bool isRtcAvailable();
 
-// Format current time as "hh.mm" (e.g., "09.53", "23.59")
-// Returns true if successful, false if time not synced
+// Copy the current time as "hh:mm" (e.g., "09:53", "23:59")
+// Precomputed at each minute edge - no timezone or formatting work per call
+// Returns true if successful, false if time not synced yet
 // Output buffer must be at least 6 bytes (5 chars + null terminator)
 bool formatTime(char* output, size_t outputSize);
 
-// Format current date as "dd-mm" (e.g., "01-01", "31-12")
-// Returns true if successful, false if time not synced
+// Copy the current date as "dd-mm" (e.g., "01-01", "31-12")
+// Precomputed at each minute edge, like formatTime()
+// Returns true if successful, false if time not synced yet
 // Output buffer must be at least 6 bytes (5 chars + null terminator)
 bool formatDate(char* output, size_t outputSize);
 
+// Get the current local hour (0-23, timezone applied, from the minute cache)
+// Returns false if time not synced yet
+bool getLocalHour(uint8_t* hour);
+
 // Force NTP resync (useful after long WiFi disconnection)
 // Also updates RTC if NTP sync succeeds
 void resyncTime();
@@ -61,8 +67,8 @@ void syncRtcFromNtp();
 // Callback is called with flags indicating what changed
 void setTimeChangeCallback(TimeChangeCallback callback);
 
-// Check for time changes and call callback if registered
-// Should be called periodically (e.g., every second or in main loop)
+// Rebuild the cached time/date strings and call the callback on changes
+// Runs at every minute edge from the TimeCheck timer (started by initTimeData)
 // Returns true if a change was detected
 bool checkTimeChange();
 
@@ -0,0 +1,292 @@
+// ============================================================================
+// display_bench.cpp - Render benchmarks and golden-frame checks
+// ============================================================================
+// Times the hot paths of the display pipeline and checks rendered frames
+// against stored references, so rendering optimisations can be measured and
+// glyph regressions caught before a release. Runs on the device ("bench"
+// command) and on the host (test/host/display_host_bench.cpp):
+// - textWidth, drawTextCenteredForRow, applySmoothScale2x, xyToIndex
+// - Full updateNeoPixels() frames (rasterise, expand, show)
+// - Golden frames: FNV-1a hash of the bit-packed buffer for fixed texts
+//
+// Runs are requested from any task and executed in the render context
+// (display task on ESP32, display timer on ESP8266), so they never race a
+// normal frame. The visible text is restored afterwards.
+// Only compiled with -DDISPLAY_BENCHMARK=1.
+// ============================================================================
+
+// ============================================================================
+// INCLUDES
+// ============================================================================
+
+#include "display_bench.h"         // This file's header
+
+#if DISPLAY_BENCHMARK
+
+#include "display_core.h"          // Text, frames and render control
+#include "fastled_render.h"        // Functions under test
+#include "../core/debug.h"         // For debug logging
+
+// ============================================================================
+// GOLDEN FRAMES
+// ============================================================================
+// Hashes were captured from the bit-packed buffer with the activity pixel
+// masked out. They are only valid for the reference geometry below - any
+// other panel configuration reports the check as skipped.
+// To refresh after an intentional glyph change, run the host benchmark (or a
+// device build with DEBUG_LOGGING) and copy the hashes it logs.
+
+#define GOLDEN_ROWS 2
+#define GOLDEN_ROW_WIDTH 64
+#define GOLDEN_ROW_HEIGHT 16
+
+struct GoldenFrame {
+  const char* text[GOLDEN_ROWS];
+  uint32_t hash;
+};
+
+static const GoldenFrame GOLDEN_FRAMES[] = {
+  {{"12:34", "-5,2*C"},       0xD90CA809},
+  {{"09-12", "23,5*C"},       0xC76DD9CB},
+  {{"~~:~~", "~~,~*C"},       0xBB52BB09},
+  {{"0123456789", "   3"},    0x5362F2EF},
+  {{"88:88", "-28,9*C"},      0x3D8945C7},
+};
+
+static const uint8_t GOLDEN_FRAME_COUNT = sizeof(GOLDEN_FRAMES) / sizeof(GOLDEN_FRAMES[0]);
+
+// A frame is re-rendered if another task changed the display mid-capture
+#define GOLDEN_MAX_ATTEMPTS 3
+
+// ============================================================================
+// STATE VARIABLES
+// ============================================================================
+
+static volatile bool benchmarkRequested = false;
+static volatile bool reportReady = false;
+static DisplayBenchmarkReport report;
+
+// Keeps benchmarked results observable so the compiler can't drop the calls
+static volatile uint32_t benchmarkSink = 0;
+
+// Texts cycled through by the text benchmarks
+static const char* const BENCH_TEXTS[] = {"12:34", "-5,2*C", "09-12", "23,5*C"};
+static const uint8_t BENCH_TEXT_COUNT = sizeof(BENCH_TEXTS) / sizeof(BENCH_TEXTS[0]);
+
+// ============================================================================
+// HELPERS
+// ============================================================================
+
+static uint32_t hashFrame(const uint8_t* data, uint16_t length) {
+  uint32_t hash = 2166136261UL;   // FNV-1a offset basis
+  for (uint16_t i = 0; i < length; i++) {
+    hash ^= data[i];
+    hash *= 16777619UL;           // FNV-1a prime
+  }
+  return hash;
+}
+
+static bool isGoldenGeometry(const DisplayConfig& cfg) {
+  if (cfg.rows != GOLDEN_ROWS) return false;
+  for (uint8_t row = 0; row < cfg.rows; row++) {
+    if (cfg.rowConfig[row].width != GOLDEN_ROW_WIDTH) return false;
+    if (cfg.rowConfig[row].height != GOLDEN_ROW_HEIGHT) return false;
+  }
+  return true;
+}
+
+// ============================================================================
+// BENCHMARKS
+// ============================================================================
+
+static void benchTextWidth(BenchmarkResult& result) {
+  for (uint8_t s = 0; s < BENCHMARK_SAMPLES; s++) {
+    uint32_t start = micros();
+    for (uint16_t i = 0; i < result.calls; i++) {
+      benchmarkSink += textWidth(BENCH_TEXTS[i % BENCH_TEXT_COUNT], 2);
+    }
+    recordTiming(result.sample, micros() - start);
+  }
+}
+
+static void benchDrawText(BenchmarkResult& result) {
+  for (uint8_t s = 0; s < BENCHMARK_SAMPLES; s++) {
+    uint32_t start = micros();
+    for (uint16_t i = 0; i < result.calls; i++) {
+      benchmarkDrawTextRow(0, BENCH_TEXTS[(s + i) % BENCH_TEXT_COUNT]);
+    }
+    recordTiming(result.sample, micros() - start);
+  }
+}
+
+static void benchSmoothScale(BenchmarkResult& result) {
+  static uint8_t scaled[FONT_HEIGHT * 2][20];
+  
+  for (uint8_t s = 0; s < BENCHMARK_SAMPLES; s++) {
+    uint32_t start = micros();
+    for (uint8_t gi = 0; gi < GLYPH_COUNT; gi++) {
+      applySmoothScale2x(&FONT_5x7[gi][0], FONT_WIDTH_TABLE[gi], FONT_HEIGHT, scaled);
+    }
+    recordTiming(result.sample, micros() - start);
+    benchmarkSink += scaled[0][0];
+    yield();
+  }
+}
+
+static void benchXyToIndex(BenchmarkResult& result, const RowConfig& rowCfg) {
+  for (uint8_t s = 0; s < BENCHMARK_SAMPLES; s++) {
+    uint32_t start = micros();
+    for (uint16_t y = 0; y < rowCfg.height; y++) {
+      for (uint16_t x = 0; x < rowCfg.width; x++) {
+        benchmarkSink += xyToIndex(x, y);
+      }
+    }
+    recordTiming(result.sample, micros() - start);
+  }
+}
+
+// Full frames: every row rasterised, expanded and pushed to the strips
+static void benchFullFrame(BenchmarkResult& result) {
+  for (uint8_t s = 0; s < BENCHMARK_SAMPLES; s++) {
+    setTextNoRender(0, BENCH_TEXTS[s % BENCH_TEXT_COUNT]);
+    markRowsDirty(ALL_ROWS_MASK);
+  
+    uint32_t start = micros();
+    updateNeoPixels();
+    recordTiming(result.sample, micros() - start);
+    yield();
+  }
+}
+
+// ============================================================================
+// GOLDEN FRAME CHECK
+// ============================================================================
+
+// Render one golden frame and hash it. Returns false if the display kept
+// changing underneath (concurrent setText() or activity blink).
+static bool captureGoldenFrame(const GoldenFrame& golden, const DisplayConfig& cfg, uint32_t& hash) {
+  for (uint8_t attempt = 0; attempt < GOLDEN_MAX_ATTEMPTS; attempt++) {
+    for (uint8_t row = 0; row < GOLDEN_ROWS; row++) {
+      setTextNoRender(row, golden.text[row]);
+    }
+    markRowsDirty(ALL_ROWS_MASK);
+    uint32_t startSeq = getUpdateSequence();
+    updateNeoPixels();
+  
+    // We are the renderer: beginFrame() hands back a private copy of the
+    // frame just committed without pinning it against the MQTT reader
+    uint8_t* frame = beginFrame();
+  
+    #if ACTIVITY_PIXEL_ENABLED
+    const RowConfig& lastRow = cfg.rowConfig[cfg.rows - 1];
+    uint16_t activityBit = lastRow.pixelOffset + (lastRow.height - 1) * lastRow.width + (lastRow.width - 1);
+    frame[activityBit / 8] &= ~(1 << (activityBit % 8));
+    #endif
+  
+    hash = hashFrame(frame, cfg.bufferSize);
+  
+    if (getUpdateSequence() == startSeq) {
+      return true;
+    }
+    yield();
+  }
+  return false;
+}
+
+static void checkGoldenFrames() {
+  DisplayConfig cfg = getDisplayConfig();
+  if (!isGoldenGeometry(cfg)) {
+    report.goldenSkipped = true;
+    DEBUG_PRINTLN("Golden frames skipped (not the reference panel geometry)");
+    return;
+  }
+  
+  for (uint8_t i = 0; i < GOLDEN_FRAME_COUNT; i++) {
+    uint32_t hash = 0;
+    bool captured = captureGoldenFrame(GOLDEN_FRAMES[i], cfg, hash);
+  
+    if (captured && hash == GOLDEN_FRAMES[i].hash) {
+      report.goldenPassed++;
+    } else {
+      report.goldenFailed++;
+      report.goldenFailMask |= (1 << i);
+      DEBUG_PRINT("Golden frame ");
+      DEBUG_PRINT(i);
+      DEBUG_PRINT(captured ? " mismatch, hash 0x" : " unstable, hash 0x");
+      DEBUG_PRINTLN(String(hash, HEX));
+    }
+  }
+}
+
+// ============================================================================
+// PUBLIC API
+// ============================================================================
+
+bool requestDisplayBenchmark() {
+  if (benchmarkRequested || reportReady) {
+    return false;
+  }
+  benchmarkRequested = true;
+  triggerRender();  // Wake the render context even if nothing is dirty
+  return true;
+}
+
+bool takeDisplayBenchmarkReport(DisplayBenchmarkReport& out) {
+  if (!reportReady) {
+    return false;
+  }
+  __sync_synchronize();
+  out = report;
+  reportReady = false;
+  return true;
+}
+
+BenchmarkResult* addBenchmarkResult(DisplayBenchmarkReport& target, const char* name, uint16_t calls) {
+  if (target.resultCount >= BENCHMARK_MAX_RESULTS) {
+    return nullptr;
+  }
+  BenchmarkResult& result = target.results[target.resultCount++];
+  result.name = name;
+  result.calls = calls;
+  resetTimingStat(result.sample);
+  return &result;
+}
+
+void runPendingDisplayBenchmark() {
+  if (!benchmarkRequested) {
+    return;
+  }
+  
+  DEBUG_PRINTLN("Running display benchmark...");
+  
+  char savedText[DISPLAY_ROWS][MAX_TEXT_LENGTH];
+  snapshotAllText(savedText);
+  
+  memset(&report, 0, sizeof(report));
+  DisplayConfig cfg = getDisplayConfig();
+  
+  benchTextWidth(*addBenchmarkResult(report, "text_width", 100));
+  benchDrawText(*addBenchmarkResult(report, "draw_text_row", 1));
+  benchSmoothScale(*addBenchmarkResult(report, "smooth_scale_2x", GLYPH_COUNT));
+  benchXyToIndex(*addBenchmarkResult(report, "xy_to_index", cfg.rowConfig[0].width * cfg.rowConfig[0].height), cfg.rowConfig[0]);
+  benchFullFrame(*addBenchmarkResult(report, "full_frame", 1));
+  checkGoldenFrames();
+  
+  // Put the real content back; the caller's render loop redraws it
+  for (uint8_t row = 0; row < DISPLAY_ROWS; row++) {
+    setTextNoRender(row, savedText[row]);
+  }
+  markRowsDirty(ALL_ROWS_MASK);
+  
+  DEBUG_PRINT("Display benchmark done, golden ");
+  DEBUG_PRINT(report.goldenPassed);
+  DEBUG_PRINT(" passed / ");
+  DEBUG_PRINT(report.goldenFailed);
+  DEBUG_PRINTLN(" failed");
+  
+  __sync_synchronize();
+  reportReady = true;
+  benchmarkRequested = false;
+}
+
+#endif // DISPLAY_BENCHMARK
@@ -0,0 +1,46 @@
+#ifndef DISPLAY_BENCH_H
+#define DISPLAY_BENCH_H
+
+#include <Arduino.h>                    // Core Arduino functionality for uint8_t, etc.
+#include "../../ski-clock-neo_config.h" // For DISPLAY_BENCHMARK
+#include "../core/timing_stats.h"       // Per-benchmark timing statistics
+
+#if DISPLAY_BENCHMARK
+
+#define BENCHMARK_MAX_RESULTS 8   // Display benchmarks + room for callers (snapshot encoding)
+#define BENCHMARK_SAMPLES 16      // Timed samples per benchmark
+
+// One benchmark: each sample times `calls` back-to-back invocations
+struct BenchmarkResult {
+  const char* name;
+  uint16_t calls;
+  TimingStat sample;
+};
+
+// Outcome of one benchmark run
+struct DisplayBenchmarkReport {
+  BenchmarkResult results[BENCHMARK_MAX_RESULTS];
+  uint8_t resultCount;
+  uint8_t goldenPassed;
+  uint8_t goldenFailed;
+  uint8_t goldenFailMask;     // Bit N set when golden frame N mismatched
+  bool goldenSkipped;         // Geometry differs from the one the references were captured on
+};
+
+// Request a run (any task). Returns false if one is already pending or its
+// report has not been collected yet. The run happens in the render context.
+bool requestDisplayBenchmark();
+
+// Copy out a finished report (true once per run)
+bool takeDisplayBenchmarkReport(DisplayBenchmarkReport& out);
+
+// Called by display_core from the render context before normal frames
+void runPendingDisplayBenchmark();
+
+// Append a caller-timed result (e.g. from MQTT code); record samples into the
+// returned slot. Returns nullptr if the report is full.
+BenchmarkResult* addBenchmarkResult(DisplayBenchmarkReport& report, const char* name, uint16_t calls);
+
+#endif // DISPLAY_BENCHMARK
+
+#endif
@@ -0,0 +1,184 @@
+// ============================================================================
+// display_brightness.cpp - Scheduled and ambient-adaptive display brightness
+// ============================================================================
+// This library decides how bright the display runs; display_core and the
+// renderer apply it:
+// - Levels are perceptual (0-255) and go through a gamma 2.2 LUT, built
+//   once at init, so equal steps look equal and low levels stay usable
+// - The cap is brightness_day, or brightness_night between night_start and
+//   night_end (local hours, from the device config - settable over MQTT)
+// - With a light sensor the level follows ambient light between
+//   BRIGHTNESS_MIN and the cap; without one it is the cap
+// - Changes ramp a few levels per 250 ms poll; sensor-driven targets only
+//   move past a small hysteresis, so the display never flickers on noise
+// - The renderer lowers whole frames further if they would exceed the
+//   POWER_BUDGET_MA current budget (see fastled_render.cpp)
+// ============================================================================
+
+// ============================================================================
+// INCLUDES
+// ============================================================================
+
+#include "display_brightness.h"        // This file's header
+#include "display_core.h"              // For the LED brightness scale
+#include "../../ski-clock-neo_config.h" // For brightness defaults
+#include "../data/data_light.h"        // Ambient light sensor
+#include "../data/data_time.h"         // Local hour for the night window
+#include "../core/device_config.h"     // Brightness schedule
+#include "../core/timer_helpers.h"     // For timer management
+#include "../core/debug.h"             // For debug logging
+#include <math.h>                      // For powf
+
+// ============================================================================
+// CONSTANTS
+// ============================================================================
+
+#define BRIGHTNESS_POLL_MS 250
+#define BRIGHTNESS_GAMMA 2.2f
+#define BRIGHTNESS_RAMP_STEP 4          // Levels per poll (~16 s from off to full)
+#define BRIGHTNESS_HYSTERESIS 6         // Ambient must move the target this far
+
+// ============================================================================
+// STATE VARIABLES
+// ============================================================================
+
+static uint8_t gammaLut[256];
+static volatile uint8_t currentLevel = 0;   // Level on the display
+static volatile uint8_t targetLevel = 0;    // Level being ramped towards
+static uint8_t targetCap = 0;               // Cap the target was derived from
+static volatile bool nightActive = false;
+static bool timeKnown = false;              // Schedule could be evaluated last poll
+
+// ============================================================================
+// FORWARD DECLARATIONS
+// ============================================================================
+
+void brightnessPollCallback();
+
+// ============================================================================
+// LEVEL CALCULATION
+// ============================================================================
+
+static void buildGammaLut() {
+  for (uint16_t i = 0; i < 256; i++) {
+    float scaled = powf(i / 255.0f, BRIGHTNESS_GAMMA) * 255.0f + 0.5f;
+    uint8_t value = (uint8_t)scaled;
+    // Keep every non-zero level visible
+    gammaLut[i] = (i > 0 && value == 0) ? 1 : value;
+  }
+}
+
+// Night window in local hours; wraps past midnight when start > end
+static bool isNightHour(const BrightnessSchedule& schedule, uint8_t hour) {
+  if (schedule.nightStartHour == schedule.nightEndHour) {
+    return false;
+  }
+  if (schedule.nightStartHour < schedule.nightEndHour) {
+    return hour >= schedule.nightStartHour && hour < schedule.nightEndHour;
+  }
+  return hour >= schedule.nightStartHour || hour < schedule.nightEndHour;
+}
+
+// Cap from the schedule (day cap until the clock is known)
+static uint8_t scheduledCap(bool* known) {
+  BrightnessSchedule schedule = getBrightnessSchedule();
+  uint8_t hour;
+  *known = getLocalHour(&hour);
+  nightActive = *known && isNightHour(schedule, hour);
+  return nightActive ? schedule.nightLevel : schedule.dayLevel;
+}
+
+// Level for the current light, between the floor and the cap
+static uint8_t ambientLevel(uint8_t cap) {
+  uint8_t floorLevel = (BRIGHTNESS_MIN < cap) ? BRIGHTNESS_MIN : cap;
+  uint16_t span = cap - floorLevel;
+  return floorLevel + (uint8_t)((span * getAmbientLight() + 127) / 255);
+}
+
+static void applyLevel(uint8_t level) {
+  currentLevel = level;
+  setDisplayBrightness(gammaLut[level]);
+}
+
+// Timer callback - re-evaluate the target and take one ramp step
+void brightnessPollCallback() {
+  bool known;
+  uint8_t cap = scheduledCap(&known);
+  
+  if (!isLightSensorPresent()) {
+    targetLevel = cap;
+  } else {
+    uint8_t level = ambientLevel(cap);
+    int16_t moved = (int16_t)level - (int16_t)targetLevel;
+    bool atLimit = level == cap || level == BRIGHTNESS_MIN;
+    if (cap != targetCap || atLimit || moved >= BRIGHTNESS_HYSTERESIS || -moved >= BRIGHTNESS_HYSTERESIS) {
+      targetLevel = level;
+    }
+  }
+  targetCap = cap;
+  
+  // The first poll that knows the time jumps straight to the schedule, so a
+  // night boot doesn't spend seconds ramping down from the day cap
+  if (known && !timeKnown) {
+    timeKnown = true;
+    applyLevel(targetLevel);
+    DEBUG_PRINT("Brightness set from schedule: ");
+    DEBUG_PRINTLN(targetLevel);
+    return;
+  }
+  timeKnown = known;
+  
+  uint8_t level = currentLevel;
+  if (level == targetLevel) {
+    return;
+  }
+  if (level < targetLevel) {
+    level = (targetLevel - level > BRIGHTNESS_RAMP_STEP) ? level + BRIGHTNESS_RAMP_STEP : targetLevel;
+  } else {
+    level = (level - targetLevel > BRIGHTNESS_RAMP_STEP) ? level - BRIGHTNESS_RAMP_STEP : targetLevel;
+  }
+  applyLevel(level);
+}
+
+// ============================================================================
+// INITIALIZATION
+// ============================================================================
+
+void initBrightness() {
+  buildGammaLut();
+  initLightData();
+  
+  // Start at the target - there is nothing on screen to ramp from yet
+  bool known;
+  targetCap = scheduledCap(&known);
+  targetLevel = isLightSensorPresent() ? ambientLevel(targetCap) : targetCap;
+  timeKnown = known;
+  applyLevel(targetLevel);
+  
+  createTimer("BrightnessPoll", BRIGHTNESS_POLL_MS, brightnessPollCallback);
+  
+  DEBUG_PRINT("Brightness initialized: level ");
+  DEBUG_PRINT(currentLevel);
+  DEBUG_PRINT(", LED scale ");
+  DEBUG_PRINT(gammaLut[currentLevel]);
+  #if POWER_BUDGET_MA > 0
+    DEBUG_PRINT(", budget ");
+    DEBUG_PRINT(POWER_BUDGET_MA);
+    DEBUG_PRINTLN(" mA");
+  #else
+    DEBUG_PRINTLN(", no power budget");
+  #endif
+}
+
+// ============================================================================
+// PUBLIC API
+// ============================================================================
+
+void getBrightnessStats(BrightnessStats& stats) {
+  stats.level = currentLevel;
+  stats.target = targetLevel;
+  stats.ambient = getAmbientLight();
+  stats.sensorPresent = isLightSensorPresent();
+  stats.night = nightActive;
+  getShownBrightness(stats.scale, stats.powerLimitedFrames);
+}
@@ -0,0 +1,24 @@
+#ifndef DISPLAY_BRIGHTNESS_H
+#define DISPLAY_BRIGHTNESS_H
+
+#include <Arduino.h>    // Include Arduino core for uint8_t, etc.
+
+// Brightness state for telemetry
+struct BrightnessStats {
+  uint8_t level;                // Current perceptual level (0-255)
+  uint8_t target;               // Level being ramped towards
+  uint8_t ambient;              // Smoothed light sensor reading (0 without one)
+  bool sensorPresent;           // Light sensor configured
+  bool night;                   // Night cap in force
+  uint8_t scale;                // LED scale of the last frame (gamma and power limit applied)
+  uint32_t powerLimitedFrames;  // Frames dimmed to stay within POWER_BUDGET_MA
+};
+
+// Build the gamma LUT, start the light sensor and the brightness poll
+// Sets the first brightness at once - call before the renderer is initialised
+void initBrightness();
+
+// Copy the current brightness state
+void getBrightnessStats(BrightnessStats& stats);
+
+#endif
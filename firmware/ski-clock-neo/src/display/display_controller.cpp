@@ -6,6 +6,7 @@
 // - Temperature display on row 1
 // - Button-controlled timer mode with countdown and elapsed time
 // - Time change detection for immediate updates
+// - Dashboard-pushed bitmaps held for a TTL in place of all content
 // ============================================================================
 
 // ============================================================================
@@ -30,6 +31,8 @@ static const uint8_t TICKS_PER_TOGGLE = 8;             // 8 ticks = 4 seconds fo
 static const uint8_t TICKS_PER_SECOND = 2;             // 2 ticks = 1 second for countdown/timer
 static const uint8_t FLASH_TICKS = 16;                 // 16 ticks = 8 seconds of flashing
 static const uint16_t RESULT_TICKS = 120;              // 120 ticks = 60 seconds result display
+static const uint16_t REMOTE_FRAME_DEFAULT_TTL_S = 60; // Pushed bitmap hold without a TTL
+static const uint16_t REMOTE_FRAME_MAX_TTL_S = 3600;   // Longest hold (7200 ticks)
 
 // ============================================================================
 // STATE VARIABLES
@@ -60,6 +63,10 @@ static bool flashVisible = true;                       // Toggle for flashing di
 static bool activityPixelState = false;
 #endif
 
+// Remote frame hold - written by the MQTT context, acted on by the tick
+static volatile uint16_t remoteFrameTicks = 0;         // Ticks to hold the pushed bitmap
+static volatile bool remoteFramePushed = false;        // New bitmap since the last tick
+
 // Transition guard to prevent rapid state changes
 static volatile bool transitionInProgress = false;
 static uint32_t lastTransitionTime = 0;
@@ -79,10 +86,35 @@ void startCountdown();
 void startTimer();
 void startFlashingResult();
 void startDisplayResult();
+bool startRemoteFrame();
 void returnToNormal();
 void cancelTimer();
 void onButtonPress();
 
+// ============================================================================
+// MODE HELPERS
+// ============================================================================
+
+// Mode name for display_mode_change events
+static const char* modeName(DisplayMode mode) {
+  switch (mode) {
+    case MODE_NORMAL:          return "normal";
+    case MODE_COUNTDOWN:       return "countdown";
+    case MODE_TIMER:           return "timer";
+    case MODE_FLASHING_RESULT: return "flashing_result";
+    case MODE_DISPLAY_RESULT:  return "display_result";
+    case MODE_REMOTE_FRAME:    return "remote_frame";
+  }
+  return "unknown";
+}
+
+// A run is in progress or its result is showing - pushed bitmaps must not
+// cut it off (elapsedSeconds would be lost)
+static bool isTimerMode(DisplayMode mode) {
+  return mode == MODE_COUNTDOWN || mode == MODE_TIMER ||
+         mode == MODE_FLASHING_RESULT || mode == MODE_DISPLAY_RESULT;
+}
+
 // ============================================================================
 // TIMER CALLBACKS
 // ============================================================================
@@ -102,6 +134,14 @@ void unifiedTickCallback() {
   }
   #endif
   
+  // A bitmap pushed since the last tick enters (or restarts) remote frame mode
+  if (remoteFramePushed) {
+    remoteFramePushed = false;
+    if (isRemoteFrameActive() && startRemoteFrame()) {
+      return;
+    }
+  }
+  
   // Capture current mode to prevent race conditions during state transitions
   DisplayMode mode = currentMode;
   
@@ -181,6 +221,15 @@ void unifiedTickCallback() {
         return;  // Exit immediately - returnToNormal handles its own update
       }
       break;
+      
+    case MODE_REMOTE_FRAME:
+      // Hold the bitmap for its TTL, or until endRemoteFrame() dropped it
+      if (!isRemoteFrameActive() || tickCounter >= remoteFrameTicks) {
+        clearRemoteFrame();
+        returnToNormal();
+        return;
+      }
+      break;
   }
   
   if (needsUpdate) {
@@ -364,7 +413,7 @@ void startCountdown() {
   timerTopRowState = 0;
   tickCounter = 0;  // Reset tick counter for synchronization
   
-  logEvent("button_press", "{\"action\":\"timer_start\"}");
+  logEvent(EVT_BUTTON_ACTION, "timer_start");
   
   updateBothRows();
   
@@ -392,7 +441,7 @@ void startFlashingResult() {
   flashVisible = true;
   tickCounter = 0;  // Reset tick counter for flash duration tracking
 
-  logEvent("button_press", "{\"action\":\"timer_stop\"}");
+  logEvent(EVT_BUTTON_ACTION, "timer_stop");
 
   updateBothRows();
   // NOTE: restartTimer() is called by onButtonPress() after this returns,
@@ -410,8 +459,30 @@ void startDisplayResult() {
   // from inside its own callback causes a crash.
 }
 
+// Enter (or restart the TTL of) remote frame mode - display_core already
+// shows the bitmap, so there is nothing to draw here. Returns false if the
+// button started a run after showRemoteFrame() accepted the push: the run
+// wins and the bitmap is dropped
+bool startRemoteFrame() {
+  if (isTimerMode(currentMode)) {
+    DEBUG_PRINTLN("Remote frame dropped, timer started first");
+    logEvent(EVT_DISPLAY_FRAME_BUSY, modeName(currentMode));
+    clearRemoteFrame();
+    return false;
+  }
+  
+  if (currentMode != MODE_REMOTE_FRAME) {
+    DEBUG_PRINTLN("Starting remote frame mode");
+    logEvent(EVT_DISPLAY_MODE_CHANGE, modeName(currentMode), modeName(MODE_REMOTE_FRAME));
+    currentMode = MODE_REMOTE_FRAME;
+  }
+  tickCounter = 0;  // TTL runs from the latest push
+  return true;
+}
+
 void returnToNormal() {
   DEBUG_PRINTLN("Returning to normal mode");
+  DisplayMode fromMode = currentMode;
   currentMode = MODE_NORMAL;
   showingTime = true;
   tickCounter = 0;  // Reset tick counter for synchronization
@@ -422,7 +493,7 @@ void returnToNormal() {
   countdownValue = 3;
   flashVisible = true;
 
-  logEvent("display_mode_change", "{\"from\":\"timer\",\"to\":\"normal\"}");
+  logEvent(EVT_DISPLAY_MODE_CHANGE, modeName(fromMode), modeName(MODE_NORMAL));
 
   updateBothRows();
   // NOTE: Do NOT call restartTimer() here - this may be called from within
@@ -432,7 +503,7 @@ void returnToNormal() {
 
 void cancelTimer() {
   DEBUG_PRINTLN("Timer cancelled");
-  logEvent("button_press", "{\"action\":\"timer_cancel\"}");
+  logEvent(EVT_BUTTON_ACTION, "timer_cancel");
   returnToNormal();
 }
 
@@ -483,6 +554,13 @@ void onButtonPress() {
       // Start new countdown (restartTimer is called inside startCountdown)
       startCountdown();
       break;
+      
+    case MODE_REMOTE_FRAME:
+      // Dismiss the pushed bitmap
+      clearRemoteFrame();
+      returnToNormal();
+      restartTimer("DisplayTick");  // Sync timer phase after dismiss
+      break;
   }
   
   transitionInProgress = false;
@@ -508,14 +586,17 @@ void initDisplayController() {
   
   DEBUG_PRINTLN("Display controller initialized");
   
-  // Initialize data libraries LAST - allows display to show immediately during boot
-  
   // Time library: NTP sync for Sweden timezone (CET/CEST)
+  // Reads the RTC and renders the time - the first frame a guest sees
   initTimeData();
   
   // Register time change callback
   setTimeChangeCallback(onTimeChange);
-  
+}
+
+// Second boot stage, once the time is on screen: sensor discovery and the
+// button (row 1 shows its placeholder until the first reading)
+void initDisplayInputs() {
   // Temperature library: DS18B20 sensor with automatic 30-second polling
   initTemperatureData();
   
@@ -550,6 +631,35 @@ DisplayMode getDisplayMode() {
   return currentMode;
 }
 
+// Pushed bitmap - shown by display_core at once; the mode follows on the next tick
+bool showRemoteFrame(const uint8_t* data, uint16_t length, uint16_t ttlSeconds) {
+  // Runs and their results keep the display (checked again on the tick, in
+  // case the button is pressed before then)
+  DisplayMode mode = currentMode;
+  if (isTimerMode(mode)) {
+    DEBUG_PRINTLN("Remote frame rejected, timer running");
+    logEvent(EVT_DISPLAY_FRAME_BUSY, modeName(mode));
+    return false;
+  }
+  
+  if (ttlSeconds == 0) {
+    ttlSeconds = REMOTE_FRAME_DEFAULT_TTL_S;
+  } else if (ttlSeconds > REMOTE_FRAME_MAX_TTL_S) {
+    ttlSeconds = REMOTE_FRAME_MAX_TTL_S;
+  }
+  
+  if (!pushRemoteFrame(data, length)) {
+    return false;
+  }
+  remoteFrameTicks = ttlSeconds * TICKS_PER_SECOND;
+  remoteFramePushed = true;
+  return true;
+}
+
+void endRemoteFrame() {
+  clearRemoteFrame();
+}
+
 // Force update of all display rows
 void forceDisplayUpdate() {
   updateBothRows();
@@ -9,20 +9,36 @@ enum DisplayMode {
   MODE_COUNTDOWN,       // Countdown 3, 2, 1 before timer starts
   MODE_TIMER,           // Timer running (00:00, 00:01, ...)
   MODE_FLASHING_RESULT, // Elapsed time flashing (0.5s interval for 8 seconds)
-  MODE_DISPLAY_RESULT   // Elapsed time solid for 1 minute, then auto-revert
+  MODE_DISPLAY_RESULT,  // Elapsed time solid for 1 minute, then auto-revert
+  MODE_REMOTE_FRAME     // Dashboard-pushed bitmap held for its TTL, then auto-revert
 };
 
 // Initialize display controller
-// Initializes time/temperature data libraries at the end
-// Display shows immediately, then data libraries init in background
+// Initializes the time library at the end, so the RTC time is rendered as
+// soon as this returns
 void initDisplayController();
 
+// Temperature sensor discovery and button input - a later boot stage, run
+// after the first frame is up (see setup())
+void initDisplayInputs();
+
 // Set display mode (normal or timer mode)
 void setDisplayMode(DisplayMode mode);
 
 // Get current display mode
 DisplayMode getDisplayMode();
 
+// Show a dashboard-pushed bitmap (display_core frame buffer layout, see
+// pushRemoteFrame()) for ttlSeconds (0 = 60 s, capped at an hour)
+// Refused while a timer run or its result is showing; a new push replaces
+// the image and restarts the TTL. Safe to call from the MQTT context - the
+// mode itself changes on the next display tick. Returns false for a bitmap
+// of the wrong size or a busy display
+bool showRemoteFrame(const uint8_t* data, uint16_t length, uint16_t ttlSeconds);
+
+// Drop the pushed bitmap now (normal mode resumes on the next tick)
+void endRemoteFrame();
+
 // Force immediate update of all display rows
 // Useful after WiFi reconnection or manual refresh
 void forceDisplayUpdate();
@@ -3,7 +3,9 @@
 // ============================================================================
 // This library manages a bit-packed display buffer and text content for each
 // row. It provides thread-safe text updates with atomic operations and
-// event-driven rendering via FreeRTOS tasks (ESP32) or TickTwo timers (ESP8266).
+// event-driven rendering via FreeRTOS tasks (ESP32) or a one-shot scheduler timer (ESP8266).
+// Frames are triple-buffered: the renderer draws into a back buffer and
+// publishes it with an index swap, so readers never need a critical section.
 // The actual pixel rendering is delegated to neopixel_render.h.
 // ============================================================================
 
@@ -15,6 +17,8 @@
 #include "display_controller.h"    // For display controller callbacks
 //#include "neopixel_render.h"     // Replaced with fastled_render.h
 #include "fastled_render.h"        // For hardware-specific rendering
+#include "display_bench.h"         // For benchmark runs in the render context
+#include "display_brightness.h"    // For the initial brightness
 #include "../core/timer_helpers.h" // For unified tick timer
 #include "../core/debug.h"         // For debug logging
 #include <string.h>                // For strncpy, strcmp
@@ -31,22 +35,56 @@
   #define DISPLAY_EXIT_CRITICAL() interrupts()
 #endif
 
+// Full memory barrier for the lock-free frame handoff (memw on Xtensa)
+#define DISPLAY_MEMORY_BARRIER() __sync_synchronize()
+
 // ============================================================================
 // STATE VARIABLES
 // ============================================================================
 
-// Display buffer storage (final rendered output for MQTT snapshots)
-uint8_t displayBuffer[MAX_DISPLAY_BUFFER_SIZE] = {0};
+// Frame buffer storage (final rendered output for MQTT snapshots)
+// At any time one buffer is the published front, one may be pinned by a
+// reader, and the renderer owns a third - so commits never touch a buffer
+// that is being read. Single reader (MQTT publishing on the main loop).
+#define FRAME_BUFFER_COUNT 3
+#define NO_PINNED_BUFFER 0xFF
+static uint8_t frameBuffers[FRAME_BUFFER_COUNT][MAX_DISPLAY_BUFFER_SIZE] = {{0}};
+static uint32_t frameSequences[FRAME_BUFFER_COUNT] = {0}; // Frame number held by each buffer
+static volatile uint8_t frontIndex = 0;                   // Latest committed frame
+static volatile uint8_t backIndex = 1;                    // Buffer the renderer draws into
+static volatile uint8_t pinnedIndex = NO_PINNED_BUFFER;   // Buffer held by a reader
+static uint32_t frameCounter = 0;                         // Incremented on every commit
 DisplayConfig displayConfig = {0};
 
 // Text content storage (what should be displayed on each row)
 char displayText[DISPLAY_ROWS][MAX_TEXT_LENGTH] = {{0}};
 
 // Event-driven rendering state
-static volatile bool displayDirty = false;           // True when display needs re-rendering
+static volatile uint8_t dirtyRowMask = 0;            // Bit N set when row N needs re-rendering
+static volatile bool activityPixelDirty = false;     // True when only the activity pixel changed
 static volatile bool renderRequested = false;        // Flag for deferred rendering
 static volatile uint32_t updateSequence = 0;         // Sequence counter to detect concurrent updates
 static RenderCallback renderCallback = nullptr;      // Optional callback after render
+static volatile uint8_t displayBrightness = BRIGHTNESS;  // Requested LED scale
+static volatile bool brightnessDirty = false;        // Scale changed, frame must be re-sent
+
+// Marquee state
+static char marqueeText[DISPLAY_ROWS][MAX_TEXT_LENGTH] = {{0}};
+static volatile uint8_t marqueeRowMask = 0;          // Rows in marquee mode
+static volatile uint8_t marqueeChangedMask = 0;      // Rows whose strip must be rebuilt
+static volatile uint8_t marqueeFrameMask = 0;        // Rows due the next scroll step
+
+// Remote frame state
+// Same idea as the frame buffers: the pusher (MQTT callback) fills its own
+// slot, the renderer reads its own, and the lock only swaps either with the
+// latest pushed slot - no bitmap is copied under the lock
+#define REMOTE_FRAME_SLOTS 3
+static uint8_t remoteFrames[REMOTE_FRAME_SLOTS][MAX_DISPLAY_BUFFER_SIZE];  // MQTT buffer is reused
+static uint8_t remoteFillIndex = 0;                  // Slot the next push is copied into
+static uint8_t remoteReadyIndex = 1;                 // Latest pushed bitmap
+static uint8_t remoteTakenIndex = 2;                 // Slot the renderer last took
+static volatile bool remoteFrameActive = false;      // Pushed bitmap replaces all rows
+static volatile bool remoteFrameDirty = false;       // Ready slot not yet taken by the renderer
 
 // Platform-specific synchronization primitives
 #if defined(ESP32)
@@ -59,6 +97,7 @@ static RenderCallback renderCallback = nullptr;      // Optional callback after
 // ============================================================================
 
 void displayRenderCallback();
+void marqueeFrameCallback();
 
 // ============================================================================
 // RENDER CALLBACKS (called by timer/task system)
@@ -66,8 +105,13 @@ void displayRenderCallback();
 
 // Display rendering callback - shared logic for both platforms
 // ESP32: Called from notification-based FreeRTOS task
-// ESP8266: Called from 1ms timer (only when dirty flag is set)
+// ESP8266: Called from a zero-delay one-shot timer armed by setText()/triggerRender()
 void displayRenderCallback() {
+  #if DISPLAY_BENCHMARK
+  // Requested runs execute here so they never race a normal frame
+  runPendingDisplayBenchmark();
+  #endif
+  
   // Only render if display is dirty
   if (!isDisplayDirty()) {
     return;
@@ -91,6 +135,17 @@ void displayRenderCallback() {
   }
 }
 
+// Marquee frame pacing - asks the render context for one scroll step
+// Frames the renderer hasn't caught up with are merged, never queued
+void marqueeFrameCallback() {
+  DISPLAY_ENTER_CRITICAL();
+  marqueeFrameMask |= marqueeRowMask;
+  updateSequence++;
+  renderRequested = true;
+  DISPLAY_EXIT_CRITICAL();
+  triggerRender();
+}
+
 #if defined(ESP32)
 // FreeRTOS rendering task for ESP32
 // Blocks on task notification, woken immediately when display becomes dirty
@@ -134,6 +189,10 @@ void initDisplay() {
   displayConfig.bufferSize = (totalPixels + 7) / 8;
   
   clearDisplayBuffer();
+  resetRenderTimingStats();
+
+  // Brightness before the renderer, so the first frame goes out at the right level
+  initBrightness();
 
   // Initialize hardware renderer (NeoPixels)
   initNeoPixels();
@@ -144,9 +203,19 @@ void initDisplay() {
     // Task blocks on ulTaskNotifyTake() until notified
     displayTaskHandle = createNotificationTask("Display", displayTask, 2048, 2);
   #elif defined(ESP8266)
-    // ESP8266: Use 1ms polling timer (checks dirty flag each iteration)
-    createTimer("Display", 1, displayRenderCallback);
+    // ESP8266: Zero-delay one-shot, armed by setText()/triggerRender() so the
+    // render runs on the next updateTimers() pass instead of being polled
+    createOneShotTimer("Display", 0, displayRenderCallback);
+  #endif
+
+  // Marquee frame timer - ESP32 paces frames from its own task so scrolling
+  // stays steady whatever the scheduler is doing; idle until a marquee starts
+  #if defined(ESP32)
+    createDedicatedTimer("MarqueeFrame", MARQUEE_FRAME_MS, marqueeFrameCallback);
+  #else
+    createTimer("MarqueeFrame", MARQUEE_FRAME_MS, marqueeFrameCallback);
   #endif
+  stopTimer("MarqueeFrame");
 
   // Initialize display controller to handle content logic (time/date/temp)
   initDisplayController();
@@ -169,20 +238,20 @@ void setText(uint8_t row, const char* text) {
     strncpy(displayText[row], text, MAX_TEXT_LENGTH - 1);
     displayText[row][MAX_TEXT_LENGTH - 1] = '\0';
     updateSequence++;
-    displayDirty = true;
+    dirtyRowMask |= (1 << row);
     renderRequested = true;
     textChanged = true;
   }
   DISPLAY_EXIT_CRITICAL();
   
-  #if defined(ESP32)
-    // Wake rendering task immediately (outside critical section)
-    if (textChanged) {
+  // Wake rendering immediately (outside critical section)
+  if (textChanged) {
+    #if defined(ESP32)
       notifyTask(displayTaskHandle);  // Immediate wakeup, no delay!
-    }
-  #else
-    (void)textChanged;  // Suppress unused warning on ESP8266
-  #endif
+    #elif defined(ESP8266)
+      triggerTimer("Display");
+    #endif
+  }
 }
 
 // Set text for a specific row without triggering render (for batch updates)
@@ -197,7 +266,7 @@ bool setTextNoRender(uint8_t row, const char* text) {
     strncpy(displayText[row], text, MAX_TEXT_LENGTH - 1);
     displayText[row][MAX_TEXT_LENGTH - 1] = '\0';
     updateSequence++;
-    displayDirty = true;
+    dirtyRowMask |= (1 << row);
     renderRequested = true;
     changed = true;
   }
@@ -211,8 +280,9 @@ void triggerRender() {
     if (displayTaskHandle != nullptr) {
       notifyTask(displayTaskHandle);
     }
+  #elif defined(ESP8266)
+    triggerTimer("Display");
   #endif
-  // On ESP8266, the 1ms polling timer will pick up renderRequested flag
 }
 
 // Get text for a specific row (read-only)
@@ -239,7 +309,7 @@ DisplayConfig getDisplayConfig() {
   return displayConfig;
 }
 
-// Set a single pixel in the display buffer
+// Set a single pixel in the back buffer (between beginFrame() and commitFrame())
 void setPixel(uint8_t row, uint16_t x, uint16_t y, bool state) {
   if (row >= displayConfig.rows) return;
   
@@ -255,33 +325,74 @@ void setPixel(uint8_t row, uint16_t x, uint16_t y, bool state) {
   
   if (byteIndex >= displayConfig.bufferSize) return;
   
+  uint8_t* buffer = frameBuffers[backIndex];
   if (state) {
-    displayBuffer[byteIndex] |= (1 << bitIndex);
+    buffer[byteIndex] |= (1 << bitIndex);
   } else {
-    displayBuffer[byteIndex] &= ~(1 << bitIndex);
+    buffer[byteIndex] &= ~(1 << bitIndex);
   }
 }
 
-// Clear the entire display buffer
+// Clear every frame buffer (initialization only - not safe against readers)
 void clearDisplayBuffer() {
-  memset(displayBuffer, 0, sizeof(displayBuffer));
+  memset(frameBuffers, 0, sizeof(frameBuffers));
 }
 
-// Commit a render buffer to the display buffer (thread-safe)
-void commitBuffer(const uint8_t* renderBuffer, uint16_t bufferSize) {
-  if (bufferSize > sizeof(displayBuffer)) {
-    bufferSize = sizeof(displayBuffer);
+// Start a frame: seed the back buffer with the current front so rows the
+// renderer leaves untouched carry over, or with a whole new frame (a taken
+// remote bitmap). Copy runs with interrupts enabled - only the renderer ever
+// writes the back buffer or moves the front index.
+uint8_t* beginFrame(const uint8_t* seed) {
+  uint8_t* back = frameBuffers[backIndex];
+  memcpy(back, seed != nullptr ? seed : frameBuffers[frontIndex], displayConfig.bufferSize);
+  return back;
+}
+
+// Publish the back buffer as the new front (index swap, no copy)
+void commitFrame() {
+  uint8_t published = backIndex;
+  frameSequences[published] = ++frameCounter;
+  
+  DISPLAY_MEMORY_BARRIER();  // Frame contents visible before the index moves
+  frontIndex = published;
+  DISPLAY_MEMORY_BARRIER();  // Pairs with the barrier in acquireDisplayBuffer()
+  
+  // Next back buffer: neither the new front nor one a reader is holding
+  uint8_t pinned = pinnedIndex;
+  for (uint8_t i = 0; i < FRAME_BUFFER_COUNT; i++) {
+    if (i != published && i != pinned) {
+      backIndex = i;
+      break;
+    }
   }
+}
+
+// Pin the current front buffer for reading (used by MQTT snapshot)
+// After pinning, re-check the front index: if a commit raced us, the writer
+// may not have seen the pin, so retry on the newer front
+const uint8_t* acquireDisplayBuffer(uint32_t* sequence) {
+  uint8_t front;
+  do {
+    front = frontIndex;
+    pinnedIndex = front;
+    DISPLAY_MEMORY_BARRIER();
+  } while (frontIndex != front);
   
-  // Use critical section to ensure atomic update (prevents MQTT from reading half-updated buffer)
-  DISPLAY_ENTER_CRITICAL();
-  memcpy(displayBuffer, renderBuffer, bufferSize);
-  DISPLAY_EXIT_CRITICAL();
+  if (sequence != nullptr) {
+    *sequence = frameSequences[front];
+  }
+  return frameBuffers[front];
 }
 
-// Get pointer to display buffer (for MQTT snapshots)
-const uint8_t* getDisplayBuffer() {
-  return displayBuffer;
+// Release the buffer pinned by acquireDisplayBuffer()
+void releaseDisplayBuffer() {
+  DISPLAY_MEMORY_BARRIER();  // Finish all reads before the writer may reuse it
+  pinnedIndex = NO_PINNED_BUFFER;
+}
+
+// Get frame number of the latest committed frame
+uint32_t getFrameSequence() {
+  return frameSequences[frontIndex];
 }
 
 // Get size of display buffer in bytes
@@ -290,22 +401,40 @@ uint16_t getDisplayBufferSize() {
 }
 
 // ============================================================================
-// SNAPSHOT & RENDER CONTROL (Public API)
+// RENDER CONTROL (Public API)
 // ============================================================================
 
-// Create snapshot buffer on-demand (delegates to hardware renderer)
-void createSnapshotBuffer() {
-  createNeopixelSnapshot();
-}
-
 // Check if display needs re-rendering
 bool isDisplayDirty() {
-  return displayDirty;
+  return dirtyRowMask != 0 || activityPixelDirty || marqueeFrameMask != 0 || brightnessDirty ||
+         remoteFrameDirty;
+}
+
+// Get bitmask of rows needing re-rendering
+uint8_t getDirtyRowMask() {
+  return dirtyRowMask;
 }
 
-// Clear the dirty flag
+// Check if the activity pixel overlay needs refreshing
+bool isActivityPixelDirty() {
+  return activityPixelDirty;
+}
+
+// Mark rows dirty (forces redraw of their content on next render)
+void markRowsDirty(uint8_t rowMask) {
+  DISPLAY_ENTER_CRITICAL();
+  dirtyRowMask |= (rowMask & ALL_ROWS_MASK);
+  updateSequence++;
+  renderRequested = true;
+  DISPLAY_EXIT_CRITICAL();
+}
+
+// Clear all dirty flags
 void clearDirtyFlag() {
-  displayDirty = false;
+  dirtyRowMask = 0;
+  activityPixelDirty = false;
+  marqueeFrameMask = 0;
+  brightnessDirty = false;
 }
 
 // Check if a render has been requested
@@ -334,7 +463,10 @@ bool clearRenderFlagsIfUnchanged(uint32_t startSeq) {
   
     DISPLAY_ENTER_CRITICAL();
     if (updateSequence == startSeq) {
-      displayDirty = false;
+      dirtyRowMask = 0;
+      activityPixelDirty = false;
+      marqueeFrameMask = 0;
+      brightnessDirty = false;
       renderRequested = false;
       cleared = true;
     }
@@ -348,11 +480,146 @@ RenderCallback getRenderCallback() {
   return renderCallback;
 }
 
-// Force immediate render (bypasses dirty flag check)
+// Force immediate render of all rows (bypasses dirty flag check)
 void renderNow() {
+  markRowsDirty(ALL_ROWS_MASK);
   updateNeoPixels();
 }
 
+// ============================================================================
+// MARQUEE (Public API)
+// ============================================================================
+
+void startMarquee(uint8_t row, const char* text) {
+  if (row >= displayConfig.rows) return;  // Bounds check
+
+  DISPLAY_ENTER_CRITICAL();
+  bool wasIdle = marqueeRowMask == 0;
+  strncpy(marqueeText[row], text, MAX_TEXT_LENGTH - 1);
+  marqueeText[row][MAX_TEXT_LENGTH - 1] = '\0';
+  marqueeRowMask |= (1 << row);
+  marqueeChangedMask |= (1 << row);
+  dirtyRowMask |= (1 << row);
+  updateSequence++;
+  renderRequested = true;
+  DISPLAY_EXIT_CRITICAL();
+
+  if (wasIdle) {
+    restartTimer("MarqueeFrame");
+  }
+  triggerRender();
+}
+
+void stopMarquee(uint8_t row) {
+  if (row >= displayConfig.rows) return;  // Bounds check
+
+  DISPLAY_ENTER_CRITICAL();
+  bool wasActive = (marqueeRowMask & (1 << row)) != 0;
+  marqueeRowMask &= ~(1 << row);
+  marqueeChangedMask &= ~(1 << row);
+  bool nowIdle = marqueeRowMask == 0;
+  if (wasActive) {
+    // Back to the row's static text
+    dirtyRowMask |= (1 << row);
+    updateSequence++;
+    renderRequested = true;
+  }
+  DISPLAY_EXIT_CRITICAL();
+
+  if (!wasActive) return;
+  if (nowIdle) {
+    stopTimer("MarqueeFrame");
+  }
+  triggerRender();
+}
+
+uint8_t getMarqueeRowMask() {
+  return marqueeRowMask;
+}
+
+uint8_t getMarqueeFrameMask() {
+  return marqueeFrameMask;
+}
+
+uint8_t takeMarqueeChanges(char dest[][MAX_TEXT_LENGTH]) {
+  DISPLAY_ENTER_CRITICAL();
+  uint8_t changed = marqueeChangedMask;
+  for (uint8_t row = 0; row < DISPLAY_ROWS; row++) {
+    if (changed & (1 << row)) {
+      strncpy(dest[row], marqueeText[row], MAX_TEXT_LENGTH);
+    }
+  }
+  marqueeChangedMask = 0;
+  DISPLAY_EXIT_CRITICAL();
+  return changed;
+}
+
+// ============================================================================
+// REMOTE FRAME (Public API)
+// ============================================================================
+
+bool pushRemoteFrame(const uint8_t* data, uint16_t length) {
+  if (length != displayConfig.bufferSize) {
+    DEBUG_PRINT("Remote frame rejected: ");
+    DEBUG_PRINT(length);
+    DEBUG_PRINT(" bytes, expected ");
+    DEBUG_PRINTLN(displayConfig.bufferSize);
+    return false;
+  }
+
+  // Only this context touches the fill slot, so the copy needs no lock
+  memcpy(remoteFrames[remoteFillIndex], data, length);
+
+  DISPLAY_ENTER_CRITICAL();
+  uint8_t filled = remoteFillIndex;
+  remoteFillIndex = remoteReadyIndex;  // An untaken older push is simply dropped
+  remoteReadyIndex = filled;
+  remoteFrameActive = true;
+  remoteFrameDirty = true;
+  updateSequence++;
+  renderRequested = true;
+  DISPLAY_EXIT_CRITICAL();
+
+  triggerRender();
+  return true;
+}
+
+void clearRemoteFrame() {
+  DISPLAY_ENTER_CRITICAL();
+  bool wasActive = remoteFrameActive;
+  remoteFrameActive = false;
+  remoteFrameDirty = false;
+  if (wasActive) {
+    // Text kept updating underneath - redraw it all
+    dirtyRowMask = ALL_ROWS_MASK;
+    updateSequence++;
+    renderRequested = true;
+  }
+  DISPLAY_EXIT_CRITICAL();
+
+  if (wasActive) {
+    triggerRender();
+  }
+}
+
+bool isRemoteFrameActive() {
+  return remoteFrameActive;
+}
+
+const uint8_t* takeRemoteFrame() {
+  const uint8_t* taken = nullptr;
+  DISPLAY_ENTER_CRITICAL();
+  if (remoteFrameDirty) {
+    uint8_t ready = remoteReadyIndex;
+    remoteReadyIndex = remoteTakenIndex;
+    remoteTakenIndex = ready;
+    remoteFrameDirty = false;
+    taken = remoteFrames[ready];
+  }
+  DISPLAY_EXIT_CRITICAL();
+  return taken;
+}
+
 // ============================================================================
 // ACTIVITY PIXEL STATE (hardware-agnostic storage)
 // ============================================================================
@@ -361,13 +628,96 @@ void renderNow() {
 static bool activityPixelVisible = false;
 
 void setActivityPixelVisible(bool visible) {
+  DISPLAY_ENTER_CRITICAL();
   activityPixelVisible = visible;
-  // Mark display dirty so updateNeoPixels() will run
-  displayDirty = true;
+  // Overlay-only change: renderer updates the single LED without redrawing rows
+  activityPixelDirty = true;
+  updateSequence++;
   renderRequested = true;
+  DISPLAY_EXIT_CRITICAL();
 }
 
 bool getActivityPixelVisible() {
   return activityPixelVisible;
 }
-#endif
\ No newline at end of file
+#endif
+
+// ============================================================================
+// BRIGHTNESS (Public API)
+// ============================================================================
+
+static uint8_t shownBrightness = 0;
+static uint32_t powerLimitedFrameCount = 0;
+
+void setDisplayBrightness(uint8_t scale) {
+  DISPLAY_ENTER_CRITICAL();
+  bool changed = displayBrightness != scale;
+  if (changed) {
+    displayBrightness = scale;
+    brightnessDirty = true;
+    updateSequence++;
+    renderRequested = true;
+  }
+  DISPLAY_EXIT_CRITICAL();
+
+  if (changed) {
+    triggerRender();
+  }
+}
+
+uint8_t getDisplayBrightness() {
+  return displayBrightness;
+}
+
+bool isBrightnessDirty() {
+  return brightnessDirty;
+}
+
+void recordShownBrightness(uint8_t scale, bool powerLimited) {
+  DISPLAY_ENTER_CRITICAL();
+  shownBrightness = scale;
+  if (powerLimited) {
+    powerLimitedFrameCount++;
+  }
+  DISPLAY_EXIT_CRITICAL();
+}
+
+void getShownBrightness(uint8_t& scale, uint32_t& powerLimitedFrames) {
+  DISPLAY_ENTER_CRITICAL();
+  scale = shownBrightness;
+  powerLimitedFrames = powerLimitedFrameCount;
+  DISPLAY_EXIT_CRITICAL();
+}
+
+// ============================================================================
+// RENDER TIMING
+// ============================================================================
+
+static TimingStat frameBuildStats;
+static TimingStat frameShowStats;
+
+void recordFrameBuildTime(uint32_t us) {
+  DISPLAY_ENTER_CRITICAL();
+  recordTiming(frameBuildStats, us);
+  DISPLAY_EXIT_CRITICAL();
+}
+
+void recordFrameShowTime(uint32_t us) {
+  DISPLAY_ENTER_CRITICAL();
+  recordTiming(frameShowStats, us);
+  DISPLAY_EXIT_CRITICAL();
+}
+
+void getRenderTimingStats(TimingStat& build, TimingStat& show) {
+  DISPLAY_ENTER_CRITICAL();
+  build = frameBuildStats;
+  show = frameShowStats;
+  DISPLAY_EXIT_CRITICAL();
+}
+
+void resetRenderTimingStats() {
+  DISPLAY_ENTER_CRITICAL();
+  resetTimingStat(frameBuildStats);
+  resetTimingStat(frameShowStats);
+  DISPLAY_EXIT_CRITICAL();
+}
@@ -3,17 +3,21 @@
 
 #include <Arduino.h>                    // Core Arduino functionality for uint8_t, etc.
 #include "../../ski-clock-neo_config.h" // Import display dimensions from shared config
+#include "../core/timing_stats.h"       // For render timing statistics
 
-// Maximum panels per row (for buffer sizing) - use largest configured row
-#define MAX_PANELS_PER_ROW 4
+// Widest configured row, computed at compile time from PANELS_PER_ROW
+#define MAX_PANELS_PER_ROW getMaxPanelsPerRow()
 #define MAX_ROW_WIDTH (MAX_PANELS_PER_ROW * PANEL_WIDTH)
 #define ROW_HEIGHT PANEL_HEIGHT
 
-// Maximum buffer size (worst case: all rows at max width)
-#define MAX_DISPLAY_BUFFER_SIZE ((DISPLAY_ROWS * MAX_ROW_WIDTH * ROW_HEIGHT) / 8)
+// Display buffer size - exactly the configured rows, one bit per pixel
+#define MAX_DISPLAY_BUFFER_SIZE ((getTotalPixels() + 7) / 8)
 
 #define MAX_TEXT_LENGTH 32
 
+// Bitmask with one bit per display row (bit N = row N), used for dirty tracking
+#define ALL_ROWS_MASK ((uint8_t)((1 << DISPLAY_ROWS) - 1))
+
 // Display row configuration structure (per-row dimensions)
 struct RowConfig {
   uint8_t panels;         // Number of panels in this row
@@ -32,8 +36,6 @@ struct DisplayConfig {
   uint16_t bufferSize;              // Total buffer size in bytes
 };
 
-// Display buffer - stores on/off state for each pixel (1 bit per pixel, packed into bytes)
-extern uint8_t displayBuffer[MAX_DISPLAY_BUFFER_SIZE];
 extern DisplayConfig displayConfig;
 
 // Text content for each row (what should be displayed)
@@ -69,30 +71,45 @@ const char* getText(uint8_t row);
 // This prevents torn reads when setText() and rendering overlap
 void snapshotAllText(char dest[][MAX_TEXT_LENGTH]);
 
-// Set pixel state in buffer (called by render libraries during frame construction)
+// Set pixel state in the back buffer (called by render libraries during frame construction)
 void setPixel(uint8_t row, uint16_t x, uint16_t y, bool state);
 
-// Clear entire display buffer
+// Clear all frame buffers (initialization only)
 void clearDisplayBuffer();
 
-// Commit complete rendered frame to display buffer (called by render libraries)
-// This atomically updates the buffer that MQTT reads from
-void commitBuffer(const uint8_t* renderBuffer, uint16_t bufferSize);
+// Frame buffers - 1 bit per pixel, packed into bytes, triple-buffered
+// Writer (render libraries): beginFrame() returns the back buffer seeded with
+// the current frame (or with seed, a whole frame in the same layout); draw
+// into it, then commitFrame() publishes it by index swap
+uint8_t* beginFrame(const uint8_t* seed = nullptr);
+void commitFrame();
+
+// Reader (MQTT snapshot): pin the latest frame, read it, then release
+// No critical section - the writer never draws into a pinned buffer
+// Only one reader may hold a buffer at a time
+const uint8_t* acquireDisplayBuffer(uint32_t* sequence = nullptr);
+void releaseDisplayBuffer();
 
-// Get display buffer pointer for direct access (used by MQTT snapshot)
-const uint8_t* getDisplayBuffer();
+// Get frame number of the latest committed frame (increments on every commit)
+uint32_t getFrameSequence();
 
 // Get display buffer size in bytes
 uint16_t getDisplayBufferSize();
 
-// Create snapshot buffer for MQTT publishing (proxies to hardware-specific renderer)
-void createSnapshotBuffer();
-
 // Event-driven rendering support
-// Check if display needs to be re-rendered
+// Check if display needs to be re-rendered (any row dirty or activity pixel changed)
 bool isDisplayDirty();
 
-// Clear the dirty flag (called after rendering)
+// Get bitmask of rows whose text changed since the last render (bit N = row N)
+uint8_t getDirtyRowMask();
+
+// Check if only the activity pixel overlay needs refreshing
+bool isActivityPixelDirty();
+
+// Mark rows dirty without changing their text (e.g. to force a full redraw)
+void markRowsDirty(uint8_t rowMask);
+
+// Clear all dirty flags (called after rendering)
 void clearDirtyFlag();
 
 // Check if rendering is requested (for main loop polling)
@@ -104,7 +121,7 @@ void clearRenderRequest();
 // Get current update sequence number (for detecting concurrent setText() calls)
 uint32_t getUpdateSequence();
 
-// Atomically clear both flags ONLY if sequence hasn't changed since startSeq
+// Atomically clear all dirty flags ONLY if sequence hasn't changed since startSeq
 // Returns true if flags were cleared, false if concurrent update detected
 bool clearRenderFlagsIfUnchanged(uint32_t startSeq);
 
@@ -120,6 +137,48 @@ RenderCallback getRenderCallback();
 // Force immediate rendering of current display state
 void renderNow();
 
+// ============================================================================
+// MARQUEE API (scrolling text, rendered by the hardware renderer)
+// ============================================================================
+
+// Scroll `text` right-to-left across `row`, looping until stopMarquee()
+// The row's static text keeps updating underneath and is shown again after
+// Frames are paced by the MarqueeFrame timer (MARQUEE_FRAME_MS per pixel)
+void startMarquee(uint8_t row, const char* text);
+void stopMarquee(uint8_t row);
+
+// Bitmask of rows currently scrolling (bit N = row N)
+uint8_t getMarqueeRowMask();
+
+// Bitmask of scrolling rows due a new frame
+uint8_t getMarqueeFrameMask();
+
+// Renderer: copy the text of rows whose marquee changed since the last call
+// into dest (char[DISPLAY_ROWS][MAX_TEXT_LENGTH]) and return their mask
+uint8_t takeMarqueeChanges(char dest[][MAX_TEXT_LENGTH]);
+
+// ============================================================================
+// REMOTE FRAME API (pushed bitmaps, shown in place of all text)
+// ============================================================================
+
+// Show a pushed 1bpp bitmap in the frame buffer layout: pixel (x, y) of a row
+// is bit ((pixelOffset + y * width + x) % 8) of byte (.. / 8), LSB first.
+// length must equal getDisplayBufferSize(); returns false (nothing shown)
+// otherwise. Text, marquee and overlay updates are held back while it shows.
+// Single pusher: call from one context only (the MQTT callback)
+bool pushRemoteFrame(const uint8_t* data, uint16_t length);
+
+// Back to text rendering - every row is redrawn
+void clearRemoteFrame();
+
+// Check if a pushed bitmap is on the display
+bool isRemoteFrameActive();
+
+// Renderer: take the newly pushed bitmap (seed for beginFrame()), or nullptr
+// if nothing new was pushed since the last call. It stays valid until the
+// next call - pushes never write the slot the renderer holds
+const uint8_t* takeRemoteFrame();
+
 // ============================================================================
 // ACTIVITY PIXEL API (hardware-agnostic, used by renderers)
 // ============================================================================
@@ -132,4 +191,41 @@ void setActivityPixelVisible(bool visible);
 bool getActivityPixelVisible();
 #endif
 
+// ============================================================================
+// BRIGHTNESS API (set by display_brightness, applied by the renderer)
+// ============================================================================
+
+// Set the LED brightness scale (0-255, gamma already applied)
+// A change re-sends the current frame at the new scale without rebuilding it
+void setDisplayBrightness(uint8_t scale);
+
+// Requested LED brightness scale (before the renderer's power limit)
+uint8_t getDisplayBrightness();
+
+// Check if the brightness changed since the last render
+bool isBrightnessDirty();
+
+// Record the scale a frame was actually sent at, and whether the power
+// budget lowered it (called by renderers)
+void recordShownBrightness(uint8_t scale, bool powerLimited);
+
+// Scale of the last frame sent, and frames the power budget has dimmed
+void getShownBrightness(uint8_t& scale, uint32_t& powerLimitedFrames);
+
+// ============================================================================
+// RENDER TIMING API (recorded by renderers, read by telemetry)
+// ============================================================================
+
+// Record time spent building a frame (rasterising and expanding to LEDs)
+void recordFrameBuildTime(uint32_t us);
+
+// Record time spent pushing a frame out to the LEDs
+void recordFrameShowTime(uint32_t us);
+
+// Copy current frame build and show statistics
+void getRenderTimingStats(TimingStat& build, TimingStat& show);
+
+// Clear frame build and show statistics
+void resetRenderTimingStats();
+
 #endif
@@ -2,11 +2,23 @@
 // fastled_render.cpp - FastLED hardware rendering and font drawing
 // ============================================================================
 // This library handles the FastLED-specific rendering:
-// - Manages CRGB arrays for each display row
-// - Converts logical (x,y) coordinates to physical strip indices
-// - Handles 90° rotation and serpentine wiring patterns
-// - Renders 5x7 font glyphs with optional 2x smoothing
-// - Creates display snapshots for MQTT publishing
+// - Keeps every row's CRGB array in one pool sized from PANELS_PER_ROW, and
+//   registers a FastLED controller for each DISPLAY_PINS entry at compile time
+// - Pushes only changed rows to the strips (per-row show on ESP8266)
+// - Converts logical (x,y) coordinates to physical strip indices using
+//   compile-time panel lookup tables (see panel_layout.h for wiring layouts)
+// - Rasterises 5x7 font glyphs (optional 2x smoothing) into a 1bpp render buffer
+// - Caches final 2x glyph bitmaps at init (overrides + smoothing applied)
+// - Expands changed rows from the render buffer into the LED arrays in one pass
+// - Marquee rows: the message is pre-rendered once into a column strip, and
+//   each frame copies a row-wide window of it into the render buffer
+// - Remote frames: a pushed bitmap is already in render buffer layout, so it
+//   is copied into the back buffer as-is - no font work at all
+// - Commits every frame to display_core so MQTT snapshots are always current
+// - Sends frames at display_core's brightness, lowered when the whole display
+//   would draw more than POWER_BUDGET_MA (FastLED's power model, summed over
+//   every row - FastLED's own limiter only runs inside FastLED.show(), which
+//   the per-row ESP8266 path doesn't use)
 //
 // Drop-in replacement for neopixel_render - uses same function names
 // ============================================================================
@@ -17,41 +29,127 @@
 
 #include "fastled_render.h"        // This file's header
 #include "font_5x7_2x_overrides.h" // Hand-crafted 2x glyphs for problem characters
+#include "panel_layout.h"          // Compile-time strip index lookup tables
 
 // ============================================================================
 // COMPILE-TIME VALIDATION
 // ============================================================================
 
-#if DISPLAY_ROWS > 2
-  #error "FastLED renderer only supports up to 2 display rows. Add DISPLAY_PIN_ROWx macros and FastLED.addLeds() calls for additional rows."
+static_assert(DISPLAY_ROWS >= 1 && DISPLAY_ROWS <= 8, "Row dirty masks are 8-bit - DISPLAY_ROWS must be 1 to 8.");
+static_assert(getMaxPanelsPerRow() * PANEL_WIDTH <= 255, "Row x coordinates are 8-bit - rows must be 255 pixels wide or less.");
+static_assert(getTotalPixels() <= 0xFFFF, "Pixel offsets are 16-bit - the display must have 65535 pixels or fewer.");
+
+#if PANEL_HEIGHT > 16
+  #error "Marquee column strips hold one 16-bit mask per column - PANEL_HEIGHT must be 16 or less."
+#endif
+
+#if (PANEL_PIXELS % 8) != 0
+  #error "Panel pixel count must be a multiple of 8 so each row starts on a render buffer byte boundary."
 #endif
 
 // ============================================================================
 // GLOBAL VARIABLES
 // ============================================================================
 
-static CRGB row0Leds[PANEL_WIDTH * PANEL_HEIGHT * 8];
-static CRGB row1Leds[PANEL_WIDTH * PANEL_HEIGHT * 8];
-CRGB* rowLeds[DISPLAY_ROWS] = {row0Leds, row1Leds};
+// Every row's LEDs back-to-back, exactly as many as PANELS_PER_ROW configures
+static CRGB ledPool[getTotalPixels()];
+CRGB* rowLeds[DISPLAY_ROWS];
 uint16_t rowPixelCounts[DISPLAY_ROWS];
 
-uint8_t fastledRenderBuffer[MAX_DISPLAY_BUFFER_SIZE] = {0};
+// One controller per row so rows can be pushed to the wire independently
+static CLEDController* rowControllers[DISPLAY_ROWS];
+
+// Registers controllers for rows 0..ROWS-1. FastLED takes the data pin as a
+// template argument, so the rows are unrolled at compile time from
+// DISPLAY_PINS rather than written out per pin
+template<uint8_t ROWS>
+struct RowControllerRegistrar {
+  static void addAll() {
+    RowControllerRegistrar<ROWS - 1>::addAll();
+    rowControllers[ROWS - 1] = &FastLED.addLeds<NEOPIXEL, DISPLAY_PINS[ROWS - 1]>(rowLeds[ROWS - 1], rowPixelCounts[ROWS - 1]);
+  }
+};
+
+template<>
+struct RowControllerRegistrar<0> {
+  static void addAll() {}
+};
+
+// 1bpp back buffer for the frame in progress (from beginFrame()) - text is
+// drawn here, then expanded into rowLeds and committed to display_core
+static uint8_t* renderBuffer = nullptr;
 
 static CRGB displayColor;
 
+// Unscaled draw of each row at full brightness, in FastLED's power model (mW)
+static uint32_t rowPowerMw[DISPLAY_ROWS];
+
+// One lit LED (displayColor) and one dark LED in the same model, cached with
+// the colour so a row's power is a popcount of its render bits
+static uint32_t litLedMw = 0;
+static uint32_t darkLedMw = 0;
+
+// Scale the strips last received; a change means every row must be re-sent
+static uint8_t sentBrightness = 0;
+
 // ESP32-C3 RMT workaround: first frame needs double-show
 #ifdef ESP32
 static bool firstFramePending = true;
 #endif
 
+// ============================================================================
+// GLYPH CACHE
+// ============================================================================
+
+// Tallest 2x glyph (FONT_HEIGHT * 2, also the tallest override)
+#define GLYPH_CACHE_MAX_HEIGHT (FONT_HEIGHT * 2)
+
+// Final 2x bitmap for one glyph, built once at init
+// Each row is a bitmask with bit c set when column c is lit (bit 0 = leftmost)
+struct CachedGlyph {
+  uint8_t width;                            // Scaled width in pixels
+  uint8_t height;                           // Scaled height in pixels
+  uint16_t rows[GLYPH_CACHE_MAX_HEIGHT];    // Packed row bitmasks
+};
+
+static CachedGlyph glyphCache2x[GLYPH_COUNT];
+
+// ============================================================================
+// MARQUEE STRIPS
+// ============================================================================
+
+#define MARQUEE_GLYPH_MAX_WIDTH 10   // Widest 2x glyph (5 columns doubled)
+#define MARQUEE_SPACE_WIDTH 4        // Gap for characters the font has no glyph for
+#define MARQUEE_MAX_COLUMNS (MAX_TEXT_LENGTH * (MARQUEE_GLYPH_MAX_WIDTH + CHAR_SPACING))
+
+// A scrolling message, pre-rendered once: one bitmask per column (bit y =
+// pixel row y). The strip is followed by a row-wide blank gap, so the text
+// scrolls fully out before it re-enters from the right.
+struct MarqueeStrip {
+  uint16_t columns[MARQUEE_MAX_COLUMNS];
+  uint16_t length;                  // Text columns in use
+  uint16_t offset;                  // Strip column at the row's left edge
+};
+
+static MarqueeStrip marqueeStrips[DISPLAY_ROWS];
 
 // ============================================================================
 // FORWARD DECLARATIONS (internal functions)
 // ============================================================================
 
-static void setPixelRow(uint8_t rowIdx, uint8_t x, uint8_t y, CRGB color);
-static void drawGlyphForRow(uint8_t rowIdx, int glyphIndex, int x0, int y0, CRGB color, uint8_t scale);
-static void drawTextCenteredForRow(uint8_t rowIdx, const char *text, uint8_t y0, CRGB color, uint8_t scale);
+static void buildGlyphCache();
+static void showRows(uint8_t rowMask);
+static void updateRemoteFrame();
+static uint8_t limitToPowerBudget(uint8_t scale);
+static void clearRowBits(const RowConfig& rowCfg);
+static void expandRowToLeds(uint8_t rowIdx, const RowConfig& rowCfg);
+static uint32_t rowPowerFromBits(uint8_t rowIdx, const RowConfig& rowCfg);
+static uint8_t glyphWidth(int glyphIndex, uint8_t scale);
+static void setRenderBit(const RowConfig& rowCfg, uint8_t x, uint8_t y, bool on);
+static void drawGlyphForRow(const RowConfig& rowCfg, int glyphIndex, int x0, int y0, uint8_t scale);
+static void drawTextCenteredForRow(const RowConfig& rowCfg, const char *text, uint8_t y0, uint8_t scale);
+static void buildMarqueeStrip(MarqueeStrip& strip, const char* text, uint8_t y0);
+static void drawMarqueeWindow(const RowConfig& rowCfg, const MarqueeStrip& strip);
 
 // ============================================================================
 // INITIALIZATION
@@ -61,12 +159,20 @@ void initNeoPixels() {
   DisplayConfig cfg = getDisplayConfig();
   
   displayColor = CRGB(DISPLAY_COLOR_R, DISPLAY_COLOR_G, DISPLAY_COLOR_B);
+  CRGB dark = CRGB::Black;
+  darkLedMw = calculate_unscaled_power_mW(&dark, 1);
+  litLedMw = calculate_unscaled_power_mW(&displayColor, 1) - darkLedMw;
+  
+  // Pre-render 2x glyphs so frames only copy bits
+  buildGlyphCache();
   
   for (uint8_t i = 0; i < DISPLAY_ROWS; i++) {
     uint16_t rowPixels = cfg.rowConfig[i].width * cfg.rowConfig[i].height;
     rowPixelCounts[i] = rowPixels;
+    rowLeds[i] = ledPool + getRowPixelOffset(i);
     
     memset(rowLeds[i], 0, sizeof(CRGB) * rowPixels);
+    rowPowerMw[i] = calculate_unscaled_power_mW(rowLeds[i], rowPixels);
     
     DEBUG_PRINT("FastLED row ");
     DEBUG_PRINT(i + 1);
@@ -79,14 +185,10 @@ void initNeoPixels() {
     DEBUG_PRINTLN(") initialised.");
   }
   
-  #if DISPLAY_ROWS >= 1
-    FastLED.addLeds<NEOPIXEL, DISPLAY_PIN_ROW0>(rowLeds[0], rowPixelCounts[0]);
-  #endif
-  #if DISPLAY_ROWS >= 2
-    FastLED.addLeds<NEOPIXEL, DISPLAY_PIN_ROW1>(rowLeds[1], rowPixelCounts[1]);
-  #endif
+  RowControllerRegistrar<DISPLAY_ROWS>::addAll();
 
-  FastLED.setBrightness(BRIGHTNESS);
+  sentBrightness = getDisplayBrightness();
+  FastLED.setBrightness(sentBrightness);
   FastLED.setDither(0);  // Disable temporal dithering to prevent color artifacts at low brightness
   
   FastLED.clear();
@@ -105,47 +207,99 @@ void updateNeoPixels() {
     return;
   }
   
+  if (isRemoteFrameActive()) {
+    updateRemoteFrame();
+    return;
+  }
+  
+  uint32_t buildStart = micros();
   uint32_t startSeq = getUpdateSequence();
   
+  // Capture what changed: rows with new text, marquee steps, and/or the
+  // activity pixel overlay
+  // (marquee changes are taken before the row mask, so a marquee started
+  // in between is still rebuilt on the next pass)
+  char marqueeSnapshot[DISPLAY_ROWS][MAX_TEXT_LENGTH];
+  uint8_t marqueeChanged = takeMarqueeChanges(marqueeSnapshot);
+  uint8_t dirtyRows = getDirtyRowMask();
+  uint8_t marqueeRows = getMarqueeRowMask();
+  uint8_t marqueeFrames = getMarqueeFrameMask();
+  uint8_t showMask = 0;
+  
   char textSnapshot[DISPLAY_ROWS][MAX_TEXT_LENGTH];
   snapshotAllText(textSnapshot);
   
   DisplayConfig cfg = getDisplayConfig();
-  
-  memset(fastledRenderBuffer, 0, cfg.bufferSize);
+  renderBuffer = beginFrame();
   
   for (uint8_t rowIdx = 0; rowIdx < DISPLAY_ROWS; rowIdx++) {
-    const char* displayText = textSnapshot[rowIdx];
     RowConfig& rowCfg = cfg.rowConfig[rowIdx];
+    uint8_t rowBit = 1 << rowIdx;
+    bool rowDirty = (dirtyRows & rowBit) != 0;
     
-    memset(rowLeds[rowIdx], 0, sizeof(CRGB) * rowPixelCounts[rowIdx]);
-    
-    drawTextCenteredForRow(rowIdx, displayText, 1, displayColor, 2);
-    
-    for (uint16_t stripIdx = 0; stripIdx < rowPixelCounts[rowIdx]; stripIdx++) {
-      if (rowLeds[rowIdx][stripIdx]) {
-        uint8_t x, y;
-        indexToXY(stripIdx, x, y);
-        
-        uint16_t pixelIndex = rowCfg.pixelOffset + (y * rowCfg.width) + x;
-        uint16_t byteIndex = pixelIndex / 8;
-        uint8_t bitIndex = pixelIndex % 8;
-        fastledRenderBuffer[byteIndex] |= (1 << bitIndex);
+    if (marqueeRows & rowBit) {
+      // Marquee row: static text changes are held back until it stops
+      MarqueeStrip& strip = marqueeStrips[rowIdx];
+      if (marqueeChanged & rowBit) {
+        buildMarqueeStrip(strip, marqueeSnapshot[rowIdx], 1);
+        rowDirty = true;
+      } else if (marqueeFrames & rowBit) {
+        strip.offset = (strip.offset + 1) % (strip.length + rowCfg.width);
+        rowDirty = true;
+      }
+      if (rowDirty) {
+        drawMarqueeWindow(rowCfg, strip);
       }
+    } else if (rowDirty) {
+      // Re-rasterize this row only; untouched rows keep their LEDs and buffer bits
+      clearRowBits(rowCfg);
+      drawTextCenteredForRow(rowCfg, textSnapshot[rowIdx], 1, 2);
+    }
+    if (rowDirty) {
+      showMask |= rowBit;
     }
     
     #if ACTIVITY_PIXEL_ENABLED
     // Overlay activity pixel on bottom-right of the last row only
-    if (rowIdx == DISPLAY_ROWS - 1) {
+    // Applied after a redraw, or on its own when only the overlay changed
+    if (rowIdx == DISPLAY_ROWS - 1 && (rowDirty || isActivityPixelDirty())) {
       uint8_t activityX = rowCfg.width - 1;
       uint8_t activityY = ROW_HEIGHT - 1;
-      uint16_t activityIdx = xyToIndex(activityX, activityY);
-      rowLeds[rowIdx][activityIdx] = getActivityPixelVisible() ? displayColor : CRGB::Black;
+      bool visible = getActivityPixelVisible();
+      setRenderBit(rowCfg, activityX, activityY, visible);
+      if (!rowDirty) {
+        // Overlay-only change: patch the single LED instead of expanding the row
+        rowLeds[rowIdx][xyToIndex(activityX, activityY)] = visible ? displayColor : CRGB::Black;
+      }
+      showMask |= (1 << rowIdx);
     }
     #endif
+    
+    if (rowDirty) {
+      expandRowToLeds(rowIdx, rowCfg);
+    }
+    if (showMask & (1 << rowIdx)) {
+      rowPowerMw[rowIdx] = rowPowerFromBits(rowIdx, rowCfg);
+    }
   }
   
-  FastLED.show();
+  // Publish the finished frame so snapshots never need a rebuild
+  if (showMask != 0) {
+    commitFrame();
+  }
+  
+  // Brightness change alone: same LEDs, re-sent at the new scale
+  if (isBrightnessDirty()) {
+    showMask |= ALL_ROWS_MASK;
+  }
+  
+  uint32_t showStart = micros();
+  recordFrameBuildTime(showStart - buildStart);
+  
+  if (showMask != 0) {
+    showRows(showMask);
+    recordFrameShowTime(micros() - showStart);
+  }
   
   // ESP32-C3 RMT workaround: double-show the first content frame
   // The first FastLED.show() after init can fail to render the first strip
@@ -153,7 +307,7 @@ void updateNeoPixels() {
   #ifdef ESP32
   if (firstFramePending) {
     delayMicroseconds(200);
-    FastLED.show();
+    showRows(ALL_ROWS_MASK);
     firstFramePending = false;
     DEBUG_PRINTLN("First frame double-show complete (ESP32 RMT workaround)");
   }
@@ -163,32 +317,130 @@ void updateNeoPixels() {
   (void)allDone;
 }
 
-// ============================================================================
-// SNAPSHOT CREATION
-// ============================================================================
+// Remote frame mode: the pushed bitmap is the whole frame. Text, marquee and
+// overlay changes wait (display_core redraws them when the mode ends), so a
+// new bitmap costs one copy into the back buffer, one expand and one show.
+// Nothing is copied when no new bitmap came in.
+static void updateRemoteFrame() {
+  uint32_t buildStart = micros();
+  uint32_t startSeq = getUpdateSequence();
+  uint8_t showMask = 0;
+  
+  const uint8_t* pushed = takeRemoteFrame();
+  if (pushed != nullptr) {
+    renderBuffer = beginFrame(pushed);
+    DisplayConfig cfg = getDisplayConfig();
+    for (uint8_t rowIdx = 0; rowIdx < DISPLAY_ROWS; rowIdx++) {
+      expandRowToLeds(rowIdx, cfg.rowConfig[rowIdx]);
+      rowPowerMw[rowIdx] = rowPowerFromBits(rowIdx, cfg.rowConfig[rowIdx]);
+    }
+    commitFrame();
+    showMask = ALL_ROWS_MASK;
+  }
+  if (isBrightnessDirty()) {
+    showMask = ALL_ROWS_MASK;
+  }
+  
+  uint32_t showStart = micros();
+  recordFrameBuildTime(showStart - buildStart);
+  
+  if (showMask != 0) {
+    showRows(showMask);
+    recordFrameShowTime(micros() - showStart);
+  }
+  
+  clearRenderFlagsIfUnchanged(startSeq);
+}
 
-void createNeopixelSnapshot() {
-  DisplayConfig cfg = getDisplayConfig();
+// Push the given rows to their strips
+// ESP32: the RMT driver only transmits once every registered controller has
+// been started, and then drives all channels in parallel - so a full
+// FastLED.show() costs one row of wire time regardless of how many changed.
+// ESP8266: rows are bit-banged one after another, so only changed rows are sent.
+static void showRows(uint8_t rowMask) {
+  if (rowMask == 0) {
+    return;
+  }
   
-  memset(fastledRenderBuffer, 0, cfg.bufferSize);
+  uint8_t requested = getDisplayBrightness();
+  uint8_t brightness = limitToPowerBudget(requested);
+  if (brightness != sentBrightness) {
+    // Rows left out would stay at the old scale
+    rowMask = ALL_ROWS_MASK;
+    sentBrightness = brightness;
+  }
+  recordShownBrightness(brightness, brightness < requested);
   
-  for (uint8_t rowIdx = 0; rowIdx < DISPLAY_ROWS; rowIdx++) {
-    RowConfig& rowCfg = cfg.rowConfig[rowIdx];
-    
-    for (uint16_t stripIdx = 0; stripIdx < rowPixelCounts[rowIdx]; stripIdx++) {
-      if (rowLeds[rowIdx][stripIdx]) {
-        uint8_t x, y;
-        indexToXY(stripIdx, x, y);
-        
-        uint16_t pixelIndex = rowCfg.pixelOffset + (y * rowCfg.width) + x;
-        uint16_t byteIndex = pixelIndex / 8;
-        uint8_t bitIndex = pixelIndex % 8;
-        fastledRenderBuffer[byteIndex] |= (1 << bitIndex);
+  #if defined(ESP32)
+    FastLED.setBrightness(brightness);
+    FastLED.show();
+  #else
+    for (uint8_t rowIdx = 0; rowIdx < DISPLAY_ROWS; rowIdx++) {
+      if ((rowMask & (1 << rowIdx)) && rowControllers[rowIdx] != nullptr) {
+        rowControllers[rowIdx]->showLeds(brightness);
       }
     }
+  #endif
+}
+
+// Highest scale up to `scale` that keeps the frame within POWER_BUDGET_MA
+// Same proportional model as FastLED's calculate_max_brightness_for_power_mW()
+static uint8_t limitToPowerBudget(uint8_t scale) {
+  #if POWER_BUDGET_MA > 0
+    uint32_t unscaledMw = 0;
+    for (uint8_t rowIdx = 0; rowIdx < DISPLAY_ROWS; rowIdx++) {
+      unscaledMw += rowPowerMw[rowIdx];
+    }
+    
+    const uint32_t budgetMw = (uint32_t)POWER_BUDGET_MA * 5;  // 5 V supply
+    uint32_t requestedMw = (unscaledMw * scale) / 256;
+    if (requestedMw > budgetMw) {
+      return (uint8_t)((budgetMw * 256) / unscaledMw);
+    }
+  #endif
+  return scale;
+}
+
+// ============================================================================
+// RENDER BUFFER
+// ============================================================================
+
+// Clear one row's bits in the render buffer (rows are byte-aligned)
+static void clearRowBits(const RowConfig& rowCfg) {
+  memset(&renderBuffer[rowCfg.pixelOffset / 8], 0, (rowCfg.width * rowCfg.height) / 8);
+}
+
+// Unscaled power of a row from its render bits (rows are byte-aligned, and
+// every lit LED shows displayColor) - a byte popcount instead of a LED scan
+static uint32_t rowPowerFromBits(uint8_t rowIdx, const RowConfig& rowCfg) {
+  const uint8_t* bits = &renderBuffer[rowCfg.pixelOffset / 8];
+  uint16_t byteCount = rowPixelCounts[rowIdx] / 8;
+  uint32_t lit = 0;
+  for (uint16_t i = 0; i < byteCount; i++) {
+    lit += __builtin_popcount(bits[i]);
   }
+  return lit * litLedMw + rowPixelCounts[rowIdx] * darkLedMw;
+}
+
+// Write one row of the render buffer into its LED array
+// Walks the strip in order and looks each index's (x, y) up in the panel
+// tables, so there is no per-pixel divide or serpentine branch
+static void expandRowToLeds(uint8_t rowIdx, const RowConfig& rowCfg) {
+  CRGB* leds = rowLeds[rowIdx];
+  uint16_t stripIdx = 0;
   
-  commitBuffer(fastledRenderBuffer, cfg.bufferSize);
+  for (uint8_t panel = 0; panel < rowCfg.panels; panel++) {
+    uint16_t panelBase = rowCfg.pixelOffset + panel * PANEL_WIDTH;
+    
+    for (uint16_t localIdx = 0; localIdx < PANEL_PIXELS; localIdx++, stripIdx++) {
+      uint8_t x = readPanelLut(&ActivePanelLut::stripToX[localIdx]);
+      uint8_t y = readPanelLut(&ActivePanelLut::stripToY[localIdx]);
+      
+      uint16_t pixelIndex = panelBase + (y * rowCfg.width) + x;
+      bool on = renderBuffer[pixelIndex / 8] & (1 << (pixelIndex % 8));
+      leds[stripIdx] = on ? displayColor : CRGB::Black;
+    }
+  }
 }
 
 // ============================================================================
@@ -197,41 +449,17 @@ void createNeopixelSnapshot() {
 
 uint16_t xyToIndex(uint8_t x, uint8_t y) {
   uint8_t panel = x / PANEL_WIDTH;
-
   uint8_t localX = x % PANEL_WIDTH;
-  uint8_t localY = y;
-
-  uint8_t tX = localY;
-  uint8_t tY = localX;
-
-  uint16_t base = panel * (PANEL_WIDTH * PANEL_HEIGHT);
-
-  if (tY % 2 == 0) {
-    return base + tY * PANEL_HEIGHT + tX;
-  } else {
-    return base + tY * PANEL_HEIGHT + ((PANEL_HEIGHT - 1) - tX);
-  }
+  
+  return panel * PANEL_PIXELS + readPanelLut(&ActivePanelLut::toStrip[y * PANEL_WIDTH + localX]);
 }
 
 void indexToXY(uint16_t index, uint8_t &x, uint8_t &y) {
-  uint8_t panel = index / (PANEL_WIDTH * PANEL_HEIGHT);
+  uint8_t panel = index / PANEL_PIXELS;
+  uint16_t localIdx = index % PANEL_PIXELS;
   
-  uint16_t localIdx = index % (PANEL_WIDTH * PANEL_HEIGHT);
-  
-  uint8_t tY = localIdx / PANEL_HEIGHT;
-  uint8_t tX;
-  
-  if (tY % 2 == 0) {
-    tX = localIdx % PANEL_HEIGHT;
-  } else {
-    tX = (PANEL_HEIGHT - 1) - (localIdx % PANEL_HEIGHT);
-  }
-  
-  uint8_t localY = tX;
-  uint8_t localX = tY;
-  
-  x = panel * PANEL_WIDTH + localX;
-  y = localY;
+  x = panel * PANEL_WIDTH + readPanelLut(&ActivePanelLut::stripToX[localIdx]);
+  y = readPanelLut(&ActivePanelLut::stripToY[localIdx]);
 }
 
 // ============================================================================
@@ -271,7 +499,6 @@ void applySmoothScale2x(const uint8_t* glyphData,
                         uint8_t h0,
                         uint8_t out[][20])
 {
-  const uint8_t W = w0 * 2;
   const uint8_t H = h0 * 2;
 
   memset(out, 0, H * 20);
@@ -329,6 +556,65 @@ void applySmoothScale2x(const uint8_t* glyphData,
   }
 }
 
+// Build the 2x glyph cache from overrides (where present) or smoothed font data
+static void buildGlyphCache() {
+  static uint8_t glyphBuffer[GLYPH_CACHE_MAX_HEIGHT][20];
+  
+  for (uint8_t gi = 0; gi < GLYPH_COUNT; gi++) {
+    CachedGlyph& cached = glyphCache2x[gi];
+    memset(&cached, 0, sizeof(cached));
+    
+    const Glyph2xOverride* override = find2xOverride(gi);
+    if (override != nullptr) {
+      uint8_t overrideW = pgm_read_byte(&override->width);
+      uint8_t overrideH = pgm_read_byte(&override->height);
+      const uint8_t* overrideData = (const uint8_t*)pgm_read_ptr(&override->data);
+      
+      if (overrideH > GLYPH_CACHE_MAX_HEIGHT) overrideH = GLYPH_CACHE_MAX_HEIGHT;
+      cached.width = overrideW;
+      cached.height = overrideH;
+      
+      for (uint8_t r = 0; r < overrideH; r++) {
+        uint8_t bits = pgm_read_byte(&overrideData[r]);
+        for (uint8_t c = 0; c < overrideW; c++) {
+          if (bits & (1 << (overrideW - 1 - c))) {
+            cached.rows[r] |= (1 << c);
+          }
+        }
+      }
+      continue;
+    }
+    
+    const uint8_t w0 = FONT_WIDTH_TABLE[gi];
+    cached.width = w0 * 2;
+    cached.height = FONT_HEIGHT * 2;
+    
+    applySmoothScale2x(&FONT_5x7[gi][0], w0, FONT_HEIGHT, glyphBuffer);
+    
+    for (uint8_t r = 0; r < cached.height; r++) {
+      for (uint8_t c = 0; c < cached.width; c++) {
+        if (glyphBuffer[r][c]) {
+          cached.rows[r] |= (1 << c);
+        }
+      }
+    }
+  }
+  
+  DEBUG_PRINT("Glyph cache built (");
+  DEBUG_PRINT(GLYPH_COUNT);
+  DEBUG_PRINT(" glyphs, ");
+  DEBUG_PRINT(sizeof(glyphCache2x));
+  DEBUG_PRINTLN(" bytes)");
+}
+
+// Width of a glyph in pixels at the given scale (2x reads from the cache)
+static uint8_t glyphWidth(int glyphIndex, uint8_t scale) {
+  if (scale == 2) {
+    return glyphCache2x[glyphIndex].width;
+  }
+  return FONT_WIDTH_TABLE[glyphIndex] * scale;
+}
+
 // ============================================================================
 // DROP-CASE GLYPHS
 // ============================================================================
@@ -341,7 +627,7 @@ static inline bool isDropCaseGlyph(int glyphIndex) {
   return (FONT_FLAGS_TABLE[glyphIndex] & FLAG_DROP_CASE) != 0;
 }
 
-static inline int getDropCaseOffset(int glyphIndex, uint8_t scale) {
+static inline int getDropCaseOffset(int glyphIndex) {
   if (!isDropCaseGlyph(glyphIndex)) return 0;
   return 1;  // Always 1 pixel offset regardless of scale
 }
@@ -350,20 +636,20 @@ static inline int getDropCaseOffset(int glyphIndex, uint8_t scale) {
 // DRAWING PRIMITIVES
 // ============================================================================
 
-static void setPixelRow(uint8_t rowIdx, uint8_t x, uint8_t y, CRGB color) {
-  DisplayConfig cfg = getDisplayConfig();
-  if (rowIdx >= cfg.rows) return;
-  if (x >= cfg.rowConfig[rowIdx].width || y >= ROW_HEIGHT) return;
-  uint16_t idx = xyToIndex(x, y);
-  if (idx < rowPixelCounts[rowIdx]) {
-    rowLeds[rowIdx][idx] = color;
+static void setRenderBit(const RowConfig& rowCfg, uint8_t x, uint8_t y, bool on) {
+  if (x >= rowCfg.width || y >= rowCfg.height) return;
+  
+  uint16_t pixelIndex = rowCfg.pixelOffset + (y * rowCfg.width) + x;
+  if (on) {
+    renderBuffer[pixelIndex / 8] |= (1 << (pixelIndex % 8));
+  } else {
+    renderBuffer[pixelIndex / 8] &= ~(1 << (pixelIndex % 8));
   }
 }
 
-static void drawGlyphForRow(uint8_t rowIdx,
+static void drawGlyphForRow(const RowConfig& rowCfg,
                int glyphIndex,
                int x0, int y0,
-               CRGB color,
                uint8_t scale)
 {
   if (glyphIndex < 0) return;
@@ -372,41 +658,21 @@ static void drawGlyphForRow(uint8_t rowIdx,
   const uint8_t h0 = FONT_HEIGHT;
   
   // Apply drop-case offset for special glyphs (comma, etc.)
-  int yOffset = getDropCaseOffset(glyphIndex, scale);
+  int yOffset = getDropCaseOffset(glyphIndex);
   int y0Adjusted = y0 + yOffset;
 
   if (scale == 2) {
-    const Glyph2xOverride* override = find2xOverride(glyphIndex);
+    // Copy pre-rendered bits from the glyph cache
+    const CachedGlyph& cached = glyphCache2x[glyphIndex];
     
-    if (override != nullptr) {
-      uint8_t overrideW = pgm_read_byte(&override->width);
-      uint8_t overrideH = pgm_read_byte(&override->height);
-      const uint8_t* overrideData = (const uint8_t*)pgm_read_ptr(&override->data);
-      
-      for (uint8_t r = 0; r < overrideH; r++) {
-        uint8_t bits = pgm_read_byte(&overrideData[r]);
-        for (uint8_t c = 0; c < overrideW; c++) {
-          bool on = bits & (1 << (overrideW - 1 - c));
-          if (on) {
-            setPixelRow(rowIdx, x0 + c, y0Adjusted + r, color);
-          }
+    for (uint8_t r = 0; r < cached.height; r++) {
+      uint16_t bits = cached.rows[r];
+      for (uint8_t c = 0; bits != 0; c++, bits >>= 1) {
+        if (bits & 1) {
+          setRenderBit(rowCfg, x0 + c, y0Adjusted + r, true);
         }
       }
-      return;
     }
-    
-    const uint8_t W = w0 * 2;
-    const uint8_t H = h0 * 2;
-
-    static uint8_t glyphBuffer[14][20];
-
-    applySmoothScale2x(&FONT_5x7[glyphIndex][0], w0, h0, glyphBuffer);
-
-    for (uint8_t r = 0; r < H; r++)
-      for (uint8_t c = 0; c < W; c++)
-        if (glyphBuffer[r][c])
-          setPixelRow(rowIdx, x0 + c, y0Adjusted + r, color);
-
     return;
   }
 
@@ -418,9 +684,9 @@ static void drawGlyphForRow(uint8_t rowIdx,
 
       for (uint8_t dy=0; dy<scale; dy++)
       for (uint8_t dx=0; dx<scale; dx++)
-        setPixelRow(rowIdx, x0 + c*scale + dx,
-                          y0Adjusted + r*scale + dy,
-                          color);
+        setRenderBit(rowCfg, x0 + c*scale + dx,
+                             y0Adjusted + r*scale + dy,
+                             true);
     }
   }
 }
@@ -435,16 +701,7 @@ uint16_t textWidth(const char *text, uint8_t scale) {
   for (uint8_t i = 0; text[i] != '\0'; i++) {
     int gi = charToGlyph(text[i]);
     if (gi >= 0) {
-      if (scale == 2) {
-        const Glyph2xOverride* override = find2xOverride(gi);
-        if (override != nullptr) {
-          width += pgm_read_byte(&override->width);
-        } else {
-          width += FONT_WIDTH_TABLE[gi] * scale;
-        }
-      } else {
-        width += FONT_WIDTH_TABLE[gi] * scale;
-      }
+      width += glyphWidth(gi, scale);
 
       if (text[i+1] != '\0') {
         width += SPACING_SCALES ? (CHAR_SPACING * scale)
@@ -456,14 +713,12 @@ uint16_t textWidth(const char *text, uint8_t scale) {
   return width;
 }
 
-static void drawTextCenteredForRow(uint8_t rowIdx,
+static void drawTextCenteredForRow(const RowConfig& rowCfg,
                       const char *text,
                       uint8_t y0,
-                      CRGB color,
                       uint8_t scale)
 {
-  DisplayConfig cfg = getDisplayConfig();
-  uint16_t rowWidth = cfg.rowConfig[rowIdx].width;
+  uint16_t rowWidth = rowCfg.width;
   
   uint16_t w = textWidth(text, scale);
   int16_t x0 = (rowWidth - w) / 2;
@@ -471,19 +726,9 @@ static void drawTextCenteredForRow(uint8_t rowIdx,
   for (uint8_t i = 0; text[i] != '\0'; i++) {
     int gi = charToGlyph(text[i]);
     if (gi >= 0) {
-      drawGlyphForRow(rowIdx, gi, x0, y0, color, scale);
-
-      uint8_t charW;
-      if (scale == 2) {
-        const Glyph2xOverride* override = find2xOverride(gi);
-        if (override != nullptr) {
-          charW = pgm_read_byte(&override->width);
-        } else {
-          charW = FONT_WIDTH_TABLE[gi] * scale;
-        }
-      } else {
-        charW = FONT_WIDTH_TABLE[gi] * scale;
-      }
+      drawGlyphForRow(rowCfg, gi, x0, y0, scale);
+
+      uint8_t charW = glyphWidth(gi, scale);
       
       uint8_t spacing = SPACING_SCALES ? (CHAR_SPACING * scale)
                                        : CHAR_SPACING;
@@ -492,3 +737,73 @@ static void drawTextCenteredForRow(uint8_t rowIdx,
     }
   }
 }
+
+// ============================================================================
+// MARQUEE RENDERING
+// ============================================================================
+
+// Pre-render a message into column bitmasks from the glyph cache (2x)
+// Characters without a glyph (spaces, letters) leave a MARQUEE_SPACE_WIDTH gap
+static void buildMarqueeStrip(MarqueeStrip& strip, const char* text, uint8_t y0) {
+  memset(strip.columns, 0, sizeof(strip.columns));
+  uint16_t x = 0;
+  
+  for (uint8_t i = 0; text[i] != '\0' && x < MARQUEE_MAX_COLUMNS; i++) {
+    int gi = charToGlyph(text[i]);
+    if (gi < 0) {
+      x += MARQUEE_SPACE_WIDTH;
+      continue;
+    }
+    
+    const CachedGlyph& cached = glyphCache2x[gi];
+    uint8_t yTop = y0 + getDropCaseOffset(gi);
+    for (uint8_t r = 0; r < cached.height && yTop + r < ROW_HEIGHT; r++) {
+      uint16_t bits = cached.rows[r];
+      for (uint8_t c = 0; bits != 0; c++, bits >>= 1) {
+        if ((bits & 1) && x + c < MARQUEE_MAX_COLUMNS) {
+          strip.columns[x + c] |= (1 << (yTop + r));
+        }
+      }
+    }
+    x += cached.width + (SPACING_SCALES ? CHAR_SPACING * 2 : CHAR_SPACING);
+  }
+  
+  strip.length = x < MARQUEE_MAX_COLUMNS ? x : MARQUEE_MAX_COLUMNS;
+  strip.offset = strip.length;  // Start on the blank gap: text enters from the right
+}
+
+// Copy the row-wide window at the strip's offset into the render buffer
+static void drawMarqueeWindow(const RowConfig& rowCfg, const MarqueeStrip& strip) {
+  clearRowBits(rowCfg);
+  
+  uint16_t period = strip.length + rowCfg.width;
+  uint16_t column = strip.offset;
+  for (uint16_t x = 0; x < rowCfg.width; x++) {
+    uint16_t bits = column < strip.length ? strip.columns[column] : 0;
+    for (uint16_t pixelIndex = rowCfg.pixelOffset + x; bits != 0; bits >>= 1, pixelIndex += rowCfg.width) {
+      if (bits & 1) {
+        renderBuffer[pixelIndex / 8] |= (1 << (pixelIndex % 8));
+      }
+    }
+    if (++column == period) {
+      column = 0;
+    }
+  }
+}
+
+#if DISPLAY_BENCHMARK
+// Same rasterisation as updateNeoPixels(), redirected into a scratch buffer so
+// the benchmark can time drawTextCenteredForRow() alone. Render context only.
+void benchmarkDrawTextRow(uint8_t row, const char* text) {
+  static uint8_t scratch[MAX_DISPLAY_BUFFER_SIZE];
+  
+  DisplayConfig cfg = getDisplayConfig();
+  if (row >= cfg.rows) return;
+  
+  uint8_t* frameBuffer = renderBuffer;
+  renderBuffer = scratch;
+  clearRowBits(cfg.rowConfig[row]);
+  drawTextCenteredForRow(cfg.rowConfig[row], text, 1, 2);
+  renderBuffer = frameBuffer;
+}
+#endif
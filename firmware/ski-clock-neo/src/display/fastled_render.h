@@ -10,11 +10,8 @@
 extern CRGB* rowLeds[DISPLAY_ROWS];
 extern uint16_t rowPixelCounts[DISPLAY_ROWS];
 
-extern uint8_t fastledRenderBuffer[MAX_DISPLAY_BUFFER_SIZE];
-
 void initNeoPixels();
 void updateNeoPixels();
-void createNeopixelSnapshot();
 
 int charToGlyph(char c);
 uint16_t xyToIndex(uint8_t x, uint8_t y);
@@ -23,4 +20,9 @@ void applySmoothScale2x(const uint8_t* glyphData, uint8_t w0, uint8_t h0, uint8_
 
 uint16_t textWidth(const char *text, uint8_t scale);
 
+#if DISPLAY_BENCHMARK
+// Rasterise one row's text into a scratch buffer (never shown or committed)
+void benchmarkDrawTextRow(uint8_t row, const char* text);
+#endif
+
 #endif
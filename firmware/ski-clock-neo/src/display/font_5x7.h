@@ -248,6 +248,9 @@ const uint8_t FONT_FLAGS_TABLE[] = {
   FLAG_DROP_CASE  // ',' (renders below baseline)
 };
 
+// Number of glyphs in the font (must match GlyphIndex enum order)
+const uint8_t GLYPH_COUNT = sizeof(FONT_5x7) / sizeof(FONT_5x7[0]);
+
 // Font dimensions
 const uint8_t FONT_HEIGHT = 7;
 const uint8_t CHAR_SPACING = 1;
@@ -0,0 +1,145 @@
+#ifndef PANEL_LAYOUT_H
+#define PANEL_LAYOUT_H
+
+#include <Arduino.h>                    // Core Arduino functionality for uint8_t, PROGMEM
+#include "../../ski-clock-neo_config.h" // Import panel dimensions and PANEL_LAYOUT
+
+// ============================================================================
+// Panel Wiring Layouts
+// ============================================================================
+// Maps a logical pixel (x, y) inside one panel to its position on the LED
+// strip, for each supported wiring pattern. The active layout is selected with
+// PANEL_LAYOUT in ski-clock-neo_config.h, and lookup tables for it are
+// generated at compile time so the renderer never divides per pixel.
+//
+// Each mapper provides (all constexpr, C++11 single-expression form):
+//   localIndex(x, y) - strip index within the panel for logical (x, y)
+//   localX(i)        - logical x for strip index i within the panel
+//   localY(i)        - logical y for strip index i within the panel
+// ============================================================================
+
+#define PANEL_PIXELS (PANEL_WIDTH * PANEL_HEIGHT)
+
+template<uint8_t LAYOUT, uint8_t W, uint8_t H>
+struct PanelMapper;
+
+// Columns of H pixels, odd columns run bottom-to-top (90° rotated serpentine)
+template<uint8_t W, uint8_t H>
+struct PanelMapper<PANEL_LAYOUT_COLUMN_SERPENTINE, W, H> {
+  static constexpr uint16_t localIndex(uint8_t x, uint8_t y) {
+    return (x % 2 == 0) ? (x * H + y) : (x * H + (H - 1 - y));
+  }
+  static constexpr uint8_t localX(uint16_t i) {
+    return i / H;
+  }
+  static constexpr uint8_t localY(uint16_t i) {
+    return ((i / H) % 2 == 0) ? (i % H) : (H - 1 - (i % H));
+  }
+};
+
+// Columns of H pixels, all running top-to-bottom
+template<uint8_t W, uint8_t H>
+struct PanelMapper<PANEL_LAYOUT_COLUMN_PROGRESSIVE, W, H> {
+  static constexpr uint16_t localIndex(uint8_t x, uint8_t y) {
+    return x * H + y;
+  }
+  static constexpr uint8_t localX(uint16_t i) {
+    return i / H;
+  }
+  static constexpr uint8_t localY(uint16_t i) {
+    return i % H;
+  }
+};
+
+// Rows of W pixels, odd rows run right-to-left
+template<uint8_t W, uint8_t H>
+struct PanelMapper<PANEL_LAYOUT_ROW_SERPENTINE, W, H> {
+  static constexpr uint16_t localIndex(uint8_t x, uint8_t y) {
+    return (y % 2 == 0) ? (y * W + x) : (y * W + (W - 1 - x));
+  }
+  static constexpr uint8_t localX(uint16_t i) {
+    return ((i / W) % 2 == 0) ? (i % W) : (W - 1 - (i % W));
+  }
+  static constexpr uint8_t localY(uint16_t i) {
+    return i / W;
+  }
+};
+
+// Rows of W pixels, all running left-to-right
+template<uint8_t W, uint8_t H>
+struct PanelMapper<PANEL_LAYOUT_ROW_PROGRESSIVE, W, H> {
+  static constexpr uint16_t localIndex(uint8_t x, uint8_t y) {
+    return y * W + x;
+  }
+  static constexpr uint8_t localX(uint16_t i) {
+    return i % W;
+  }
+  static constexpr uint8_t localY(uint16_t i) {
+    return i / W;
+  }
+};
+
+typedef PanelMapper<PANEL_LAYOUT, PANEL_WIDTH, PANEL_HEIGHT> ActivePanelMapper;
+
+// ============================================================================
+// Compile-time Lookup Tables
+// ============================================================================
+
+// Strip index within a panel fits a byte for panels up to 256 pixels
+template<bool SMALL> struct PanelIndexType { typedef uint16_t type; };
+template<> struct PanelIndexType<true> { typedef uint8_t type; };
+typedef PanelIndexType<(PANEL_PIXELS <= 256)>::type PanelLocalIndex;
+
+// Integer sequence 0..N-1 (log-depth so large panels stay under template depth limits)
+template<uint16_t... I> struct PanelSeq {};
+
+template<typename A, typename B> struct PanelSeqConcat;
+template<uint16_t... A, uint16_t... B>
+struct PanelSeqConcat<PanelSeq<A...>, PanelSeq<B...> > {
+  typedef PanelSeq<A..., (sizeof...(A) + B)...> type;
+};
+
+template<uint16_t N>
+struct MakePanelSeq {
+  typedef typename PanelSeqConcat<typename MakePanelSeq<N / 2>::type,
+                                  typename MakePanelSeq<N - N / 2>::type>::type type;
+};
+template<> struct MakePanelSeq<0> { typedef PanelSeq<> type; };
+template<> struct MakePanelSeq<1> { typedef PanelSeq<0> type; };
+
+template<typename Seq> struct PanelLut;
+
+template<uint16_t... I>
+struct PanelLut<PanelSeq<I...> > {
+  static const PanelLocalIndex toStrip[PANEL_PIXELS];  // [y * PANEL_WIDTH + x] -> strip index in panel
+  static const uint8_t stripToX[PANEL_PIXELS];         // strip index in panel -> logical x
+  static const uint8_t stripToY[PANEL_PIXELS];         // strip index in panel -> logical y
+};
+
+template<uint16_t... I>
+const PanelLocalIndex PanelLut<PanelSeq<I...> >::toStrip[PANEL_PIXELS] PROGMEM = {
+  (PanelLocalIndex)ActivePanelMapper::localIndex(I % PANEL_WIDTH, I / PANEL_WIDTH)...
+};
+
+template<uint16_t... I>
+const uint8_t PanelLut<PanelSeq<I...> >::stripToX[PANEL_PIXELS] PROGMEM = {
+  ActivePanelMapper::localX(I)...
+};
+
+template<uint16_t... I>
+const uint8_t PanelLut<PanelSeq<I...> >::stripToY[PANEL_PIXELS] PROGMEM = {
+  ActivePanelMapper::localY(I)...
+};
+
+typedef PanelLut<MakePanelSeq<PANEL_PIXELS>::type> ActivePanelLut;
+
+// PROGMEM readers for either index width
+inline uint16_t readPanelLut(const uint8_t* entry) {
+  return pgm_read_byte(entry);
+}
+
+inline uint16_t readPanelLut(const uint16_t* entry) {
+  return pgm_read_word(entry);
+}
+
+#endif
@@ -0,0 +1,78 @@
+// ============================================================================
+// display_host_bench.cpp - Display benchmarks and golden frames on the host
+// ============================================================================
+// Runs the same benchmark and golden-frame check as the on-device "bench"
+// command (display_bench.cpp), against the real display sources compiled for
+// x86 with the shims in shims/. The display is driven exactly as on ESP8266:
+// initDisplay(), then updateTimers() until the render callback has run the
+// requested benchmark.
+//
+// Exit status is non-zero when a golden frame mismatches or is skipped, so
+// ctest catches glyph and layout regressions without hardware.
+// Snapshot encoding is only timed on the device (it lives in mqtt_client).
+// ============================================================================
+
+// ============================================================================
+// INCLUDES
+// ============================================================================
+
+#include "../../src/display/display_core.h"   // initDisplay(), render loop
+#include "../../src/display/display_bench.h"  // Benchmark request and report
+#include "../../src/core/timer_helpers.h"     // updateTimers()
+
+// Timer passes before giving up on the render callback
+#define HOST_MAX_TIMER_PASSES 100000
+
+// ============================================================================
+// HELPERS
+// ============================================================================
+
+static bool pumpUntilReport(DisplayBenchmarkReport& report) {
+  for (uint32_t pass = 0; pass < HOST_MAX_TIMER_PASSES; pass++) {
+    updateTimers();
+    if (takeDisplayBenchmarkReport(report)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void printReport(const DisplayBenchmarkReport& report) {
+  printf("\n%-18s %6s %10s %10s %10s %12s\n", "benchmark", "calls", "min us", "avg us", "max us", "ns/call");
+  for (uint8_t i = 0; i < report.resultCount; i++) {
+    const BenchmarkResult& result = report.results[i];
+    uint32_t average = timingAverage(result.sample);
+    double perCall = result.calls > 0 ? average * 1000.0 / result.calls : 0.0;
+    printf("%-18s %6u %10u %10u %10u %12.1f\n", result.name, result.calls,
+           timingMinimum(result.sample), average, result.sample.maxUs, perCall);
+  }
+
+  if (report.goldenSkipped) {
+    printf("\ngolden frames: skipped (not the reference panel geometry)\n");
+  } else {
+    printf("\ngolden frames: %u passed, %u failed (mask 0x%02X)\n",
+           report.goldenPassed, report.goldenFailed, report.goldenFailMask);
+  }
+}
+
+// ============================================================================
+// MAIN
+// ============================================================================
+
+int main() {
+  initDisplay();
+
+  if (!requestDisplayBenchmark()) {
+    printf("ERROR: benchmark request rejected\n");
+    return 2;
+  }
+
+  DisplayBenchmarkReport report;
+  if (!pumpUntilReport(report)) {
+    printf("ERROR: render callback never ran the benchmark\n");
+    return 2;
+  }
+
+  printReport(report);
+  return (report.goldenSkipped || report.goldenFailed > 0) ? 1 : 0;
+}
@@ -0,0 +1,79 @@
+// ============================================================================
+// host_fakes.cpp - Fixed data providers for the host display build
+// ============================================================================
+// The display controller pulls time, date and temperature from the data
+// modules, which need real hardware (RTC, OneWire, button GPIO). These
+// stand-ins return fixed values so every host run renders the same frames.
+// Events are counted instead of queued for MQTT.
+// ============================================================================
+
+// ============================================================================
+// INCLUDES
+// ============================================================================
+
+#include "../../src/data/data_time.h"            // Faked: time provider
+#include "../../src/data/data_temperature.h"     // Faked: temperature provider
+#include "../../src/data/data_button.h"          // Faked: button input
+#include "../../src/core/event_log.h"            // Faked: event queue
+#include "../../src/display/display_brightness.h" // Faked: brightness control
+
+// ============================================================================
+// TIME
+// ============================================================================
+
+void initTimeData() {}
+bool isTimeSynced() { return true; }
+bool isRtcAvailable() { return false; }
+void setTimeChangeCallback(TimeChangeCallback) {}
+
+bool formatTime(char* output, size_t outputSize) {
+  snprintf(output, outputSize, "12:34");
+  return true;
+}
+
+bool formatDate(char* output, size_t outputSize) {
+  snprintf(output, outputSize, "14-10");
+  return true;
+}
+
+bool getLocalHour(uint8_t* hour) {
+  *hour = 12;
+  return true;
+}
+
+// ============================================================================
+// TEMPERATURE
+// ============================================================================
+
+void initTemperatureData() {}
+
+bool formatTemperature(char* output, size_t outputSize) {
+  snprintf(output, outputSize, "-5,2*C");
+  return true;
+}
+
+// ============================================================================
+// BUTTON
+// ============================================================================
+
+void initButton() {}
+void updateButton() {}
+void clearButtonPressed() {}
+void setButtonPressCallback(ButtonCallback) {}
+
+// ============================================================================
+// EVENTS AND BRIGHTNESS
+// ============================================================================
+
+uint32_t hostEventCount = 0;
+
+void logEvent(EventKind, EventValue, EventValue) {
+  hostEventCount++;
+}
+
+void logEventWithString(EventKind, const char*, EventValue, EventValue) {
+  hostEventCount++;
+}
+
+// The display starts at BRIGHTNESS; the schedule and light sensor aren't modelled
+void initBrightness() {}
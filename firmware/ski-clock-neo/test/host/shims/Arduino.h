@@ -0,0 +1,82 @@
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+// ============================================================================
+// Host shim for the Arduino core - just what the display pipeline uses
+// ============================================================================
+// The host build compiles as ESP8266 (single loop context, interrupts as the
+// critical section), so no FreeRTOS shim is needed. Serial goes to stdout.
+// ============================================================================
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <string>
+#include "binary.h"  // B0 ... B11111111 literals used by the font tables
+
+// Flash access is plain memory on the host
+#define PROGMEM
+#define IRAM_ATTR
+#define ICACHE_RAM_ATTR
+#define pgm_read_byte(p) (*(const uint8_t*)(p))
+#define pgm_read_word(p) (*(const uint16_t*)(p))
+#define pgm_read_dword(p) (*(const uint32_t*)(p))
+#define pgm_read_ptr(p) (*(void* const*)(p))
+#define memcpy_P memcpy
+
+#define HEX 16
+#define DEC 10
+
+// Timing (host steady clock, starting at 0 when the program starts)
+uint32_t millis();
+uint32_t micros();
+inline void delay(uint32_t) {}
+inline void delayMicroseconds(uint32_t) {}
+inline void yield() {}
+
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+template<class T> T min(T a, T b) { return a < b ? a : b; }
+template<class T> T max(T a, T b) { return a > b ? a : b; }
+
+class String {
+public:
+  String() {}
+  String(const char* str) : value(str ? str : "") {}
+  String(unsigned long number, int base = DEC) {
+    char digits[24];
+    snprintf(digits, sizeof(digits), base == HEX ? "%lX" : "%lu", number);
+    value = digits;
+  }
+  const char* c_str() const { return value.c_str(); }
+  unsigned int length() const { return value.size(); }
+
+private:
+  std::string value;
+};
+
+class HostSerial {
+public:
+  void begin(unsigned long) {}
+  void print(const char* str) { fputs(str, stdout); }
+  void print(const String& str) { fputs(str.c_str(), stdout); }
+  void print(char c) { fputc(c, stdout); }
+  void print(unsigned char n) { ::printf("%u", n); }
+  void print(int n) { ::printf("%d", n); }
+  void print(unsigned int n) { ::printf("%u", n); }
+  void print(long n) { ::printf("%ld", n); }
+  void print(unsigned long n) { ::printf("%lu", n); }
+  void print(double n) { ::printf("%.2f", n); }
+  template<class T> void println(T value) { print(value); println(); }
+  void println() { fputc('\n', stdout); }
+  template<class... Args> void printf(const char* format, Args... args) { ::printf(format, args...); }
+};
+
+extern HostSerial Serial;
+
+#endif
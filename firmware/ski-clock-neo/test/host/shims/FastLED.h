@@ -0,0 +1,79 @@
+#ifndef FASTLED_H
+#define FASTLED_H
+
+// ============================================================================
+// Host shim for FastLED - LED arrays are real, show() only counts frames
+// ============================================================================
+
+#include <Arduino.h>
+
+struct CRGB {
+  enum HTMLColorCode { Black = 0x000000 };
+
+  uint8_t r, g, b;
+
+  CRGB() : r(0), g(0), b(0) {}
+  CRGB(uint8_t red, uint8_t green, uint8_t blue) : r(red), g(green), b(blue) {}
+  CRGB(HTMLColorCode code) : r((code >> 16) & 0xFF), g((code >> 8) & 0xFF), b(code & 0xFF) {}
+
+  bool operator==(const CRGB& other) const { return r == other.r && g == other.g && b == other.b; }
+  bool operator!=(const CRGB& other) const { return !(*this == other); }
+};
+
+// Chipset tag for addLeds<NEOPIXEL, PIN>()
+enum { NEOPIXEL };
+
+class CLEDController {
+public:
+  CLEDController() : leds(nullptr), count(0), shows(0) {}
+  void showLeds(uint8_t) { shows++; }
+
+  CRGB* leds;
+  int count;
+  uint32_t shows;
+};
+
+#define HOST_FASTLED_MAX_CONTROLLERS 8
+
+class CFastLED {
+public:
+  CFastLED() : controllerCount(0), brightness(255), shows(0) {}
+
+  template<int CHIPSET, uint8_t DATA_PIN>
+  CLEDController& addLeds(CRGB* leds, int count) {
+    CLEDController& controller = controllers[controllerCount++ % HOST_FASTLED_MAX_CONTROLLERS];
+    controller.leds = leds;
+    controller.count = count;
+    return controller;
+  }
+
+  void setBrightness(uint8_t scale) { brightness = scale; }
+  uint8_t getBrightness() const { return brightness; }
+  void setDither(uint8_t) {}
+  void clear() {
+    for (uint8_t i = 0; i < controllerCount && i < HOST_FASTLED_MAX_CONTROLLERS; i++) {
+      for (int led = 0; led < controllers[i].count; led++) controllers[i].leds[led] = CRGB::Black;
+    }
+  }
+  void show() { shows++; }
+
+  CLEDController controllers[HOST_FASTLED_MAX_CONTROLLERS];
+  uint8_t controllerCount;
+  uint8_t brightness;
+  uint32_t shows;
+};
+
+extern CFastLED FastLED;
+
+// FastLED's power model at 5 V: 16/11/15 mA per full R/G/B channel, 1 mA idle per LED
+inline uint32_t calculate_unscaled_power_mW(const CRGB* leds, uint16_t count) {
+  uint32_t red = 0, green = 0, blue = 0;
+  for (uint16_t i = 0; i < count; i++) {
+    red += leds[i].r;
+    green += leds[i].g;
+    blue += leds[i].b;
+  }
+  return (red * 16 * 5 + green * 11 * 5 + blue * 15 * 5) / 256 + count * 5;
+}
+
+#endif
@@ -0,0 +1,22 @@
+// ============================================================================
+// host_arduino.cpp - Definitions behind the Arduino and FastLED host shims
+// ============================================================================
+
+#include <Arduino.h>  // Shim declarations
+#include <FastLED.h>  // Shim declarations
+#include <chrono>     // For millis()/micros()
+
+HostSerial Serial;
+CFastLED FastLED;
+
+static const std::chrono::steady_clock::time_point hostStart = std::chrono::steady_clock::now();
+
+uint32_t millis() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now() - hostStart).count();
+}
+
+uint32_t micros() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - hostStart).count();
+}